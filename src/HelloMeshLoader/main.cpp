@@ -1,20 +1,45 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #define VMA_IMPLEMENTATION
 #define VMA_VULKAN_VERSION 1000000
 #include "vk_mem_alloc.h"
 #include <GLFW/glfw3.h>
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <VkBootstrap.h>
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 #include <spdlog/spdlog.h>
+#include <lve_archive.hpp>
+#include <lve_asset_manager.hpp>
+#include <lve_cooked_mesh.hpp>
+#include <lve_frame_telemetry.hpp>
+#include <lve_frustum_culling.hpp>
+#include <lve_gltf.hpp>
+#include <lve_job_system.hpp>
+#include <lve_mesh_normals.hpp>
+#include <lve_paged_mesh.hpp>
+#include <lve_task.hpp>
 
 class HelloMeshLoader
 {
 public:
     void run()
     {
+        start_time = std::chrono::steady_clock::now();
         init();
         renderLoop();
         cleanup();
@@ -28,11 +53,15 @@ private:
     vkb::Instance vkb_instance{};
     VkSurfaceKHR surface{};
     vkb::Device vkb_device{};
+    vkb::DispatchTable disp{};
     VkQueue graphics_queue{};
     vkb::Swapchain vkb_swapchain{};
     std::vector<VkImageView> swapchain_image_views{};
     VkPipelineShaderStageCreateInfo shader_stage_cis[2]{};
+    VkPipelineShaderStageCreateInfo prepass_stage_ci{};
     VkPipeline graphics_pipeline{};
+    // Depth-only pass over the position stream, followed by shading with an EQUAL depth test
+    VkPipeline prepass_pipeline{}, equal_pipeline{};
     VkPipelineLayout pipeline_layout{};
     VkRenderPass render_pass{};
     VkCommandPool command_pool{};
@@ -42,14 +71,124 @@ private:
     {
         VkBuffer buffer;
         VmaAllocation allocation;
-    } data_buffer{};
-    tinyobj::attrib_t attrib;
+    };
+    // Interleaved vertices, positions alone for the depth pre-pass and indices of every mesh.
+    // VMA virtual blocks hand out the ranges, so the scene binds once and one indirect draw
+    // covers all meshes.
+    struct GeometryPool
+    {
+        Buffer vertices;
+        Buffer positions;
+        Buffer indices;
+        VmaVirtualBlock vertex_block;
+        VmaVirtualBlock index_block;
+        uint32_t vertex_capacity;
+        uint32_t index_capacity;
+    } geometry{};
+    const uint32_t POOL_VERTICES = 1 << 20, POOL_INDICES = 1 << 22;
+    // Ranges of a mesh in the geometry pool, its positions share the vertex range
+    struct Mesh
+    {
+        VmaVirtualAllocation vertex_allocation;
+        VmaVirtualAllocation index_allocation;
+        uint32_t vertex_offset, vertex_count;
+        uint32_t first_index, index_count;
+    };
+    // Meshes are assets interned by path. Each scene slot draws the placeholder until its first mesh
+    // has streamed in, afterwards its current mesh until a requested one is resident.
+    const size_t SLOT_COUNT = 2;
+    lve::LveAssetManager assets{};
+    lve::LveAssetId placeholder_id{};
+    std::vector<std::string> mesh_paths{};
+    std::unordered_map<lve::LveAssetId, Mesh> meshes{};
+    std::vector<lve::LveAssetId> mesh_slots{}, slot_requests{};
+    size_t mesh_cycle{};
+    bool cycle_key_down{};
+    // Edges of OBJ files without normals sharper than this keep a normal per side
+    float crease_angle{lve::LveMeshNormals::NO_CREASE};
+    // Pool bytes resident meshes may hold, unreferenced meshes beyond it are evicted
+    uint64_t mesh_budget{};
+    bool memory_budget_supported{};
+    // Compaction moves every mesh, it waits until no upload holds ranges of the current pool
+    uint32_t uploads_in_flight{};
+    bool defragmenting{};
+    // PAGED_MESH renders a single mesh out of core instead of the slots. Its clusters stream from a
+    // page file into a pool of PAGE_POOL_PAGES fixed-size pages, each page slot one draw.
+    std::unique_ptr<lve::LvePageFile> page_file{};
+    std::unique_ptr<lve::LvePageTable> page_table{};
+    lve::LveFrustumCulling page_culling{};
+    std::vector<uint32_t> visible_pages{};
+    std::vector<std::pair<float, uint32_t>> page_priorities{};
+    // Visible clusters without a resident page this frame, and the cluster of every draw
+    std::vector<uint32_t> missing_pages{};
+    std::vector<uint32_t> drawn_pages{};
+    glm::vec4 page_bounds{};
+    float page_error_pixels{1.0f};
+    float orbit_angle{};
+    const uint32_t MAX_PAGE_LOADS = 32;
+    uint32_t page_loads_in_flight{};
+    struct Image
+    {
+        VkImage image;
+        VmaAllocation allocation;
+    } depth_image{};
+    VkImageView depth_image_view{};
+    VkFormat depth_format{};
     struct Vertex
     {
         glm::vec3 position;
         glm::vec3 color;
     };
-    size_t vertex_count{}, data_size{};
+    struct MeshData
+    {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+    // Mesh waiting in a staging buffer for its copy into the geometry pool
+    struct StagedMesh
+    {
+        Buffer staging;
+        uint32_t vertex_count, index_count;
+    };
+    // Packed per-instance transform, rotation is a quaternion and scale is uniform
+    struct Instance
+    {
+        glm::vec4 position_scale;
+        glm::vec4 rotation;
+    };
+    std::vector<Instance> scene{};
+    Buffer instance_buffer{};
+    // Mesh slot of each instance, instances are grouped by slot so each slot is one draw
+    std::vector<uint32_t> scene_slots{}, slot_instance_counts{};
+    std::vector<VkDrawIndexedIndirectCommand> draws{};
+    Buffer draw_buffer{};
+    bool multi_draw_indirect{};
+    glm::mat4 view_proj{1.0f};
+    glm::vec3 eye{};
+    bool depth_prepass{}, depth_prepass_key_down{};
+    bool front_to_back{true}, sort_key_down{};
+    VkQueryPool statistics_pool{};
+    bool statistics_supported{}, statistics_enabled{}, statistics_key_down{};
+    uint64_t statistics_frames{};
+    // Last counts and sample count per scene configuration, written on exit in the layout of
+    // LvePipelineStatistics::writeJson
+    struct SceneStatistics
+    {
+        std::string name;
+        uint64_t counters[4];
+        uint64_t sample_count;
+    };
+    std::vector<SceneStatistics> scene_statistics{};
+    lve::LveFrameTelemetry frame_telemetry{};
+    // Time spent recording command buffers this frame, wherever they were re-recorded
+    std::chrono::steady_clock::duration record_time{};
+    std::chrono::steady_clock::time_point start_time{};
+    // Asset coroutines resume on the render loop through this, frame serials count submits
+    lve::LveFrameScheduler frame_scheduler{};
+    uint64_t submitted_frames{}, completed_frames{};
+    std::vector<lve::LveTask<>> asset_tasks{};
+    // Upload command buffers recorded since the last submit, sent ahead of the frame's commands
+    std::vector<VkCommandBuffer> submit_batch{};
 
     inline void check(auto val, const char *msg)
     {
@@ -85,6 +224,14 @@ private:
         spdlog::info("VkBootstrap: Initialize");
 
         vkb::InstanceBuilder vkb_inst_buildr{};
+        // VK_EXT_memory_budget needs physical device properties 2, an extension on Vulkan 1.0
+        auto system_info_ret = vkb::SystemInfo::get_system_info();
+        bool properties2_supported =
+            system_info_ret && system_info_ret.value().is_extension_available(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        if (properties2_supported)
+        {
+            vkb_inst_buildr.enable_extension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        }
 #ifdef NDEBUG
         auto inst_ret = vkb_inst_buildr.set_app_name("HelloMeshLoader").build();
 #else
@@ -103,12 +250,32 @@ private:
         auto phys_dev_ret = vkb_phys_dev_selectr.set_minimum_version(1, 0).set_surface(surface).select();
         check(phys_dev_ret, "Vulkan: Failed to select physical device");
 
+        // Pipeline statistics are optional instrumentation, enable them only if present
+        VkPhysicalDeviceFeatures supported_features{};
+        vkGetPhysicalDeviceFeatures(phys_dev_ret.value().physical_device, &supported_features);
+        if (supported_features.pipelineStatisticsQuery)
+        {
+            VkPhysicalDeviceFeatures statistics_features{.pipelineStatisticsQuery = VK_TRUE};
+            statistics_supported = phys_dev_ret.value().enable_features_if_present(statistics_features);
+        }
+        // One indirect call for every mesh needs several draws per call with their own instance ranges
+        if (supported_features.multiDrawIndirect && supported_features.drawIndirectFirstInstance)
+        {
+            VkPhysicalDeviceFeatures indirect_features{.multiDrawIndirect = VK_TRUE, .drawIndirectFirstInstance = VK_TRUE};
+            multi_draw_indirect = phys_dev_ret.value().enable_features_if_present(indirect_features);
+        }
+        // Real heap budgets instead of VMA's estimate from heap sizes
+        memory_budget_supported =
+            properties2_supported && phys_dev_ret.value().enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
         vkb::DeviceBuilder vkb_dev_buildr{phys_dev_ret.value()};
         auto dev_ret = vkb_dev_buildr.build();
         check(dev_ret, "Vulkan: Failed to create logical device");
         vkb_device = dev_ret.value();
+        disp = vkb_device.make_table();
 
         VmaAllocatorCreateInfo allocator_ci{
+            .flags = memory_budget_supported ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0u,
             .physicalDevice = phys_dev_ret.value(),
             .device = vkb_device.device,
             .instance = vkb_instance,
@@ -139,27 +306,14 @@ private:
 
         swapchain_image_views = vkb_swapchain.get_image_views().value();
     }
-    std::vector<char> readFile(const std::string &path)
-    {
-        std::ifstream file(path, std::ios_base::binary);
-        check(file.is_open(), "Failed to open file");
-
-        file.seekg(0, std::ios_base::end);
-        size_t file_size = file.tellg();
-        check(file_size, "File is empty");
-        file.seekg(std::ios_base::beg);
-
-        std::vector<char> buffer(file_size);
-        file.read(buffer.data(), file_size);
-        check(buffer.size() == file_size, "Failed to read file completely");
-
-        return buffer;
-    }
     VkShaderModule loadShaderModule(const std::string &path)
     {
         spdlog::info("Load shader: {}", path);
 
-        std::vector<char> code = readFile(path);
+        // Created straight from the mapped asset archive when it holds the module
+        std::vector<std::byte> storage{};
+        std::span<const std::byte> code = lve::LveArchive::load(path, storage);
+        check(!code.empty(), "Shader module is empty");
 
         VkShaderModuleCreateInfo shader_module_ci{};
         shader_module_ci.codeSize = code.size();
@@ -167,7 +321,7 @@ private:
         shader_module_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
         VkShaderModule shader_module{};
-        check(vkCreateShaderModule(vkb_device.device, &shader_module_ci, nullptr, &shader_module) == VK_SUCCESS,
+        check(disp.createShaderModule(&shader_module_ci, nullptr, &shader_module) == VK_SUCCESS,
               "Failed to create shader module");
 
         return shader_module;
@@ -186,34 +340,132 @@ private:
 
         shader_stage_cis[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
         shader_stage_cis[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        // The depth pre-pass is optional, without its shader the scene renders in a single pass
+        const char *prepass_path = "shaders/depth_vert.spv";
+        if (!lve::LveArchive::findDefault(prepass_path) && !std::filesystem::exists(prepass_path))
+        {
+            spdlog::warn("{} is missing, the depth pre-pass is unavailable", prepass_path);
+            prepass_stage_ci = {};
+            depth_prepass = false;
+            return;
+        }
+
+        // The depth pre-pass has no fragment stage, depth is written by fixed function
+        prepass_stage_ci = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = loadShaderModule(prepass_path),
+            .pName = "main"};
     }
-    void createRenderPass()
+    VkFormat findDepthFormat()
     {
-        VkAttachmentDescription attachment_desc{
-            .format = vkb_swapchain.image_format,
+        for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT})
+        {
+            VkFormatProperties properties{};
+            vkGetPhysicalDeviceFormatProperties(vkb_device.physical_device.physical_device, format, &properties);
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+            {
+                return format;
+            }
+        }
+        check(false, "Vulkan: Failed to find supported depth format");
+        return VK_FORMAT_UNDEFINED;
+    }
+    void createDepthImage()
+    {
+        depth_format = findDepthFormat();
+
+        VkImageCreateInfo image_ci{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = depth_format,
+            .extent = {fb_width, fb_height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
             .samples = VK_SAMPLE_COUNT_1_BIT,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-            .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+
+        VmaAllocationCreateInfo allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE};
+
+        check(vmaCreateImage(allocator, &image_ci, &allocation_ci, &depth_image.image,
+                             &depth_image.allocation, nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate depth image");
+
+        VkImageViewCreateInfo image_view_ci{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = depth_image.image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = depth_format,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .levelCount = 1,
+                .layerCount = 1}};
+
+        check(disp.createImageView(&image_view_ci, nullptr, &depth_image_view) == VK_SUCCESS,
+              "Vulkan: Failed to create depth image view");
+    }
+    void createRenderPass()
+    {
+        createDepthImage();
+
+        VkAttachmentDescription attachment_descs[2] = {
+            VkAttachmentDescription{
+                .format = vkb_swapchain.image_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR},
+            VkAttachmentDescription{
+                .format = depth_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+        };
 
         VkAttachmentReference color_attachment_ref{
             .attachment = 0,
             .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
 
+        VkAttachmentReference depth_attachment_ref{
+            .attachment = 1,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
         VkSubpassDescription subpass_desc{
             .colorAttachmentCount = 1,
             .pColorAttachments = &color_attachment_ref,
+            .pDepthStencilAttachment = &depth_attachment_ref,
         };
 
+        // All framebuffers share one depth image, so the clear waits for the previous frame's depth writes
+        VkSubpassDependency subpass_dependency{
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+
         VkRenderPassCreateInfo render_pass_ci{
             .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-            .attachmentCount = 1,
-            .pAttachments = &attachment_desc,
+            .attachmentCount = 2,
+            .pAttachments = attachment_descs,
             .subpassCount = 1,
-            .pSubpasses = &subpass_desc};
+            .pSubpasses = &subpass_desc,
+            .dependencyCount = 1,
+            .pDependencies = &subpass_dependency};
 
         check(
-            vkCreateRenderPass(vkb_device.device, &render_pass_ci, nullptr, &render_pass) == VK_SUCCESS,
+            disp.createRenderPass(&render_pass_ci, nullptr, &render_pass) == VK_SUCCESS,
             "Vulkan: Failed to create render pass");
 
         frame_buffers.resize(vkb_swapchain.image_count);
@@ -221,17 +473,18 @@ private:
         VkFramebufferCreateInfo frame_buffer_ci{
             .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
             .renderPass = render_pass,
-            .attachmentCount = 1,
+            .attachmentCount = 2,
             .width = fb_width,
             .height = fb_height,
             .layers = 1};
 
         for (int i = 0; i < frame_buffers.size(); i++)
         {
-            frame_buffer_ci.pAttachments = &swapchain_image_views[i],
+            VkImageView attachments[2] = {swapchain_image_views[i], depth_image_view};
+            frame_buffer_ci.pAttachments = attachments;
 
             check(
-                vkCreateFramebuffer(vkb_device.device, &frame_buffer_ci, nullptr, &frame_buffers[i]) == VK_SUCCESS,
+                disp.createFramebuffer(&frame_buffer_ci, nullptr, &frame_buffers[i]) == VK_SUCCESS,
                 "Vulkan: Failed to create frame buffer");
         }
     }
@@ -242,12 +495,18 @@ private:
 
         setupShaderStage();
 
-        VkVertexInputBindingDescription vertex_input_bd{
-            .binding = 0,
-            .stride = sizeof(Vertex),
-            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+        VkVertexInputBindingDescription vertex_input_bds[2] = {
+            VkVertexInputBindingDescription{
+                .binding = 0,
+                .stride = sizeof(Vertex),
+                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX},
+            VkVertexInputBindingDescription{
+                .binding = 1,
+                .stride = sizeof(Instance),
+                .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE},
+        };
 
-        VkVertexInputAttributeDescription vertex_input_ads[2] = {
+        VkVertexInputAttributeDescription vertex_input_ads[4] = {
             VkVertexInputAttributeDescription{
                 .location = 0,
                 .binding = 0,
@@ -258,13 +517,23 @@ private:
                 .binding = 0,
                 .format = VK_FORMAT_R32G32B32_SFLOAT,
                 .offset = static_cast<uint32_t>(offsetof(Vertex, color))},
+            VkVertexInputAttributeDescription{
+                .location = 2,
+                .binding = 1,
+                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                .offset = static_cast<uint32_t>(offsetof(Instance, position_scale))},
+            VkVertexInputAttributeDescription{
+                .location = 3,
+                .binding = 1,
+                .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+                .offset = static_cast<uint32_t>(offsetof(Instance, rotation))},
         };
 
         VkPipelineVertexInputStateCreateInfo vertex_input_sci{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-            .vertexBindingDescriptionCount = 1,
-            .pVertexBindingDescriptions = &vertex_input_bd,
-            .vertexAttributeDescriptionCount = 2,
+            .vertexBindingDescriptionCount = 2,
+            .pVertexBindingDescriptions = vertex_input_bds,
+            .vertexAttributeDescriptionCount = 4,
             .pVertexAttributeDescriptions = vertex_input_ads};
 
         VkViewport viewport{.width = static_cast<float>(fb_width), .height = static_cast<float>(fb_height)};
@@ -295,6 +564,12 @@ private:
             .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
             .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
 
+        VkPipelineDepthStencilStateCreateInfo depth_stencil_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .depthTestEnable = VK_TRUE,
+            .depthWriteEnable = VK_TRUE,
+            .depthCompareOp = VK_COMPARE_OP_LESS};
+
         VkPipelineColorBlendAttachmentState color_blend_attachment_state{
             .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT};
 
@@ -303,11 +578,18 @@ private:
             .attachmentCount = 1,
             .pAttachments = &color_blend_attachment_state};
 
+        VkPushConstantRange push_constant_range{
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(glm::mat4)};
+
         VkPipelineLayoutCreateInfo pipeline_layout_ci{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &push_constant_range,
         };
 
-        check(vkCreatePipelineLayout(vkb_device.device, &pipeline_layout_ci, nullptr, &pipeline_layout) == VK_SUCCESS,
+        check(disp.createPipelineLayout(&pipeline_layout_ci, nullptr, &pipeline_layout) == VK_SUCCESS,
               "Vulkan: Failed to create pipeline layout");
 
         createRenderPass();
@@ -321,14 +603,62 @@ private:
             .pViewportState = &viewport_sci,
             .pRasterizationState = &rasterization_sci,
             .pMultisampleState = &multisample_sci,
+            .pDepthStencilState = &depth_stencil_sci,
             .pColorBlendState = &color_blend_sci,
             .layout = pipeline_layout,
             .renderPass = render_pass};
 
         check(
-            vkCreateGraphicsPipelines(
-                vkb_device.device, nullptr, 1, &graphics_pipeline_ci, nullptr, &graphics_pipeline) == VK_SUCCESS,
+            disp.createGraphicsPipelines(
+                nullptr, 1, &graphics_pipeline_ci, nullptr, &graphics_pipeline) == VK_SUCCESS,
             "Vulkan: Failed to create graphics pipeline");
+
+        // After the pre-pass only the nearest surface passes, so every fragment shaded is a visible one
+        depth_stencil_sci.depthWriteEnable = VK_FALSE;
+        depth_stencil_sci.depthCompareOp = VK_COMPARE_OP_EQUAL;
+
+        check(
+            disp.createGraphicsPipelines(
+                nullptr, 1, &graphics_pipeline_ci, nullptr, &equal_pipeline) == VK_SUCCESS,
+            "Vulkan: Failed to create depth equal pipeline");
+        if (!prepass_stage_ci.module)
+        {
+            return;
+        }
+
+        // The pre-pass reads tightly packed positions instead of the interleaved vertex stream
+        VkVertexInputBindingDescription prepass_input_bds[2] = {
+            VkVertexInputBindingDescription{
+                .binding = 0,
+                .stride = sizeof(glm::vec3),
+                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX},
+            vertex_input_bds[1],
+        };
+
+        VkVertexInputAttributeDescription prepass_input_ads[3] = {
+            vertex_input_ads[0],
+            vertex_input_ads[2],
+            vertex_input_ads[3],
+        };
+
+        VkPipelineVertexInputStateCreateInfo prepass_input_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .vertexBindingDescriptionCount = 2,
+            .pVertexBindingDescriptions = prepass_input_bds,
+            .vertexAttributeDescriptionCount = 3,
+            .pVertexAttributeDescriptions = prepass_input_ads};
+
+        depth_stencil_sci.depthWriteEnable = VK_TRUE;
+        depth_stencil_sci.depthCompareOp = VK_COMPARE_OP_LESS;
+        color_blend_attachment_state.colorWriteMask = 0;
+        graphics_pipeline_ci.stageCount = 1;
+        graphics_pipeline_ci.pStages = &prepass_stage_ci;
+        graphics_pipeline_ci.pVertexInputState = &prepass_input_sci;
+
+        check(
+            disp.createGraphicsPipelines(
+                nullptr, 1, &graphics_pipeline_ci, nullptr, &prepass_pipeline) == VK_SUCCESS,
+            "Vulkan: Failed to create depth pre-pass pipeline");
     }
     void createCommandBuffers()
     {
@@ -338,7 +668,7 @@ private:
             .queueFamilyIndex = vkb_device.get_queue_index(vkb::QueueType::graphics).value()};
 
         check(
-            vkCreateCommandPool(vkb_device.device, &command_pool_ci, nullptr, &command_pool) == VK_SUCCESS,
+            disp.createCommandPool(&command_pool_ci, nullptr, &command_pool) == VK_SUCCESS,
             "Vulkan: Failed to create command pool");
 
         command_buffers.resize(vkb_swapchain.image_count);
@@ -349,196 +679,1665 @@ private:
             .commandBufferCount = static_cast<uint32_t>(command_buffers.size())};
 
         check(
-            vkAllocateCommandBuffers(vkb_device.device, &command_buffer_ai, command_buffers.data()) == VK_SUCCESS,
+            disp.allocateCommandBuffers(&command_buffer_ai, command_buffers.data()) == VK_SUCCESS,
             "Vulkan: Failed to allocate command buffers");
-    }
 
-    void uploadMesh(const std::string &model_path)
+        if (statistics_supported)
+        {
+            // One query per swapchain image, as command buffers are recorded per image
+            VkQueryPoolCreateInfo query_pool_ci{
+                .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+                .queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+                .queryCount = static_cast<uint32_t>(command_buffers.size()),
+                .pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                                      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT};
+
+            check(
+                disp.createQueryPool(&query_pool_ci, nullptr, &statistics_pool) == VK_SUCCESS,
+                "Vulkan: Failed to create pipeline statistics query pool");
+        }
+    }
+    void recordCommandBuffers()
     {
-        spdlog::info("Upload mesh: {}", model_path);
+        VkCommandBufferBeginInfo command_buffer_bi{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT};
 
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+        VkClearValue clear_values[2] = {
+            VkClearValue{.color = VkClearColorValue{{0.0f, 0.0f, 0.0f, 1.0f}}},
+            VkClearValue{.depthStencil = VkClearDepthStencilValue{1.0f, 0}},
+        };
 
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, model_path.c_str());
-        check(err.empty(), err.c_str());
-        check(ret, "tinyobjloader: Failed to load model");
+        VkRenderPassBeginInfo render_pass_bi{
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass = render_pass,
+            .clearValueCount = 2,
+            .pClearValues = clear_values,
+        };
+        render_pass_bi.renderArea.extent.width = fb_width;
+        render_pass_bi.renderArea.extent.height = fb_height;
 
-        if (!warn.empty())
+        auto record_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frame_buffers.size(); i++)
+        {
+            disp.resetCommandBuffer(command_buffers[i], 0);
+            disp.beginCommandBuffer(command_buffers[i], &command_buffer_bi);
+            if (statistics_enabled)
+            {
+                disp.cmdResetQueryPool(command_buffers[i], statistics_pool, i, 1);
+            }
+            render_pass_bi.framebuffer = frame_buffers[i];
+            VkBuffer vertex_buffers[2] = {geometry.vertices.buffer, instance_buffer.buffer};
+            VkBuffer position_buffers[2] = {geometry.positions.buffer, instance_buffer.buffer};
+            VkDeviceSize offsets[2] = {0, 0};
+            disp.cmdPushConstants(command_buffers[i], pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                                  sizeof(glm::mat4), &view_proj);
+            disp.cmdBeginRenderPass(command_buffers[i], &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+            // The query spans both passes, the pre-pass has no fragment stage so FS invocations are shading only
+            if (statistics_enabled)
+            {
+                disp.cmdBeginQuery(command_buffers[i], statistics_pool, i, 0);
+            }
+            // Every mesh and instance of the scene in a single indirect draw per pass
+            disp.cmdBindIndexBuffer(command_buffers[i], geometry.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+            if (depth_prepass)
+            {
+                disp.cmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, prepass_pipeline);
+                disp.cmdBindVertexBuffers(command_buffers[i], 0, 2, position_buffers, offsets);
+                drawScene(command_buffers[i]);
+                disp.cmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, equal_pipeline);
+            }
+            else
+            {
+                disp.cmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+            }
+            disp.cmdBindVertexBuffers(command_buffers[i], 0, 2, vertex_buffers, offsets);
+            drawScene(command_buffers[i]);
+            if (statistics_enabled)
+            {
+                disp.cmdEndQuery(command_buffers[i], statistics_pool, i);
+            }
+            disp.cmdEndRenderPass(command_buffers[i]);
+            disp.endCommandBuffer(command_buffers[i]);
+        }
+        record_time += std::chrono::steady_clock::now() - record_start;
+    }
+    void drawScene(VkCommandBuffer command_buffer)
+    {
+        if (multi_draw_indirect)
         {
-            spdlog::error("tinyobjloader: {}", warn);
+            disp.cmdDrawIndexedIndirect(command_buffer, draw_buffer.buffer, 0, static_cast<uint32_t>(draws.size()),
+                                        sizeof(VkDrawIndexedIndirectCommand));
             return;
         }
-
-        for (size_t s = 0; s < shapes.size(); s++)
+        // Page draws change every frame, single indirect draws keep the recording valid
+        if (page_file)
         {
-            for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+            for (size_t i = 0; i < draws.size(); i++)
             {
-                size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
-                for (size_t v = 0; v < fv; v++)
-                {
-                    vertex_count++;
-                }
+                disp.cmdDrawIndexedIndirect(command_buffer, draw_buffer.buffer, i * sizeof(VkDrawIndexedIndirectCommand),
+                                            1, sizeof(VkDrawIndexedIndirectCommand));
             }
+            return;
+        }
+        // Without multiDrawIndirect the same draws go direct, one per mesh
+        for (const VkDrawIndexedIndirectCommand &draw : draws)
+        {
+            disp.cmdDrawIndexed(command_buffer, draw.indexCount, draw.instanceCount, draw.firstIndex,
+                                draw.vertexOffset, draw.firstInstance);
+        }
+    }
+    void toggleStatistics()
+    {
+        if (!statistics_supported)
+        {
+            spdlog::warn("Vulkan: pipelineStatisticsQuery is not supported");
+            return;
         }
 
-        spdlog::info("Vertex count: {}", vertex_count);
-        data_size = vertex_count * sizeof(Vertex);
+        // Command buffers are recorded in advance, so re-record them without the queries
+        disp.deviceWaitIdle();
+        statistics_enabled = !statistics_enabled;
+        statistics_frames = 0;
+        recordCommandBuffers();
+        spdlog::info("Pipeline statistics: {}", statistics_enabled ? "on" : "off");
+    }
+    void toggleDepthPrepass()
+    {
+        if (!prepass_pipeline)
+        {
+            spdlog::warn("Depth pre-pass: unavailable without its shader");
+            return;
+        }
 
-        VkBufferCreateInfo buffer_ci{
-            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-            .size = data_size,
-            .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        };
+        disp.deviceWaitIdle();
+        depth_prepass = !depth_prepass;
+        statistics_frames = 0;
+        recordCommandBuffers();
+        spdlog::info("Depth pre-pass: {}", depth_prepass ? "on" : "off");
+    }
+    void toggleSortOrder()
+    {
+        // The instance buffer is read by in-flight commands, the recorded draws stay valid
+        disp.deviceWaitIdle();
+        front_to_back = !front_to_back;
+        statistics_frames = 0;
+        sortScene();
+        writeInstances();
+        spdlog::info("Draw order: {}", front_to_back ? "front to back" : "back to front");
+    }
+    bool keyPressed(int key, bool &key_down)
+    {
+        bool pressed = glfwGetKey(window, key) == GLFW_PRESS;
+        bool edge = pressed && !key_down;
+        key_down = pressed;
+        return edge;
+    }
+    void sampleStatistics(uint32_t query, bool log)
+    {
+        // Input assembly vertices, VS invocations, clipping primitives, FS invocations, availability
+        uint64_t results[5]{};
+        disp.getQueryPoolResults(statistics_pool, query, 1, sizeof(results), results, sizeof(results),
+                                 VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (!results[4])
+        {
+            return;
+        }
 
-        VmaAllocationCreateInfo allocation_ci{
-            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-            .usage = VMA_MEMORY_USAGE_AUTO};
+        std::string name = std::string("Scene (") + (depth_prepass ? "pre-pass, " : "single pass, ") +
+                           (front_to_back ? "front to back)" : "back to front)");
+        auto it = std::find_if(scene_statistics.begin(), scene_statistics.end(), [&](const SceneStatistics &entry)
+                               { return entry.name == name; });
+        if (it == scene_statistics.end())
+        {
+            it = scene_statistics.insert(it, {name, {}, 0});
+        }
+        std::copy(results, results + 4, it->counters);
+        it->sample_count++;
+
+        if (log)
+        {
+            spdlog::info("{}: IA vertices {}, VS invocations {}, clipping primitives {}, FS invocations {}",
+                         name, results[0], results[1], results[2], results[3]);
+        }
+    }
 
-        spdlog::info("VMA: Allocate buffer: {} bytes", data_size);
-        check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &data_buffer.buffer,
-                              &data_buffer.allocation, nullptr) == VK_SUCCESS,
-              "VMA: Failed to allocate buffer");
+    void writeStatistics(const std::string &path)
+    {
+        std::ofstream file(path);
+        check(file.is_open(), "Failed to open pipeline statistics file");
 
-        float *ptr;
-        vmaMapMemory(allocator, data_buffer.allocation, reinterpret_cast<void **>(&ptr));
-        for (size_t s = 0; s < shapes.size(); s++)
+        file << "{\n  \"pipelineStatistics\": [";
+        for (size_t i = 0; i < scene_statistics.size(); i++)
         {
-            size_t index_offset = 0;
-            for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+            const SceneStatistics &entry = scene_statistics[i];
+            file << (i ? ",\n" : "\n")
+                 << "    {\"name\": \"" << entry.name << "\""
+                 << ", \"samples\": " << entry.sample_count
+                 << ", \"inputAssemblyVertices\": " << entry.counters[0]
+                 << ", \"vertexShaderInvocations\": " << entry.counters[1]
+                 << ", \"clippingPrimitives\": " << entry.counters[2]
+                 << ", \"fragmentShaderInvocations\": " << entry.counters[3] << "}";
+        }
+        file << "\n  ]\n}\n";
+    }
+
+    MeshData placeholderMesh()
+    {
+        // Unit cube with counter-clockwise outward faces, colored by normal like the teapot
+        MeshData cube{};
+        for (int axis = 0; axis < 3; axis++)
+        {
+            for (float sign : {-1.0f, 1.0f})
             {
-                size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
-                for (size_t v = 0; v < fv; v++)
+                glm::vec3 normal{0.0f}, u{0.0f}, v{0.0f};
+                normal[axis] = sign;
+                u[(axis + 1) % 3] = 0.5f;
+                v[(axis + 2) % 3] = 0.5f;
+                if (sign < 0.0f)
                 {
-                    tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-                    tinyobj::real_t vx = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-                    tinyobj::real_t vy = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-                    tinyobj::real_t vz = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
-                    tinyobj::real_t nx = 0, ny = 0, nz = 0;
-
-                    if (idx.normal_index >= 0)
-                    {
-                        nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
-                        ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
-                        nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
-                    }
-
-                    auto vertex = Vertex(glm::vec3(vx, vy, vz), glm::vec3(nx, ny, nz));
-                    memcpy(ptr, &vertex, sizeof(Vertex));
+                    std::swap(u, v);
+                }
 
-                    ptr += sizeof(Vertex) / sizeof(float);
-                    vertex_count++;
+                glm::vec3 center = 0.5f * normal;
+                uint32_t base = static_cast<uint32_t>(cube.vertices.size());
+                for (const glm::vec3 &corner : {center - u - v, center + u - v, center + u + v, center - u + v})
+                {
+                    cube.vertices.push_back(Vertex(corner, normal));
+                }
+                for (uint32_t corner : {0u, 1u, 2u, 2u, 3u, 0u})
+                {
+                    cube.indices.push_back(base + corner);
                 }
-                index_offset += fv;
             }
         }
-        vmaUnmapMemory(allocator, data_buffer.allocation);
+        return cube;
     }
 
-    void init()
-    {
-        initGLFW();
-        initVulkan();
-        createSwapchain();
-        uploadMesh("assets/Teapot.obj");
-        createGraphicsPipeline();
-        createCommandBuffers();
-    }
-    void renderLoop()
+    GeometryPool createGeometryPool(uint32_t vertex_capacity, uint32_t index_capacity)
     {
-        spdlog::info("Enter render loop");
-
-        uint32_t img_idx{};
-
-        VkFenceCreateInfo fence_ci{
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT};
-
-        VkFence swapchain_fence{}, render_fence{};
-        check(
-            vkCreateFence(vkb_device.device, &fence_ci, nullptr, &swapchain_fence) == VK_SUCCESS,
-            "Vulkan: Failed to create swapchain fence");
-        check(
-            vkCreateFence(vkb_device.device, &fence_ci, nullptr, &render_fence) == VK_SUCCESS,
-            "Vulkan: Failed to create render fence");
+        GeometryPool pool{.vertex_capacity = vertex_capacity, .index_capacity = index_capacity};
 
-        VkCommandBufferBeginInfo command_buffer_bi{
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT};
+        // Device local and never mapped, meshes arrive through staging copies. Transfer source for
+        // defragmentation, which copies the resident meshes into a fresh pool.
+        VkBufferUsageFlags transfer_usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        struct
+        {
+            Buffer *buffer;
+            VkDeviceSize size;
+            VkBufferUsageFlags usage;
+        } pool_buffers[3] = {
+            {&pool.vertices, VkDeviceSize{vertex_capacity} * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+            {&pool.positions, VkDeviceSize{vertex_capacity} * sizeof(glm::vec3), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT},
+            {&pool.indices, VkDeviceSize{index_capacity} * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT},
+        };
 
-        VkClearValue clear_value{.color = VkClearColorValue{{0.0f, 0.0f, 0.0f, 1.0f}}};
+        VkDeviceSize pool_size = 0;
+        for (const auto &pool_buffer : pool_buffers)
+        {
+            VkBufferCreateInfo buffer_ci{
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .size = pool_buffer.size,
+                .usage = pool_buffer.usage | transfer_usage,
+            };
+
+            VmaAllocationCreateInfo allocation_ci{.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE};
+
+            check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &pool_buffer.buffer->buffer,
+                                  &pool_buffer.buffer->allocation, nullptr) == VK_SUCCESS,
+                  "VMA: Failed to allocate geometry pool buffer");
+            pool_size += pool_buffer.size;
+        }
 
-        VkRenderPassBeginInfo render_pass_bi{
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .renderPass = render_pass,
-            .clearValueCount = 1,
-            .pClearValues = &clear_value,
-        };
-        render_pass_bi.renderArea.extent.width = fb_width;
-        render_pass_bi.renderArea.extent.height = fb_height;
+        // The virtual blocks count vertices and indices rather than bytes
+        VmaVirtualBlockCreateInfo vertex_block_ci{.size = vertex_capacity};
+        VmaVirtualBlockCreateInfo index_block_ci{.size = index_capacity};
+        check(vmaCreateVirtualBlock(&vertex_block_ci, &pool.vertex_block) == VK_SUCCESS,
+              "VMA: Failed to create vertex block");
+        check(vmaCreateVirtualBlock(&index_block_ci, &pool.index_block) == VK_SUCCESS,
+              "VMA: Failed to create index block");
+
+        spdlog::info("VMA: Allocate geometry pool: {} vertices, {} indices, {} bytes",
+                     vertex_capacity, index_capacity, pool_size);
+        return pool;
+    }
 
-        VkSubmitInfo submit_info{
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .commandBufferCount = 1};
+    void destroyGeometryPool(GeometryPool &pool)
+    {
+        // Meshes still resident are released with the pool
+        vmaClearVirtualBlock(pool.vertex_block);
+        vmaClearVirtualBlock(pool.index_block);
+        vmaDestroyVirtualBlock(pool.vertex_block);
+        vmaDestroyVirtualBlock(pool.index_block);
+        vmaDestroyBuffer(allocator, pool.vertices.buffer, pool.vertices.allocation);
+        vmaDestroyBuffer(allocator, pool.positions.buffer, pool.positions.allocation);
+        vmaDestroyBuffer(allocator, pool.indices.buffer, pool.indices.allocation);
+        pool = {};
+    }
 
-        VkPresentInfoKHR present_info{
-            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-            .swapchainCount = 1,
-            .pSwapchains = &vkb_swapchain.swapchain};
+    Mesh allocateMesh(uint32_t vertex_count, uint32_t index_count)
+    {
+        Mesh allocated{.vertex_count = vertex_count, .index_count = index_count};
 
-        // Record commands in advance
-        for (int i = 0; i < frame_buffers.size(); i++)
+        VmaVirtualAllocationCreateInfo vertex_ci{.size = vertex_count};
+        VmaVirtualAllocationCreateInfo index_ci{.size = index_count};
+        VkDeviceSize vertex_offset{}, first_index{};
+        // A full pool makes room by evicting cached meshes, least recently released first
+        while (vmaVirtualAllocate(geometry.vertex_block, &vertex_ci, &allocated.vertex_allocation, &vertex_offset) != VK_SUCCESS)
         {
-            vkResetCommandBuffer(command_buffers[i], 0);
-            vkBeginCommandBuffer(command_buffers[i], &command_buffer_bi);
-            render_pass_bi.framebuffer = frame_buffers[i];
-            vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-            VkDeviceSize offset = 0;
-            vkCmdBindVertexBuffers(command_buffers[i], 0, 1, &data_buffer.buffer, &offset);
-            vkCmdBeginRenderPass(command_buffers[i], &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdDraw(command_buffers[i], static_cast<uint32_t>(vertex_count), 1, 0, 0);
-            vkCmdEndRenderPass(command_buffers[i]);
-            vkEndCommandBuffer(command_buffers[i]);
+            check(evictMeshes(1) > 0, "VMA: Geometry pool is out of vertex space");
         }
-
-        while (!glfwWindowShouldClose(window))
+        while (vmaVirtualAllocate(geometry.index_block, &index_ci, &allocated.index_allocation, &first_index) != VK_SUCCESS)
         {
-            glfwPollEvents();
+            check(evictMeshes(1) > 0, "VMA: Geometry pool is out of index space");
+        }
 
-            // Wait until all commands have executed on graphics queue
-            vkWaitForFences(vkb_device.device, 1, &render_fence, VK_TRUE, 1000000000);
-            vkResetFences(vkb_device.device, 1, &swapchain_fence);
-            vkAcquireNextImageKHR(
-                vkb_device.device, vkb_swapchain.swapchain, 1000000000, VK_NULL_HANDLE, swapchain_fence, &img_idx);
+        allocated.vertex_offset = static_cast<uint32_t>(vertex_offset);
+        allocated.first_index = static_cast<uint32_t>(first_index);
+        return allocated;
+    }
 
-            // Wait until next image is acquired
-            vkWaitForFences(vkb_device.device, 1, &swapchain_fence, VK_TRUE, 1000000000);
-            vkResetFences(vkb_device.device, 1, &render_fence);
-            submit_info.pCommandBuffers = &command_buffers[img_idx];
-            vkQueueSubmit(graphics_queue, 1, &submit_info, render_fence);
+    uint64_t meshBytes(const Mesh &resident)
+    {
+        return uint64_t{resident.vertex_count} * (sizeof(Vertex) + sizeof(glm::vec3)) +
+               uint64_t{resident.index_count} * sizeof(uint32_t);
+    }
 
-            present_info.pImageIndices = &img_idx,
-            vkQueuePresentKHR(graphics_queue, &present_info);
+    size_t evictMeshes(uint64_t bytes)
+    {
+        std::vector<lve::LveAssetId> evicted = assets.evict(bytes);
+        for (lve::LveAssetId id : evicted)
+        {
+            const Mesh &unloaded = meshes.at(id);
+            vmaVirtualFree(geometry.vertex_block, unloaded.vertex_allocation);
+            vmaVirtualFree(geometry.index_block, unloaded.index_allocation);
+            meshes.erase(id);
+            spdlog::info("Asset manager: Evict mesh: {}", assets.getPath(id));
         }
+        return evicted.size();
+    }
 
-        vkDeviceWaitIdle(vkb_device.device);
-        vkDestroyFence(vkb_device.device, swapchain_fence, nullptr);
-        vkDestroyFence(vkb_device.device, render_fence, nullptr);
+    uint32_t geometryHeap()
+    {
+        VmaAllocationInfo allocation_info{};
+        vmaGetAllocationInfo(allocator, geometry.vertices.allocation, &allocation_info);
+        const VkPhysicalDeviceMemoryProperties *memory_properties{};
+        vmaGetMemoryProperties(allocator, &memory_properties);
+        return memory_properties->memoryTypes[allocation_info.memoryType].heapIndex;
     }
-    void destroySwapchain()
+
+    void enforceMeshBudget()
     {
-        spdlog::info("Destroy swapchain");
+        // The mesh budget shrinks by however far the pool's heap is over the budget VMA reports
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+        vmaGetHeapBudgets(allocator, budgets);
+        const VmaBudget &heap = budgets[geometryHeap()];
+        uint64_t budget = mesh_budget;
+        if (heap.usage > heap.budget)
+        {
+            budget -= std::min(budget, heap.usage - heap.budget);
+        }
 
-        for (const auto &frame_buffer : frame_buffers)
+        uint64_t resident = assets.getResidentBytes();
+        if (resident > budget && evictMeshes(resident - budget) > 0)
         {
-            vkDestroyFramebuffer(vkb_device.device, frame_buffer, nullptr);
+            spdlog::info("Asset manager: {} of {} bytes resident, {} meshes cached",
+                         assets.getResidentBytes(), budget, assets.getCachedCount());
+            compactGeometry();
         }
+    }
 
-        for (const auto &image_view : swapchain_image_views)
+    void compactGeometry()
+    {
+        if (uploads_in_flight == 0 && !defragmenting && isGeometryFragmented())
         {
-            vkDestroyImageView(vkb_device.device, image_view, nullptr);
+            startAssetTask(defragmentGeometry());
         }
+    }
+
+    void startAssetTask(lve::LveTask<> task)
+    {
+        asset_tasks.push_back(std::move(task));
+        asset_tasks.back().start();
+    }
+
+    bool isGeometryFragmented()
+    {
+        // Free space split into several ranges cannot take a mesh as large as all of it
+        VmaDetailedStatistics vertex_statistics{}, index_statistics{};
+        vmaCalculateVirtualBlockStatistics(geometry.vertex_block, &vertex_statistics);
+        vmaCalculateVirtualBlockStatistics(geometry.index_block, &index_statistics);
+        return vertex_statistics.unusedRangeCount > 1 || index_statistics.unusedRangeCount > 1;
+    }
+
+    Buffer createStaging(uint32_t vertex_count, uint32_t index_count)
+    {
+        // Vertices, then positions, then indices, the layout recordMeshUpload copies from
+        VkDeviceSize vertex_bytes = VkDeviceSize{vertex_count} * sizeof(Vertex);
+        VkDeviceSize position_bytes = VkDeviceSize{vertex_count} * sizeof(glm::vec3);
+        VkDeviceSize index_bytes = VkDeviceSize{index_count} * sizeof(uint32_t);
+
+        VkBufferCreateInfo buffer_ci{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = vertex_bytes + position_bytes + index_bytes,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        };
+
+        VmaAllocationCreateInfo allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO};
+
+        Buffer staging{};
+        check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &staging.buffer, &staging.allocation, nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate staging buffer");
+        return staging;
+    }
+
+    Buffer createStaging(const MeshData &data)
+    {
+        Buffer staging = createStaging(static_cast<uint32_t>(data.vertices.size()), static_cast<uint32_t>(data.indices.size()));
+        VkDeviceSize vertex_bytes = data.vertices.size() * sizeof(Vertex);
+        VkDeviceSize position_bytes = data.vertices.size() * sizeof(glm::vec3);
+        VkDeviceSize index_bytes = data.indices.size() * sizeof(uint32_t);
+
+        std::byte *ptr;
+        vmaMapMemory(allocator, staging.allocation, reinterpret_cast<void **>(&ptr));
+        memcpy(ptr, data.vertices.data(), vertex_bytes);
+        glm::vec3 *position_ptr = reinterpret_cast<glm::vec3 *>(ptr + vertex_bytes);
+        for (const Vertex &vertex : data.vertices)
+        {
+            *position_ptr++ = vertex.position;
+        }
+        memcpy(ptr + vertex_bytes + position_bytes, data.indices.data(), index_bytes);
+        vmaUnmapMemory(allocator, staging.allocation);
+
+        return staging;
+    }
+
+    VkCommandBuffer beginTransferCommands()
+    {
+        VkCommandBufferAllocateInfo command_buffer_ai{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = command_pool,
+            .commandBufferCount = 1};
+
+        VkCommandBuffer command_buffer{};
+        check(
+            disp.allocateCommandBuffers(&command_buffer_ai, &command_buffer) == VK_SUCCESS,
+            "Vulkan: Failed to allocate transfer command buffer");
+
+        VkCommandBufferBeginInfo command_buffer_bi{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+        disp.beginCommandBuffer(command_buffer, &command_buffer_bi);
+        return command_buffer;
+    }
+
+    void endTransferCommands(VkCommandBuffer command_buffer)
+    {
+        // Copies complete before any later vertex or index fetch of the same submit
+        VkMemoryBarrier barrier{
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT};
+
+        disp.cmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                                0, 1, &barrier, 0, nullptr, 0, nullptr);
+        disp.endCommandBuffer(command_buffer);
+    }
+
+    void recordMeshCopy(VkCommandBuffer command_buffer, VkBuffer src_vertices, VkBuffer src_positions, VkBuffer src_indices,
+                        VkDeviceSize src_vertex_offset, VkDeviceSize src_position_offset, VkDeviceSize src_index_offset,
+                        const Mesh &target)
+    {
+        VkBufferCopy vertex_region{
+            .srcOffset = src_vertex_offset,
+            .dstOffset = VkDeviceSize{target.vertex_offset} * sizeof(Vertex),
+            .size = VkDeviceSize{target.vertex_count} * sizeof(Vertex)};
+        VkBufferCopy position_region{
+            .srcOffset = src_position_offset,
+            .dstOffset = VkDeviceSize{target.vertex_offset} * sizeof(glm::vec3),
+            .size = VkDeviceSize{target.vertex_count} * sizeof(glm::vec3)};
+        VkBufferCopy index_region{
+            .srcOffset = src_index_offset,
+            .dstOffset = VkDeviceSize{target.first_index} * sizeof(uint32_t),
+            .size = VkDeviceSize{target.index_count} * sizeof(uint32_t)};
+
+        disp.cmdCopyBuffer(command_buffer, src_vertices, geometry.vertices.buffer, 1, &vertex_region);
+        disp.cmdCopyBuffer(command_buffer, src_positions, geometry.positions.buffer, 1, &position_region);
+        disp.cmdCopyBuffer(command_buffer, src_indices, geometry.indices.buffer, 1, &index_region);
+    }
+
+    void recordMeshUpload(VkCommandBuffer command_buffer, const Buffer &staging, const Mesh &target)
+    {
+        VkDeviceSize vertex_bytes = VkDeviceSize{target.vertex_count} * sizeof(Vertex);
+        VkDeviceSize position_bytes = VkDeviceSize{target.vertex_count} * sizeof(glm::vec3);
+        recordMeshCopy(command_buffer, staging.buffer, staging.buffer, staging.buffer,
+                       0, vertex_bytes, vertex_bytes + position_bytes, target);
+    }
+
+    Mesh uploadNow(const MeshData &data)
+    {
+        // Blocks on the queue, only for the small placeholder the first frame needs
+        Buffer staging = createStaging(data);
+        Mesh uploaded = allocateMesh(static_cast<uint32_t>(data.vertices.size()), static_cast<uint32_t>(data.indices.size()));
+
+        VkCommandBuffer command_buffer = beginTransferCommands();
+        recordMeshUpload(command_buffer, staging, uploaded);
+        endTransferCommands(command_buffer);
+
+        VkSubmitInfo submit_info{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &command_buffer};
+
+        disp.queueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
+        disp.queueWaitIdle(graphics_queue);
+        disp.freeCommandBuffers(command_pool, 1, &command_buffer);
+        vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+
+        return uploaded;
+    }
+
+    MeshData parseObj(const std::string &model_path)
+    {
+        spdlog::info("Load mesh: {}", model_path);
+
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, model_path.c_str());
+        check(err.empty(), err.c_str());
+        check(ret, "tinyobjloader: Failed to load model");
+
+        if (!warn.empty())
+        {
+            spdlog::warn("tinyobjloader: {}", warn);
+        }
+
+        // Without normals in the file they are generated and indexed like the file's would be,
+        // corners then refer to them by their position in the shapes
+        std::vector<glm::vec3> generated_normals{};
+        std::vector<uint32_t> normal_indices{};
+        if (attrib.normals.empty())
+        {
+            std::vector<uint32_t> position_indices{};
+            for (const tinyobj::shape_t &shape : shapes)
+            {
+                for (const tinyobj::index_t &idx : shape.mesh.indices)
+                {
+                    position_indices.push_back(static_cast<uint32_t>(idx.vertex_index));
+                }
+            }
+            auto start = std::chrono::steady_clock::now();
+            lve::LveMeshNormals::generate(attrib.vertices, position_indices, crease_angle, generated_normals, normal_indices);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            spdlog::info("Generated {} normals in {} ms", generated_normals.size(),
+                         std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+        }
+
+        // Corners sharing a position and normal become one indexed vertex
+        MeshData data{};
+        std::unordered_map<uint64_t, uint32_t> unique_vertices{};
+        size_t corner = 0;
+        for (size_t s = 0; s < shapes.size(); s++)
+        {
+            size_t index_offset = 0;
+            for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+            {
+                size_t fv = size_t(shapes[s].mesh.num_face_vertices[f]);
+                for (size_t v = 0; v < fv; v++, corner++)
+                {
+                    tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
+                    if (!normal_indices.empty())
+                    {
+                        idx.normal_index = static_cast<int>(normal_indices[corner]);
+                    }
+                    uint64_t key = (uint64_t(uint32_t(idx.vertex_index)) << 32) | uint32_t(idx.normal_index);
+                    auto [it, inserted] = unique_vertices.try_emplace(key, static_cast<uint32_t>(data.vertices.size()));
+                    if (inserted)
+                    {
+                        tinyobj::real_t vx = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
+                        tinyobj::real_t vy = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
+                        tinyobj::real_t vz = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
+                        tinyobj::real_t nx = 0, ny = 0, nz = 0;
+
+                        if (!normal_indices.empty())
+                        {
+                            const glm::vec3 &normal = generated_normals[size_t(idx.normal_index)];
+                            nx = normal.x;
+                            ny = normal.y;
+                            nz = normal.z;
+                        }
+                        else if (idx.normal_index >= 0)
+                        {
+                            nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
+                            ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
+                            nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
+                        }
+
+                        data.vertices.push_back(Vertex(glm::vec3(vx, vy, vz), glm::vec3(nx, ny, nz)));
+                    }
+                    data.indices.push_back(it->second);
+                }
+                index_offset += fv;
+            }
+        }
+
+        spdlog::info("Vertex count: {}, index count: {}", data.vertices.size(), data.indices.size());
+        return data;
+    }
+
+    StagedMesh stageGltf(const std::string &model_path)
+    {
+        spdlog::info("Load mesh: {}", model_path);
+
+        // Attributes already laid out like ours are copied from the mapped file into staging as
+        // they are, only the others go through a conversion
+        lve::LveGltf gltf{model_path};
+        // Summed wide, many primitives can add up past 32 bits and wrap into a too small staging buffer
+        uint64_t total_vertices = 0, total_indices = 0;
+        for (const lve::LveGltf::Primitive &primitive : gltf.getPrimitives())
+        {
+            const lve::LveGltf::Accessor &position = gltf.getAccessor(primitive.position);
+            total_vertices += position.count;
+            total_indices += primitive.indices != lve::LveGltf::NO_ACCESSOR ? gltf.getAccessor(primitive.indices).count : position.count;
+        }
+        check(total_vertices > 0, "glTF: No triangles");
+        check(total_vertices <= POOL_VERTICES && total_indices <= POOL_INDICES, "glTF: Mesh does not fit the geometry pool");
+        uint32_t vertex_count = static_cast<uint32_t>(total_vertices);
+        uint32_t index_count = static_cast<uint32_t>(total_indices);
+        if (gltf.getSkippedPrimitiveCount() > 0)
+        {
+            spdlog::warn("glTF: Skipped {} primitives that are not triangle lists", gltf.getSkippedPrimitiveCount());
+        }
+
+        StagedMesh staged{createStaging(vertex_count, index_count), vertex_count, index_count};
+        std::byte *ptr;
+        vmaMapMemory(allocator, staged.staging.allocation, reinterpret_cast<void **>(&ptr));
+        Vertex *vertices = reinterpret_cast<Vertex *>(ptr);
+        glm::vec3 *positions = reinterpret_cast<glm::vec3 *>(ptr + VkDeviceSize{vertex_count} * sizeof(Vertex));
+        uint32_t *indices = reinterpret_cast<uint32_t *>(ptr + VkDeviceSize{vertex_count} * (sizeof(Vertex) + sizeof(glm::vec3)));
+
+        size_t copied_bytes = 0, converted_bytes = 0;
+        uint32_t base_vertex = 0;
+        for (const lve::LveGltf::Primitive &primitive : gltf.getPrimitives())
+        {
+            const lve::LveGltf::Accessor &position = gltf.getAccessor(primitive.position);
+            const lve::LveGltf::Accessor *normal =
+                primitive.normal != lve::LveGltf::NO_ACCESSOR ? &gltf.getAccessor(primitive.normal) : nullptr;
+            size_t count = position.count;
+
+            // Float positions interleaved with float normals right behind them are already our vertex
+            // format. With both strides a whole vertex, the bounds check of the normals covers all
+            // count * sizeof(Vertex) bytes from the first position.
+            bool vertices_match = normal && position.componentType == lve::LveGltf::Float &&
+                                  normal->componentType == lve::LveGltf::Float && position.stride == sizeof(Vertex) &&
+                                  normal->stride == sizeof(Vertex) && normal->data == position.data + offsetof(Vertex, color);
+            if (vertices_match)
+            {
+                memcpy(vertices, position.data, count * sizeof(Vertex));
+                copied_bytes += count * sizeof(Vertex);
+            }
+            else
+            {
+                lve::LveGltf::copyVec3(position, &vertices->position, sizeof(Vertex));
+                if (normal)
+                {
+                    lve::LveGltf::copyVec3(*normal, &vertices->color, sizeof(Vertex));
+                }
+                else
+                {
+                    for (size_t v = 0; v < count; v++)
+                    {
+                        vertices[v].color = glm::vec3(0.0f);
+                    }
+                }
+                converted_bytes += count * sizeof(Vertex);
+            }
+
+            if (position.componentType == lve::LveGltf::Float && position.stride == sizeof(glm::vec3))
+            {
+                memcpy(positions, position.data, count * sizeof(glm::vec3));
+                copied_bytes += count * sizeof(glm::vec3);
+            }
+            else
+            {
+                lve::LveGltf::copyVec3(position, positions, sizeof(glm::vec3));
+                converted_bytes += count * sizeof(glm::vec3);
+            }
+
+            // Indices of later primitives are rebased onto their place in the combined vertices
+            uint32_t primitive_index_count = static_cast<uint32_t>(count);
+            if (primitive.indices == lve::LveGltf::NO_ACCESSOR)
+            {
+                for (uint32_t i = 0; i < primitive_index_count; i++)
+                {
+                    indices[i] = base_vertex + i;
+                }
+                converted_bytes += count * sizeof(uint32_t);
+            }
+            else
+            {
+                const lve::LveGltf::Accessor &primitive_indices = gltf.getAccessor(primitive.indices);
+                primitive_index_count = primitive_indices.count;
+                if (base_vertex == 0 && primitive_indices.componentType == lve::LveGltf::UnsignedInt &&
+                    primitive_indices.stride == sizeof(uint32_t))
+                {
+                    memcpy(indices, primitive_indices.data, size_t{primitive_index_count} * sizeof(uint32_t));
+                    copied_bytes += size_t{primitive_index_count} * sizeof(uint32_t);
+                }
+                else
+                {
+                    lve::LveGltf::copyIndices(primitive_indices, indices, base_vertex);
+                    converted_bytes += size_t{primitive_index_count} * sizeof(uint32_t);
+                }
+            }
+
+            vertices += count;
+            positions += count;
+            indices += primitive_index_count;
+            base_vertex += static_cast<uint32_t>(count);
+        }
+        vmaUnmapMemory(allocator, staged.staging.allocation);
+
+        spdlog::info("Vertex count: {}, index count: {}, {} KiB copied as is, {} KiB converted",
+                     vertex_count, index_count, copied_bytes / 1024, converted_bytes / 1024);
+        return staged;
+    }
+
+    StagedMesh stageCooked(const lve::LveCookedMesh &cooked, uint32_t lod)
+    {
+        // vp_cook wrote the file in the staging layout or compressed, either way the level's vertex
+        // prefix, its positions and its indices go straight into the mapping
+        static_assert(sizeof(Vertex) == sizeof(lve::LveCookedMesh::Vertex), "Cooked vertices must match ours");
+        const lve::LveCookedMesh::Lod &level = cooked.getLods()[lod];
+        check(level.vertexCount > 0 && level.indexCount > 0, "Cooked mesh: No triangles");
+
+        StagedMesh staged{createStaging(level.vertexCount, level.indexCount), level.vertexCount, level.indexCount};
+        VkDeviceSize vertex_bytes = VkDeviceSize{level.vertexCount} * sizeof(Vertex);
+        VkDeviceSize position_bytes = VkDeviceSize{level.vertexCount} * sizeof(glm::vec3);
+        std::byte *ptr;
+        vmaMapMemory(allocator, staged.staging.allocation, reinterpret_cast<void **>(&ptr));
+        try
+        {
+            cooked.readVertices(lod, reinterpret_cast<lve::LveCookedMesh::Vertex *>(ptr), reinterpret_cast<glm::vec3 *>(ptr + vertex_bytes));
+            cooked.readIndices(lod, reinterpret_cast<uint32_t *>(ptr + vertex_bytes + position_bytes));
+        }
+        catch (...)
+        {
+            vmaUnmapMemory(allocator, staged.staging.allocation);
+            vmaDestroyBuffer(allocator, staged.staging.buffer, staged.staging.allocation);
+            throw;
+        }
+        vmaUnmapMemory(allocator, staged.staging.allocation);
+
+        spdlog::info("Vertex count: {}, index count: {}, level {} of {}", level.vertexCount, level.indexCount, lod,
+                     cooked.getLods().size());
+        return staged;
+    }
+
+    lve::LveTask<std::shared_ptr<const lve::LveCookedMesh>> openCooked(std::string model_path)
+    {
+        co_await lve::resumeOn(lve::LveJobSystem::get());
+        spdlog::info("Load mesh: {}", model_path);
+        co_return std::make_shared<const lve::LveCookedMesh>(model_path);
+    }
+
+    lve::LveTask<StagedMesh> loadCookedLevel(std::shared_ptr<const lve::LveCookedMesh> cooked, uint32_t lod)
+    {
+        co_await lve::resumeOn(lve::LveJobSystem::get());
+        co_return stageCooked(*cooked, lod);
+    }
+
+    lve::LveTask<StagedMesh> loadMesh(std::string model_path)
+    {
+        // Parsing and staging run on a worker while the render loop keeps presenting, VMA
+        // allocations are thread safe
+        co_await lve::resumeOn(lve::LveJobSystem::get());
+        if (std::filesystem::path(model_path).extension() == ".glb")
+        {
+            co_return stageGltf(model_path);
+        }
+
+        MeshData data = parseObj(model_path);
+        co_return StagedMesh{createStaging(data), static_cast<uint32_t>(data.vertices.size()),
+                             static_cast<uint32_t>(data.indices.size())};
+    }
+
+    lve::LveTask<Mesh> uploadToGpu(StagedMesh staged)
+    {
+        Buffer staging = staged.staging;
+
+        // The virtual blocks and the command pool belong to the render loop, the copy rides along
+        // with its next submit
+        co_await frame_scheduler.schedule();
+
+        uploads_in_flight++;
+        Mesh uploaded = allocateMesh(staged.vertex_count, staged.index_count);
+        VkCommandBuffer upload_command_buffer = beginTransferCommands();
+        recordMeshUpload(upload_command_buffer, staging, uploaded);
+        endTransferCommands(upload_command_buffer);
+        submit_batch.push_back(upload_command_buffer);
+
+        // Resumed after the frame fence of that submit has signalled
+        co_await frame_scheduler.waitForFrame(submitted_frames + 1);
+
+        disp.freeCommandBuffers(command_pool, 1, &upload_command_buffer);
+        vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+        uploads_in_flight--;
+
+        co_return uploaded;
+    }
+
+    lve::LveTask<> defragmentGeometry()
+    {
+        // Packs the resident meshes into a fresh pool, the copies ride along with the next submit.
+        // Started from the render loop while no upload holds ranges of the current pool.
+        defragmenting = true;
+        GeometryPool old_geometry = geometry;
+        geometry = createGeometryPool(old_geometry.vertex_capacity, old_geometry.index_capacity);
+
+        VkCommandBuffer defragment_command_buffer = beginTransferCommands();
+        for (auto &[id, resident] : meshes)
+        {
+            Mesh moved = allocateMesh(resident.vertex_count, resident.index_count);
+            recordMeshCopy(defragment_command_buffer,
+                           old_geometry.vertices.buffer, old_geometry.positions.buffer, old_geometry.indices.buffer,
+                           VkDeviceSize{resident.vertex_offset} * sizeof(Vertex),
+                           VkDeviceSize{resident.vertex_offset} * sizeof(glm::vec3),
+                           VkDeviceSize{resident.first_index} * sizeof(uint32_t), moved);
+            resident = moved;
+        }
+        endTransferCommands(defragment_command_buffer);
+        submit_batch.push_back(defragment_command_buffer);
+
+        writeDraws();
+        recordCommandBuffers();
+        spdlog::info("Geometry pool: Defragment {} meshes", meshes.size());
+
+        co_await frame_scheduler.waitForFrame(submitted_frames + 1);
+
+        disp.freeCommandBuffers(command_pool, 1, &defragment_command_buffer);
+        destroyGeometryPool(old_geometry);
+        defragmenting = false;
+    }
+
+    lve::LveTask<> requestMesh(size_t slot, lve::LveAssetId id)
+    {
+        auto requested = std::chrono::steady_clock::now();
+        // Only the first request loads, others for the same mesh wait for that load
+        if (assets.acquire(id))
+        {
+            const std::string &model_path = assets.getPath(id);
+            std::shared_ptr<const lve::LveCookedMesh> cooked{};
+            Mesh streamed{};
+            std::exception_ptr failure{};
+            try
+            {
+                StagedMesh staged{};
+                if (std::filesystem::path(model_path).extension() == ".lvemesh")
+                {
+                    // Coarsest level first, refineMesh streams in the finer ones behind it
+                    cooked = co_await openCooked(model_path);
+                    staged = co_await loadCookedLevel(cooked, static_cast<uint32_t>(cooked->getLods().size() - 1));
+                }
+                else
+                {
+                    staged = co_await loadMesh(model_path);
+                }
+                streamed = co_await uploadToGpu(staged);
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+
+            // A failed load throws on the worker it ran on, the asset manager belongs to the render loop
+            if (failure)
+            {
+                co_await frame_scheduler.schedule();
+                // The slot keeps its previous mesh, requests waiting on this load give up with it
+                assets.markFailed(id);
+                assets.release(id);
+                std::rethrow_exception(failure);
+            }
+
+            // Back on the render loop after its fence wait, no command buffer is in flight
+            meshes[id] = streamed;
+            assets.markResident(id, meshBytes(streamed));
+
+            auto elapsed = std::chrono::steady_clock::now() - start_time;
+            spdlog::info("Mesh streamed in after {} ms: {}", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+                         assets.getPath(id));
+            if (cooked && cooked->getLods().size() > 1)
+            {
+                startAssetTask(refineMesh(id, std::move(cooked), requested));
+            }
+        }
+        else
+        {
+            if (!co_await assets.whenResident(id))
+            {
+                assets.release(id);
+                co_return;
+            }
+            // A resident mesh does not suspend, and key handling runs while the last frame is in flight
+            co_await frame_scheduler.schedule();
+        }
+
+        // A newer request for the slot wins, whichever load finishes first
+        if (slot_requests[slot] != id)
+        {
+            assets.release(id);
+            co_return;
+        }
+
+        lve::LveAssetId previous = mesh_slots[slot];
+        mesh_slots[slot] = id;
+        assets.release(previous);
+        writeDraws();
+        recordCommandBuffers();
+        enforceMeshBudget();
+
+        // Presented once the next submit's fence has signalled
+        co_await frame_scheduler.waitForFrame(submitted_frames + 1);
+        if (mesh_slots[slot] == id)
+        {
+            auto elapsed = std::chrono::steady_clock::now() - requested;
+            spdlog::info("Time to first pixel {} ms: {}", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+                         assets.getPath(id));
+        }
+    }
+
+    lve::LveTask<> refineMesh(lve::LveAssetId id, std::shared_ptr<const lve::LveCookedMesh> cooked,
+                              std::chrono::steady_clock::time_point requested)
+    {
+        // Our reference keeps the mesh from being evicted while finer levels replace it
+        assets.acquire(id);
+        for (uint32_t lod = static_cast<uint32_t>(cooked->getLods().size() - 1); lod-- > 0;)
+        {
+            Mesh refined{};
+            std::exception_ptr failure{};
+            try
+            {
+                StagedMesh staged = co_await loadCookedLevel(cooked, lod);
+                refined = co_await uploadToGpu(staged);
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+            }
+
+            // The mesh stays at the last level that made it, released on the render loop
+            if (failure)
+            {
+                co_await frame_scheduler.schedule();
+                assets.release(id);
+                std::rethrow_exception(failure);
+            }
+
+            // The coarser level may have moved in a defragment, whatever range it holds now is freed
+            Mesh &resident = meshes.at(id);
+            vmaVirtualFree(geometry.vertex_block, resident.vertex_allocation);
+            vmaVirtualFree(geometry.index_block, resident.index_allocation);
+            resident = refined;
+            assets.setBytes(id, meshBytes(refined));
+            if (std::find(mesh_slots.begin(), mesh_slots.end(), id) != mesh_slots.end())
+            {
+                writeDraws();
+                recordCommandBuffers();
+            }
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - requested;
+        spdlog::info("Full detail after {} ms: {}", std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(),
+                     assets.getPath(id));
+        assets.release(id);
+        enforceMeshBudget();
+    }
+
+    void requestSlot(size_t slot, const std::string &model_path)
+    {
+        lve::LveAssetId id = assets.intern(model_path);
+        slot_requests[slot] = id;
+        startAssetTask(requestMesh(slot, id));
+    }
+
+    void cycleMeshes()
+    {
+        mesh_cycle++;
+        for (size_t slot = 0; slot < SLOT_COUNT; slot++)
+        {
+            requestSlot(slot, mesh_paths[(slot + mesh_cycle) % mesh_paths.size()]);
+        }
+    }
+
+    void buildScene(size_t instance_count)
+    {
+        spdlog::info("Build scene: {} instances", instance_count);
+
+        // Cubic grid of instances, each with its own rotation around the up axis
+        size_t side = static_cast<size_t>(std::ceil(std::cbrt(static_cast<double>(instance_count))));
+        const float spacing = 2.0f;
+        float half_extent = 0.5f * spacing * static_cast<float>(side - 1);
+
+        // Instances take turns between the mesh slots
+        scene.resize(instance_count);
+        scene_slots.resize(instance_count);
+        slot_instance_counts.assign(SLOT_COUNT, 0);
+        for (size_t i = 0; i < instance_count; i++)
+        {
+            scene_slots[i] = static_cast<uint32_t>(i % SLOT_COUNT);
+            slot_instance_counts[scene_slots[i]]++;
+            glm::vec3 cell{static_cast<float>(i % side),
+                           static_cast<float>((i / side) % side),
+                           static_cast<float>(i / (side * side))};
+            glm::quat rotation = glm::angleAxis(static_cast<float>(i) * 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+            scene[i].position_scale = glm::vec4(cell * spacing - half_extent, 1.0f);
+            scene[i].rotation = glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w);
+        }
+
+        // Frame the whole grid
+        float radius = half_extent + spacing;
+        glm::mat4 proj = glm::perspective(
+            glm::radians(45.0f), static_cast<float>(fb_width) / static_cast<float>(fb_height), 0.1f, radius * 6.0f);
+        proj[1][1] *= -1.0f;
+        eye = glm::vec3(0.0f, radius, radius * 2.5f);
+        glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        view_proj = proj * view;
+
+        sortScene();
+    }
+
+    void sortScene()
+    {
+        // Instances rasterize in buffer order, nearest first lets early depth testing reject hidden fragments.
+        // Grouped by mesh slot first, each slot's instances are one contiguous draw.
+        struct Keyed
+        {
+            uint32_t slot;
+            float distance;
+            Instance instance;
+        };
+        std::vector<Keyed> keyed(scene.size());
+        for (size_t i = 0; i < scene.size(); i++)
+        {
+            glm::vec3 offset = glm::vec3(scene[i].position_scale) - eye;
+            keyed[i] = {scene_slots[i], glm::dot(offset, offset), scene[i]};
+        }
+
+        std::sort(keyed.begin(), keyed.end(), [this](const Keyed &a, const Keyed &b)
+                  {
+                      if (a.slot != b.slot)
+                      {
+                          return a.slot < b.slot;
+                      }
+                      return front_to_back ? a.distance < b.distance : a.distance > b.distance; });
+
+        for (size_t i = 0; i < scene.size(); i++)
+        {
+            scene_slots[i] = keyed[i].slot;
+            scene[i] = keyed[i].instance;
+        }
+    }
+
+    void uploadInstances()
+    {
+        size_t instance_data_size = scene.size() * sizeof(Instance);
+
+        VkBufferCreateInfo buffer_ci{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = instance_data_size,
+            .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        };
+
+        VmaAllocationCreateInfo allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO};
+
+        spdlog::info("VMA: Allocate instance buffer: {} bytes", instance_data_size);
+        check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &instance_buffer.buffer,
+                              &instance_buffer.allocation, nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate instance buffer");
+
+        writeInstances();
+    }
+
+    void writeInstances()
+    {
+        void *ptr;
+        vmaMapMemory(allocator, instance_buffer.allocation, &ptr);
+        memcpy(ptr, scene.data(), scene.size() * sizeof(Instance));
+        vmaUnmapMemory(allocator, instance_buffer.allocation);
+    }
+
+    void createDrawBuffer(size_t draw_count)
+    {
+        draws.resize(draw_count);
+
+        VkBufferCreateInfo buffer_ci{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = draw_count * sizeof(VkDrawIndexedIndirectCommand),
+            .usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        };
+
+        VmaAllocationCreateInfo allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO};
+
+        check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &draw_buffer.buffer,
+                              &draw_buffer.allocation, nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate draw buffer");
+    }
+
+    void writeDraws()
+    {
+        // One indexed draw per mesh slot over its instance range, rewritten whenever a slot's mesh
+        // or its place in the pool changes
+        uint32_t first_instance = 0;
+        for (size_t slot = 0; slot < mesh_slots.size(); slot++)
+        {
+            const Mesh &slot_mesh = meshes.at(mesh_slots[slot]);
+            draws[slot] = {
+                .indexCount = slot_mesh.index_count,
+                .instanceCount = slot_instance_counts[slot],
+                .firstIndex = slot_mesh.first_index,
+                .vertexOffset = static_cast<int32_t>(slot_mesh.vertex_offset),
+                .firstInstance = first_instance};
+            first_instance += slot_instance_counts[slot];
+        }
+
+        uploadDraws();
+    }
+
+    void uploadDraws()
+    {
+        void *ptr;
+        vmaMapMemory(allocator, draw_buffer.allocation, &ptr);
+        memcpy(ptr, draws.data(), draws.size() * sizeof(VkDrawIndexedIndirectCommand));
+        vmaUnmapMemory(allocator, draw_buffer.allocation);
+    }
+
+    void initPagedMesh(const std::string &model_path)
+    {
+        // The offline split, redone only when the page file is missing, older than the model or
+        // of an older format
+        std::string page_path = model_path + ".pages";
+        std::error_code error{};
+        auto build = [&]()
+        {
+            spdlog::info("Build page file: {}", page_path);
+            MeshData data = parseObj(model_path);
+            lve::LvePageFile::build(page_path, data.vertices.data(), sizeof(Vertex), static_cast<uint32_t>(data.vertices.size()),
+                                    data.indices.data(), static_cast<uint32_t>(data.indices.size()));
+        };
+        if (!std::filesystem::exists(page_path) ||
+            std::filesystem::last_write_time(page_path, error) < std::filesystem::last_write_time(model_path, error))
+        {
+            build();
+        }
+
+        try
+        {
+            page_file = std::make_unique<lve::LvePageFile>(page_path);
+        }
+        catch (const std::runtime_error &e)
+        {
+            spdlog::warn("{}", e.what());
+            build();
+            page_file = std::make_unique<lve::LvePageFile>(page_path);
+        }
+        check(page_file->getVertexStride() == sizeof(Vertex), "Page file: Unexpected vertex stride");
+        const auto &clusters = page_file->getClusters();
+        for (const lve::LvePageFile::Cluster &cluster : clusters)
+        {
+            page_culling.add(cluster.center, cluster.radius);
+        }
+        page_bounds = page_file->getBounds();
+
+        // PAGE_POOL_PAGES bounds GPU residency, a handful simulates a tiny memory budget. Without it
+        // MESH_BUDGET_MB does, in whole pages. PAGE_ERROR_PIXELS skips clusters smaller than that on screen.
+        uint32_t page_count = 1024;
+        if (const char *pages = std::getenv("PAGE_POOL_PAGES"))
+        {
+            page_count = std::max<uint32_t>(1, std::strtoul(pages, nullptr, 10));
+        }
+        else if (const char *budget = std::getenv("MESH_BUDGET_MB"))
+        {
+            uint64_t page_bytes = uint64_t{lve::LvePageFile::PAGE_VERTICES} * (sizeof(Vertex) + sizeof(glm::vec3)) +
+                                  uint64_t{lve::LvePageFile::PAGE_INDICES} * sizeof(uint32_t);
+            page_count = static_cast<uint32_t>(std::clamp<uint64_t>((std::strtoull(budget, nullptr, 10) << 20) / page_bytes, 1, 1024));
+        }
+        if (const char *pixels = std::getenv("PAGE_ERROR_PIXELS"))
+        {
+            page_error_pixels = std::strtof(pixels, nullptr);
+        }
+
+        page_table = std::make_unique<lve::LvePageTable>(page_count, static_cast<uint32_t>(clusters.size()));
+        geometry = createGeometryPool(page_count * lve::LvePageFile::PAGE_VERTICES, page_count * lve::LvePageFile::PAGE_INDICES);
+        spdlog::info("Paged mesh: {} clusters, {} page slots", clusters.size(), page_count);
+
+        buildScene(1);
+        uploadInstances();
+        createGraphicsPipeline();
+        createCommandBuffers();
+        createDrawBuffer(page_count);
+        uploadDraws();
+
+        // Where updatePages starts the orbit, the camera stays there
+        glm::vec3 center{page_bounds};
+        glm::vec3 start_eye = center + page_bounds.w * glm::vec3(0.0f, 0.4f, 1.2f);
+        view_proj = pageProjection() * glm::lookAt(start_eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    lve::LveTask<> loadPage(uint32_t cluster, uint32_t slot)
+    {
+        co_await lve::resumeOn(lve::LveJobSystem::get());
+
+        const lve::LvePageFile::Cluster &info = page_file->getClusters()[cluster];
+        Buffer staging{};
+        std::exception_ptr failure{};
+        try
+        {
+            MeshData data{};
+            data.vertices.resize(info.vertexCount);
+            data.indices.resize(info.indexCount);
+            page_file->readPage(cluster, data.vertices.data(), data.indices.data());
+            staging = createStaging(data);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+
+        co_await frame_scheduler.schedule();
+
+        // The page table belongs to the render loop, the slot is given back there
+        if (failure)
+        {
+            page_table->abortLoad(slot);
+            page_loads_in_flight--;
+            std::rethrow_exception(failure);
+        }
+
+        Mesh page{
+            .vertex_offset = slot * lve::LvePageFile::PAGE_VERTICES,
+            .vertex_count = info.vertexCount,
+            .first_index = slot * lve::LvePageFile::PAGE_INDICES,
+            .index_count = info.indexCount};
+        VkCommandBuffer page_command_buffer = beginTransferCommands();
+        recordMeshUpload(page_command_buffer, staging, page);
+        endTransferCommands(page_command_buffer);
+        submit_batch.push_back(page_command_buffer);
+
+        co_await frame_scheduler.waitForFrame(submitted_frames + 1);
+
+        disp.freeCommandBuffers(command_pool, 1, &page_command_buffer);
+        vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+        page_table->endLoad(slot);
+        page_loads_in_flight--;
+    }
+
+    glm::mat4 pageProjection() const
+    {
+        float radius = page_bounds.w;
+        glm::mat4 proj = glm::perspective(
+            glm::radians(45.0f), static_cast<float>(fb_width) / static_cast<float>(fb_height), radius * 0.01f, radius * 4.0f);
+        proj[1][1] *= -1.0f;
+        return proj;
+    }
+
+    void updatePages()
+    {
+        // Slow orbit close to the mesh, so clusters keep entering and leaving the view. The mesh turns
+        // the other way under a fixed camera instead, the camera is recorded into the command buffers.
+        glm::vec3 center{page_bounds};
+        float radius = page_bounds.w;
+        orbit_angle += 0.002f;
+        glm::quat turn = glm::angleAxis(-orbit_angle, glm::vec3(0.0f, 1.0f, 0.0f));
+        scene[0].position_scale = glm::vec4(center - turn * center, 1.0f);
+        scene[0].rotation = glm::vec4(turn.x, turn.y, turn.z, turn.w);
+        writeInstances();
+
+        // Culling works in mesh space, where the camera orbits
+        glm::mat4 proj = pageProjection();
+        eye = center + radius * glm::vec3(1.2f * std::sin(orbit_angle), 0.4f, 1.2f * std::cos(orbit_angle));
+        glm::mat4 mesh_view_proj = proj * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+        // Visible clusters by projected radius, largest first. Below page_error_pixels a cluster changes
+        // the image by less than that and is neither drawn nor loaded.
+        const auto &clusters = page_file->getClusters();
+        page_culling.cull(lve::LveFrustum::fromViewProjection(mesh_view_proj), visible_pages);
+        float pixels_per_unit = 0.5f * static_cast<float>(fb_height) * std::abs(proj[1][1]);
+        page_priorities.clear();
+        for (uint32_t cluster : visible_pages)
+        {
+            const lve::LvePageFile::Cluster &info = clusters[cluster];
+            float distance = std::max(glm::length(info.center - eye) - info.radius, radius * 0.01f);
+            float pixels = info.radius / distance * pixels_per_unit;
+            if (pixels >= page_error_pixels)
+            {
+                page_priorities.emplace_back(pixels, cluster);
+            }
+        }
+        std::sort(page_priorities.begin(), page_priorities.end(), [](const auto &a, const auto &b)
+                  { return a.first > b.first; });
+
+        // Every resident visible cluster is marked used before any load picks a slot, so a load
+        // never evicts a page drawn this frame. Unused draws keep zero instances.
+        uint64_t frame = submitted_frames + 1;
+        bool draws_changed = false;
+        uint32_t draw_count = 0;
+        missing_pages.clear();
+        drawn_pages.clear();
+        for (const auto &[pixels, cluster] : page_priorities)
+        {
+            uint32_t slot = page_table->use(cluster, frame);
+            if (slot == lve::LvePageTable::NO_SLOT)
+            {
+                missing_pages.push_back(cluster);
+                continue;
+            }
+            VkDrawIndexedIndirectCommand draw{
+                .indexCount = clusters[cluster].indexCount,
+                .instanceCount = 1,
+                .firstIndex = slot * lve::LvePageFile::PAGE_INDICES,
+                .vertexOffset = static_cast<int32_t>(slot * lve::LvePageFile::PAGE_VERTICES)};
+            draws_changed |= std::memcmp(&draws[draw_count], &draw, sizeof(draw)) != 0;
+            draws[draw_count++] = draw;
+            drawn_pages.push_back(cluster);
+        }
+        for (size_t i = draw_count; i < draws.size() && draws[i].instanceCount != 0; i++)
+        {
+            draws[i] = {};
+            draws_changed = true;
+        }
+
+        // Missing clusters load largest first while slots and the per-frame load limit allow
+        for (uint32_t cluster : missing_pages)
+        {
+            if (page_loads_in_flight == MAX_PAGE_LOADS)
+            {
+                break;
+            }
+            if (page_table->isLoading(cluster))
+            {
+                continue;
+            }
+            uint32_t slot = page_table->beginLoad(cluster, frame);
+            if (slot == lve::LvePageTable::NO_SLOT)
+            {
+                break;
+            }
+            page_loads_in_flight++;
+            startAssetTask(loadPage(cluster, slot));
+        }
+
+        // With a pool smaller than the visible set, e.g. a few PAGE_POOL_PAGES or a small
+        // MESH_BUDGET_MB, this is what a load evicting a drawn page would break
+        for (uint32_t i = 0; i < draw_count; i++)
+        {
+            check(page_table->use(drawn_pages[i], frame) * lve::LvePageFile::PAGE_INDICES == draws[i].firstIndex,
+                  "Paged mesh: A page drawn this frame was evicted");
+        }
+
+        // The recorded commands read the draws from the draw buffer, only the buffer changes with residency
+        if (draws_changed)
+        {
+            uploadDraws();
+        }
+
+        if (frame % 600 == 0)
+        {
+            spdlog::info("Paged mesh: {} visible clusters, {} drawn, {} of {} pages resident, {} evictions",
+                         page_priorities.size(), draw_count, page_table->getResidentCount(),
+                         page_table->getSlotCount(), page_table->getEvictionCount());
+        }
+    }
+
+    void init()
+    {
+        initGLFW();
+        initVulkan();
+        createSwapchain();
+
+        // DEPTH_PREPASS=1 starts with the depth pre-pass enabled, Z toggles it at runtime
+        if (const char *prepass = std::getenv("DEPTH_PREPASS"))
+        {
+            depth_prepass = std::strtol(prepass, nullptr, 10) != 0;
+        }
+
+        // CREASE_ANGLE=degrees splits generated normals at edges sharper than that, by default they are smooth everywhere
+        if (const char *crease = std::getenv("CREASE_ANGLE"))
+        {
+            crease_angle = glm::radians(std::strtof(crease, nullptr));
+        }
+
+        // PAGED_MESH=path.obj renders that mesh out of core, split into a page file next to it
+        if (const char *paged_mesh = std::getenv("PAGED_MESH"))
+        {
+            initPagedMesh(paged_mesh);
+        }
+        else
+        {
+            initMeshSlots();
+        }
+    }
+    void initMeshSlots()
+    {
+        geometry = createGeometryPool(POOL_VERTICES, POOL_INDICES);
+
+        // MESHES lists the .obj, .glb or vp_cook .lvemesh files the slots cycle through with N, separated by semicolons
+        std::string meshes_env = "assets/Teapot.obj;assets/Monkey.obj";
+        if (const char *paths = std::getenv("MESHES"))
+        {
+            meshes_env = paths;
+        }
+        for (size_t begin = 0; begin <= meshes_env.size();)
+        {
+            size_t end = std::min(meshes_env.find(';', begin), meshes_env.size());
+            if (end > begin)
+            {
+                mesh_paths.push_back(meshes_env.substr(begin, end - begin));
+            }
+            begin = end + 1;
+        }
+        check(!mesh_paths.empty(), "MESHES: No mesh paths");
+
+        // INSTANCE_COUNT scales the scene for benchmarking, e.g. 1 to 100000. One instance per slot by default.
+        size_t instance_count = SLOT_COUNT;
+        if (const char *count = std::getenv("INSTANCE_COUNT"))
+        {
+            instance_count = std::max<size_t>(1, std::strtoull(count, nullptr, 10));
+        }
+        buildScene(instance_count);
+        uploadInstances();
+        createGraphicsPipeline();
+        createCommandBuffers();
+
+        // MESH_BUDGET_MB caps the pool bytes held by meshes, by default half of what VMA reports as
+        // the pool heap's budget, from VK_EXT_memory_budget when available
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+        vmaGetHeapBudgets(allocator, budgets);
+        mesh_budget = budgets[geometryHeap()].budget / 2;
+        if (const char *budget = std::getenv("MESH_BUDGET_MB"))
+        {
+            mesh_budget = std::strtoull(budget, nullptr, 10) << 20;
+        }
+        spdlog::info("Asset manager: Mesh budget {} bytes{}", mesh_budget,
+                     memory_budget_supported ? "" : ", VK_EXT_memory_budget not supported");
+
+        // Drawn in every slot until the first meshes have streamed in
+        placeholder_id = assets.intern("placeholder");
+        assets.acquire(placeholder_id);
+        meshes[placeholder_id] = uploadNow(placeholderMesh());
+        assets.markResident(placeholder_id, meshBytes(meshes[placeholder_id]));
+        mesh_slots.assign(SLOT_COUNT, placeholder_id);
+        slot_requests.assign(SLOT_COUNT, placeholder_id);
+        for (size_t slot = 1; slot < SLOT_COUNT; slot++)
+        {
+            assets.acquire(placeholder_id);
+        }
+        createDrawBuffer(SLOT_COUNT);
+        writeDraws();
+
+        for (size_t slot = 0; slot < SLOT_COUNT; slot++)
+        {
+            requestSlot(slot, mesh_paths[slot % mesh_paths.size()]);
+        }
+    }
+    void renderLoop()
+    {
+        spdlog::info("Enter render loop");
+
+        uint32_t img_idx{};
+
+        VkFenceCreateInfo fence_ci{
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+
+        VkFence swapchain_fence{}, render_fence{};
+        check(
+            disp.createFence(&fence_ci, nullptr, &swapchain_fence) == VK_SUCCESS,
+            "Vulkan: Failed to create swapchain fence");
+        check(
+            disp.createFence(&fence_ci, nullptr, &render_fence) == VK_SUCCESS,
+            "Vulkan: Failed to create render fence");
+
+        VkSubmitInfo submit_info{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1};
+
+        VkPresentInfoKHR present_info{
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .swapchainCount = 1,
+            .pSwapchains = &vkb_swapchain.swapchain};
+
+        // Record commands in advance
+        recordCommandBuffers();
+
+        using Phase = lve::LveFrameTelemetry::Phase;
+        using Clock = std::chrono::steady_clock;
+
+        while (!glfwWindowShouldClose(window))
+        {
+            frame_telemetry.beginFrame();
+            record_time = {};
+            auto phase_start = Clock::now();
+            auto phase_record_time = record_time;
+            // Command buffers are re-recorded by whatever changed them, that span counts as Record
+            // and not as the phase it happened in
+            auto endPhase = [&](Phase phase)
+            {
+                auto now = Clock::now();
+                frame_telemetry.addPhaseTime(phase, now - phase_start - (record_time - phase_record_time));
+                phase_start = now;
+                phase_record_time = record_time;
+            };
+
+            glfwPollEvents();
+
+            // P toggles pipeline statistics queries, Z the depth pre-pass, both re-record the command buffers.
+            // F flips the instance order to compare front to back against back to front, N cycles the meshes.
+            if (keyPressed(GLFW_KEY_P, statistics_key_down))
+            {
+                toggleStatistics();
+            }
+            if (keyPressed(GLFW_KEY_Z, depth_prepass_key_down))
+            {
+                toggleDepthPrepass();
+            }
+            if (keyPressed(GLFW_KEY_F, sort_key_down))
+            {
+                toggleSortOrder();
+            }
+            if (keyPressed(GLFW_KEY_N, cycle_key_down) && !page_file)
+            {
+                cycleMeshes();
+            }
+            endPhase(Phase::Poll);
+
+            // Wait until all commands have executed on graphics queue
+            disp.waitForFences(1, &render_fence, VK_TRUE, 1000000000);
+
+            // Everything submitted so far has completed, resume the asset coroutines waiting on it
+            completed_frames = submitted_frames;
+            frame_scheduler.pump(completed_frames);
+            // A failed load has cleaned up after itself, the frame goes on without it
+            for (lve::LveTask<> &task : asset_tasks)
+            {
+                if (task.isDone())
+                {
+                    try
+                    {
+                        task.get();
+                    }
+                    catch (const std::exception &e)
+                    {
+                        spdlog::error("Asset load failed: {}", e.what());
+                    }
+                }
+            }
+            std::erase_if(asset_tasks, [](const lve::LveTask<> &task)
+                          { return task.isDone(); });
+            if (page_file)
+            {
+                updatePages();
+            }
+            // Other applications may take memory from the heap at any time
+            else if (submitted_frames % 60 == 0)
+            {
+                enforceMeshBudget();
+            }
+
+            // The previous frame is complete, so its queries can be read without waiting. The frame
+            // before the toggle was recorded without them.
+            if (statistics_enabled && ++statistics_frames > 1)
+            {
+                sampleStatistics(img_idx, statistics_frames % 600 == 0);
+            }
+
+            disp.resetFences(1, &swapchain_fence);
+            disp.acquireNextImageKHR(
+                vkb_swapchain.swapchain, 1000000000, VK_NULL_HANDLE, swapchain_fence, &img_idx);
+
+            // Wait until next image is acquired
+            disp.waitForFences(1, &swapchain_fence, VK_TRUE, 1000000000);
+            endPhase(Phase::AcquireWait);
+
+            disp.resetFences(1, &render_fence);
+            submit_batch.push_back(command_buffers[img_idx]);
+            submit_info.commandBufferCount = static_cast<uint32_t>(submit_batch.size());
+            submit_info.pCommandBuffers = submit_batch.data();
+            disp.queueSubmit(graphics_queue, 1, &submit_info, render_fence);
+            submit_batch.clear();
+            submitted_frames++;
+            endPhase(Phase::Submit);
+
+            present_info.pImageIndices = &img_idx,
+            disp.queuePresentKHR(graphics_queue, &present_info);
+            endPhase(Phase::Present);
+
+            if (submitted_frames == 1)
+            {
+                auto elapsed = Clock::now() - start_time;
+                spdlog::info("First frame after {} ms",
+                             std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+            }
+
+            frame_telemetry.addPhaseTime(Phase::Record, record_time);
+            frame_telemetry.endFrame();
+            frame_telemetry.update();
+        }
+
+        disp.deviceWaitIdle();
+
+        // A mesh still streaming in finishes first, so its staging buffers are released
+        while (std::any_of(asset_tasks.begin(), asset_tasks.end(), [](const lve::LveTask<> &task)
+                           { return !task.isDone(); }))
+        {
+            frame_scheduler.pump(UINT64_MAX);
+            std::this_thread::yield();
+        }
+        submit_batch.clear();
+
+        frame_telemetry.drain();
+        frame_telemetry.logSummary();
+        if (const char *telemetry_path = std::getenv("LVE_TELEMETRY"))
+        {
+            frame_telemetry.writeSummary(telemetry_path);
+        }
+        // Same file and layout as the lve app, so one script reads both
+        if (!scene_statistics.empty())
+        {
+            writeStatistics("pipeline_statistics.json");
+        }
+        disp.destroyFence(swapchain_fence, nullptr);
+        disp.destroyFence(render_fence, nullptr);
+    }
+    void destroySwapchain()
+    {
+        spdlog::info("Destroy swapchain");
+
+        for (const auto &frame_buffer : frame_buffers)
+        {
+            disp.destroyFramebuffer(frame_buffer, nullptr);
+        }
+
+        for (const auto &image_view : swapchain_image_views)
+        {
+            disp.destroyImageView(image_view, nullptr);
+        }
+
+        disp.destroyImageView(depth_image_view, nullptr);
+        vmaDestroyImage(allocator, depth_image.image, depth_image.allocation);
 
         vkb::destroy_swapchain(vkb_swapchain);
     }
@@ -546,27 +2345,34 @@ private:
     {
         spdlog::info("Destroy graphics pipeline");
 
-        vkDestroyPipeline(vkb_device, graphics_pipeline, nullptr);
-        vkDestroyRenderPass(vkb_device.device, render_pass, nullptr);
-        vkDestroyPipelineLayout(vkb_device.device, pipeline_layout, nullptr);
+        disp.destroyPipeline(graphics_pipeline, nullptr);
+        disp.destroyPipeline(equal_pipeline, nullptr);
+        disp.destroyPipeline(prepass_pipeline, nullptr);
+        disp.destroyRenderPass(render_pass, nullptr);
+        disp.destroyPipelineLayout(pipeline_layout, nullptr);
 
         for (const auto &shader_stage_ci : shader_stage_cis)
         {
-            vkDestroyShaderModule(vkb_device.device, shader_stage_ci.module, nullptr);
+            disp.destroyShaderModule(shader_stage_ci.module, nullptr);
         }
+        disp.destroyShaderModule(prepass_stage_ci.module, nullptr);
     }
     void discardMesh()
     {
         spdlog::info("Discard mesh");
 
-        vmaDestroyBuffer(allocator, data_buffer.buffer, data_buffer.allocation);
+        destroyGeometryPool(geometry);
+        meshes.clear();
+        vmaDestroyBuffer(allocator, instance_buffer.buffer, instance_buffer.allocation);
+        vmaDestroyBuffer(allocator, draw_buffer.buffer, draw_buffer.allocation);
     }
     void cleanup()
     {
         spdlog::info("Cleanup");
 
         discardMesh();
-        vkDestroyCommandPool(vkb_device.device, command_pool, nullptr);
+        disp.destroyQueryPool(statistics_pool, nullptr);
+        disp.destroyCommandPool(command_pool, nullptr);
         destroyGraphicsPipeline();
         destroySwapchain();
         vmaDestroyAllocator(allocator);
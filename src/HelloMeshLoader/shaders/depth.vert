@@ -0,0 +1,21 @@
+#version 450
+
+layout (location = 0) in vec3 inPosition;
+layout (location = 2) in vec4 inPositionScale;
+layout (location = 3) in vec4 inRotation;
+
+layout (push_constant) uniform Camera {
+    mat4 viewProj;
+} camera;
+
+// Must match shader.vert exactly, the shading pass tests against this depth with EQUAL
+invariant gl_Position;
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+void main() {
+    vec3 worldPosition = rotate(inRotation, inPosition * inPositionScale.w) + inPositionScale.xyz;
+    gl_Position = camera.viewProj * vec4(worldPosition, 1.0);
+}
@@ -2,9 +2,23 @@
 
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec4 inPositionScale;
+layout (location = 3) in vec4 inRotation;
 layout (location = 0) out vec3 outColor;
 
+layout (push_constant) uniform Camera {
+    mat4 viewProj;
+} camera;
+
+// Keeps depth bit-identical to depth.vert for the EQUAL test after the pre-pass
+invariant gl_Position;
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
 void main() {
-    gl_Position = vec4(inPosition.x, -1.0 * inPosition.y, inPosition.z, 1.0);
-    outColor = inNormal;
-}
\ No newline at end of file
+    vec3 worldPosition = rotate(inRotation, inPosition * inPositionScale.w) + inPositionScale.xyz;
+    gl_Position = camera.viewProj * vec4(worldPosition, 1.0);
+    outColor = rotate(inRotation, inNormal);
+}
@@ -0,0 +1,970 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#define VMA_IMPLEMENTATION
+#define VMA_VULKAN_VERSION 1000000
+#include "vk_mem_alloc.h"
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <VkBootstrap.h>
+#include <spdlog/spdlog.h>
+#include <lve_frustum_culling.hpp>
+#include <lve_point_cloud.hpp>
+
+class HelloPointCloud
+{
+public:
+    void run()
+    {
+        init();
+        renderLoop();
+        cleanup();
+    }
+
+private:
+    VmaAllocator allocator{};
+    GLFWwindow *window{};
+    const uint32_t WIDTH = 800, HEIGHT = 600;
+    uint32_t fb_width{}, fb_height{};
+    vkb::Instance vkb_instance{};
+    VkSurfaceKHR surface{};
+    vkb::Device vkb_device{};
+    vkb::DispatchTable disp{};
+    VkQueue graphics_queue{};
+    vkb::Swapchain vkb_swapchain{};
+    std::vector<VkImageView> swapchain_image_views{};
+    VkPipelineShaderStageCreateInfo shader_stage_cis[2]{};
+    VkPipeline graphics_pipeline{};
+    VkPipelineLayout pipeline_layout{};
+    VkRenderPass render_pass{};
+    VkCommandPool command_pool{};
+    std::vector<VkCommandBuffer> command_buffers{};
+    std::vector<VkFramebuffer> frame_buffers{};
+    struct Buffer
+    {
+        VkBuffer buffer;
+        VmaAllocation allocation;
+    };
+    struct Image
+    {
+        VkImage image;
+        VmaAllocation allocation;
+    } depth_image{};
+    VkImageView depth_image_view{};
+    VkFormat depth_format{};
+    // Every point of the cloud in octree order, each node one draw of its range
+    lve::LvePointCloud cloud{};
+    Buffer point_buffer{};
+    // One indirect draw per selected node, rewritten every frame
+    Buffer draw_buffer{};
+    VkDrawIndirectCommand *mapped_draws{};
+    uint32_t draw_count{};
+    bool multi_draw_indirect{};
+    std::vector<uint32_t> selected_nodes{};
+    uint64_t selected_points{};
+    // POINT_BUDGET caps the points drawn per frame, POINT_SPACING_PIXELS stops refining nodes whose
+    // point spacing is below it on screen. L toggles the level of detail, without it every point is drawn.
+    uint64_t point_budget{10'000'000};
+    float spacing_pixels{1.0f};
+    bool lod_enabled{true}, lod_key_down{};
+    float orbit_angle{};
+    glm::mat4 view_proj_model{1.0f};
+    // POINT_BENCHMARK=1 steps through point budgets and logs the frame cost of each
+    bool benchmark{};
+    std::vector<uint64_t> benchmark_budgets{};
+    size_t benchmark_step{};
+    uint32_t benchmark_frames{};
+    double benchmark_frame_seconds{}, benchmark_select_seconds{};
+    uint64_t benchmark_points{};
+    const uint32_t BENCHMARK_WARMUP = 30, BENCHMARK_FRAMES = 300;
+
+    inline void check(auto val, const char *msg)
+    {
+#ifdef NDEBUG
+        (void)val;
+        (void)msg;
+        if (!val)
+        {
+            exit(EXIT_FAILURE);
+        }
+#else
+        if (!val)
+        {
+            throw std::runtime_error(msg);
+        }
+#endif
+    }
+    void initGLFW()
+    {
+        spdlog::info("GLFW: Initialize");
+        check(glfwInit(), "GLFW: Failed to initialize");
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        window = glfwCreateWindow(WIDTH, HEIGHT, "HelloPointCloud", nullptr, nullptr);
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        fb_width = static_cast<uint32_t>(width);
+        fb_height = static_cast<uint32_t>(height);
+    }
+    void initVulkan()
+    {
+        spdlog::info("VkBootstrap: Initialize");
+
+        vkb::InstanceBuilder vkb_inst_buildr{};
+#ifdef NDEBUG
+        auto inst_ret = vkb_inst_buildr.set_app_name("HelloPointCloud").build();
+#else
+        auto inst_ret = vkb_inst_buildr.set_app_name("HelloPointCloud")
+                            .enable_validation_layers()
+                            .use_default_debug_messenger()
+                            .build();
+#endif
+        check(inst_ret, "Vulkan: Failed to create instance");
+        vkb_instance = inst_ret.value();
+
+        check(glfwCreateWindowSurface(vkb_instance.instance, window, nullptr, &surface) == VK_SUCCESS,
+              "Vulkan: Failed to create window surface");
+
+        vkb::PhysicalDeviceSelector vkb_phys_dev_selectr{vkb_instance};
+        auto phys_dev_ret = vkb_phys_dev_selectr.set_minimum_version(1, 0).set_surface(surface).select();
+        check(phys_dev_ret, "Vulkan: Failed to select physical device");
+
+        // All selected nodes in one indirect call, otherwise one direct draw per node
+        VkPhysicalDeviceFeatures supported_features{};
+        vkGetPhysicalDeviceFeatures(phys_dev_ret.value().physical_device, &supported_features);
+        if (supported_features.multiDrawIndirect)
+        {
+            VkPhysicalDeviceFeatures indirect_features{.multiDrawIndirect = VK_TRUE};
+            multi_draw_indirect = phys_dev_ret.value().enable_features_if_present(indirect_features);
+        }
+
+        vkb::DeviceBuilder vkb_dev_buildr{phys_dev_ret.value()};
+        auto dev_ret = vkb_dev_buildr.build();
+        check(dev_ret, "Vulkan: Failed to create logical device");
+        vkb_device = dev_ret.value();
+        disp = vkb_device.make_table();
+
+        VmaAllocatorCreateInfo allocator_ci{
+            .physicalDevice = phys_dev_ret.value(),
+            .device = vkb_device.device,
+            .instance = vkb_instance,
+            .vulkanApiVersion = VK_API_VERSION_1_0,
+        };
+
+        check(vmaCreateAllocator(&allocator_ci, &allocator) == VK_SUCCESS, "VMA: Failed to create allocator");
+
+        auto graphics_queue_ret = vkb_device.get_queue(vkb::QueueType::graphics);
+        check(graphics_queue_ret, "Vulkan: Failed to get graphics queue");
+        graphics_queue = graphics_queue_ret.value();
+    }
+    void createSwapchain()
+    {
+        spdlog::info("Create swapchain");
+
+        VkSurfaceFormatKHR surf_format{
+            .format = VK_FORMAT_B8G8R8A8_UNORM,
+        };
+
+        vkb::SwapchainBuilder vkb_swapchain_buildr{vkb_device};
+        auto swapchain_ret = vkb_swapchain_buildr
+                                 .set_desired_format(surf_format)
+                                 .set_desired_min_image_count(3)
+                                 .build();
+        check(swapchain_ret, "Vulkan: Failed to create swapchain");
+        vkb_swapchain = swapchain_ret.value();
+
+        swapchain_image_views = vkb_swapchain.get_image_views().value();
+    }
+    std::vector<char> readFile(const std::string &path)
+    {
+        std::ifstream file(path, std::ios_base::binary);
+        check(file.is_open(), "Failed to open file");
+
+        file.seekg(0, std::ios_base::end);
+        size_t file_size = file.tellg();
+        check(file_size, "File is empty");
+        file.seekg(std::ios_base::beg);
+
+        std::vector<char> buffer(file_size);
+        file.read(buffer.data(), file_size);
+        check(buffer.size() == file_size, "Failed to read file completely");
+
+        return buffer;
+    }
+    VkShaderModule loadShaderModule(const std::string &path)
+    {
+        spdlog::info("Load shader: {}", path);
+
+        // check exits silently in release builds, so say which file it is before
+        if (!std::filesystem::exists(path))
+        {
+            spdlog::error("Missing shader {}, building HelloPointCloud compiles it into the build directory, run from there", path);
+        }
+        check(std::filesystem::exists(path), "Missing shader");
+
+        std::vector<char> code = readFile(path);
+
+        VkShaderModuleCreateInfo shader_module_ci{};
+        shader_module_ci.codeSize = code.size();
+        shader_module_ci.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        shader_module_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+        VkShaderModule shader_module{};
+        check(disp.createShaderModule(&shader_module_ci, nullptr, &shader_module) == VK_SUCCESS,
+              "Failed to create shader module");
+
+        return shader_module;
+    }
+    void setupShaderStage()
+    {
+        VkShaderModule shader_modules[2] = {loadShaderModule("shaders/point_vert.spv"),
+                                            loadShaderModule("shaders/point_frag.spv")};
+
+        for (int i = 0; i < 2; i++)
+        {
+            shader_stage_cis[i].module = shader_modules[i];
+            shader_stage_cis[i].pName = "main";
+            shader_stage_cis[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        }
+
+        shader_stage_cis[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shader_stage_cis[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    VkFormat findDepthFormat()
+    {
+        for (VkFormat format : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT})
+        {
+            VkFormatProperties properties{};
+            vkGetPhysicalDeviceFormatProperties(vkb_device.physical_device.physical_device, format, &properties);
+            if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+            {
+                return format;
+            }
+        }
+        check(false, "Vulkan: Failed to find supported depth format");
+        return VK_FORMAT_UNDEFINED;
+    }
+    void createDepthImage()
+    {
+        depth_format = findDepthFormat();
+
+        VkImageCreateInfo image_ci{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = depth_format,
+            .extent = {fb_width, fb_height, 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+
+        VmaAllocationCreateInfo allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE};
+
+        check(vmaCreateImage(allocator, &image_ci, &allocation_ci, &depth_image.image,
+                             &depth_image.allocation, nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate depth image");
+
+        VkImageViewCreateInfo image_view_ci{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = depth_image.image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = depth_format,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .levelCount = 1,
+                .layerCount = 1}};
+
+        check(disp.createImageView(&image_view_ci, nullptr, &depth_image_view) == VK_SUCCESS,
+              "Vulkan: Failed to create depth image view");
+    }
+    void createRenderPass()
+    {
+        createDepthImage();
+
+        VkAttachmentDescription attachment_descs[2] = {
+            VkAttachmentDescription{
+                .format = vkb_swapchain.image_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR},
+            VkAttachmentDescription{
+                .format = depth_format,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+                .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+        };
+
+        VkAttachmentReference color_attachment_ref{
+            .attachment = 0,
+            .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+        VkAttachmentReference depth_attachment_ref{
+            .attachment = 1,
+            .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+        VkSubpassDescription subpass_desc{
+            .colorAttachmentCount = 1,
+            .pColorAttachments = &color_attachment_ref,
+            .pDepthStencilAttachment = &depth_attachment_ref,
+        };
+
+        // All framebuffers share one depth image, so the clear waits for the previous frame's depth writes
+        VkSubpassDependency subpass_dependency{
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
+
+        VkRenderPassCreateInfo render_pass_ci{
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+            .attachmentCount = 2,
+            .pAttachments = attachment_descs,
+            .subpassCount = 1,
+            .pSubpasses = &subpass_desc,
+            .dependencyCount = 1,
+            .pDependencies = &subpass_dependency};
+
+        check(
+            disp.createRenderPass(&render_pass_ci, nullptr, &render_pass) == VK_SUCCESS,
+            "Vulkan: Failed to create render pass");
+
+        frame_buffers.resize(vkb_swapchain.image_count);
+
+        VkFramebufferCreateInfo frame_buffer_ci{
+            .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass = render_pass,
+            .attachmentCount = 2,
+            .width = fb_width,
+            .height = fb_height,
+            .layers = 1};
+
+        for (int i = 0; i < frame_buffers.size(); i++)
+        {
+            VkImageView attachments[2] = {swapchain_image_views[i], depth_image_view};
+            frame_buffer_ci.pAttachments = attachments;
+
+            check(
+                disp.createFramebuffer(&frame_buffer_ci, nullptr, &frame_buffers[i]) == VK_SUCCESS,
+                "Vulkan: Failed to create frame buffer");
+        }
+    }
+
+    void createGraphicsPipeline()
+    {
+        spdlog::info("Create graphics pipeline");
+
+        setupShaderStage();
+
+        VkVertexInputBindingDescription vertex_input_bd{
+            .binding = 0,
+            .stride = sizeof(lve::LvePoint),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+
+        // Both formats are mandatory for vertex buffers
+        VkVertexInputAttributeDescription vertex_input_ads[2] = {
+            VkVertexInputAttributeDescription{
+                .location = 0,
+                .binding = 0,
+                .format = VK_FORMAT_R16G16B16A16_UNORM,
+                .offset = static_cast<uint32_t>(offsetof(lve::LvePoint, position))},
+            VkVertexInputAttributeDescription{
+                .location = 1,
+                .binding = 0,
+                .format = VK_FORMAT_R8G8B8A8_UNORM,
+                .offset = static_cast<uint32_t>(offsetof(lve::LvePoint, color))},
+        };
+
+        VkPipelineVertexInputStateCreateInfo vertex_input_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .vertexBindingDescriptionCount = 1,
+            .pVertexBindingDescriptions = &vertex_input_bd,
+            .vertexAttributeDescriptionCount = 2,
+            .pVertexAttributeDescriptions = vertex_input_ads};
+
+        VkViewport viewport{.width = static_cast<float>(fb_width), .height = static_cast<float>(fb_height), .maxDepth = 1.0f};
+
+        VkRect2D scissor{};
+        scissor.extent = {
+            .width = fb_width,
+            .height = fb_height,
+        };
+
+        VkPipelineViewportStateCreateInfo viewport_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+            .viewportCount = 1,
+            .pViewports = &viewport,
+            .scissorCount = 1,
+            .pScissors = &scissor};
+
+        VkPipelineInputAssemblyStateCreateInfo input_assembly_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+            .topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST};
+
+        VkPipelineRasterizationStateCreateInfo rasterization_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+            .lineWidth = 1.0f};
+
+        VkPipelineMultisampleStateCreateInfo multisample_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
+
+        VkPipelineDepthStencilStateCreateInfo depth_stencil_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .depthTestEnable = VK_TRUE,
+            .depthWriteEnable = VK_TRUE,
+            .depthCompareOp = VK_COMPARE_OP_LESS};
+
+        VkPipelineColorBlendAttachmentState color_blend_attachment_state{
+            .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT};
+
+        VkPipelineColorBlendStateCreateInfo color_blend_sci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+            .attachmentCount = 1,
+            .pAttachments = &color_blend_attachment_state};
+
+        VkPushConstantRange push_constant_range{
+            .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+            .offset = 0,
+            .size = sizeof(glm::mat4)};
+
+        VkPipelineLayoutCreateInfo pipeline_layout_ci{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &push_constant_range,
+        };
+
+        check(disp.createPipelineLayout(&pipeline_layout_ci, nullptr, &pipeline_layout) == VK_SUCCESS,
+              "Vulkan: Failed to create pipeline layout");
+
+        createRenderPass();
+
+        VkGraphicsPipelineCreateInfo graphics_pipeline_ci{
+            .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+            .stageCount = 2,
+            .pStages = shader_stage_cis,
+            .pVertexInputState = &vertex_input_sci,
+            .pInputAssemblyState = &input_assembly_sci,
+            .pViewportState = &viewport_sci,
+            .pRasterizationState = &rasterization_sci,
+            .pMultisampleState = &multisample_sci,
+            .pDepthStencilState = &depth_stencil_sci,
+            .pColorBlendState = &color_blend_sci,
+            .layout = pipeline_layout,
+            .renderPass = render_pass};
+
+        check(
+            disp.createGraphicsPipelines(
+                nullptr, 1, &graphics_pipeline_ci, nullptr, &graphics_pipeline) == VK_SUCCESS,
+            "Vulkan: Failed to create graphics pipeline");
+    }
+    void createCommandBuffers()
+    {
+        VkCommandPoolCreateInfo command_pool_ci{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+            .queueFamilyIndex = vkb_device.get_queue_index(vkb::QueueType::graphics).value()};
+
+        check(
+            disp.createCommandPool(&command_pool_ci, nullptr, &command_pool) == VK_SUCCESS,
+            "Vulkan: Failed to create command pool");
+
+        command_buffers.resize(vkb_swapchain.image_count);
+
+        VkCommandBufferAllocateInfo command_buffer_ai{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = command_pool,
+            .commandBufferCount = static_cast<uint32_t>(command_buffers.size())};
+
+        check(
+            disp.allocateCommandBuffers(&command_buffer_ai, command_buffers.data()) == VK_SUCCESS,
+            "Vulkan: Failed to allocate command buffers");
+    }
+
+    void loadCloud()
+    {
+        // POINT_CLOUD=capture.ply loads a capture, otherwise POINT_COUNT points of procedural terrain
+        auto start = std::chrono::steady_clock::now();
+        uint64_t file_bytes = 0;
+        if (const char *path = std::getenv("POINT_CLOUD"))
+        {
+            spdlog::info("Load point cloud: {}", path);
+            cloud = lve::LvePointCloud::loadPly(path);
+            std::ifstream file(path, std::ios_base::binary | std::ios_base::ate);
+            file_bytes = static_cast<uint64_t>(file.tellg());
+        }
+        else
+        {
+            uint32_t point_count = 20'000'000;
+            if (const char *count = std::getenv("POINT_COUNT"))
+            {
+                point_count = std::max<uint32_t>(1, std::strtoul(count, nullptr, 10));
+            }
+            spdlog::info("Generate point cloud: {} points", point_count);
+            cloud = lve::LvePointCloud::generate(point_count, 1);
+        }
+
+        const lve::LvePointCloud::LoadTimes &times = cloud.getLoadTimes();
+        double points = static_cast<double>(cloud.getPoints().size());
+        spdlog::info("Point cloud: {} points, {} nodes, depth {}", cloud.getPoints().size(), cloud.getNodes().size(),
+                     cloud.getDepth());
+        spdlog::info("Point cloud: Read and quantize {:.2f} s ({:.1f} M points/s), octree {:.2f} s ({:.1f} M points/s)",
+                     times.read, points / times.read / 1e6, times.build, points / times.build / 1e6);
+        if (file_bytes)
+        {
+            spdlog::info("Point cloud: Read {} bytes at {:.0f} MB/s", file_bytes,
+                         static_cast<double>(file_bytes) / times.read / 1e6);
+        }
+
+        uploadPoints();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info("Point cloud: Ready after {:.2f} s, {:.1f} M points/s end to end", elapsed, points / elapsed / 1e6);
+    }
+    void uploadPoints()
+    {
+        auto start = std::chrono::steady_clock::now();
+        const std::vector<lve::LvePoint> &points = cloud.getPoints();
+        VkDeviceSize point_bytes = points.size() * sizeof(lve::LvePoint);
+
+        VkBufferCreateInfo buffer_ci{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = point_bytes,
+            .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        };
+
+        VmaAllocationCreateInfo allocation_ci{.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE};
+
+        check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &point_buffer.buffer, &point_buffer.allocation,
+                              nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate point buffer");
+
+        // A fixed staging chunk reused per copy keeps host memory flat for clouds of any size
+        const VkDeviceSize CHUNK_BYTES = VkDeviceSize{64} << 20;
+        VkDeviceSize chunk_bytes = std::min(CHUNK_BYTES, point_bytes);
+        VkBufferCreateInfo staging_ci{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = chunk_bytes,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        };
+
+        VmaAllocationCreateInfo staging_allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO};
+
+        Buffer staging{};
+        check(vmaCreateBuffer(allocator, &staging_ci, &staging_allocation_ci, &staging.buffer, &staging.allocation,
+                              nullptr) == VK_SUCCESS,
+              "VMA: Failed to allocate staging buffer");
+
+        VkCommandBufferAllocateInfo command_buffer_ai{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = command_pool,
+            .commandBufferCount = 1};
+
+        VkCommandBuffer command_buffer{};
+        check(
+            disp.allocateCommandBuffers(&command_buffer_ai, &command_buffer) == VK_SUCCESS,
+            "Vulkan: Failed to allocate transfer command buffer");
+
+        VkCommandBufferBeginInfo command_buffer_bi{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+        VkSubmitInfo submit_info{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &command_buffer};
+
+        void *ptr;
+        vmaMapMemory(allocator, staging.allocation, &ptr);
+        for (VkDeviceSize offset = 0; offset < point_bytes; offset += chunk_bytes)
+        {
+            VkDeviceSize size = std::min(chunk_bytes, point_bytes - offset);
+            memcpy(ptr, reinterpret_cast<const std::byte *>(points.data()) + offset, size);
+
+            VkBufferCopy region{.dstOffset = offset, .size = size};
+            disp.resetCommandBuffer(command_buffer, 0);
+            disp.beginCommandBuffer(command_buffer, &command_buffer_bi);
+            disp.cmdCopyBuffer(command_buffer, staging.buffer, point_buffer.buffer, 1, &region);
+            disp.endCommandBuffer(command_buffer);
+            disp.queueSubmit(graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
+            disp.queueWaitIdle(graphics_queue);
+        }
+        vmaUnmapMemory(allocator, staging.allocation);
+
+        disp.freeCommandBuffers(command_pool, 1, &command_buffer);
+        vmaDestroyBuffer(allocator, staging.buffer, staging.allocation);
+
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info("VMA: Upload {} point bytes in {:.2f} s ({:.0f} MB/s)", point_bytes, elapsed,
+                     static_cast<double>(point_bytes) / elapsed / 1e6);
+    }
+    void createDrawBuffer()
+    {
+        // Host visible and persistently mapped, one slot per node so any selection fits
+        VkBufferCreateInfo buffer_ci{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = cloud.getNodes().size() * sizeof(VkDrawIndirectCommand),
+            .usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        };
+
+        VmaAllocationCreateInfo allocation_ci{
+            .flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            .usage = VMA_MEMORY_USAGE_AUTO};
+
+        VmaAllocationInfo allocation_info{};
+        check(vmaCreateBuffer(allocator, &buffer_ci, &allocation_ci, &draw_buffer.buffer, &draw_buffer.allocation,
+                              &allocation_info) == VK_SUCCESS,
+              "VMA: Failed to allocate draw buffer");
+        mapped_draws = static_cast<VkDrawIndirectCommand *>(allocation_info.pMappedData);
+    }
+
+    void updateCamera()
+    {
+        // Orbits the cloud while moving in and out, so detail has to follow the distance
+        glm::vec3 center = cloud.getOrigin() + glm::vec3(0.5f * cloud.getSize());
+        float size = cloud.getSize();
+        orbit_angle += 0.003f;
+        float distance = size * (0.45f + 0.35f * std::sin(orbit_angle * 0.7f));
+        glm::vec3 eye = center + glm::vec3(distance * std::sin(orbit_angle), 0.35f * distance, distance * std::cos(orbit_angle));
+
+        glm::mat4 proj = glm::perspective(
+            glm::radians(45.0f), static_cast<float>(fb_width) / static_cast<float>(fb_height), size * 0.001f, size * 4.0f);
+        proj[1][1] *= -1.0f;
+        glm::mat4 view_proj = proj * glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+        // UNORM positions to world, folded into the matrix the shader applies
+        glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), cloud.getOrigin()), glm::vec3(size));
+        view_proj_model = view_proj * model;
+
+        auto start = std::chrono::steady_clock::now();
+        if (lod_enabled)
+        {
+            float pixels_per_unit = 0.5f * static_cast<float>(fb_height) * std::abs(proj[1][1]);
+            selected_points = cloud.select(lve::LveFrustum::fromViewProjection(view_proj), eye, pixels_per_unit,
+                                           spacing_pixels, point_budget, selected_nodes);
+        }
+        else
+        {
+            selected_nodes.resize(cloud.getNodes().size());
+            for (uint32_t i = 0; i < selected_nodes.size(); i++)
+            {
+                selected_nodes[i] = i;
+            }
+            selected_points = cloud.getPoints().size();
+        }
+
+        draw_count = static_cast<uint32_t>(selected_nodes.size());
+        for (uint32_t i = 0; i < draw_count; i++)
+        {
+            const lve::LvePointCloud::Node &node = cloud.getNodes()[selected_nodes[i]];
+            mapped_draws[i] = {
+                .vertexCount = node.pointCount,
+                .instanceCount = 1,
+                .firstVertex = node.firstPoint};
+        }
+        benchmark_select_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    void recordCommandBuffer(uint32_t img_idx)
+    {
+        VkCommandBuffer command_buffer = command_buffers[img_idx];
+
+        VkCommandBufferBeginInfo command_buffer_bi{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+
+        VkClearValue clear_values[2] = {
+            VkClearValue{.color = VkClearColorValue{{0.0f, 0.0f, 0.0f, 1.0f}}},
+            VkClearValue{.depthStencil = VkClearDepthStencilValue{1.0f, 0}},
+        };
+
+        VkRenderPassBeginInfo render_pass_bi{
+            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass = render_pass,
+            .framebuffer = frame_buffers[img_idx],
+            .clearValueCount = 2,
+            .pClearValues = clear_values,
+        };
+        render_pass_bi.renderArea.extent.width = fb_width;
+        render_pass_bi.renderArea.extent.height = fb_height;
+
+        disp.resetCommandBuffer(command_buffer, 0);
+        disp.beginCommandBuffer(command_buffer, &command_buffer_bi);
+        disp.cmdBeginRenderPass(command_buffer, &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+        disp.cmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+        disp.cmdPushConstants(command_buffer, pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+                              sizeof(glm::mat4), &view_proj_model);
+        VkDeviceSize offset = 0;
+        disp.cmdBindVertexBuffers(command_buffer, 0, 1, &point_buffer.buffer, &offset);
+        if (multi_draw_indirect)
+        {
+            disp.cmdDrawIndirect(command_buffer, draw_buffer.buffer, 0, draw_count, sizeof(VkDrawIndirectCommand));
+        }
+        else
+        {
+            for (uint32_t i = 0; i < draw_count; i++)
+            {
+                disp.cmdDraw(command_buffer, mapped_draws[i].vertexCount, 1, mapped_draws[i].firstVertex, 0);
+            }
+        }
+        disp.cmdEndRenderPass(command_buffer);
+        disp.endCommandBuffer(command_buffer);
+    }
+    bool keyPressed(int key, bool &key_down)
+    {
+        bool pressed = glfwGetKey(window, key) == GLFW_PRESS;
+        bool edge = pressed && !key_down;
+        key_down = pressed;
+        return edge;
+    }
+
+    void startBenchmarkStep()
+    {
+        point_budget = benchmark_budgets[benchmark_step];
+        orbit_angle = 0.0f;
+        benchmark_frames = 0;
+        benchmark_frame_seconds = 0.0;
+        benchmark_select_seconds = 0.0;
+        benchmark_points = 0;
+    }
+    // Returns false once the last budget has been measured
+    bool updateBenchmark(double frame_seconds)
+    {
+        // Warm-up frames are left out, the first ones after a budget change still run at the old cost
+        if (++benchmark_frames <= BENCHMARK_WARMUP)
+        {
+            benchmark_frame_seconds = 0.0;
+            benchmark_select_seconds = 0.0;
+            benchmark_points = 0;
+            return true;
+        }
+        benchmark_frame_seconds += frame_seconds;
+        benchmark_points += selected_points;
+        if (benchmark_frames < BENCHMARK_WARMUP + BENCHMARK_FRAMES)
+        {
+            return true;
+        }
+
+        double frames = BENCHMARK_FRAMES;
+        spdlog::info("Benchmark: Budget {:>10} points, drawn {:>10.0f} points/frame, frame {:.2f} ms, selection {:.3f} ms, "
+                     "{:.0f} M points/s",
+                     point_budget, static_cast<double>(benchmark_points) / frames,
+                     benchmark_frame_seconds / frames * 1e3, benchmark_select_seconds / frames * 1e3,
+                     static_cast<double>(benchmark_points) / benchmark_frame_seconds / 1e6);
+        if (++benchmark_step == benchmark_budgets.size())
+        {
+            return false;
+        }
+        startBenchmarkStep();
+        return true;
+    }
+
+    void init()
+    {
+        initGLFW();
+        initVulkan();
+        createSwapchain();
+        createGraphicsPipeline();
+        createCommandBuffers();
+
+        if (const char *budget = std::getenv("POINT_BUDGET"))
+        {
+            point_budget = std::max<uint64_t>(1, std::strtoull(budget, nullptr, 10));
+        }
+        if (const char *spacing = std::getenv("POINT_SPACING_PIXELS"))
+        {
+            spacing_pixels = std::strtof(spacing, nullptr);
+        }
+        loadCloud();
+        createDrawBuffer();
+
+        if (const char *benchmark_env = std::getenv("POINT_BENCHMARK"))
+        {
+            benchmark = std::strtol(benchmark_env, nullptr, 10) != 0;
+        }
+        if (benchmark)
+        {
+            // Budgets up to the whole cloud, spacing is ignored so the budget alone bounds the cost
+            spacing_pixels = 0.0f;
+            for (uint64_t budget = 1'000'000; budget < cloud.getPoints().size(); budget *= 2)
+            {
+                benchmark_budgets.push_back(budget);
+            }
+            benchmark_budgets.push_back(cloud.getPoints().size());
+            startBenchmarkStep();
+        }
+    }
+    void renderLoop()
+    {
+        spdlog::info("Enter render loop");
+
+        uint32_t img_idx{};
+
+        VkFenceCreateInfo fence_ci{
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+            .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+
+        VkFence swapchain_fence{}, render_fence{};
+        check(
+            disp.createFence(&fence_ci, nullptr, &swapchain_fence) == VK_SUCCESS,
+            "Vulkan: Failed to create swapchain fence");
+        check(
+            disp.createFence(&fence_ci, nullptr, &render_fence) == VK_SUCCESS,
+            "Vulkan: Failed to create render fence");
+
+        VkSubmitInfo submit_info{
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1};
+
+        VkPresentInfoKHR present_info{
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .swapchainCount = 1,
+            .pSwapchains = &vkb_swapchain.swapchain};
+
+        using Clock = std::chrono::steady_clock;
+        auto frame_start = Clock::now();
+        uint64_t frame = 0;
+
+        while (!glfwWindowShouldClose(window))
+        {
+            glfwPollEvents();
+            if (keyPressed(GLFW_KEY_L, lod_key_down))
+            {
+                lod_enabled = !lod_enabled;
+                spdlog::info("Level of detail: {}", lod_enabled ? "on" : "off");
+            }
+
+            // Wait until all commands have executed on graphics queue, the draw buffer is free again
+            disp.waitForFences(1, &render_fence, VK_TRUE, 1000000000);
+
+            auto now = Clock::now();
+            double frame_seconds = std::chrono::duration<double>(now - frame_start).count();
+            frame_start = now;
+            // The first frame has no previous one to measure against
+            if (benchmark && frame > 0 && !updateBenchmark(frame_seconds))
+            {
+                break;
+            }
+            if (!benchmark && frame > 0 && frame % 300 == 0)
+            {
+                spdlog::info("Point cloud: {} points in {} nodes, frame {:.2f} ms", selected_points, draw_count,
+                             frame_seconds * 1e3);
+            }
+            frame++;
+            updateCamera();
+
+            disp.resetFences(1, &swapchain_fence);
+            disp.acquireNextImageKHR(
+                vkb_swapchain.swapchain, 1000000000, VK_NULL_HANDLE, swapchain_fence, &img_idx);
+
+            // Wait until next image is acquired
+            disp.waitForFences(1, &swapchain_fence, VK_TRUE, 1000000000);
+
+            // Selection changes every frame, so the commands are recorded for the acquired image only
+            recordCommandBuffer(img_idx);
+
+            disp.resetFences(1, &render_fence);
+            submit_info.pCommandBuffers = &command_buffers[img_idx];
+            disp.queueSubmit(graphics_queue, 1, &submit_info, render_fence);
+
+            present_info.pImageIndices = &img_idx,
+            disp.queuePresentKHR(graphics_queue, &present_info);
+        }
+
+        disp.deviceWaitIdle();
+        disp.destroyFence(swapchain_fence, nullptr);
+        disp.destroyFence(render_fence, nullptr);
+    }
+    void destroySwapchain()
+    {
+        spdlog::info("Destroy swapchain");
+
+        for (const auto &frame_buffer : frame_buffers)
+        {
+            disp.destroyFramebuffer(frame_buffer, nullptr);
+        }
+
+        for (const auto &image_view : swapchain_image_views)
+        {
+            disp.destroyImageView(image_view, nullptr);
+        }
+
+        disp.destroyImageView(depth_image_view, nullptr);
+        vmaDestroyImage(allocator, depth_image.image, depth_image.allocation);
+
+        vkb::destroy_swapchain(vkb_swapchain);
+    }
+    void destroyGraphicsPipeline()
+    {
+        spdlog::info("Destroy graphics pipeline");
+
+        disp.destroyPipeline(graphics_pipeline, nullptr);
+        disp.destroyRenderPass(render_pass, nullptr);
+        disp.destroyPipelineLayout(pipeline_layout, nullptr);
+
+        for (const auto &shader_stage_ci : shader_stage_cis)
+        {
+            disp.destroyShaderModule(shader_stage_ci.module, nullptr);
+        }
+    }
+    void cleanup()
+    {
+        spdlog::info("Cleanup");
+
+        vmaDestroyBuffer(allocator, point_buffer.buffer, point_buffer.allocation);
+        vmaDestroyBuffer(allocator, draw_buffer.buffer, draw_buffer.allocation);
+        disp.destroyCommandPool(command_pool, nullptr);
+        destroyGraphicsPipeline();
+        destroySwapchain();
+        vmaDestroyAllocator(allocator);
+        vkb::destroy_device(vkb_device);
+        vkDestroySurfaceKHR(vkb_instance.instance, surface, nullptr);
+        vkb::destroy_instance(vkb_instance);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
+};
+
+#ifdef _WIN32
+#ifdef NDEBUG
+#include <Windows.h>
+#define main() WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+#endif
+#endif
+
+int main()
+{
+    try
+    {
+        HelloPointCloud app{};
+        app.run();
+
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception e)
+    {
+        spdlog::error(e.what());
+
+        return EXIT_FAILURE;
+    }
+}
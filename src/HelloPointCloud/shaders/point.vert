@@ -0,0 +1,16 @@
+#version 450
+
+// Quantized positions arrive as UNORM, the push constant maps them straight to clip space
+layout (location = 0) in vec4 inPosition;
+layout (location = 1) in vec4 inColor;
+layout (location = 0) out vec3 outColor;
+
+layout (push_constant) uniform Camera {
+    mat4 viewProjModel;
+} camera;
+
+void main() {
+    gl_Position = camera.viewProjModel * vec4(inPosition.xyz, 1.0);
+    gl_PointSize = 1.0;
+    outColor = inColor.rgb;
+}
@@ -25,6 +25,7 @@ private:
     vkb::Instance vkb_instance{};
     VkSurfaceKHR surface{};
     vkb::Device vkb_device{};
+    vkb::DispatchTable disp{};
     VkQueue graphics_queue{};
     vkb::Swapchain vkb_swapchain{};
     std::vector<VkImageView> swapchain_image_views{};
@@ -90,6 +91,7 @@ private:
         auto dev_ret = vkb_dev_buildr.build();
         check(dev_ret, "Vulkan: Failed to create logical device");
         vkb_device = dev_ret.value();
+        disp = vkb_device.make_table();
 
         auto graphics_queue_ret = vkb_device.get_queue(vkb::QueueType::graphics);
         check(graphics_queue_ret, "Vulkan: Failed to get graphics queue");
@@ -141,7 +143,7 @@ private:
         shader_module_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
         VkShaderModule shader_module{};
-        check(vkCreateShaderModule(vkb_device.device, &shader_module_ci, nullptr, &shader_module) == VK_SUCCESS,
+        check(disp.createShaderModule(&shader_module_ci, nullptr, &shader_module) == VK_SUCCESS,
               "Failed to create shader module");
 
         return shader_module;
@@ -189,7 +191,7 @@ private:
             .pSubpasses = &subpass_desc};
 
         check(
-            vkCreateRenderPass(vkb_device.device, &render_pass_ci, nullptr, &render_pass) == VK_SUCCESS,
+            disp.createRenderPass(&render_pass_ci, nullptr, &render_pass) == VK_SUCCESS,
             "Vulkan: Failed to create render pass");
 
         frame_buffers.resize(vkb_swapchain.image_count);
@@ -207,7 +209,7 @@ private:
             frame_buffer_ci.pAttachments = &swapchain_image_views[i],
 
             check(
-                vkCreateFramebuffer(vkb_device.device, &frame_buffer_ci, nullptr, &frame_buffers[i]) == VK_SUCCESS,
+                disp.createFramebuffer(&frame_buffer_ci, nullptr, &frame_buffers[i]) == VK_SUCCESS,
                 "Vulkan: Failed to create frame buffer");
         }
     }
@@ -261,7 +263,7 @@ private:
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         };
 
-        check(vkCreatePipelineLayout(vkb_device.device, &pipeline_layout_ci, nullptr, &pipeline_layout) == VK_SUCCESS,
+        check(disp.createPipelineLayout(&pipeline_layout_ci, nullptr, &pipeline_layout) == VK_SUCCESS,
               "Vulkan: Failed to create pipeline layout");
 
         createRenderPass();
@@ -280,8 +282,8 @@ private:
             .renderPass = render_pass};
 
         check(
-            vkCreateGraphicsPipelines(
-                vkb_device.device, nullptr, 1, &graphics_pipeline_ci, nullptr, &graphics_pipeline) == VK_SUCCESS,
+            disp.createGraphicsPipelines(
+                nullptr, 1, &graphics_pipeline_ci, nullptr, &graphics_pipeline) == VK_SUCCESS,
             "Vulkan: Failed to create graphics pipeline");
     }
     void createCommandBuffers()
@@ -292,7 +294,7 @@ private:
             .queueFamilyIndex = vkb_device.get_queue_index(vkb::QueueType::graphics).value()};
 
         check(
-            vkCreateCommandPool(vkb_device.device, &command_pool_ci, nullptr, &command_pool) == VK_SUCCESS,
+            disp.createCommandPool(&command_pool_ci, nullptr, &command_pool) == VK_SUCCESS,
             "Vulkan: Failed to create command pool");
 
         command_buffers.resize(vkb_swapchain.image_count);
@@ -303,7 +305,7 @@ private:
             .commandBufferCount = static_cast<uint32_t>(command_buffers.size())};
 
         check(
-            vkAllocateCommandBuffers(vkb_device.device, &command_buffer_ai, command_buffers.data()) == VK_SUCCESS,
+            disp.allocateCommandBuffers(&command_buffer_ai, command_buffers.data()) == VK_SUCCESS,
             "Vulkan: Failed to allocate command buffers");
     }
     void init()
@@ -326,10 +328,10 @@ private:
 
         VkFence swapchain_fence{}, render_fence{};
         check(
-            vkCreateFence(vkb_device.device, &fence_ci, nullptr, &swapchain_fence) == VK_SUCCESS,
+            disp.createFence(&fence_ci, nullptr, &swapchain_fence) == VK_SUCCESS,
             "Vulkan: Failed to create swapchain fence");
         check(
-            vkCreateFence(vkb_device.device, &fence_ci, nullptr, &render_fence) == VK_SUCCESS,
+            disp.createFence(&fence_ci, nullptr, &render_fence) == VK_SUCCESS,
             "Vulkan: Failed to create render fence");
 
         VkCommandBufferBeginInfo command_buffer_bi{
@@ -359,14 +361,14 @@ private:
         // Record commands in advance
         for (int i = 0; i < frame_buffers.size(); i++)
         {
-            vkResetCommandBuffer(command_buffers[i], 0);
-            vkBeginCommandBuffer(command_buffers[i], &command_buffer_bi);
+            disp.resetCommandBuffer(command_buffers[i], 0);
+            disp.beginCommandBuffer(command_buffers[i], &command_buffer_bi);
             render_pass_bi.framebuffer = frame_buffers[i];
-            vkCmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
-            vkCmdBeginRenderPass(command_buffers[i], &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdDraw(command_buffers[i], 3, 1, 0, 0);
-            vkCmdEndRenderPass(command_buffers[i]);
-            vkEndCommandBuffer(command_buffers[i]);
+            disp.cmdBindPipeline(command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphics_pipeline);
+            disp.cmdBeginRenderPass(command_buffers[i], &render_pass_bi, VK_SUBPASS_CONTENTS_INLINE);
+            disp.cmdDraw(command_buffers[i], 3, 1, 0, 0);
+            disp.cmdEndRenderPass(command_buffers[i]);
+            disp.endCommandBuffer(command_buffers[i]);
         }
 
         while (!glfwWindowShouldClose(window))
@@ -374,24 +376,24 @@ private:
             glfwPollEvents();
 
             // Wait until all commands have executed on graphics queue
-            vkWaitForFences(vkb_device.device, 1, &render_fence, VK_TRUE, 1000000000);
-            vkResetFences(vkb_device.device, 1, &swapchain_fence);
-            vkAcquireNextImageKHR(
-                vkb_device.device, vkb_swapchain.swapchain, 1000000000, VK_NULL_HANDLE, swapchain_fence, &img_idx);
+            disp.waitForFences(1, &render_fence, VK_TRUE, 1000000000);
+            disp.resetFences(1, &swapchain_fence);
+            disp.acquireNextImageKHR(
+                vkb_swapchain.swapchain, 1000000000, VK_NULL_HANDLE, swapchain_fence, &img_idx);
 
             // Wait until next image is acquired
-            vkWaitForFences(vkb_device.device, 1, &swapchain_fence, VK_TRUE, 1000000000);
-            vkResetFences(vkb_device.device, 1, &render_fence);
+            disp.waitForFences(1, &swapchain_fence, VK_TRUE, 1000000000);
+            disp.resetFences(1, &render_fence);
             submit_info.pCommandBuffers = &command_buffers[img_idx];
-            vkQueueSubmit(graphics_queue, 1, &submit_info, render_fence);
+            disp.queueSubmit(graphics_queue, 1, &submit_info, render_fence);
 
             present_info.pImageIndices = &img_idx,
-            vkQueuePresentKHR(graphics_queue, &present_info);
+            disp.queuePresentKHR(graphics_queue, &present_info);
         }
 
-        vkDeviceWaitIdle(vkb_device.device);
-        vkDestroyFence(vkb_device.device, swapchain_fence, nullptr);
-        vkDestroyFence(vkb_device.device, render_fence, nullptr);
+        disp.deviceWaitIdle();
+        disp.destroyFence(swapchain_fence, nullptr);
+        disp.destroyFence(render_fence, nullptr);
     }
     void destroySwapchain()
     {
@@ -399,12 +401,12 @@ private:
 
         for (const auto &frame_buffer : frame_buffers)
         {
-            vkDestroyFramebuffer(vkb_device.device, frame_buffer, nullptr);
+            disp.destroyFramebuffer(frame_buffer, nullptr);
         }
 
         for (const auto &image_view : swapchain_image_views)
         {
-            vkDestroyImageView(vkb_device.device, image_view, nullptr);
+            disp.destroyImageView(image_view, nullptr);
         }
 
         vkb::destroy_swapchain(vkb_swapchain);
@@ -413,20 +415,20 @@ private:
     {
         spdlog::info("Destroy graphics pipeline");
 
-        vkDestroyPipeline(vkb_device, graphics_pipeline, nullptr);
-        vkDestroyRenderPass(vkb_device.device, render_pass, nullptr);
-        vkDestroyPipelineLayout(vkb_device.device, pipeline_layout, nullptr);
+        disp.destroyPipeline(graphics_pipeline, nullptr);
+        disp.destroyRenderPass(render_pass, nullptr);
+        disp.destroyPipelineLayout(pipeline_layout, nullptr);
 
         for (const auto &shader_stage_ci : shader_stage_cis)
         {
-            vkDestroyShaderModule(vkb_device.device, shader_stage_ci.module, nullptr);
+            disp.destroyShaderModule(shader_stage_ci.module, nullptr);
         }
     }
     void cleanup()
     {
         spdlog::info("Cleanup");
 
-        vkDestroyCommandPool(vkb_device.device, command_pool, nullptr);
+        disp.destroyCommandPool(command_pool, nullptr);
         destroyGraphicsPipeline();
         destroySwapchain();
         vkb::destroy_device(vkb_device);
@@ -1,35 +1,439 @@
 #include "first_app.hpp"
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <limits>
+#include <spdlog/spdlog.h>
 #include <stdexcept>
 
 namespace lve
 {
-    FirstApp::FirstApp()
+    FirstApp::FirstApp(uint32_t instanceCount)
     {
+        lveSwapchain.setTelemetry(&frameTelemetry);
+        loadModel();
+        buildScene(instanceCount);
         createPipelineLayout();
         createPipeline();
         createCommandBuffers();
+
+        renderQueue = std::make_unique<LveRenderQueue>(lveDevice, LveSwapChain::MAX_FRAMES_IN_FLIGHT, instanceCount);
+        queuePipeline = renderQueue->registerPipeline(*lvePipeline, pipelineLayout);
+        for (uint32_t mesh = 0; mesh < lveModel->getMeshCount(); mesh++)
+        {
+            queueMeshes.push_back(renderQueue->registerMesh(*lveModel, mesh));
+        }
     }
     FirstApp::~FirstApp()
     {
-        vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+        lveDevice.disp.destroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
     }
 
     void FirstApp::run()
     {
+        auto previousTime = std::chrono::steady_clock::now();
         while (!lveWindow.shouldClose())
         {
-            glfwPollEvents();
+            frameTelemetry.beginFrame();
+            {
+                LveFrameTelemetry::Scope pollScope{frameTelemetry, LveFrameTelemetry::Phase::Poll};
+                LVE_TRACE_ZONE("Poll events");
+                glfwPollEvents();
+                handleInput();
+            }
+            auto currentTime = std::chrono::steady_clock::now();
+            updateTransforms(std::chrono::duration<float>(currentTime - previousTime).count());
+            previousTime = currentTime;
             drawFrame();
+            frameTelemetry.endFrame();
+            frameTelemetry.update();
+
+            if (++frameCount % 600 == 0)
+            {
+                gpuProfiler.logStats();
+                pipelineStatistics.logStats();
+                if (renderQueueEnabled && !gpuCullingEnabled)
+                {
+                    const auto &stats = renderQueue->getReplayStats();
+                    spdlog::info("Render queue: {} packets, {} draws, {} pipeline binds, {} descriptor set binds, "
+                                 "{} vertex buffer binds, {} index buffer binds",
+                                 stats.packets, stats.draws, stats.pipelineBinds, stats.descriptorSetBinds,
+                                 stats.vertexBufferBinds, stats.indexBufferBinds);
+                }
+                if (gpuCullingEnabled)
+                {
+                    const auto &counters = gpuCulling->getCounters();
+                    spdlog::info("GPU culling: visible {}, frustum culled {}, occlusion culled {}",
+                                 counters.visible, counters.frustumCulled, counters.occlusionCulled);
+                }
+            }
+        }
+
+        lveDevice.disp.deviceWaitIdle(lveDevice.device());
+
+        frameTelemetry.drain();
+        frameTelemetry.logSummary();
+        if (const char *telemetryPath = std::getenv("LVE_TELEMETRY"))
+        {
+            frameTelemetry.writeSummary(telemetryPath);
+        }
+
+        if (!pipelineStatistics.getStats().empty())
+        {
+            pipelineStatistics.writeJson("pipeline_statistics.json");
+        }
+    }
+
+    void FirstApp::handleInput()
+    {
+        // P toggles pipeline statistics queries
+        bool keyDown = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_P) == GLFW_PRESS;
+        if (keyDown && !statisticsKeyDown)
+        {
+            pipelineStatistics.setEnabled(!pipelineStatistics.isEnabled());
+            spdlog::info("Pipeline statistics: {}", pipelineStatistics.isEnabled() ? "on" : "off");
+        }
+        statisticsKeyDown = keyDown;
+
+        // I switches between one draw per instance and indirect draws
+        keyDown = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_I) == GLFW_PRESS;
+        if (keyDown && !drawModeKeyDown)
+        {
+            drawMode = drawMode == LveDrawList::Mode::Indirect ? LveDrawList::Mode::Direct : LveDrawList::Mode::Indirect;
+            spdlog::info("Draw mode: {}", drawMode == LveDrawList::Mode::Indirect ? "indirect" : "direct");
+            frameTelemetry.reset();
+        }
+        drawModeKeyDown = keyDown;
+
+        // G toggles GPU culling
+        keyDown = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_G) == GLFW_PRESS;
+        if (keyDown && !gpuCullingKeyDown)
+        {
+            setGpuCulling(!gpuCullingEnabled);
+            frameTelemetry.reset();
+        }
+        gpuCullingKeyDown = keyDown;
+
+        // Q draws the CPU culled scene through the sorted render queue instead of the draw list
+        keyDown = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_Q) == GLFW_PRESS;
+        if (keyDown && !renderQueueKeyDown)
+        {
+            renderQueueEnabled = !renderQueueEnabled;
+            spdlog::info("Render queue: {}", renderQueueEnabled ? "on" : "off");
+            frameTelemetry.reset();
+        }
+        renderQueueKeyDown = keyDown;
+
+        // R toggles spinning the scene
+        keyDown = glfwGetKey(lveWindow.getGLFWwindow(), GLFW_KEY_R) == GLFW_PRESS;
+        if (keyDown && !animateKeyDown)
+        {
+            animate = !animate;
+            spdlog::info("Animation: {}", animate ? "on" : "off");
+            if (animate && gpuCullingEnabled)
+            {
+                spdlog::warn("GPU culling draws the scene as it was when culling was enabled");
+            }
+        }
+        animateKeyDown = keyDown;
+    }
+
+    void FirstApp::setGpuCulling(bool enable)
+    {
+        if (enable && !LveGpuCulling::isSupported(lveDevice))
+        {
+            spdlog::warn("GPU culling: drawIndirectFirstInstance is not supported by the device");
+            return;
+        }
+        // Without them the CPU keeps culling instead of failing to create the pipelines
+        if (enable && !gpuCulling && !LveGpuCulling::hasShaders())
+        {
+            spdlog::warn("GPU culling: {} or {} is missing, run from the build directory",
+                         LveGpuCulling::HIZ_SHADER_PATH, LveGpuCulling::CULL_SHADER_PATH);
+            return;
+        }
+
+        if (enable)
+        {
+            if (!gpuCulling)
+            {
+                gpuCulling = std::make_unique<LveGpuCulling>(lveDevice, lveSwapchain, *lveModel, LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+            }
+
+            // The GPU keeps its own copy of the scene, refresh it with the current transforms
+            lveDevice.disp.deviceWaitIdle(lveDevice.device());
+            std::vector<LveGpuCulling::Object> objects{};
+            objects.reserve(ecs.size());
+            ecs.forEach<TransformComponent, MeshComponent>(
+                [&](const TransformComponent &transform, const MeshComponent &mesh)
+                { objects.push_back({transform.toInstance(), mesh.mesh, {}}); });
+            gpuCulling->setScene(objects);
+        }
+
+        gpuCullingEnabled = enable;
+        previousImageIndex = UINT32_MAX;
+        spdlog::info("GPU culling: {}", gpuCullingEnabled ? "on" : "off");
+    }
+
+    void FirstApp::loadModel()
+    {
+        LveModel::Builder builder{};
+
+        builder.addMesh(
+            {{{0.0f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}},
+             {{-0.5f, 0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}},
+             {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}}},
+            {0, 1, 2});
+
+        builder.addMesh(
+            {{{-0.5f, -0.5f, 0.0f}, {1.0f, 1.0f, 0.0f}},
+             {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 1.0f}},
+             {{0.5f, 0.5f, 0.0f}, {1.0f, 0.0f, 1.0f}},
+             {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}}},
+            {0, 1, 2, 2, 3, 0});
+
+        // Triangle fan around the center vertex
+        std::vector<LveModel::Vertex> hexagonVertices{{{0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}}};
+        std::vector<uint32_t> hexagonIndices{};
+        for (uint32_t i = 0; i < 6; i++)
+        {
+            float angle = glm::radians(60.0f * static_cast<float>(i));
+            hexagonVertices.push_back({{0.5f * std::cos(angle), 0.5f * std::sin(angle), 0.0f}, {1.0f, 0.5f, 0.0f}});
+            hexagonIndices.insert(hexagonIndices.end(), {0, i + 1, (i + 1) % 6 + 1});
+        }
+        builder.addMesh(hexagonVertices, hexagonIndices);
+
+        lveModel = std::make_unique<LveModel>(lveDevice, builder);
+    }
+
+    void FirstApp::buildScene(uint32_t instanceCount)
+    {
+        spdlog::info("Build scene: {} instances of {} meshes", instanceCount, lveModel->getMeshCount());
+
+        // Square grid in the XY plane, meshes interleaved so every batch is scattered
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+        const float spacing = 1.25f;
+        float halfExtent = 0.5f * spacing * static_cast<float>(side - 1);
+
+        ecs.clear();
+        frustumCulling.clear();
+        for (uint32_t i = 0; i < instanceCount; i++)
+        {
+            TransformComponent transform{};
+            transform.position = glm::vec3{static_cast<float>(i % side) * spacing - halfExtent,
+                                           static_cast<float>(i / side) * spacing - halfExtent,
+                                           0.0f};
+            transform.scale = 1.0f;
+            transform.rotation = glm::angleAxis(static_cast<float>(i) * 0.3f, glm::vec3(0.0f, 0.0f, 1.0f));
+            MeshComponent mesh{i % lveModel->getMeshCount()};
+
+            // World-space bounding sphere for CPU culling
+            glm::vec4 boundingSphere = lveModel->getMesh(mesh.mesh).boundingSphere;
+            glm::vec3 center = transform.rotation * (glm::vec3(boundingSphere) * transform.scale) + transform.position;
+            CullingComponent culling{frustumCulling.add(center, boundingSphere.w * transform.scale)};
+
+            // Every other object spins, so the scene spans two archetypes
+            if (i % 2 == 0)
+            {
+                float speed = 0.5f + static_cast<float>(i % 7) * 0.25f;
+                ecs.create(transform, mesh, culling, SpinComponent{i % 4 == 0 ? speed : -speed});
+            }
+            else
+            {
+                ecs.create(transform, mesh, culling);
+            }
+        }
+        visibleSpheres.clear();
+        sphereVisible.assign(frustumCulling.size(), 0);
+        spdlog::info("CPU culling: {}", LveFrustumCulling::isaName(frustumCulling.getIsa()));
+
+        drawList = std::make_unique<LveDrawList>(lveDevice, *lveModel, LveSwapChain::MAX_FRAMES_IN_FLIGHT, instanceCount);
+
+        // Frame the whole grid
+        float distance = (halfExtent + spacing) / std::tan(glm::radians(22.5f));
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), lveSwapchain.extentAspectRatio(), 0.1f, distance * 2.0f);
+        projection[1][1] *= -1.0f;
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, distance), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        viewProjection = projection * view;
+
+        spdlog::info("Draw mode: indirect, multiDrawIndirect {}, drawIndirectFirstInstance {}, drawIndirectCount {}",
+                     lveDevice.enabledFeatures.multiDrawIndirect == VK_TRUE,
+                     lveDevice.enabledFeatures.drawIndirectFirstInstance == VK_TRUE,
+                     lveDevice.hasDrawIndirectCount());
+    }
+
+    LveDrawList::Instance FirstApp::TransformComponent::toInstance() const
+    {
+        return {glm::vec4(position, scale), glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w)};
+    }
+
+    void FirstApp::updateTransforms(float deltaSeconds)
+    {
+        if (!animate)
+        {
+            return;
+        }
+
+        LVE_TRACE_ZONE("Transform system");
+        ecs.parallelForEach<TransformComponent, SpinComponent>(
+            [deltaSeconds](TransformComponent &transform, const SpinComponent &spin)
+            {
+                transform.rotation = glm::normalize(
+                    glm::angleAxis(spin.radiansPerSecond * deltaSeconds, glm::vec3(0.0f, 0.0f, 1.0f)) * transform.rotation);
+            });
+
+        // Mesh bounding spheres are not centered on the origin, so their centers follow the rotation
+        ecs.forEachChunk<TransformComponent, MeshComponent, CullingComponent, SpinComponent>(
+            [&](uint32_t count, const LveEntity *, const TransformComponent *transforms, const MeshComponent *meshes,
+                const CullingComponent *culling, const SpinComponent *)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    glm::vec4 boundingSphere = lveModel->getMesh(meshes[i].mesh).boundingSphere;
+                    const TransformComponent &transform = transforms[i];
+                    glm::vec3 center = transform.rotation * (glm::vec3(boundingSphere) * transform.scale) + transform.position;
+                    frustumCulling.update(culling[i].sphere, center, boundingSphere.w * transform.scale);
+                }
+            });
+    }
+
+    void FirstApp::cullScene()
+    {
+        LVE_TRACE_ZONE("Frustum culling");
+        for (uint32_t sphere : visibleSpheres)
+        {
+            sphereVisible[sphere] = 0;
+        }
+        frustumCulling.cull(LveFrustum::fromViewProjection(viewProjection), visibleSpheres);
+        for (uint32_t sphere : visibleSpheres)
+        {
+            sphereVisible[sphere] = 1;
+        }
+    }
+
+    void FirstApp::updateDrawList(uint32_t frameIndex)
+    {
+        cullScene();
+        drawList->clear();
+        ecs.forEachChunk<TransformComponent, MeshComponent, CullingComponent>(
+            [&](uint32_t count, const LveEntity *, const TransformComponent *transforms, const MeshComponent *meshes,
+                const CullingComponent *culling)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    if (sphereVisible[culling[i].sphere])
+                    {
+                        drawList->add(meshes[i].mesh, transforms[i].toInstance());
+                    }
+                }
+            });
+        drawList->build(frameIndex);
+    }
+
+    void FirstApp::updateRenderQueue(uint32_t frameIndex)
+    {
+        cullScene();
+        renderQueue->clear();
+        ecs.forEachChunk<TransformComponent, MeshComponent, CullingComponent>(
+            [&](uint32_t count, const LveEntity *, const TransformComponent *transforms, const MeshComponent *meshes,
+                const CullingComponent *culling)
+            {
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    if (!sphereVisible[culling[i].sphere])
+                    {
+                        continue;
+                    }
+                    glm::vec4 clipPosition = viewProjection * glm::vec4(transforms[i].position, 1.0f);
+                    float depth = clipPosition.w > 0.0f ? clipPosition.z / clipPosition.w : 0.0f;
+                    renderQueue->submit(
+                        LveRenderQueue::makeKey(0, queuePipeline, LveRenderQueue::NO_DESCRIPTOR_SET, queueMeshes[meshes[i].mesh], depth),
+                        transforms[i].toInstance());
+                }
+            });
+        renderQueue->build(frameIndex);
+    }
+
+    void FirstApp::benchmarkDispatch(uint32_t drawCount)
+    {
+        VkCommandBufferAllocateInfo commandBufferAi{};
+        commandBufferAi.commandBufferCount = 1;
+        commandBufferAi.commandPool = lveDevice.getCommandPool();
+        commandBufferAi.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        commandBufferAi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+
+        VkCommandBuffer commandBuffer{};
+        if (lveDevice.disp.allocateCommandBuffers(lveDevice.device(), &commandBufferAi, &commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to allocate command buffers");
+        }
+
+        VkCommandBufferBeginInfo commandBufferBi{};
+        commandBufferBi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        commandBufferBi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VkRenderPassBeginInfo renderPassBi{};
+        renderPassBi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassBi.renderPass = lveSwapchain.getRenderPass();
+        renderPassBi.framebuffer = lveSwapchain.getFrameBuffer(0);
+        renderPassBi.renderArea.extent = lveSwapchain.getSwapChainExtent();
+
+        // Recorded but never submitted, only the CPU recording cost is of interest
+        auto record = [&](PFN_vkCmdDraw cmdDraw)
+        {
+            lveDevice.disp.beginCommandBuffer(commandBuffer, &commandBufferBi);
+            lveDevice.disp.cmdBeginRenderPass(commandBuffer, &renderPassBi, VK_SUBPASS_CONTENTS_INLINE);
+            lvePipeline->bind(commandBuffer);
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < drawCount; i++)
+            {
+                cmdDraw(commandBuffer, 3, 1, 0, 0);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            lveDevice.disp.cmdEndRenderPass(commandBuffer);
+            lveDevice.disp.endCommandBuffer(commandBuffer);
+            lveDevice.disp.resetCommandBuffer(commandBuffer, 0);
+
+            return std::chrono::duration<double, std::nano>(elapsed).count() / drawCount;
+        };
+
+        // Warm up allocations inside the command pool and both call paths before timing, then
+        // alternate the paths so neither one gets the warmer caches or the quieter moment
+        record(vkCmdDraw);
+        record(lveDevice.disp.cmdDraw);
+        double loaderNs = std::numeric_limits<double>::max();
+        double dispatchNs = std::numeric_limits<double>::max();
+        for (int repeat = 0; repeat < 5; repeat++)
+        {
+            loaderNs = std::min(loaderNs, record(vkCmdDraw));
+            dispatchNs = std::min(dispatchNs, record(lveDevice.disp.cmdDraw));
         }
 
-        vkDeviceWaitIdle(lveDevice.device());
+        spdlog::info("Dispatch benchmark, {} draws: loader {:.2f} ns/call, device dispatch {:.2f} ns/call ({:.1f}% faster)",
+                     drawCount, loaderNs, dispatchNs, (loaderNs - dispatchNs) / loaderNs * 100.0);
+
+        lveDevice.disp.freeCommandBuffers(lveDevice.device(), lveDevice.getCommandPool(), 1, &commandBuffer);
     }
+
     void FirstApp::createPipelineLayout()
     {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(glm::mat4);
+
         VkPipelineLayoutCreateInfo pipelineLayoutCi{};
         pipelineLayoutCi.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCi.pushConstantRangeCount = 1;
+        pipelineLayoutCi.pPushConstantRanges = &pushConstantRange;
 
-        if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutCi, nullptr, &pipelineLayout) != VK_SUCCESS)
+        if (lveDevice.disp.createPipelineLayout(lveDevice.device(), &pipelineLayoutCi, nullptr, &pipelineLayout) != VK_SUCCESS)
         {
             throw std::runtime_error("Vulkan: Failed to create pipeline layout");
         }
@@ -37,9 +441,20 @@ namespace lve
 
     void FirstApp::createPipeline()
     {
+        LVE_TRACE_ZONE("FirstApp::createPipeline");
         auto pipelineConfig = LvePipeline::defaultPipelineConfigInfo(lveSwapchain.width(), lveSwapchain.height());
         pipelineConfig.renderPass = lveSwapchain.getRenderPass();
         pipelineConfig.layout = pipelineLayout;
+        // The meshes are flat, keep both faces
+        pipelineConfig.rasterizationSci.cullMode = VK_CULL_MODE_NONE;
+        pipelineConfig.bindingDescriptions = LveModel::Vertex::getBindingDescriptions();
+        pipelineConfig.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
+        auto instanceBindings = LveDrawList::Instance::getBindingDescriptions();
+        auto instanceAttributes = LveDrawList::Instance::getAttributeDescriptions();
+        pipelineConfig.bindingDescriptions.insert(
+            pipelineConfig.bindingDescriptions.end(), instanceBindings.begin(), instanceBindings.end());
+        pipelineConfig.attributeDescriptions.insert(
+            pipelineConfig.attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
         lvePipeline = std::make_unique<LvePipeline>(
             lveDevice,
             "shaders/simple_vert.spv",
@@ -49,7 +464,8 @@ namespace lve
 
     void FirstApp::createCommandBuffers()
     {
-        commandBuffers.resize(lveSwapchain.imageCount());
+        // One command buffer per frame in flight, re-recorded every frame
+        commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
 
         VkCommandBufferAllocateInfo commandBufferAi{};
         commandBufferAi.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
@@ -57,52 +473,112 @@ namespace lve
         commandBufferAi.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         commandBufferAi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 
-        if (vkAllocateCommandBuffers(lveDevice.device(), &commandBufferAi, commandBuffers.data()) != VK_SUCCESS)
+        if (lveDevice.disp.allocateCommandBuffers(lveDevice.device(), &commandBufferAi, commandBuffers.data()) != VK_SUCCESS)
         {
             throw std::runtime_error("Vulkan: Failed to allocate command buffers");
         }
+    }
+
+    void FirstApp::recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex)
+    {
+        LVE_TRACE_ZONE("FirstApp::recordCommandBuffer");
+        VkCommandBuffer commandBuffer = commandBuffers[frameIndex];
+
+        VkCommandBufferBeginInfo commandBufferBi{};
+        commandBufferBi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        commandBufferBi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (lveDevice.disp.beginCommandBuffer(commandBuffer, &commandBufferBi) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to begin recording command buffer");
+        }
 
-        for (int i = 0; i < commandBuffers.size(); i++)
+        bool useRenderQueue = renderQueueEnabled && !gpuCullingEnabled;
+        if (useRenderQueue)
+        {
+            updateRenderQueue(frameIndex);
+        }
+        else if (!gpuCullingEnabled)
         {
-            VkCommandBufferBeginInfo commandBufferBi{};
-            commandBufferBi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            updateDrawList(frameIndex);
+        }
 
-            if (vkBeginCommandBuffer(commandBuffers[i], &commandBufferBi) != VK_SUCCESS)
-            {
-                throw std::runtime_error("Vulkan: Failed to begin recording command buffer");
-            }
+        gpuProfiler.beginFrame(commandBuffer, frameIndex);
+        pipelineStatistics.beginFrame(commandBuffer, frameIndex);
 
-            VkRenderPassBeginInfo renderPassBi{};
-            renderPassBi.renderPass = lveSwapchain.getRenderPass();
-            renderPassBi.framebuffer = lveSwapchain.getFrameBuffer(i);
-            renderPassBi.renderArea.extent = lveSwapchain.getSwapChainExtent();
-            renderPassBi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            std::vector<VkClearValue> clearValues(2);
-            clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
-            clearValues[1].depthStencil = {1.0f, 0};
-            renderPassBi.clearValueCount = 2;
-            renderPassBi.pClearValues = clearValues.data();
-
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassBi, VK_SUBPASS_CONTENTS_INLINE);
-            lvePipeline->bind(commandBuffers[i]);
-            vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
-            vkCmdEndRenderPass(commandBuffers[i]);
-            if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-            {
-                throw std::runtime_error("Vulkan: Failed to record command buffer");
-            }
+        if (gpuCullingEnabled)
+        {
+            uint32_t cullScope = gpuProfiler.beginScope(commandBuffer, "GPU culling");
+            gpuCulling->cull(commandBuffer, frameIndex, viewProjection, previousImageIndex);
+            gpuProfiler.endScope(commandBuffer, cullScope);
+            previousImageIndex = imageIndex;
+        }
+
+        VkRenderPassBeginInfo renderPassBi{};
+        renderPassBi.renderPass = lveSwapchain.getRenderPass();
+        renderPassBi.framebuffer = lveSwapchain.getFrameBuffer(static_cast<int>(imageIndex));
+        renderPassBi.renderArea.extent = lveSwapchain.getSwapChainExtent();
+        renderPassBi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        std::vector<VkClearValue> clearValues(2);
+        clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        clearValues[1].depthStencil = {1.0f, 0};
+        renderPassBi.clearValueCount = 2;
+        renderPassBi.pClearValues = clearValues.data();
+
+        uint32_t renderPassScope = gpuProfiler.beginScope(commandBuffer, "Render pass");
+        lveDevice.disp.cmdBeginRenderPass(commandBuffer, &renderPassBi, VK_SUBPASS_CONTENTS_INLINE);
+        // The render queue binds its own pipelines, push constants only need a compatible layout
+        if (!useRenderQueue)
+        {
+            lvePipeline->bind(commandBuffer);
+        }
+        lveDevice.disp.cmdPushConstants(
+            commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &viewProjection);
+        uint32_t sceneDraw = pipelineStatistics.beginDraw(commandBuffer, "Scene");
+        if (useRenderQueue)
+        {
+            renderQueue->draw(commandBuffer, 0);
+        }
+        else if (gpuCullingEnabled)
+        {
+            gpuCulling->draw(commandBuffer);
+        }
+        else
+        {
+            drawList->draw(commandBuffer, drawMode);
+        }
+        pipelineStatistics.endDraw(commandBuffer, sceneDraw);
+        lveDevice.disp.cmdEndRenderPass(commandBuffer);
+        gpuProfiler.endScope(commandBuffer, renderPassScope);
+
+        if (lveDevice.disp.endCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to record command buffer");
         }
     }
 
     void FirstApp::drawFrame()
     {
+        LVE_TRACE_ZONE("FirstApp::drawFrame");
         uint32_t imageIndex{};
-        auto result = lveSwapchain.acquireNextImage(&imageIndex);
+        VkResult result{};
+        {
+            LveFrameTelemetry::Scope acquireScope{frameTelemetry, LveFrameTelemetry::Phase::AcquireWait};
+            result = lveSwapchain.acquireNextImage(&imageIndex);
+        }
         if (result != VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
         {
             throw std::runtime_error("Vulkan: Failed to acquire next image");
         }
-        result = lveSwapchain.submitCommandBuffers(&commandBuffers[imageIndex], &imageIndex);
+
+        // acquireNextImage waited on this frame's fence, so its command buffer is free again
+        uint32_t frameIndex = lveSwapchain.getCurrentFrame();
+        {
+            LveFrameTelemetry::Scope recordScope{frameTelemetry, LveFrameTelemetry::Phase::Record};
+            recordCommandBuffer(frameIndex, imageIndex);
+        }
+
+        result = lveSwapchain.submitCommandBuffers(&commandBuffers[frameIndex], &imageIndex);
         if (result != VK_SUCCESS)
         {
             throw std::runtime_error("Vulkan: Failed to present swapchain image");
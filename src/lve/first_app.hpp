@@ -5,6 +5,16 @@
 #include "lve_pipeline.hpp"
 #include "lve_device.hpp"
 #include "lve_swap_chain.hpp"
+#include "lve_gpu_profiler.hpp"
+#include "lve_pipeline_statistics.hpp"
+#include "lve_model.hpp"
+#include "lve_draw_list.hpp"
+#include "lve_gpu_culling.hpp"
+#include "lve_frustum_culling.hpp"
+#include "lve_render_queue.hpp"
+#include "lve_ecs.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace lve
 {
@@ -12,24 +22,88 @@ namespace lve
     {
     public:
         static constexpr int WIDTH = 640, HEIGHT = 480;
-        FirstApp();
+        static constexpr uint32_t DEFAULT_INSTANCE_COUNT = 1000;
+        explicit FirstApp(uint32_t instanceCount = DEFAULT_INSTANCE_COUNT);
         ~FirstApp();
         void run();
+        // Times recording drawCount draws through the loader exports and through LveDeviceDispatch
+        void benchmarkDispatch(uint32_t drawCount);
+        // Culls and compacts the scene in a compute pass instead of building the draw list on the CPU
+        void setGpuCulling(bool enable);
 
         FirstApp(const FirstApp &) = delete;
         FirstApp &operator=(const FirstApp &) = delete;
 
     private:
+        // Scene components, every entity has a transform, a mesh and a culling sphere
+        struct TransformComponent
+        {
+            glm::vec3 position;
+            float scale;
+            glm::quat rotation;
+
+            LveDrawList::Instance toInstance() const;
+        };
+        struct MeshComponent
+        {
+            uint32_t mesh;
+        };
+        struct CullingComponent
+        {
+            uint32_t sphere;
+        };
+        // Rotation about the z axis, only applied while animation is on
+        struct SpinComponent
+        {
+            float radiansPerSecond;
+        };
+
+        void loadModel();
+        void buildScene(uint32_t instanceCount);
+        // Transform system: spins entities and moves their culling spheres along
+        void updateTransforms(float deltaSeconds);
+        // Culling system: marks the visible entities' spheres in sphereVisible
+        void cullScene();
+        void updateDrawList(uint32_t frameIndex);
+        void updateRenderQueue(uint32_t frameIndex);
         void createPipelineLayout();
         void createPipeline();
         void createCommandBuffers();
+        void recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex);
         void drawFrame();
+        void handleInput();
 
         LveWindow lveWindow{WIDTH, HEIGHT, "Hello, Vulkan!"};
         LveDevice lveDevice{lveWindow};
         LveSwapChain lveSwapchain{lveDevice, lveWindow.getExtent()};
+        LveGpuProfiler gpuProfiler{lveDevice, LveSwapChain::MAX_FRAMES_IN_FLIGHT};
+        LvePipelineStatistics pipelineStatistics{lveDevice, LveSwapChain::MAX_FRAMES_IN_FLIGHT};
+        LveFrameTelemetry frameTelemetry{};
         std::unique_ptr<LvePipeline> lvePipeline;
+        std::unique_ptr<LveModel> lveModel;
+        std::unique_ptr<LveDrawList> drawList;
+        std::unique_ptr<LveGpuCulling> gpuCulling;
+        std::unique_ptr<LveRenderQueue> renderQueue;
+        // Render queue mesh ids, indexed by model mesh
+        std::vector<uint32_t> queueMeshes{};
+        uint32_t queuePipeline{};
+        bool renderQueueEnabled{};
+        bool gpuCullingEnabled{};
+        uint32_t previousImageIndex{UINT32_MAX};
+        LveDrawList::Mode drawMode{LveDrawList::Mode::Indirect};
+        LveEcs ecs{};
+        LveFrustumCulling frustumCulling{};
+        std::vector<uint32_t> visibleSpheres{};
+        std::vector<uint8_t> sphereVisible{};
+        bool animate{};
+        glm::mat4 viewProjection{1.0f};
         VkPipelineLayout pipelineLayout{};
         std::vector<VkCommandBuffer> commandBuffers{};
+        uint64_t frameCount{};
+        bool statisticsKeyDown{};
+        bool drawModeKeyDown{};
+        bool gpuCullingKeyDown{};
+        bool renderQueueKeyDown{};
+        bool animateKeyDown{};
     };
 }
\ No newline at end of file
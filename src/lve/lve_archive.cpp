@@ -0,0 +1,306 @@
+#include "lve_archive.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+namespace lve
+{
+    static constexpr char ARCHIVE_MAGIC[4] = {'L', 'V', 'P', 'K'};
+    static constexpr uint32_t ARCHIVE_VERSION = 1;
+    // Seeds tried per bucket before giving up, buckets hold two names on average so a handful
+    // of tries is the norm
+    static constexpr uint32_t MAX_SEED = 1u << 24;
+
+    static_assert(std::endian::native == std::endian::little, "Archives are little endian");
+
+    // Followed by the bucket seeds, the entries in slot order, the names and the data
+    struct ArchiveHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t bucketCount;
+        uint32_t namesSize;
+        uint32_t reserved;
+    };
+
+    struct ArchiveEntry
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t nameOffset;
+        uint32_t nameSize;
+    };
+
+    namespace
+    {
+        uint64_t hashName(std::string_view name)
+        {
+            uint64_t hash = 0xCBF29CE484222325ull;
+            for (char c : name)
+            {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+            }
+            return hash;
+        }
+
+        uint32_t slotOf(uint64_t hash, uint32_t seed, uint32_t entryCount)
+        {
+            uint64_t value = hash ^ (seed * 0x9E3779B97F4A7C15ull);
+            value ^= value >> 30;
+            value *= 0xBF58476D1CE4E5B9ull;
+            value ^= value >> 27;
+            value *= 0x94D049BB133111EBull;
+            value ^= value >> 31;
+            return static_cast<uint32_t>(value % entryCount);
+        }
+
+        size_t alignUp(size_t value, size_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // Layout shared by the writer and the reader
+        size_t entriesOffset(uint32_t bucketCount)
+        {
+            return alignUp(sizeof(ArchiveHeader) + size_t{bucketCount} * sizeof(uint32_t), alignof(ArchiveEntry));
+        }
+    }
+
+    void LveArchive::write(const std::string &path, const std::vector<Source> &sources)
+    {
+        uint32_t entryCount = static_cast<uint32_t>(sources.size());
+        uint32_t bucketCount = std::max(1u, entryCount / 2);
+
+        // Hash and displace: buckets are placed largest first, each with the first seed that moves
+        // all of its names to free slots
+        std::vector<uint64_t> hashes(entryCount);
+        std::vector<std::vector<uint32_t>> buckets(bucketCount);
+        for (uint32_t i = 0; i < entryCount; i++)
+        {
+            hashes[i] = hashName(sources[i].name);
+            buckets[hashes[i] % bucketCount].push_back(i);
+        }
+        std::vector<uint32_t> bucketOrder(bucketCount);
+        std::iota(bucketOrder.begin(), bucketOrder.end(), 0u);
+        std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](uint32_t a, uint32_t b)
+                         { return buckets[a].size() > buckets[b].size(); });
+
+        std::vector<uint32_t> seeds(bucketCount, 0);
+        std::vector<uint32_t> slotSources(entryCount, UINT32_MAX);
+        std::vector<uint32_t> slots{};
+        for (uint32_t bucket : bucketOrder)
+        {
+            const std::vector<uint32_t> &members = buckets[bucket];
+            if (members.empty())
+            {
+                continue;
+            }
+            for (uint32_t i = 1; i < members.size(); i++)
+            {
+                for (uint32_t j = 0; j < i; j++)
+                {
+                    if (hashes[members[i]] == hashes[members[j]])
+                    {
+                        throw std::runtime_error("LveArchive: Duplicate or colliding name " + sources[members[i]].name);
+                    }
+                }
+            }
+
+            uint32_t seed = 1;
+            for (; seed < MAX_SEED; seed++)
+            {
+                slots.clear();
+                for (uint32_t member : members)
+                {
+                    uint32_t slot = slotOf(hashes[member], seed, entryCount);
+                    if (slotSources[slot] != UINT32_MAX || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                    {
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (slots.size() == members.size())
+                {
+                    break;
+                }
+            }
+            if (seed == MAX_SEED)
+            {
+                throw std::runtime_error("LveArchive: Failed to build the name table");
+            }
+            seeds[bucket] = seed;
+            for (size_t m = 0; m < members.size(); m++)
+            {
+                slotSources[slots[m]] = members[m];
+            }
+        }
+
+        std::vector<ArchiveEntry> entries(entryCount);
+        std::string names{};
+        for (uint32_t slot = 0; slot < entryCount; slot++)
+        {
+            const std::string &name = sources[slotSources[slot]].name;
+            entries[slot].nameOffset = static_cast<uint32_t>(names.size());
+            entries[slot].nameSize = static_cast<uint32_t>(name.size());
+            names += name;
+        }
+
+        // Written next to the target and renamed over it, a running reader keeps its old mapping
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out{tempPath, std::ios::binary | std::ios::trunc};
+            if (!out)
+            {
+                throw std::runtime_error("LveArchive: Failed to create " + tempPath);
+            }
+
+            // Data behind the table space first, the table once the data offsets are known
+            size_t offset = entriesOffset(bucketCount) + entries.size() * sizeof(ArchiveEntry) + names.size();
+            for (uint32_t slot = 0; slot < entryCount; slot++)
+            {
+                LveMappedFile source{sources[slotSources[slot]].path};
+                offset = alignUp(offset, ENTRY_ALIGNMENT);
+                out.seekp(static_cast<std::streamoff>(offset));
+                out.write(reinterpret_cast<const char *>(source.getData()), static_cast<std::streamsize>(source.getSize()));
+                entries[slot].offset = offset;
+                entries[slot].size = source.getSize();
+                offset += source.getSize();
+            }
+
+            ArchiveHeader header{{}, ARCHIVE_VERSION, entryCount, bucketCount, static_cast<uint32_t>(names.size()), 0};
+            std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+            out.seekp(0);
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(seeds.data()), seeds.size() * sizeof(uint32_t));
+            const char padding[alignof(ArchiveEntry)]{};
+            out.write(padding, static_cast<std::streamsize>(entriesOffset(bucketCount) - sizeof(header) - seeds.size() * sizeof(uint32_t)));
+            out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+            out.write(names.data(), static_cast<std::streamsize>(names.size()));
+            if (!out)
+            {
+                throw std::runtime_error("LveArchive: Failed to write " + tempPath);
+            }
+        }
+
+        std::error_code error{};
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            throw std::runtime_error("LveArchive: Failed to replace " + path);
+        }
+    }
+
+    LveArchive::LveArchive(const std::string &path) : file{path}
+    {
+        ArchiveHeader header{};
+        if (file.getSize() < sizeof(header))
+        {
+            throw std::runtime_error("LveArchive: Not an archive: " + path);
+        }
+        std::memcpy(&header, file.getData(), sizeof(header));
+        if (std::memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.version != ARCHIVE_VERSION ||
+            header.bucketCount == 0)
+        {
+            throw std::runtime_error("LveArchive: Not an archive: " + path);
+        }
+
+        size_t namesOffset = entriesOffset(header.bucketCount) + size_t{header.entryCount} * sizeof(ArchiveEntry);
+        if (namesOffset + header.namesSize > file.getSize())
+        {
+            throw std::runtime_error("LveArchive: Truncated table: " + path);
+        }
+
+        // Checked once here, so lookups can trust every range
+        entryCount = header.entryCount;
+        bucketCount = header.bucketCount;
+        seeds = reinterpret_cast<const uint32_t *>(file.getData() + sizeof(header));
+        entries = file.getData() + entriesOffset(bucketCount);
+        names = reinterpret_cast<const char *>(file.getData() + namesOffset);
+        const ArchiveEntry *table = reinterpret_cast<const ArchiveEntry *>(entries);
+        for (uint32_t slot = 0; slot < entryCount; slot++)
+        {
+            const ArchiveEntry &entry = table[slot];
+            if (entry.nameOffset > header.namesSize || entry.nameSize > header.namesSize - entry.nameOffset ||
+                entry.offset > file.getSize() || entry.size > file.getSize() - entry.offset)
+            {
+                throw std::runtime_error("LveArchive: Entry out of bounds: " + path);
+            }
+        }
+    }
+
+    std::optional<std::span<const std::byte>> LveArchive::find(std::string_view name) const
+    {
+        if (entryCount == 0)
+        {
+            return std::nullopt;
+        }
+
+        uint64_t hash = hashName(name);
+        uint32_t slot = slotOf(hash, seeds[hash % bucketCount], entryCount);
+        const ArchiveEntry &entry = reinterpret_cast<const ArchiveEntry *>(entries)[slot];
+        // Names not in the archive land on some entry too, the comparison rejects them
+        if (std::string_view(names + entry.nameOffset, entry.nameSize) != name)
+        {
+            return std::nullopt;
+        }
+        return std::span<const std::byte>(file.getData() + entry.offset, static_cast<size_t>(entry.size));
+    }
+
+    const LveArchive *LveArchive::getDefault()
+    {
+        static const std::unique_ptr<LveArchive> archive = []() -> std::unique_ptr<LveArchive>
+        {
+            // An archive named explicitly has to exist, the default one is optional
+            if (const char *path = std::getenv("LVE_ARCHIVE"))
+            {
+                return std::make_unique<LveArchive>(path);
+            }
+            if (!std::filesystem::exists(DEFAULT_PATH))
+            {
+                return nullptr;
+            }
+            return std::make_unique<LveArchive>(DEFAULT_PATH);
+        }();
+        return archive.get();
+    }
+
+    std::optional<std::span<const std::byte>> LveArchive::findDefault(const std::string &path)
+    {
+        const LveArchive *archive = getDefault();
+        if (!archive)
+        {
+            return std::nullopt;
+        }
+        return archive->find(std::filesystem::path(path).lexically_normal().generic_string());
+    }
+
+    std::span<const std::byte> LveArchive::load(const std::string &path, std::vector<std::byte> &storage)
+    {
+        if (std::optional<std::span<const std::byte>> data = findDefault(path))
+        {
+            return *data;
+        }
+
+        std::ifstream file{path, std::ios::binary | std::ios::ate};
+        if (!file)
+        {
+            throw std::runtime_error("LveArchive: Failed to open " + path);
+        }
+        storage.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char *>(storage.data()), static_cast<std::streamsize>(storage.size()));
+        if (!file)
+        {
+            throw std::runtime_error("LveArchive: Failed to read " + path);
+        }
+        return storage;
+    }
+}
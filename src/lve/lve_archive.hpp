@@ -0,0 +1,58 @@
+#pragma once
+
+#include "lve_mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lve
+{
+    // Read-only pack of named files, mapped once. Entries start ENTRY_ALIGNMENT aligned and are
+    // handed out as views into the mapping. Names resolve through a minimal perfect hash built
+    // when writing, a lookup hashes the name, reads one bucket seed and compares one entry.
+    class LveArchive
+    {
+    public:
+        static constexpr size_t ENTRY_ALIGNMENT = 64;
+        // Opened by getDefault() unless LVE_ARCHIVE names another file
+        static constexpr const char *DEFAULT_PATH = "assets.lvepak";
+
+        struct Source
+        {
+            // Forward slashes, as passed to find()
+            std::string name;
+            std::string path;
+        };
+
+        static void write(const std::string &path, const std::vector<Source> &sources);
+
+        explicit LveArchive(const std::string &path);
+
+        LveArchive(const LveArchive &) = delete;
+        LveArchive &operator=(const LveArchive &) = delete;
+
+        std::optional<std::span<const std::byte>> find(std::string_view name) const;
+        uint32_t getEntryCount() const { return entryCount; }
+
+        // Process wide archive the loaders look in before the file system, nullptr when there is
+        // none. Opened on first use.
+        static const LveArchive *getDefault();
+        // View of a file system path in the default archive, if it holds it
+        static std::optional<std::span<const std::byte>> findDefault(const std::string &path);
+        // Contents of path from the default archive, or read from disk into storage when the
+        // archive does not hold it
+        static std::span<const std::byte> load(const std::string &path, std::vector<std::byte> &storage);
+
+    private:
+        LveMappedFile file;
+        uint32_t entryCount{};
+        uint32_t bucketCount{};
+        const uint32_t *seeds{};
+        const std::byte *entries{};
+        const char *names{};
+    };
+}
@@ -0,0 +1,165 @@
+#include "lve_asset_manager.hpp"
+#include <stdexcept>
+
+namespace lve
+{
+    LveAssetId LveAssetManager::intern(const std::string &path)
+    {
+        LveAssetId id = 14695981039346656037ull;
+        for (char c : path)
+        {
+            id = (id ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+
+        auto [it, inserted] = assets.try_emplace(id);
+        if (inserted)
+        {
+            it->second.path = path;
+            it->second.cachedIt = cached.end();
+        }
+        else if (it->second.path != path)
+        {
+            throw std::runtime_error("LveAssetManager: Asset id collision between " + it->second.path + " and " + path);
+        }
+        return id;
+    }
+
+    LveAssetManager::Asset &LveAssetManager::find(LveAssetId id)
+    {
+        auto it = assets.find(id);
+        if (it == assets.end())
+        {
+            throw std::runtime_error("LveAssetManager: Unknown asset id");
+        }
+        return it->second;
+    }
+
+    const LveAssetManager::Asset &LveAssetManager::find(LveAssetId id) const
+    {
+        auto it = assets.find(id);
+        if (it == assets.end())
+        {
+            throw std::runtime_error("LveAssetManager: Unknown asset id");
+        }
+        return it->second;
+    }
+
+    const std::string &LveAssetManager::getPath(LveAssetId id) const
+    {
+        return find(id).path;
+    }
+
+    LveAssetManager::State LveAssetManager::getState(LveAssetId id) const
+    {
+        return find(id).state;
+    }
+
+    uint32_t LveAssetManager::getRefCount(LveAssetId id) const
+    {
+        return find(id).refCount;
+    }
+
+    bool LveAssetManager::acquire(LveAssetId id)
+    {
+        Asset &asset = find(id);
+        if (asset.refCount++ == 0 && asset.cachedIt != cached.end())
+        {
+            cached.erase(asset.cachedIt);
+            asset.cachedIt = cached.end();
+        }
+
+        if (asset.state != State::Unloaded)
+        {
+            return false;
+        }
+        asset.state = State::Loading;
+        return true;
+    }
+
+    void LveAssetManager::release(LveAssetId id)
+    {
+        Asset &asset = find(id);
+        if (asset.refCount == 0)
+        {
+            throw std::runtime_error("LveAssetManager: Released an unreferenced asset: " + asset.path);
+        }
+        // Still loading, it is cached once markResident arrives
+        if (--asset.refCount == 0 && asset.state == State::Resident)
+        {
+            cached.push_front(id);
+            asset.cachedIt = cached.begin();
+        }
+    }
+
+    void LveAssetManager::markResident(LveAssetId id, uint64_t bytes)
+    {
+        Asset &asset = find(id);
+        if (asset.state != State::Loading)
+        {
+            throw std::runtime_error("LveAssetManager: Asset was not loading: " + asset.path);
+        }
+        asset.state = State::Resident;
+        asset.bytes = bytes;
+        residentBytes += bytes;
+        if (asset.refCount == 0)
+        {
+            cached.push_front(id);
+            asset.cachedIt = cached.begin();
+        }
+
+        resumeWaiters(asset);
+    }
+
+    void LveAssetManager::markFailed(LveAssetId id)
+    {
+        Asset &asset = find(id);
+        if (asset.state != State::Loading)
+        {
+            throw std::runtime_error("LveAssetManager: Asset was not loading: " + asset.path);
+        }
+        asset.state = State::Unloaded;
+        resumeWaiters(asset);
+    }
+
+    void LveAssetManager::resumeWaiters(Asset &asset)
+    {
+        // Swapped out first, a resumed coroutine may acquire or release this asset again
+        std::vector<std::coroutine_handle<>> waiters{};
+        waiters.swap(asset.waiters);
+        for (std::coroutine_handle<> waiter : waiters)
+        {
+            waiter.resume();
+        }
+    }
+
+    void LveAssetManager::setBytes(LveAssetId id, uint64_t bytes)
+    {
+        Asset &asset = find(id);
+        if (asset.state != State::Resident)
+        {
+            throw std::runtime_error("LveAssetManager: Asset is not resident: " + asset.path);
+        }
+        residentBytes = residentBytes - asset.bytes + bytes;
+        asset.bytes = bytes;
+    }
+
+    std::vector<LveAssetId> LveAssetManager::evict(uint64_t bytes)
+    {
+        std::vector<LveAssetId> evicted{};
+        uint64_t reclaimed = 0;
+        while (reclaimed < bytes && !cached.empty())
+        {
+            LveAssetId id = cached.back();
+            cached.pop_back();
+
+            Asset &asset = find(id);
+            asset.state = State::Unloaded;
+            asset.cachedIt = cached.end();
+            residentBytes -= asset.bytes;
+            reclaimed += asset.bytes;
+            asset.bytes = 0;
+            evicted.push_back(id);
+        }
+        return evicted;
+    }
+}
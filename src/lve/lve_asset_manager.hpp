@@ -0,0 +1,91 @@
+#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    // 64-bit FNV-1a hash of the asset path
+    using LveAssetId = uint64_t;
+
+    // Residency bookkeeping for assets loaded by path. The first acquire of an unloaded asset
+    // makes the caller load it, later acquires share that load and its result. Assets nobody
+    // references stay cached in least recently released order until evict() reclaims them.
+    // Not thread safe, used from the render loop.
+    class LveAssetManager
+    {
+    public:
+        enum class State
+        {
+            Unloaded,
+            Loading,
+            Resident
+        };
+
+        LveAssetManager() = default;
+        LveAssetManager(const LveAssetManager &) = delete;
+        LveAssetManager &operator=(const LveAssetManager &) = delete;
+
+        // The same path always interns to the same id
+        LveAssetId intern(const std::string &path);
+        const std::string &getPath(LveAssetId id) const;
+        State getState(LveAssetId id) const;
+        uint32_t getRefCount(LveAssetId id) const;
+        uint64_t getResidentBytes() const { return residentBytes; }
+        uint32_t getCachedCount() const { return static_cast<uint32_t>(cached.size()); }
+
+        // Adds a reference. Returns true if the asset was unloaded, the caller then loads it and
+        // reports back with markResident.
+        bool acquire(LveAssetId id);
+        void release(LveAssetId id);
+        // Resumes the coroutines waiting in whenResident
+        void markResident(LveAssetId id, uint64_t bytes);
+        // The load failed, the asset is unloaded again so the next acquire retries it. Resumes the
+        // waiters, who see it is not resident.
+        void markFailed(LveAssetId id);
+        // For a resident asset whose memory changed, e.g. after streaming in a finer level
+        void setBytes(LveAssetId id, uint64_t bytes);
+
+        // co_await whenResident(id) continues once the asset is resident or its load failed, on the
+        // thread reporting it, and yields whether it is resident
+        auto whenResident(LveAssetId id) { return Awaiter{*this, id}; }
+
+        // Unloads unreferenced assets, least recently released first, until at least bytes have been
+        // reclaimed or none are left. Returns them so the owner can free their memory.
+        std::vector<LveAssetId> evict(uint64_t bytes);
+
+    private:
+        struct Asset
+        {
+            std::string path{};
+            State state{State::Unloaded};
+            uint32_t refCount{};
+            uint64_t bytes{};
+            // Position in cached while resident and unreferenced
+            std::list<LveAssetId>::iterator cachedIt{};
+            std::vector<std::coroutine_handle<>> waiters{};
+        };
+        struct Awaiter
+        {
+            LveAssetManager &manager;
+            LveAssetId id;
+
+            bool await_ready() { return manager.getState(id) == State::Resident; }
+            void await_suspend(std::coroutine_handle<> handle) { manager.find(id).waiters.push_back(handle); }
+            bool await_resume() const { return manager.getState(id) == State::Resident; }
+        };
+
+        Asset &find(LveAssetId id);
+        const Asset &find(LveAssetId id) const;
+        void resumeWaiters(Asset &asset);
+
+        std::unordered_map<LveAssetId, Asset> assets{};
+        // Most recently released at the front
+        std::list<LveAssetId> cached{};
+        uint64_t residentBytes{};
+    };
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <limits>
+
+namespace lve
+{
+    // Fastest of repeatCount runs in nanoseconds, slower runs lost time to scheduling noise.
+    // setup runs untimed before every run, for runs that consume their input.
+    template <typename Run, std::invocable Setup>
+    double measureBestNs(Run &&run, Setup &&setup, int repeatCount = 5)
+    {
+        double bestNs = std::numeric_limits<double>::max();
+        for (int repeat = 0; repeat < repeatCount; repeat++)
+        {
+            setup();
+            auto start = std::chrono::steady_clock::now();
+            run();
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            bestNs = std::min(bestNs, std::chrono::duration<double, std::nano>(elapsed).count());
+        }
+        return bestNs;
+    }
+
+    template <typename Run>
+    double measureBestNs(Run &&run, int repeatCount = 5)
+    {
+        return measureBestNs(run, []() {}, repeatCount);
+    }
+}
@@ -0,0 +1,83 @@
+#include "lve_buffer.hpp"
+#include <cstring>
+#include <stdexcept>
+
+namespace lve
+{
+    LveBuffer::LveBuffer(
+        LveDevice &device,
+        VkDeviceSize size,
+        VkBufferUsageFlags usageFlags,
+        VkMemoryPropertyFlags memoryPropertyFlags) : device{device}, size{size}
+    {
+        device.createBuffer(size, usageFlags, memoryPropertyFlags, buffer, memory);
+    }
+
+    LveBuffer::~LveBuffer()
+    {
+        unmap();
+        device.disp.destroyBuffer(device.device(), buffer, nullptr);
+        device.disp.freeMemory(device.device(), memory, nullptr);
+    }
+
+    std::unique_ptr<LveBuffer> LveBuffer::createDeviceLocal(
+        LveDevice &device, const void *data, VkDeviceSize size, VkBufferUsageFlags usageFlags)
+    {
+        LveBuffer stagingBuffer{
+            device,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+        stagingBuffer.map();
+        stagingBuffer.writeToBuffer(data, size);
+
+        auto buffer = std::make_unique<LveBuffer>(
+            device,
+            size,
+            usageFlags | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        device.copyBuffer(stagingBuffer.getBuffer(), buffer->getBuffer(), size);
+
+        return buffer;
+    }
+
+    void LveBuffer::map()
+    {
+        if (mapped != nullptr)
+        {
+            return;
+        }
+        if (device.disp.mapMemory(device.device(), memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to map buffer memory");
+        }
+    }
+
+    void LveBuffer::unmap()
+    {
+        if (mapped != nullptr)
+        {
+            device.disp.unmapMemory(device.device(), memory);
+            mapped = nullptr;
+        }
+    }
+
+    void LveBuffer::writeToBuffer(const void *data, VkDeviceSize writeSize, VkDeviceSize offset)
+    {
+        if (mapped == nullptr)
+        {
+            throw std::runtime_error("LveBuffer: Cannot write to an unmapped buffer");
+        }
+        memcpy(static_cast<char *>(mapped) + offset, data, static_cast<size_t>(writeSize));
+    }
+
+    void LveBuffer::flush()
+    {
+        VkMappedMemoryRange mappedRange{};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = memory;
+        mappedRange.offset = 0;
+        mappedRange.size = VK_WHOLE_SIZE;
+        device.disp.flushMappedMemoryRanges(device.device(), 1, &mappedRange);
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include <memory>
+
+namespace lve
+{
+    // A VkBuffer with its own memory allocation, optionally mapped for host writes
+    class LveBuffer
+    {
+    public:
+        LveBuffer(
+            LveDevice &device,
+            VkDeviceSize size,
+            VkBufferUsageFlags usageFlags,
+            VkMemoryPropertyFlags memoryPropertyFlags);
+        ~LveBuffer();
+        LveBuffer(const LveBuffer &) = delete;
+        LveBuffer &operator=(const LveBuffer &) = delete;
+
+        // Uploads data through a staging buffer and waits for the copy to finish
+        static std::unique_ptr<LveBuffer> createDeviceLocal(
+            LveDevice &device, const void *data, VkDeviceSize size, VkBufferUsageFlags usageFlags);
+
+        void map();
+        void unmap();
+        void writeToBuffer(const void *data, VkDeviceSize size, VkDeviceSize offset = 0);
+        // Only needed for memory without VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        void flush();
+
+        VkBuffer getBuffer() const { return buffer; }
+        void *getMappedMemory() const { return mapped; }
+        VkDeviceSize getSize() const { return size; }
+
+    private:
+        LveDevice &device;
+        VkBuffer buffer{};
+        VkDeviceMemory memory{};
+        VkDeviceSize size{};
+        void *mapped{};
+    };
+}
@@ -0,0 +1,57 @@
+#include "lve_compute_pipeline.hpp"
+#include "lve_archive.hpp"
+#include "lve_trace.hpp"
+#include <stdexcept>
+
+namespace lve
+{
+    LveComputePipeline::LveComputePipeline(LveDevice &device, const std::string &compFilePath, VkPipelineLayout layout)
+        : device{device}
+    {
+        createComputePipeline(compFilePath, layout);
+    }
+
+    LveComputePipeline::~LveComputePipeline()
+    {
+        device.disp.destroyShaderModule(device.device(), compShaderModule, nullptr);
+        device.disp.destroyPipeline(device.device(), computePipeline, nullptr);
+    }
+
+    void LveComputePipeline::bind(VkCommandBuffer commandBuffer)
+    {
+        device.disp.cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+    }
+
+    void LveComputePipeline::createComputePipeline(const std::string &compFilePath, VkPipelineLayout layout)
+    {
+        LVE_TRACE_ZONE("LveComputePipeline::createComputePipeline");
+        std::vector<std::byte> compStorage{};
+        auto compCode = LveArchive::load(compFilePath, compStorage);
+
+        VkShaderModuleCreateInfo shaderModuleCi{};
+        shaderModuleCi.codeSize = compCode.size();
+        shaderModuleCi.pCode = reinterpret_cast<const uint32_t *>(compCode.data());
+        shaderModuleCi.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+
+        if (device.disp.createShaderModule(device.device(), &shaderModuleCi, nullptr, &compShaderModule) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create shader module");
+        }
+
+        VkPipelineShaderStageCreateInfo shaderStage{};
+        shaderStage.module = compShaderModule;
+        shaderStage.pName = "main";
+        shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+
+        VkComputePipelineCreateInfo computePipelineCi{};
+        computePipelineCi.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        computePipelineCi.stage = shaderStage;
+        computePipelineCi.layout = layout;
+
+        if (device.disp.createComputePipelines(device.device(), nullptr, 1, &computePipelineCi, nullptr, &computePipeline) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create compute pipeline");
+        }
+    }
+}
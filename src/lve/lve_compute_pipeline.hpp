@@ -0,0 +1,24 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include <string>
+
+namespace lve
+{
+    class LveComputePipeline
+    {
+    public:
+        LveComputePipeline(LveDevice &device, const std::string &compFilePath, VkPipelineLayout layout);
+        ~LveComputePipeline();
+        LveComputePipeline(const LveComputePipeline &) = delete;
+        void operator=(const LveComputePipeline &) = delete;
+        void bind(VkCommandBuffer commandBuffer);
+
+    private:
+        void createComputePipeline(const std::string &compFilePath, VkPipelineLayout layout);
+
+        LveDevice &device;
+        VkPipeline computePipeline{};
+        VkShaderModule compShaderModule{};
+    };
+}
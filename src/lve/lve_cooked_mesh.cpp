@@ -0,0 +1,292 @@
+#include "lve_cooked_mesh.hpp"
+#include "lve_archive.hpp"
+#include "lve_mesh_codec.hpp"
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace lve
+{
+    static constexpr char COOKED_MESH_MAGIC[4] = {'L', 'V', 'C', 'M'};
+    static constexpr uint32_t COOKED_MESH_VERSION = 3;
+    static constexpr uint32_t COOKED_MESH_ENCODED = 1;
+
+    static_assert(std::endian::native == std::endian::little, "Cooked meshes are little endian");
+    static_assert(sizeof(LveCookedMesh::Vertex) == 24, "Cooked vertices are two packed vec3");
+
+    // Followed by the LOD table, then either the vertices, positions and indices, or from the
+    // coarsest level to the full mesh, the encoded vertices each level adds and its encoded indices
+    struct CookedMeshHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        float positionStep;
+        float positionOrigin[3];
+        uint32_t flags;
+    };
+
+    // Encoded vertex, grid coordinates from positionOrigin and the normal as cooked
+    struct PackedVertex
+    {
+        uint16_t position[3];
+        int8_t normal[3];
+        uint8_t padding[3];
+    };
+    static_assert(sizeof(PackedVertex) == 12, "Packed vertices are encoded as three 4-byte columns");
+
+    static constexpr float NORMAL_STEPS = static_cast<float>((1u << (LveMeshOptimizer::NORMAL_BITS - 1)) - 1);
+
+    void LveCookedMesh::write(const std::string &path, const std::vector<Vertex> &vertices,
+                              const std::vector<uint32_t> &indices, const std::vector<Lod> &lods, float positionStep,
+                              bool encode)
+    {
+        if (lods.empty() || lods.size() > MAX_LODS)
+        {
+            throw std::runtime_error("LveCookedMesh: Between 1 and 8 levels of detail required");
+        }
+        std::vector<Lod> table = lods;
+        for (Lod &lod : table)
+        {
+            if (lod.firstIndex > indices.size() || lod.indexCount > indices.size() - lod.firstIndex)
+            {
+                throw std::runtime_error("LveCookedMesh: Level of detail exceeds the indices");
+            }
+            lod.vertexCount = 0;
+            for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++)
+            {
+                if (indices[i] >= vertices.size())
+                {
+                    throw std::runtime_error("LveCookedMesh: Index exceeds the vertices");
+                }
+                lod.vertexCount = std::max(lod.vertexCount, indices[i] + 1);
+            }
+        }
+        // Each level's prefix covers the coarser ones, so the vertices decode coarse to fine
+        table[0].vertexCount = static_cast<uint32_t>(vertices.size());
+        for (size_t l = table.size() - 1; l-- > 0;)
+        {
+            table[l].vertexCount = std::max(table[l].vertexCount, table[l + 1].vertexCount);
+        }
+
+        glm::vec3 origin{vertices.empty() ? 0.0f : FLT_MAX};
+        for (const Vertex &vertex : vertices)
+        {
+            origin = glm::min(origin, vertex.position);
+        }
+
+        std::vector<std::vector<std::byte>> vertexData(lods.size());
+        std::vector<std::vector<std::byte>> indexData(lods.size());
+        if (encode)
+        {
+            const float positionSteps = static_cast<float>((1u << LveMeshOptimizer::POSITION_BITS) - 1);
+            std::vector<PackedVertex> packed(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                glm::vec3 grid = glm::clamp(glm::floor((vertices[i].position - origin) / positionStep + 0.5f),
+                                            glm::vec3(0.0f), glm::vec3(positionSteps));
+                glm::vec3 normal = glm::clamp(glm::floor(vertices[i].normal * NORMAL_STEPS + 0.5f),
+                                              glm::vec3(-NORMAL_STEPS), glm::vec3(NORMAL_STEPS));
+                for (int c = 0; c < 3; c++)
+                {
+                    packed[i].position[c] = static_cast<uint16_t>(grid[c]);
+                    packed[i].normal[c] = static_cast<int8_t>(normal[c]);
+                }
+            }
+
+            // Every level's vertices and indices are separate streams, so the coarse levels decode
+            // without touching the data of the finer ones
+            for (size_t l = 0; l < table.size(); l++)
+            {
+                uint32_t firstVertex = l + 1 < table.size() ? table[l + 1].vertexCount : 0;
+                vertexData[l] = LveMeshCodec::encodeVertices(packed.data() + firstVertex, table[l].vertexCount - firstVertex,
+                                                             sizeof(PackedVertex));
+                indexData[l] = LveMeshCodec::encodeIndices(indices.data() + table[l].firstIndex, table[l].indexCount);
+                table[l].encodedVertexSize = static_cast<uint32_t>(vertexData[l].size());
+                table[l].encodedIndexSize = static_cast<uint32_t>(indexData[l].size());
+            }
+        }
+        else
+        {
+            for (Lod &lod : table)
+            {
+                lod.encodedVertexSize = 0;
+                lod.encodedIndexSize = 0;
+            }
+        }
+
+        // Written next to the target and renamed over it, so readers never see half a mesh
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream out{tempPath, std::ios::binary | std::ios::trunc};
+            if (!out)
+            {
+                throw std::runtime_error("LveCookedMesh: Failed to create " + tempPath);
+            }
+
+            CookedMeshHeader header{{}, COOKED_MESH_VERSION, static_cast<uint32_t>(vertices.size()),
+                                    static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lods.size()),
+                                    positionStep, {origin.x, origin.y, origin.z}, encode ? COOKED_MESH_ENCODED : 0};
+            std::memcpy(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic));
+            out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(Lod));
+            if (encode)
+            {
+                for (size_t l = table.size(); l-- > 0;)
+                {
+                    out.write(reinterpret_cast<const char *>(vertexData[l].data()), static_cast<std::streamsize>(vertexData[l].size()));
+                    out.write(reinterpret_cast<const char *>(indexData[l].data()), static_cast<std::streamsize>(indexData[l].size()));
+                }
+            }
+            else
+            {
+                out.write(reinterpret_cast<const char *>(vertices.data()), vertices.size() * sizeof(Vertex));
+                for (const Vertex &vertex : vertices)
+                {
+                    out.write(reinterpret_cast<const char *>(&vertex.position), sizeof(glm::vec3));
+                }
+                out.write(reinterpret_cast<const char *>(indices.data()), indices.size() * sizeof(uint32_t));
+            }
+            if (!out)
+            {
+                throw std::runtime_error("LveCookedMesh: Failed to write " + tempPath);
+            }
+        }
+
+        std::error_code error{};
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            throw std::runtime_error("LveCookedMesh: Failed to replace " + path);
+        }
+    }
+
+    LveCookedMesh::LveCookedMesh(const std::string &path)
+    {
+        if (std::optional<std::span<const std::byte>> entry = LveArchive::findDefault(path))
+        {
+            data = *entry;
+        }
+        else
+        {
+            file = std::make_unique<LveMappedFile>(path);
+            data = std::span<const std::byte>(file->getData(), file->getSize());
+        }
+
+        CookedMeshHeader header{};
+        if (data.size() < sizeof(header))
+        {
+            throw std::runtime_error("LveCookedMesh: Not a cooked mesh: " + path);
+        }
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (std::memcmp(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != COOKED_MESH_VERSION)
+        {
+            throw std::runtime_error("LveCookedMesh: Not a cooked mesh: " + path);
+        }
+        if (header.lodCount == 0 || header.lodCount > MAX_LODS)
+        {
+            throw std::runtime_error("LveCookedMesh: Bad level of detail count: " + path);
+        }
+
+        size_t lodOffset = sizeof(header);
+        size_t dataOffset = lodOffset + header.lodCount * sizeof(Lod);
+        if (data.size() < dataOffset)
+        {
+            throw std::runtime_error("LveCookedMesh: Truncated mesh: " + path);
+        }
+        lods.resize(header.lodCount);
+        std::memcpy(lods.data(), data.data() + lodOffset, lods.size() * sizeof(Lod));
+        for (size_t l = 0; l < lods.size(); l++)
+        {
+            const Lod &lod = lods[l];
+            uint32_t coarserVertices = l + 1 < lods.size() ? lods[l + 1].vertexCount : 0;
+            if (lod.firstIndex > header.indexCount || lod.indexCount > header.indexCount - lod.firstIndex ||
+                lod.vertexCount > header.vertexCount || lod.vertexCount < coarserVertices)
+            {
+                throw std::runtime_error("LveCookedMesh: Level of detail exceeds the mesh: " + path);
+            }
+        }
+
+        encoded = (header.flags & COOKED_MESH_ENCODED) != 0;
+        size_t end = dataOffset;
+        vertexOffsets.resize(lods.size());
+        indexOffsets.resize(lods.size());
+        if (encoded)
+        {
+            for (size_t l = lods.size(); l-- > 0;)
+            {
+                vertexOffsets[l] = end;
+                indexOffsets[l] = vertexOffsets[l] + lods[l].encodedVertexSize;
+                end = indexOffsets[l] + lods[l].encodedIndexSize;
+            }
+        }
+        else
+        {
+            // Every section starts 4-byte aligned, mappings and archive entries are aligned further
+            positionOffset = dataOffset + size_t{header.vertexCount} * sizeof(Vertex);
+            size_t indexOffset = positionOffset + size_t{header.vertexCount} * sizeof(glm::vec3);
+            for (size_t l = 0; l < lods.size(); l++)
+            {
+                vertexOffsets[l] = dataOffset;
+                indexOffsets[l] = indexOffset + size_t{lods[l].firstIndex} * sizeof(uint32_t);
+            }
+            end = indexOffset + size_t{header.indexCount} * sizeof(uint32_t);
+        }
+        if (data.size() != end)
+        {
+            throw std::runtime_error("LveCookedMesh: Truncated mesh: " + path);
+        }
+
+        vertexCount = header.vertexCount;
+        indexCount = header.indexCount;
+        positionStep = header.positionStep;
+        positionOrigin = glm::vec3(header.positionOrigin[0], header.positionOrigin[1], header.positionOrigin[2]);
+    }
+
+    void LveCookedMesh::readVertices(uint32_t lod, Vertex *vertices, glm::vec3 *positions) const
+    {
+        uint32_t count = lods.at(lod).vertexCount;
+        if (!encoded)
+        {
+            std::memcpy(vertices, data.data() + vertexOffsets[lod], size_t{count} * sizeof(Vertex));
+            std::memcpy(positions, data.data() + positionOffset, size_t{count} * sizeof(glm::vec3));
+            return;
+        }
+
+        std::vector<PackedVertex> packed(count);
+        for (size_t l = lods.size(); l-- > lod;)
+        {
+            uint32_t firstVertex = l + 1 < lods.size() ? lods[l + 1].vertexCount : 0;
+            LveMeshCodec::decodeVertices(packed.data() + firstVertex, lods[l].vertexCount - firstVertex, sizeof(PackedVertex),
+                                         data.subspan(vertexOffsets[l], lods[l].encodedVertexSize));
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const PackedVertex &vertex = packed[i];
+            glm::vec3 position = positionOrigin + glm::vec3(vertex.position[0], vertex.position[1], vertex.position[2]) * positionStep;
+            vertices[i].position = position;
+            vertices[i].normal = glm::vec3(vertex.normal[0], vertex.normal[1], vertex.normal[2]) / NORMAL_STEPS;
+            positions[i] = position;
+        }
+    }
+
+    void LveCookedMesh::readIndices(uint32_t lod, uint32_t *indices) const
+    {
+        const Lod &level = lods.at(lod);
+        if (!encoded)
+        {
+            std::memcpy(indices, data.data() + indexOffsets[lod], size_t{level.indexCount} * sizeof(uint32_t));
+            return;
+        }
+        LveMeshCodec::decodeIndices(indices, level.indexCount, level.vertexCount,
+                                    data.subspan(indexOffsets[lod], level.encodedIndexSize));
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "lve_mapped_file.hpp"
+#include "lve_mesh_optimizer.hpp"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    // Mesh written by vp_cook for the renderer's upload layout: vertices, their positions as a
+    // separate stream for the depth pre-pass, and the indices of every level of detail. Every level
+    // references a prefix of the vertices, the coarser the level the shorter, so a level can be
+    // read and drawn on its own. Raw files hold exactly that and reading is a copy out of the
+    // default archive or a mapping of the file. Encoded files hold the quantized vertices and the
+    // indices compressed with LveMeshCodec, coarsest level first, so streaming a mesh coarse to
+    // fine reads the file front to back.
+    class LveCookedMesh
+    {
+    public:
+        using Vertex = LveMeshOptimizer::Vertex;
+
+        static constexpr uint32_t MAX_LODS = 8;
+
+        // Index range of one level of detail, 0 is the full mesh. error is the world space size of
+        // the simplification grid cell, 0 for the full mesh.
+        struct Lod
+        {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            // The level references vertices [0, vertexCount)
+            uint32_t vertexCount;
+            float error;
+            // Bytes of the vertices the level adds to the next coarser one and of its indices
+            // when encoded, 0 in raw files
+            uint32_t encodedVertexSize;
+            uint32_t encodedIndexSize;
+        };
+
+        // indices holds all levels back to back as described by lods, vertexCount and the encoded
+        // sizes are filled in. Vertices should be numbered coarsest level first, or every level
+        // covers almost all of them. Encoding expects positions on the positionStep grid and
+        // normals of NORMAL_BITS, as quantizeAndWeld leaves them.
+        static void write(const std::string &path, const std::vector<Vertex> &vertices,
+                          const std::vector<uint32_t> &indices, const std::vector<Lod> &lods, float positionStep,
+                          bool encode);
+
+        explicit LveCookedMesh(const std::string &path);
+
+        LveCookedMesh(const LveCookedMesh &) = delete;
+        LveCookedMesh &operator=(const LveCookedMesh &) = delete;
+
+        uint32_t getVertexCount() const { return vertexCount; }
+        uint32_t getIndexCount() const { return indexCount; }
+        const std::vector<Lod> &getLods() const { return lods; }
+        // Grid step positions were snapped to when cooking
+        float getPositionStep() const { return positionStep; }
+
+        bool isEncoded() const { return encoded; }
+        // Size of the mesh in the file or archive
+        size_t getDataSize() const { return data.size(); }
+
+        // Writes the lod's vertexCount vertices and positions. Only the data of that level and the
+        // coarser ones is touched.
+        void readVertices(uint32_t lod, Vertex *vertices, glm::vec3 *positions) const;
+        // Writes the lod's indexCount indices
+        void readIndices(uint32_t lod, uint32_t *indices) const;
+
+    private:
+        // Only set when the mesh is not in the default archive
+        std::unique_ptr<LveMappedFile> file{};
+        uint32_t vertexCount{};
+        uint32_t indexCount{};
+        std::vector<Lod> lods{};
+        float positionStep{};
+        glm::vec3 positionOrigin{};
+        bool encoded{};
+        std::span<const std::byte> data{};
+        // Start of each level's vertices and indices in data. Raw files keep all positions after
+        // the vertices at positionOffset.
+        std::vector<size_t> vertexOffsets{};
+        std::vector<size_t> indexOffsets{};
+        size_t positionOffset{};
+    };
+}
@@ -1,4 +1,5 @@
 #include "lve_device.hpp"
+#include "lve_trace.hpp"
 
 // std headers
 #include <cstring>
@@ -66,12 +67,13 @@ namespace lve
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    setupCalibratedTimestamps();
   }
 
   LveDevice::~LveDevice()
   {
-    vkDestroyCommandPool(device_, commandPool, nullptr);
-    vkDestroyDevice(device_, nullptr);
+    disp.destroyCommandPool(device_, commandPool, nullptr);
+    disp.destroyDevice(device_, nullptr);
 
     if (enableValidationLayers)
     {
@@ -84,6 +86,7 @@ namespace lve
 
   void LveDevice::createInstance()
   {
+    LVE_TRACE_ZONE("LveDevice::createInstance");
     if (enableValidationLayers && !checkValidationLayerSupport())
     {
       throw std::runtime_error("validation layers requested, but not available!");
@@ -130,6 +133,7 @@ namespace lve
 
   void LveDevice::pickPhysicalDevice()
   {
+    LVE_TRACE_ZONE("LveDevice::pickPhysicalDevice");
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
     if (deviceCount == 0)
@@ -160,6 +164,7 @@ namespace lve
 
   void LveDevice::createLogicalDevice()
   {
+    LVE_TRACE_ZONE("LveDevice::createLogicalDevice");
     QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
@@ -176,8 +181,15 @@ namespace lve
       queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+    enabledFeatures = deviceFeatures;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -186,8 +198,30 @@ namespace lve
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(
+        physicalDevice,
+        nullptr,
+        &extensionCount,
+        availableExtensions.data());
+
+    enabledDeviceExtensions = deviceExtensions;
+    for (const char *optional : optionalDeviceExtensions)
+    {
+      for (const auto &extension : availableExtensions)
+      {
+        if (strcmp(optional, extension.extensionName) == 0)
+        {
+          enabledDeviceExtensions.push_back(optional);
+          break;
+        }
+      }
+    }
+
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
 
     // might not really be necessary anymore because device specific validation layers
     // have been deprecated
@@ -205,9 +239,16 @@ namespace lve
     {
       throw std::runtime_error("failed to create logical device!");
     }
+    disp.load(device_);
+    if (isExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+    {
+      cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(
+          device_,
+          "vkCmdDrawIndexedIndirectCountKHR");
+    }
 
-    vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
-    vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+    disp.getDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
+    disp.getDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
   }
 
   void LveDevice::createCommandPool()
@@ -220,12 +261,85 @@ namespace lve
     poolInfo.flags =
         VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-    if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+    if (disp.createCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create command pool!");
     }
   }
 
+  void LveDevice::setupCalibratedTimestamps()
+  {
+    if (!isExtensionEnabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+    {
+      return;
+    }
+
+    // steady_clock is CLOCK_MONOTONIC on the platforms we calibrate against
+    auto getTimeDomains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)vkGetInstanceProcAddr(
+        instance,
+        "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT");
+    if (getTimeDomains == nullptr)
+    {
+      return;
+    }
+
+    uint32_t domainCount = 0;
+    getTimeDomains(physicalDevice, &domainCount, nullptr);
+    std::vector<VkTimeDomainEXT> domains(domainCount);
+    getTimeDomains(physicalDevice, &domainCount, domains.data());
+
+    bool hasDevice = false, hasMonotonic = false;
+    for (auto domain : domains)
+    {
+      hasDevice |= domain == VK_TIME_DOMAIN_DEVICE_EXT;
+      hasMonotonic |= domain == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+    }
+
+    if (hasDevice && hasMonotonic)
+    {
+      vkGetCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(
+          device_,
+          "vkGetCalibratedTimestampsEXT");
+    }
+  }
+
+  bool LveDevice::isExtensionEnabled(const char *extensionName)
+  {
+    for (const char *extension : enabledDeviceExtensions)
+    {
+      if (strcmp(extension, extensionName) == 0)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool LveDevice::getCalibratedTimestamps(uint64_t &deviceTicks, uint64_t &hostNs)
+  {
+    if (vkGetCalibratedTimestamps == nullptr)
+    {
+      return false;
+    }
+
+    VkCalibratedTimestampInfoEXT timestampInfos[2]{};
+    timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    timestampInfos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+
+    uint64_t timestamps[2]{};
+    uint64_t maxDeviation{};
+    if (vkGetCalibratedTimestamps(device_, 2, timestampInfos, timestamps, &maxDeviation) != VK_SUCCESS)
+    {
+      return false;
+    }
+
+    deviceTicks = timestamps[0];
+    hostNs = timestamps[1];
+    return true;
+  }
+
   void LveDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
   bool LveDevice::isDeviceSuitable(VkPhysicalDevice device)
@@ -484,25 +598,25 @@ namespace lve
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    if (disp.createBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create vertex buffer!");
     }
 
     VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
+    disp.getBufferMemoryRequirements(device_, buffer, &memRequirements);
 
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
     allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, props);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+    if (disp.allocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to allocate vertex buffer memory!");
     }
 
-    vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+    disp.bindBufferMemory(device_, buffer, bufferMemory, 0);
   }
 
   VkCommandBuffer LveDevice::beginSingleTimeCommands()
@@ -514,29 +628,29 @@ namespace lve
     allocInfo.commandBufferCount = 1;
 
     VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+    disp.allocateCommandBuffers(device_, &allocInfo, &commandBuffer);
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    disp.beginCommandBuffer(commandBuffer, &beginInfo);
     return commandBuffer;
   }
 
   void LveDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer)
   {
-    vkEndCommandBuffer(commandBuffer);
+    disp.endCommandBuffer(commandBuffer);
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue_);
+    disp.queueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+    disp.queueWaitIdle(graphicsQueue_);
 
-    vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+    disp.freeCommandBuffers(device_, commandPool, 1, &commandBuffer);
   }
 
   void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
@@ -547,7 +661,7 @@ namespace lve
     copyRegion.srcOffset = 0; // Optional
     copyRegion.dstOffset = 0; // Optional
     copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    disp.cmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
     endSingleTimeCommands(commandBuffer);
   }
@@ -570,7 +684,7 @@ namespace lve
     region.imageOffset = {0, 0, 0};
     region.imageExtent = {width, height, 1};
 
-    vkCmdCopyBufferToImage(
+    disp.cmdCopyBufferToImage(
         commandBuffer,
         buffer,
         image,
@@ -586,25 +700,25 @@ namespace lve
       VkImage &image,
       VkDeviceMemory &imageMemory)
   {
-    if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    if (disp.createImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create image!");
     }
 
     VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device_, image, &memRequirements);
+    disp.getImageMemoryRequirements(device_, image, &memRequirements);
 
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
     allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, props);
 
-    if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+    if (disp.allocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to allocate image memory!");
     }
 
-    if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS)
+    if (disp.bindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to bind image memory!");
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_window.hpp"
+#include "lve_device_dispatch.hpp"
 
 // std lib headers
 #include <string>
@@ -44,6 +45,7 @@ namespace lve
     LveDevice &operator=(LveDevice &&) = delete;
 
     VkCommandPool getCommandPool() { return commandPool; }
+    VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
     VkDevice device() { return device_; }
     VkSurfaceKHR surface() { return surface_; }
     VkQueue graphicsQueue() { return graphicsQueue_; }
@@ -74,7 +76,18 @@ namespace lve
         VkImage &image,
         VkDeviceMemory &imageMemory);
 
+    bool isExtensionEnabled(const char *extensionName);
+    // Samples the device timestamp counter and steady_clock together, needs VK_EXT_calibrated_timestamps
+    bool hasCalibratedTimestamps() { return vkGetCalibratedTimestamps != nullptr; }
+    bool getCalibratedTimestamps(uint64_t &deviceTicks, uint64_t &hostNs);
+    bool hasDrawIndirectCount() { return cmdDrawIndexedIndirectCount != nullptr; }
+
     VkPhysicalDeviceProperties properties;
+    VkPhysicalDeviceFeatures enabledFeatures{};
+    // Device-level functions of device(), use these instead of the loader exports
+    LveDeviceDispatch disp{};
+    // Optional, null without VK_KHR_draw_indirect_count
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
 
   private:
     void createInstance();
@@ -83,6 +96,7 @@ namespace lve
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void setupCalibratedTimestamps();
 
     // helper functions
     bool isDeviceSuitable(VkPhysicalDevice device);
@@ -107,6 +121,11 @@ namespace lve
 
     const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
     const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+    const std::vector<const char *> optionalDeviceExtensions = {
+        VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME,
+        VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME};
+    std::vector<const char *> enabledDeviceExtensions;
+    PFN_vkGetCalibratedTimestampsEXT vkGetCalibratedTimestamps = nullptr;
   };
 
 } // namespace lve
\ No newline at end of file
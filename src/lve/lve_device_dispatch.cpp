@@ -0,0 +1,17 @@
+#include "lve_device_dispatch.hpp"
+#include <stdexcept>
+
+namespace lve
+{
+    void LveDeviceDispatch::load(VkDevice device)
+    {
+#define LVE_LOAD_DEVICE_FUNCTION(member, function)                                    \
+    member = reinterpret_cast<PFN_##function>(vkGetDeviceProcAddr(device, #function)); \
+    if (member == nullptr)                                                             \
+    {                                                                                  \
+        throw std::runtime_error("Vulkan: Failed to load " #function);                 \
+    }
+        LVE_DEVICE_FUNCTIONS(LVE_LOAD_DEVICE_FUNCTION)
+#undef LVE_LOAD_DEVICE_FUNCTION
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Device-level entry points fetched with vkGetDeviceProcAddr. Calling through these skips the
+// loader trampoline that every exported vk* device function goes through.
+#define LVE_DEVICE_FUNCTIONS(X)                                   \
+    X(destroyDevice, vkDestroyDevice)                             \
+    X(getDeviceQueue, vkGetDeviceQueue)                           \
+    X(deviceWaitIdle, vkDeviceWaitIdle)                           \
+    X(queueSubmit, vkQueueSubmit)                                 \
+    X(queueWaitIdle, vkQueueWaitIdle)                             \
+    X(allocateMemory, vkAllocateMemory)                           \
+    X(freeMemory, vkFreeMemory)                                   \
+    X(mapMemory, vkMapMemory)                                     \
+    X(unmapMemory, vkUnmapMemory)                                 \
+    X(flushMappedMemoryRanges, vkFlushMappedMemoryRanges)         \
+    X(bindBufferMemory, vkBindBufferMemory)                       \
+    X(bindImageMemory, vkBindImageMemory)                         \
+    X(getBufferMemoryRequirements, vkGetBufferMemoryRequirements) \
+    X(getImageMemoryRequirements, vkGetImageMemoryRequirements)   \
+    X(createFence, vkCreateFence)                                 \
+    X(destroyFence, vkDestroyFence)                               \
+    X(resetFences, vkResetFences)                                 \
+    X(getFenceStatus, vkGetFenceStatus)                           \
+    X(waitForFences, vkWaitForFences)                             \
+    X(createSemaphore, vkCreateSemaphore)                         \
+    X(destroySemaphore, vkDestroySemaphore)                       \
+    X(createQueryPool, vkCreateQueryPool)                         \
+    X(destroyQueryPool, vkDestroyQueryPool)                       \
+    X(getQueryPoolResults, vkGetQueryPoolResults)                 \
+    X(createBuffer, vkCreateBuffer)                               \
+    X(destroyBuffer, vkDestroyBuffer)                             \
+    X(createImage, vkCreateImage)                                 \
+    X(destroyImage, vkDestroyImage)                               \
+    X(createImageView, vkCreateImageView)                         \
+    X(destroyImageView, vkDestroyImageView)                       \
+    X(createSampler, vkCreateSampler)                             \
+    X(destroySampler, vkDestroySampler)                           \
+    X(createShaderModule, vkCreateShaderModule)                   \
+    X(destroyShaderModule, vkDestroyShaderModule)                 \
+    X(createGraphicsPipelines, vkCreateGraphicsPipelines)         \
+    X(createComputePipelines, vkCreateComputePipelines)           \
+    X(destroyPipeline, vkDestroyPipeline)                         \
+    X(createPipelineLayout, vkCreatePipelineLayout)               \
+    X(destroyPipelineLayout, vkDestroyPipelineLayout)             \
+    X(createDescriptorSetLayout, vkCreateDescriptorSetLayout)     \
+    X(destroyDescriptorSetLayout, vkDestroyDescriptorSetLayout)   \
+    X(createDescriptorPool, vkCreateDescriptorPool)               \
+    X(destroyDescriptorPool, vkDestroyDescriptorPool)             \
+    X(allocateDescriptorSets, vkAllocateDescriptorSets)           \
+    X(updateDescriptorSets, vkUpdateDescriptorSets)               \
+    X(createRenderPass, vkCreateRenderPass)                       \
+    X(destroyRenderPass, vkDestroyRenderPass)                     \
+    X(createFramebuffer, vkCreateFramebuffer)                     \
+    X(destroyFramebuffer, vkDestroyFramebuffer)                   \
+    X(createCommandPool, vkCreateCommandPool)                     \
+    X(destroyCommandPool, vkDestroyCommandPool)                   \
+    X(resetCommandPool, vkResetCommandPool)                       \
+    X(allocateCommandBuffers, vkAllocateCommandBuffers)           \
+    X(freeCommandBuffers, vkFreeCommandBuffers)                   \
+    X(beginCommandBuffer, vkBeginCommandBuffer)                   \
+    X(endCommandBuffer, vkEndCommandBuffer)                       \
+    X(resetCommandBuffer, vkResetCommandBuffer)                   \
+    X(cmdBindPipeline, vkCmdBindPipeline)                         \
+    X(cmdBindDescriptorSets, vkCmdBindDescriptorSets)             \
+    X(cmdBindVertexBuffers, vkCmdBindVertexBuffers)               \
+    X(cmdBindIndexBuffer, vkCmdBindIndexBuffer)                   \
+    X(cmdPushConstants, vkCmdPushConstants)                       \
+    X(cmdSetViewport, vkCmdSetViewport)                           \
+    X(cmdSetScissor, vkCmdSetScissor)                             \
+    X(cmdDraw, vkCmdDraw)                                         \
+    X(cmdDrawIndexed, vkCmdDrawIndexed)                           \
+    X(cmdDrawIndirect, vkCmdDrawIndirect)                         \
+    X(cmdDrawIndexedIndirect, vkCmdDrawIndexedIndirect)           \
+    X(cmdDispatch, vkCmdDispatch)                                 \
+    X(cmdCopyBuffer, vkCmdCopyBuffer)                             \
+    X(cmdCopyBufferToImage, vkCmdCopyBufferToImage)               \
+    X(cmdFillBuffer, vkCmdFillBuffer)                             \
+    X(cmdPipelineBarrier, vkCmdPipelineBarrier)                   \
+    X(cmdBeginQuery, vkCmdBeginQuery)                             \
+    X(cmdEndQuery, vkCmdEndQuery)                                 \
+    X(cmdResetQueryPool, vkCmdResetQueryPool)                     \
+    X(cmdWriteTimestamp, vkCmdWriteTimestamp)                     \
+    X(cmdBeginRenderPass, vkCmdBeginRenderPass)                   \
+    X(cmdNextSubpass, vkCmdNextSubpass)                           \
+    X(cmdEndRenderPass, vkCmdEndRenderPass)                       \
+    X(createSwapchainKHR, vkCreateSwapchainKHR)                   \
+    X(destroySwapchainKHR, vkDestroySwapchainKHR)                 \
+    X(getSwapchainImagesKHR, vkGetSwapchainImagesKHR)             \
+    X(acquireNextImageKHR, vkAcquireNextImageKHR)                 \
+    X(queuePresentKHR, vkQueuePresentKHR)
+
+namespace lve
+{
+    struct LveDeviceDispatch
+    {
+#define LVE_DECLARE_DEVICE_FUNCTION(member, function) PFN_##function member = nullptr;
+        LVE_DEVICE_FUNCTIONS(LVE_DECLARE_DEVICE_FUNCTION)
+#undef LVE_DECLARE_DEVICE_FUNCTION
+
+        void load(VkDevice device);
+    };
+}
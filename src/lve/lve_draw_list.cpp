@@ -0,0 +1,210 @@
+#include "lve_draw_list.hpp"
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+namespace lve
+{
+    std::vector<VkVertexInputBindingDescription> LveDrawList::Instance::getBindingDescriptions()
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 1;
+        bindingDescriptions[0].stride = sizeof(Instance);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> LveDrawList::Instance::getAttributeDescriptions()
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+        attributeDescriptions[0].location = 2;
+        attributeDescriptions[0].binding = 1;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(Instance, positionScale);
+        attributeDescriptions[1].location = 3;
+        attributeDescriptions[1].binding = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(Instance, rotation);
+        return attributeDescriptions;
+    }
+
+    LveDrawList::LveDrawList(LveDevice &device, LveModel &model, uint32_t framesInFlight, uint32_t maxInstances)
+        : device{device}, model{model}, maxInstances{maxInstances}
+    {
+        frames.resize(framesInFlight);
+        for (auto &frame : frames)
+        {
+            frame.instanceBuffer = std::make_unique<LveBuffer>(
+                device,
+                sizeof(Instance) * maxInstances,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.instanceBuffer->map();
+
+            frame.indirectBuffer = std::make_unique<LveBuffer>(
+                device,
+                COMMANDS_OFFSET + COMMAND_STRIDE * model.getMeshCount(),
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.indirectBuffer->map();
+        }
+
+        batchOffsets.resize(model.getMeshCount() + 1);
+        commands.reserve(model.getMeshCount());
+    }
+
+    void LveDrawList::clear()
+    {
+        meshes.clear();
+        instances.clear();
+    }
+
+    void LveDrawList::add(uint32_t mesh, const Instance &instance)
+    {
+        // build counts instances per mesh by index
+        if (mesh >= model.getMeshCount())
+        {
+            throw std::runtime_error("LveDrawList: Mesh index out of range");
+        }
+        meshes.push_back(mesh);
+        instances.push_back(instance);
+    }
+
+    void LveDrawList::build(uint32_t frameIndex)
+    {
+        LVE_TRACE_ZONE("LveDrawList::build");
+        if (instances.size() > maxInstances)
+        {
+            throw std::runtime_error("LveDrawList: Instance capacity exceeded");
+        }
+
+        currentFrame = frameIndex;
+        auto &frame = frames[currentFrame];
+
+        // Counting sort by mesh, each mesh's instances become one contiguous batch
+        std::fill(batchOffsets.begin(), batchOffsets.end(), 0);
+        for (uint32_t mesh : meshes)
+        {
+            batchOffsets[mesh + 1]++;
+        }
+        for (size_t i = 1; i < batchOffsets.size(); i++)
+        {
+            batchOffsets[i] += batchOffsets[i - 1];
+        }
+
+        commands.clear();
+        for (uint32_t mesh = 0; mesh < model.getMeshCount(); mesh++)
+        {
+            uint32_t instanceCount = batchOffsets[mesh + 1] - batchOffsets[mesh];
+            if (instanceCount == 0)
+            {
+                continue;
+            }
+
+            const auto &meshInfo = model.getMesh(mesh);
+            VkDrawIndexedIndirectCommand command{};
+            command.indexCount = meshInfo.indexCount;
+            command.instanceCount = instanceCount;
+            command.firstIndex = meshInfo.firstIndex;
+            command.vertexOffset = meshInfo.vertexOffset;
+            command.firstInstance = batchOffsets[mesh];
+            commands.push_back(command);
+        }
+
+        // Scatter straight into the mapped buffer, batchOffsets becomes each batch's end
+        auto *mappedInstances = static_cast<Instance *>(frame.instanceBuffer->getMappedMemory());
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            mappedInstances[batchOffsets[meshes[i]]++] = instances[i];
+        }
+
+        uint32_t drawCount = getBatchCount();
+        frame.indirectBuffer->writeToBuffer(&drawCount, sizeof(drawCount));
+        frame.indirectBuffer->writeToBuffer(commands.data(), COMMAND_STRIDE * commands.size(), COMMANDS_OFFSET);
+    }
+
+    void LveDrawList::draw(VkCommandBuffer commandBuffer, Mode mode)
+    {
+        if (commands.empty())
+        {
+            return;
+        }
+
+        model.bind(commandBuffer);
+        VkBuffer buffers[] = {frames[currentFrame].instanceBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        device.disp.cmdBindVertexBuffers(commandBuffer, 1, 1, buffers, offsets);
+
+        if (mode == Mode::Indirect)
+        {
+            drawIndirect(commandBuffer);
+        }
+        else
+        {
+            drawDirect(commandBuffer);
+        }
+    }
+
+    void LveDrawList::drawDirect(VkCommandBuffer commandBuffer)
+    {
+        for (const auto &command : commands)
+        {
+            for (uint32_t i = 0; i < command.instanceCount; i++)
+            {
+                device.disp.cmdDrawIndexed(
+                    commandBuffer,
+                    command.indexCount,
+                    1,
+                    command.firstIndex,
+                    command.vertexOffset,
+                    command.firstInstance + i);
+            }
+        }
+    }
+
+    void LveDrawList::drawIndirect(VkCommandBuffer commandBuffer)
+    {
+        // A non-zero firstInstance in an indirect command needs drawIndirectFirstInstance,
+        // without it fall back to one direct draw per batch
+        if (device.enabledFeatures.drawIndirectFirstInstance != VK_TRUE)
+        {
+            for (const auto &command : commands)
+            {
+                device.disp.cmdDrawIndexed(
+                    commandBuffer,
+                    command.indexCount,
+                    command.instanceCount,
+                    command.firstIndex,
+                    command.vertexOffset,
+                    command.firstInstance);
+            }
+            return;
+        }
+
+        VkBuffer indirectBuffer = frames[currentFrame].indirectBuffer->getBuffer();
+        if (device.hasDrawIndirectCount())
+        {
+            device.cmdDrawIndexedIndirectCount(
+                commandBuffer,
+                indirectBuffer,
+                COMMANDS_OFFSET,
+                indirectBuffer,
+                0,
+                model.getMeshCount(),
+                COMMAND_STRIDE);
+        }
+        else if (device.enabledFeatures.multiDrawIndirect == VK_TRUE)
+        {
+            device.disp.cmdDrawIndexedIndirect(commandBuffer, indirectBuffer, COMMANDS_OFFSET, getBatchCount(), COMMAND_STRIDE);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < getBatchCount(); i++)
+            {
+                device.disp.cmdDrawIndexedIndirect(
+                    commandBuffer, indirectBuffer, COMMANDS_OFFSET + COMMAND_STRIDE * i, 1, COMMAND_STRIDE);
+            }
+        }
+    }
+}
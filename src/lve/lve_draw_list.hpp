@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_model.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace lve
+{
+    // CPU-built draw list. Instances are grouped into one batch per mesh and written, together
+    // with a VkDrawIndexedIndirectCommand per batch, into buffers owned by the frame in flight.
+    class LveDrawList
+    {
+    public:
+        // Packed per-instance transform, rotation is a quaternion and scale is uniform
+        struct Instance
+        {
+            glm::vec4 positionScale;
+            glm::vec4 rotation;
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        enum class Mode
+        {
+            // One vkCmdDrawIndexed per instance, the baseline to compare against
+            Direct,
+            // A few vkCmdDrawIndexedIndirect(Count) calls regardless of the instance count
+            Indirect,
+        };
+
+        LveDrawList(LveDevice &device, LveModel &model, uint32_t framesInFlight, uint32_t maxInstances);
+        LveDrawList(const LveDrawList &) = delete;
+        LveDrawList &operator=(const LveDrawList &) = delete;
+
+        void clear();
+        void add(uint32_t mesh, const Instance &instance);
+        // Writes this frame's instance and indirect buffers, the frame's fence must have been waited on
+        void build(uint32_t frameIndex);
+        void draw(VkCommandBuffer commandBuffer, Mode mode);
+
+        uint32_t getInstanceCount() const { return static_cast<uint32_t>(instances.size()); }
+        uint32_t getBatchCount() const { return static_cast<uint32_t>(commands.size()); }
+
+    private:
+        struct FrameBuffers
+        {
+            std::unique_ptr<LveBuffer> instanceBuffer;
+            // Draw count followed by the commands
+            std::unique_ptr<LveBuffer> indirectBuffer;
+        };
+
+        static constexpr VkDeviceSize COMMANDS_OFFSET = sizeof(VkDrawIndexedIndirectCommand);
+        static constexpr uint32_t COMMAND_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+
+        void drawDirect(VkCommandBuffer commandBuffer);
+        void drawIndirect(VkCommandBuffer commandBuffer);
+
+        LveDevice &device;
+        LveModel &model;
+        uint32_t maxInstances;
+        uint32_t currentFrame{};
+        std::vector<FrameBuffers> frames{};
+        std::vector<uint32_t> meshes{};
+        std::vector<Instance> instances{};
+        std::vector<uint32_t> batchOffsets{};
+        std::vector<VkDrawIndexedIndirectCommand> commands{};
+    };
+}
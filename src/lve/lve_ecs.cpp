@@ -0,0 +1,326 @@
+#include "lve_ecs.hpp"
+#include "lve_benchmark.hpp"
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace lve
+{
+    static constexpr uint32_t NO_ARCHETYPE = UINT32_MAX;
+
+    // Component ids are process wide, so every LveEcs agrees on them
+    static std::mutex registryMutex{};
+    static std::vector<uint32_t> registrySizes{};
+    static std::vector<uint32_t> registryAlignments{};
+
+    uint32_t LveEcs::registerComponent(uint32_t size, uint32_t alignment)
+    {
+        std::lock_guard lock{registryMutex};
+        if (registrySizes.size() >= MAX_COMPONENTS)
+        {
+            throw std::runtime_error("LveEcs: Too many component types");
+        }
+        registrySizes.push_back(size);
+        registryAlignments.push_back(alignment);
+        return static_cast<uint32_t>(registrySizes.size() - 1);
+    }
+
+    LveEcs::ComponentInfo LveEcs::componentInfo(uint32_t component)
+    {
+        std::lock_guard lock{registryMutex};
+        return {registrySizes[component], registryAlignments[component]};
+    }
+
+    void LveEcs::checkAlive(LveEntity entity) const
+    {
+        if (!isAlive(entity))
+        {
+            throw std::runtime_error("LveEcs: Entity is not alive");
+        }
+    }
+
+    bool LveEcs::isAlive(LveEntity entity) const
+    {
+        return entity.index < records.size() &&
+               records[entity.index].archetype != NO_ARCHETYPE &&
+               records[entity.index].generation == entity.generation;
+    }
+
+    uint32_t LveEcs::findOrCreateArchetype(ComponentMask mask)
+    {
+        auto it = archetypeIndex.find(mask);
+        if (it != archetypeIndex.end())
+        {
+            return it->second;
+        }
+
+        auto archetype = std::make_unique<Archetype>();
+        archetype->mask = mask;
+        for (uint32_t component = 0; component < MAX_COMPONENTS; component++)
+        {
+            if (mask & (ComponentMask{1} << component))
+            {
+                archetype->components.push_back(component);
+            }
+        }
+
+        // Largest row count whose arrays, each aligned for its type, fit in one chunk
+        auto layout = [&](uint32_t rows)
+        {
+            size_t offset = sizeof(LveEntity) * rows;
+            for (uint32_t component : archetype->components)
+            {
+                ComponentInfo info = componentInfo(component);
+                offset = (offset + info.alignment - 1) / info.alignment * info.alignment;
+                archetype->offsets[component] = static_cast<uint32_t>(offset);
+                archetype->sizes[component] = info.size;
+                offset += static_cast<size_t>(info.size) * rows;
+            }
+            return offset;
+        };
+
+        size_t rowSize = sizeof(LveEntity);
+        for (uint32_t component : archetype->components)
+        {
+            rowSize += componentInfo(component).size;
+        }
+        uint32_t rows = static_cast<uint32_t>(CHUNK_SIZE / rowSize);
+        while (rows > 0 && layout(rows) > CHUNK_SIZE)
+        {
+            rows--;
+        }
+        if (rows == 0)
+        {
+            throw std::runtime_error("LveEcs: Components do not fit in a chunk");
+        }
+        archetype->capacity = rows;
+
+        uint32_t index = static_cast<uint32_t>(archetypes.size());
+        archetypes.push_back(std::move(archetype));
+        archetypeIndex.emplace(mask, index);
+        return index;
+    }
+
+    LveEntity LveEcs::allocateEntity()
+    {
+        uint32_t index{};
+        if (!freeIndices.empty())
+        {
+            index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(records.size());
+            records.push_back({NO_ARCHETYPE, 0, 0, 0});
+        }
+        aliveCount++;
+        return {index, records[index].generation};
+    }
+
+    void LveEcs::allocateRow(uint32_t archetypeIndex, LveEntity entity, EntityRecord &record)
+    {
+        Archetype &archetype = *archetypes[archetypeIndex];
+        if (archetype.chunks.empty() || archetype.chunks.back()->count == archetype.capacity)
+        {
+            archetype.chunks.push_back(std::make_unique<Chunk>());
+        }
+
+        Chunk &chunk = *archetype.chunks.back();
+        record.archetype = archetypeIndex;
+        record.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+        record.row = chunk.count++;
+        reinterpret_cast<LveEntity *>(chunk.data)[record.row] = entity;
+    }
+
+    void LveEcs::removeRow(uint32_t archetypeIndex, uint32_t chunkIndex, uint32_t row)
+    {
+        Archetype &archetype = *archetypes[archetypeIndex];
+        Chunk &chunk = *archetype.chunks[chunkIndex];
+        Chunk &last = *archetype.chunks.back();
+        uint32_t lastRow = last.count - 1;
+
+        if (&chunk != &last || row != lastRow)
+        {
+            for (uint32_t component : archetype.components)
+            {
+                uint32_t size = archetype.sizes[component];
+                uint32_t offset = archetype.offsets[component];
+                std::memcpy(chunk.data + offset + size * row, last.data + offset + size * lastRow, size);
+            }
+
+            LveEntity moved = reinterpret_cast<LveEntity *>(last.data)[lastRow];
+            reinterpret_cast<LveEntity *>(chunk.data)[row] = moved;
+            records[moved.index].chunk = chunkIndex;
+            records[moved.index].row = row;
+        }
+
+        if (--last.count == 0)
+        {
+            archetype.chunks.pop_back();
+        }
+    }
+
+    void LveEcs::moveEntity(LveEntity entity, ComponentMask mask)
+    {
+        uint32_t target = findOrCreateArchetype(mask);
+        EntityRecord source = records[entity.index];
+        EntityRecord &record = records[entity.index];
+        allocateRow(target, entity, record);
+
+        // Components present in both archetypes keep their values, added ones are left for the caller
+        const Archetype &from = *archetypes[source.archetype];
+        const Archetype &to = *archetypes[target];
+        const std::byte *sourceData = from.chunks[source.chunk]->data;
+        std::byte *targetData = to.chunks[record.chunk]->data;
+        for (uint32_t component : to.components)
+        {
+            if (from.mask & (ComponentMask{1} << component))
+            {
+                uint32_t size = to.sizes[component];
+                std::memcpy(targetData + to.offsets[component] + size * record.row,
+                            sourceData + from.offsets[component] + size * source.row,
+                            size);
+            }
+        }
+
+        removeRow(source.archetype, source.chunk, source.row);
+    }
+
+    void LveEcs::destroy(LveEntity entity)
+    {
+        checkAlive(entity);
+        EntityRecord &record = records[entity.index];
+        uint32_t archetype = record.archetype;
+        uint32_t chunk = record.chunk;
+        uint32_t row = record.row;
+
+        record.archetype = NO_ARCHETYPE;
+        record.generation++;
+        freeIndices.push_back(entity.index);
+        aliveCount--;
+
+        removeRow(archetype, chunk, row);
+    }
+
+    void LveEcs::clear()
+    {
+        for (auto &archetype : archetypes)
+        {
+            archetype->chunks.clear();
+        }
+
+        // Bump every generation so no handle from before survives the clear
+        freeIndices.clear();
+        for (uint32_t index = static_cast<uint32_t>(records.size()); index > 0; index--)
+        {
+            EntityRecord &record = records[index - 1];
+            if (record.archetype != NO_ARCHETYPE)
+            {
+                record.archetype = NO_ARCHETYPE;
+                record.generation++;
+            }
+            freeIndices.push_back(index - 1);
+        }
+        aliveCount = 0;
+    }
+
+    void LveEcs::benchmark(uint32_t entityCount)
+    {
+        struct Position
+        {
+            float x, y, z;
+        };
+        struct Velocity
+        {
+            float x, y, z;
+        };
+        struct Health
+        {
+            float value;
+        };
+
+        auto elapsedMs = [](auto start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        LveEcs ecs{};
+        std::vector<LveEntity> entities(entityCount);
+
+        // A quarter of the entities get a third component, so queries span two archetypes
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < entityCount; i++)
+        {
+            Position position{static_cast<float>(i), 0.0f, 0.0f};
+            Velocity velocity{1.0f, 2.0f, 3.0f};
+            entities[i] = i % 4 == 0 ? ecs.create(position, velocity, Health{100.0f}) : ecs.create(position, velocity);
+        }
+        double createMs = elapsedMs(start);
+
+        auto measure = [](auto &&run)
+        { return measureBestNs(run) * 1e-6; };
+
+        const float dt = 1.0f / 60.0f;
+        double forEachMs = measure([&]()
+                                   { ecs.forEach<Position, Velocity>([dt](Position &position, const Velocity &velocity)
+                                                                     {
+                                                                         position.x += velocity.x * dt;
+                                                                         position.y += velocity.y * dt;
+                                                                         position.z += velocity.z * dt;
+                                                                     }); });
+        double parallelMs = measure([&]()
+                                    { ecs.parallelForEach<Position, Velocity>([dt](Position &position, const Velocity &velocity)
+                                                                              {
+                                                                                  position.x += velocity.x * dt;
+                                                                                  position.y += velocity.y * dt;
+                                                                                  position.z += velocity.z * dt;
+                                                                              }); });
+
+        // The same update over individually allocated objects, the layout this replaces
+        struct Object
+        {
+            Position position;
+            Velocity velocity;
+            Health health;
+        };
+        std::vector<std::unique_ptr<Object>> objects(entityCount);
+        for (uint32_t i = 0; i < entityCount; i++)
+        {
+            objects[i] = std::make_unique<Object>(Object{{static_cast<float>(i), 0.0f, 0.0f}, {1.0f, 2.0f, 3.0f}, {100.0f}});
+        }
+        double objectMs = measure([&]()
+                                  {
+                                      for (auto &object : objects)
+                                      {
+                                          object->position.x += object->velocity.x * dt;
+                                          object->position.y += object->velocity.y * dt;
+                                          object->position.z += object->velocity.z * dt;
+                                      }
+                                  });
+
+        // Destroy in creation order, the worst case for swap removal locality
+        start = std::chrono::steady_clock::now();
+        for (LveEntity entity : entities)
+        {
+            ecs.destroy(entity);
+        }
+        double destroyMs = elapsedMs(start);
+
+        if (ecs.size() != 0 || ecs.isAlive(entities[0]))
+        {
+            spdlog::warn("ECS benchmark: entities are still alive after destroy");
+        }
+
+        spdlog::info("ECS benchmark, {} entities: create {:.1f} ns/entity, destroy {:.1f} ns/entity, "
+                     "forEach {:.2f} ns/entity, parallelForEach {:.2f} ns/entity, heap objects {:.2f} ns/entity",
+                     entityCount,
+                     createMs * 1e6 / entityCount,
+                     destroyMs * 1e6 / entityCount,
+                     forEachMs * 1e6 / entityCount,
+                     parallelMs * 1e6 / entityCount,
+                     objectMs * 1e6 / entityCount);
+    }
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "lve_job_system.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    // Generation counters make handles of destroyed entities fail instead of aliasing a reused slot
+    struct LveEntity
+    {
+        uint32_t index{UINT32_MAX};
+        uint32_t generation{};
+
+        bool operator==(const LveEntity &other) const = default;
+    };
+
+    // Archetype entity-component system. Entities with the same set of components share an
+    // archetype, whose components live in 16 KB chunks with one tightly packed array per component,
+    // so queries walk memory linearly. Components must be trivially copyable, they are moved between
+    // chunks with memcpy.
+    class LveEcs
+    {
+    public:
+        static constexpr size_t CHUNK_SIZE = 16 * 1024;
+        static constexpr uint32_t MAX_COMPONENTS = 64;
+        // Below this many matching chunks parallelForEach runs on the calling thread
+        static constexpr uint32_t PARALLEL_THRESHOLD = 16;
+
+        using ComponentMask = uint64_t;
+
+        LveEcs() = default;
+        LveEcs(const LveEcs &) = delete;
+        LveEcs &operator=(const LveEcs &) = delete;
+
+        template <typename... Ts>
+        LveEntity create(const Ts &...components)
+        {
+            uint32_t archetype = findOrCreateArchetype(maskOf<Ts...>());
+            LveEntity entity = allocateEntity();
+            EntityRecord &record = records[entity.index];
+            record.archetype = archetype;
+            allocateRow(archetype, entity, record);
+            (new (componentPointer<Ts>(record)) Ts(components), ...);
+            return entity;
+        }
+
+        void destroy(LveEntity entity);
+        void clear();
+        bool isAlive(LveEntity entity) const;
+        uint32_t size() const { return aliveCount; }
+
+        template <typename T>
+        void add(LveEntity entity, const T &component)
+        {
+            checkAlive(entity);
+            ComponentMask bit = ComponentMask{1} << componentId<T>();
+            const EntityRecord &record = records[entity.index];
+            if ((archetypes[record.archetype]->mask & bit) == 0)
+            {
+                moveEntity(entity, archetypes[record.archetype]->mask | bit);
+            }
+            new (componentPointer<T>(records[entity.index])) T(component);
+        }
+
+        template <typename T>
+        void remove(LveEntity entity)
+        {
+            checkAlive(entity);
+            ComponentMask bit = ComponentMask{1} << componentId<T>();
+            const EntityRecord &record = records[entity.index];
+            if ((archetypes[record.archetype]->mask & bit) != 0)
+            {
+                moveEntity(entity, archetypes[record.archetype]->mask & ~bit);
+            }
+        }
+
+        // Returns nullptr if the entity does not have the component. Valid until the entity or
+        // another entity of its archetype is created, destroyed or changes components.
+        template <typename T>
+        T *get(LveEntity entity)
+        {
+            checkAlive(entity);
+            const EntityRecord &record = records[entity.index];
+            if ((archetypes[record.archetype]->mask & (ComponentMask{1} << componentId<T>())) == 0)
+            {
+                return nullptr;
+            }
+            return componentPointer<T>(record);
+        }
+
+        // function(uint32_t count, const LveEntity *entities, Ts *...components) per non-empty chunk
+        // of every archetype holding all of Ts
+        template <typename... Ts, typename Function>
+        void forEachChunk(Function &&function)
+        {
+            ComponentMask required = maskOf<Ts...>();
+            for (auto &archetype : archetypes)
+            {
+                if ((archetype->mask & required) != required)
+                {
+                    continue;
+                }
+                for (auto &chunk : archetype->chunks)
+                {
+                    function(chunk->count,
+                             reinterpret_cast<const LveEntity *>(chunk->data),
+                             reinterpret_cast<Ts *>(chunk->data + archetype->offsets[componentId<Ts>()])...);
+                }
+            }
+        }
+
+        // function(Ts &...components) per entity holding all of Ts
+        template <typename... Ts, typename Function>
+        void forEach(Function &&function)
+        {
+            forEachChunk<Ts...>([&](uint32_t count, const LveEntity *, Ts *...components)
+                                {
+                                    for (uint32_t i = 0; i < count; i++)
+                                    {
+                                        function(components[i]...);
+                                    }
+                                });
+        }
+
+        // forEach with the matching chunks split across the job system. The function must only
+        // touch the components it is given, structural changes are not allowed while it runs.
+        template <typename... Ts, typename Function>
+        void parallelForEach(Function &&function)
+        {
+            std::vector<std::pair<Archetype *, Chunk *>> matching{};
+            ComponentMask required = maskOf<Ts...>();
+            for (auto &archetype : archetypes)
+            {
+                if ((archetype->mask & required) == required)
+                {
+                    for (auto &chunk : archetype->chunks)
+                    {
+                        matching.emplace_back(archetype.get(), chunk.get());
+                    }
+                }
+            }
+
+            auto runChunks = [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t c = begin; c < end; c++)
+                {
+                    auto [archetype, chunk] = matching[c];
+                    std::byte *data = chunk->data;
+                    for (uint32_t i = 0; i < chunk->count; i++)
+                    {
+                        function(reinterpret_cast<Ts *>(data + archetype->offsets[componentId<Ts>()])[i]...);
+                    }
+                }
+            };
+
+            uint32_t chunkCount = static_cast<uint32_t>(matching.size());
+            if (chunkCount < PARALLEL_THRESHOLD)
+            {
+                runChunks(0, chunkCount);
+                return;
+            }
+            LveJobSystem::get().parallelFor(chunkCount, 1, runChunks);
+        }
+
+        template <typename T>
+        static uint32_t componentId()
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "LveEcs components are moved with memcpy");
+            static const uint32_t id = registerComponent(sizeof(T), alignof(T));
+            return id;
+        }
+
+        template <typename... Ts>
+        static ComponentMask maskOf()
+        {
+            return ((ComponentMask{1} << componentId<Ts>()) | ... | ComponentMask{0});
+        }
+
+        // Logs create, iterate and destroy throughput for entityCount entities
+        static void benchmark(uint32_t entityCount);
+
+    private:
+        struct Chunk
+        {
+            // Entity handles first, then one array per component at the archetype's offsets
+            alignas(64) std::byte data[CHUNK_SIZE];
+            uint32_t count{};
+        };
+        struct Archetype
+        {
+            ComponentMask mask{};
+            std::vector<uint32_t> components{};
+            uint32_t offsets[MAX_COMPONENTS]{};
+            // Copied from the registry so row moves do not take its lock
+            uint32_t sizes[MAX_COMPONENTS]{};
+            uint32_t capacity{};
+            std::vector<std::unique_ptr<Chunk>> chunks{};
+        };
+        // archetype is UINT32_MAX while the slot is free
+        struct EntityRecord
+        {
+            uint32_t archetype{};
+            uint32_t chunk{};
+            uint32_t row{};
+            uint32_t generation{};
+        };
+        struct ComponentInfo
+        {
+            uint32_t size;
+            uint32_t alignment;
+        };
+
+        template <typename T>
+        T *componentPointer(const EntityRecord &record)
+        {
+            const Archetype &archetype = *archetypes[record.archetype];
+            std::byte *data = archetype.chunks[record.chunk]->data;
+            return reinterpret_cast<T *>(data + archetype.offsets[componentId<T>()]) + record.row;
+        }
+
+        static uint32_t registerComponent(uint32_t size, uint32_t alignment);
+        static ComponentInfo componentInfo(uint32_t component);
+
+        void checkAlive(LveEntity entity) const;
+        uint32_t findOrCreateArchetype(ComponentMask mask);
+        LveEntity allocateEntity();
+        // Appends a row for the entity to the archetype's last chunk and points the record at it
+        void allocateRow(uint32_t archetype, LveEntity entity, EntityRecord &record);
+        // Fills the hole with the archetype's last row
+        void removeRow(uint32_t archetype, uint32_t chunk, uint32_t row);
+        void moveEntity(LveEntity entity, ComponentMask mask);
+
+        std::vector<std::unique_ptr<Archetype>> archetypes{};
+        std::unordered_map<ComponentMask, uint32_t> archetypeIndex{};
+        std::vector<EntityRecord> records{};
+        std::vector<uint32_t> freeIndices{};
+        uint32_t aliveCount{};
+    };
+}
@@ -0,0 +1,241 @@
+#include "lve_frame_telemetry.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace lve
+{
+    uint32_t LveHistogram::bucketIndex(uint64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT)
+        {
+            return static_cast<uint32_t>(value);
+        }
+
+        // Keep the top SUB_BUCKET_BITS + 1 significant bits
+        uint32_t exponent = static_cast<uint32_t>(std::bit_width(value)) - 1 - SUB_BUCKET_BITS;
+        uint32_t subBucket = static_cast<uint32_t>(value >> exponent);
+        return exponent * SUB_BUCKET_COUNT + subBucket;
+    }
+
+    uint64_t LveHistogram::bucketValue(uint32_t index)
+    {
+        if (index < SUB_BUCKET_COUNT)
+        {
+            return index;
+        }
+
+        uint32_t exponent = index / SUB_BUCKET_COUNT - 1;
+        uint64_t subBucket = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+        uint64_t lower = subBucket << exponent;
+        return lower + (((1ull << exponent) - 1) >> 1);
+    }
+
+    void LveHistogram::record(uint64_t value)
+    {
+        buckets[bucketIndex(value)]++;
+        totalCount++;
+        sum += value;
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+
+    void LveHistogram::reset()
+    {
+        *this = LveHistogram{};
+    }
+
+    uint64_t LveHistogram::percentile(double p) const
+    {
+        if (totalCount == 0)
+        {
+            return 0;
+        }
+
+        uint64_t target = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(totalCount)));
+        target = std::clamp<uint64_t>(target, 1, totalCount);
+
+        uint64_t cumulative = 0;
+        for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            cumulative += buckets[i];
+            if (cumulative >= target)
+            {
+                return std::clamp(bucketValue(i), min(), maxValue);
+            }
+        }
+        return maxValue;
+    }
+
+    const char *LveFrameTelemetry::phaseName(Phase phase)
+    {
+        switch (phase)
+        {
+        case Phase::Poll:
+            return "poll";
+        case Phase::AcquireWait:
+            return "acquire-wait";
+        case Phase::Record:
+            return "record";
+        case Phase::Submit:
+            return "submit";
+        case Phase::Present:
+            return "present";
+        default:
+            return "unknown";
+        }
+    }
+
+    void LveFrameTelemetry::beginFrame()
+    {
+        current = {};
+        current.frameIndex = frameCounter++;
+        frameStart = std::chrono::steady_clock::now();
+    }
+
+    void LveFrameTelemetry::addPhaseTime(Phase phase, std::chrono::steady_clock::duration duration)
+    {
+        current.phaseNs[static_cast<uint32_t>(phase)] +=
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+
+    void LveFrameTelemetry::endFrame()
+    {
+        current.totalNs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart).count());
+
+        uint64_t write = writeIndex.load(std::memory_order_relaxed);
+        if (write - readIndex.load(std::memory_order_acquire) >= RING_SIZE)
+        {
+            // The consumer fell behind, drop rather than block the frame
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        ring[write % RING_SIZE] = current;
+        writeIndex.store(write + 1, std::memory_order_release);
+    }
+
+    void LveFrameTelemetry::drain()
+    {
+        uint64_t read = readIndex.load(std::memory_order_relaxed);
+        uint64_t write = writeIndex.load(std::memory_order_acquire);
+
+        for (; read != write; read++)
+        {
+            const auto &sample = ring[read % RING_SIZE];
+            for (uint32_t i = 0; i < PHASE_COUNT; i++)
+            {
+                phaseHistograms[i].record(sample.phaseNs[i]);
+            }
+            totalHistogram.record(sample.totalNs);
+        }
+
+        readIndex.store(read, std::memory_order_release);
+    }
+
+    void LveFrameTelemetry::update(std::chrono::seconds reportInterval)
+    {
+        drain();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= reportInterval)
+        {
+            logSummary();
+            lastReport = now;
+        }
+    }
+
+    void LveFrameTelemetry::reset()
+    {
+        drain();
+        for (auto &histogram : phaseHistograms)
+        {
+            histogram.reset();
+        }
+        totalHistogram.reset();
+    }
+
+    void LveFrameTelemetry::logSummary() const
+    {
+        auto logHistogram = [](const char *name, const LveHistogram &histogram)
+        {
+            spdlog::info("CPU {:>12}: p50 {:8.3f} ms, p90 {:8.3f} ms, p99 {:8.3f} ms, p99.9 {:8.3f} ms, max {:8.3f} ms",
+                         name,
+                         histogram.percentile(50.0) * 1e-6,
+                         histogram.percentile(90.0) * 1e-6,
+                         histogram.percentile(99.0) * 1e-6,
+                         histogram.percentile(99.9) * 1e-6,
+                         histogram.max() * 1e-6);
+        };
+
+        spdlog::info("Frame telemetry: {} frames, {} dropped", totalHistogram.count(), droppedFrames());
+        logHistogram("frame", totalHistogram);
+        for (uint32_t i = 0; i < PHASE_COUNT; i++)
+        {
+            logHistogram(phaseName(static_cast<Phase>(i)), phaseHistograms[i]);
+        }
+    }
+
+    void LveFrameTelemetry::writeSummary(const std::string &filePath) const
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("LveFrameTelemetry: Failed to open file");
+        }
+
+        if (filePath.ends_with(".csv"))
+        {
+            writeCsv(file);
+        }
+        else
+        {
+            writeJson(file);
+        }
+    }
+
+    void LveFrameTelemetry::writeCsv(std::ostream &file) const
+    {
+        auto writeRow = [&file](const char *name, const LveHistogram &histogram)
+        {
+            file << name << ',' << histogram.count() << ',' << histogram.mean() << ',' << histogram.min() << ','
+                 << histogram.percentile(50.0) << ',' << histogram.percentile(90.0) << ','
+                 << histogram.percentile(99.0) << ',' << histogram.percentile(99.9) << ',' << histogram.max() << '\n';
+        };
+
+        file << "phase,count,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,p99.9_ns,max_ns\n";
+        writeRow("frame", totalHistogram);
+        for (uint32_t i = 0; i < PHASE_COUNT; i++)
+        {
+            writeRow(phaseName(static_cast<Phase>(i)), phaseHistograms[i]);
+        }
+    }
+
+    void LveFrameTelemetry::writeJson(std::ostream &file) const
+    {
+        auto writeObject = [&file](const char *name, const LveHistogram &histogram)
+        {
+            file << "    \"" << name << "\": {\"count\": " << histogram.count()
+                 << ", \"meanNs\": " << histogram.mean()
+                 << ", \"minNs\": " << histogram.min()
+                 << ", \"p50Ns\": " << histogram.percentile(50.0)
+                 << ", \"p90Ns\": " << histogram.percentile(90.0)
+                 << ", \"p99Ns\": " << histogram.percentile(99.0)
+                 << ", \"p999Ns\": " << histogram.percentile(99.9)
+                 << ", \"maxNs\": " << histogram.max() << "}";
+        };
+
+        file << "{\n  \"droppedFrames\": " << droppedFrames() << ",\n  \"phases\": {\n";
+        writeObject("frame", totalHistogram);
+        for (uint32_t i = 0; i < PHASE_COUNT; i++)
+        {
+            file << ",\n";
+            writeObject(phaseName(static_cast<Phase>(i)), phaseHistograms[i]);
+        }
+        file << "\n  }\n}\n";
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace lve
+{
+    // Log-linear histogram in the spirit of HdrHistogram. Values below 64 are exact,
+    // larger values fall into 32 sub-buckets per power of two (~3% relative error).
+    class LveHistogram
+    {
+    public:
+        static constexpr uint32_t SUB_BUCKET_BITS = 5;
+        static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+        static constexpr uint32_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+        void record(uint64_t value);
+        void reset();
+        uint64_t percentile(double p) const;
+        uint64_t count() const { return totalCount; }
+        uint64_t min() const { return totalCount ? minValue : 0; }
+        uint64_t max() const { return maxValue; }
+        double mean() const { return totalCount ? static_cast<double>(sum) / static_cast<double>(totalCount) : 0.0; }
+
+    private:
+        static uint32_t bucketIndex(uint64_t value);
+        static uint64_t bucketValue(uint32_t index);
+
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+        uint64_t totalCount{};
+        uint64_t minValue{UINT64_MAX};
+        uint64_t maxValue{};
+        uint64_t sum{};
+    };
+
+    // Per-frame CPU time split into phases. The render loop produces samples into a
+    // single-producer/single-consumer lock-free ring, the consumer drains them into
+    // histograms, so a reporting thread never blocks the frame.
+    class LveFrameTelemetry
+    {
+    public:
+        enum class Phase : uint32_t
+        {
+            Poll,
+            AcquireWait,
+            Record,
+            Submit,
+            Present,
+            Count
+        };
+        static constexpr uint32_t PHASE_COUNT = static_cast<uint32_t>(Phase::Count);
+        static constexpr size_t RING_SIZE = 1024;
+
+        struct FrameSample
+        {
+            uint64_t frameIndex{};
+            uint64_t totalNs{};
+            std::array<uint64_t, PHASE_COUNT> phaseNs{};
+        };
+
+        class Scope
+        {
+        public:
+            Scope(LveFrameTelemetry &telemetry, Phase phase)
+                : telemetry{telemetry}, phase{phase}, start{std::chrono::steady_clock::now()} {}
+            ~Scope() { telemetry.addPhaseTime(phase, std::chrono::steady_clock::now() - start); }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            LveFrameTelemetry &telemetry;
+            Phase phase;
+            std::chrono::steady_clock::time_point start;
+        };
+
+        static const char *phaseName(Phase phase);
+
+        // Producer side, called from the render loop
+        void beginFrame();
+        void addPhaseTime(Phase phase, std::chrono::steady_clock::duration duration);
+        void endFrame();
+
+        // Consumer side
+        void drain();
+        // Drains and logs a summary once reportInterval has elapsed since the last one
+        void update(std::chrono::seconds reportInterval = std::chrono::seconds{5});
+        void logSummary() const;
+        // Format is chosen by extension, .json or .csv
+        void writeSummary(const std::string &filePath) const;
+        void reset();
+
+        const LveHistogram &phaseHistogram(Phase phase) const { return phaseHistograms[static_cast<uint32_t>(phase)]; }
+        const LveHistogram &frameHistogram() const { return totalHistogram; }
+        uint64_t droppedFrames() const { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        void writeCsv(std::ostream &file) const;
+        void writeJson(std::ostream &file) const;
+
+        std::array<FrameSample, RING_SIZE> ring{};
+        std::atomic<uint64_t> writeIndex{};
+        std::atomic<uint64_t> readIndex{};
+        std::atomic<uint64_t> dropped{};
+
+        FrameSample current{};
+        std::chrono::steady_clock::time_point frameStart{};
+        uint64_t frameCounter{};
+
+        std::array<LveHistogram, PHASE_COUNT> phaseHistograms{};
+        LveHistogram totalHistogram{};
+        std::chrono::steady_clock::time_point lastReport{std::chrono::steady_clock::now()};
+    };
+}
@@ -0,0 +1,391 @@
+#include "lve_frustum_culling.hpp"
+#include "lve_benchmark.hpp"
+#include "lve_job_system.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <spdlog/spdlog.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LVE_CULLING_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define LVE_TARGET(isa)
+#else
+#define LVE_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace lve
+{
+    LveFrustum LveFrustum::fromViewProjection(const glm::mat4 &viewProjection)
+    {
+        // glm matrices are column-major
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+        {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        LveFrustum frustum{};
+        frustum.planes[0] = rows[3] + rows[0];
+        frustum.planes[1] = rows[3] - rows[0];
+        frustum.planes[2] = rows[3] + rows[1];
+        frustum.planes[3] = rows[3] - rows[1];
+        frustum.planes[4] = rows[2];
+        frustum.planes[5] = rows[3] - rows[2];
+        for (auto &plane : frustum.planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+        return frustum;
+    }
+
+    namespace
+    {
+        struct SphereArrays
+        {
+            const float *x;
+            const float *y;
+            const float *z;
+            const float *r;
+        };
+
+        uint32_t cullScalar(const LveFrustum &frustum, const SphereArrays &spheres, uint32_t begin, uint32_t end, uint32_t *visible)
+        {
+            uint32_t visibleCount = 0;
+            for (uint32_t i = begin; i < end; i++)
+            {
+                bool inside = true;
+                for (const auto &plane : frustum.planes)
+                {
+                    float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w;
+                    inside &= distance >= -spheres.r[i];
+                }
+                visible[visibleCount] = i;
+                visibleCount += inside ? 1 : 0;
+            }
+            return visibleCount;
+        }
+
+#ifdef LVE_CULLING_X86
+        inline uint32_t appendMask(uint32_t mask, uint32_t base, uint32_t *visible, uint32_t visibleCount)
+        {
+            while (mask != 0)
+            {
+#if defined(_MSC_VER) && !defined(__clang__)
+                unsigned long lane;
+                _BitScanForward(&lane, mask);
+#else
+                uint32_t lane = static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+                visible[visibleCount++] = base + lane;
+                mask &= mask - 1;
+            }
+            return visibleCount;
+        }
+
+        LVE_TARGET("sse4.1")
+        uint32_t cullSse41(const LveFrustum &frustum, const SphereArrays &spheres, uint32_t begin, uint32_t end, uint32_t *visible)
+        {
+            __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (int p = 0; p < 6; p++)
+            {
+                planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+            }
+
+            const __m128 zero = _mm_setzero_ps();
+            uint32_t visibleCount = 0;
+            for (uint32_t i = begin; i < end; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(spheres.x + i);
+                __m128 y = _mm_loadu_ps(spheres.y + i);
+                __m128 z = _mm_loadu_ps(spheres.z + i);
+                __m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(spheres.r + i));
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < 6; p++)
+                {
+                    __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)), _mm_mul_ps(planeZ[p], z)),
+                        planeW[p]);
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+                }
+                visibleCount = appendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, visible, visibleCount);
+            }
+            return visibleCount;
+        }
+
+        LVE_TARGET("avx2")
+        uint32_t cullAvx2(const LveFrustum &frustum, const SphereArrays &spheres, uint32_t begin, uint32_t end, uint32_t *visible)
+        {
+            __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for (int p = 0; p < 6; p++)
+            {
+                planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+            }
+
+            const __m256 zero = _mm256_setzero_ps();
+            uint32_t visibleCount = 0;
+            for (uint32_t i = begin; i < end; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(spheres.x + i);
+                __m256 y = _mm256_loadu_ps(spheres.y + i);
+                __m256 z = _mm256_loadu_ps(spheres.z + i);
+                __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(spheres.r + i));
+
+                // Same operation order as the scalar kernel so all kernels agree bit for bit
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int p = 0; p < 6; p++)
+                {
+                    __m256 distance = _mm256_add_ps(
+                        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)), _mm256_mul_ps(planeZ[p], z)),
+                        planeW[p]);
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+                }
+                visibleCount = appendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, visible, visibleCount);
+            }
+            return visibleCount;
+        }
+#endif
+    }
+
+    LveFrustumCulling::LveFrustumCulling() : isa{detectIsa()}
+    {
+    }
+
+    LveFrustumCulling::Isa LveFrustumCulling::detectIsa()
+    {
+#ifdef LVE_CULLING_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        bool sse41 = (info[2] & (1 << 19)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        bool sse41 = __builtin_cpu_supports("sse4.1");
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        if (avx2)
+        {
+            return Isa::Avx2;
+        }
+        if (sse41)
+        {
+            return Isa::Sse41;
+        }
+#endif
+        return Isa::Scalar;
+    }
+
+    const char *LveFrustumCulling::isaName(Isa isa)
+    {
+        switch (isa)
+        {
+        case Isa::Avx2:
+            return "AVX2";
+        case Isa::Sse41:
+            return "SSE4.1";
+        default:
+            return "Scalar";
+        }
+    }
+
+    void LveFrustumCulling::setIsa(Isa requested)
+    {
+        isa = std::min(requested, detectIsa());
+    }
+
+    void LveFrustumCulling::clear()
+    {
+        count = 0;
+        centerX.clear();
+        centerY.clear();
+        centerZ.clear();
+        radius.clear();
+    }
+
+    uint32_t LveFrustumCulling::add(const glm::vec3 &center, float sphereRadius)
+    {
+        if (count == centerX.size())
+        {
+            // A radius of -infinity fails every plane test
+            size_t padded = centerX.size() + LANE_COUNT;
+            centerX.resize(padded, 0.0f);
+            centerY.resize(padded, 0.0f);
+            centerZ.resize(padded, 0.0f);
+            radius.resize(padded, -std::numeric_limits<float>::infinity());
+        }
+
+        uint32_t index = count++;
+        update(index, center, sphereRadius);
+        return index;
+    }
+
+    void LveFrustumCulling::update(uint32_t index, const glm::vec3 &center, float sphereRadius)
+    {
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        radius[index] = sphereRadius;
+    }
+
+    uint32_t LveFrustumCulling::cullRange(const LveFrustum &frustum, uint32_t begin, uint32_t end, uint32_t *visible) const
+    {
+        SphereArrays spheres{centerX.data(), centerY.data(), centerZ.data(), radius.data()};
+        switch (isa)
+        {
+#ifdef LVE_CULLING_X86
+        case Isa::Avx2:
+            return cullAvx2(frustum, spheres, begin, end, visible);
+        case Isa::Sse41:
+            return cullSse41(frustum, spheres, begin, end, visible);
+#endif
+        default:
+            return cullScalar(frustum, spheres, begin, end, visible);
+        }
+    }
+
+    void LveFrustumCulling::cull(const LveFrustum &frustum, std::vector<uint32_t> &visible) const
+    {
+        // Kernels run over whole lanes, the padding is never visible
+        uint32_t end = static_cast<uint32_t>(centerX.size());
+        visible.resize(end);
+
+        LveJobSystem &jobSystem = LveJobSystem::get();
+        uint32_t threadCount = jobSystem.getThreadCount();
+        if (count < PARALLEL_THRESHOLD || threadCount == 1)
+        {
+            visible.resize(cullRange(frustum, 0, end, visible.data()));
+            return;
+        }
+
+        // Each chunk compacts into its own slice of the output, then the slices are joined in order
+        uint32_t chunkSize = (end / threadCount + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT;
+        uint32_t chunkCount = (end + chunkSize - 1) / chunkSize;
+        std::vector<uint32_t> chunkCounts(chunkCount);
+        jobSystem.parallelFor(chunkCount, 1, [&](uint32_t firstChunk, uint32_t lastChunk)
+                              {
+                                  for (uint32_t chunk = firstChunk; chunk < lastChunk; chunk++)
+                                  {
+                                      uint32_t begin = chunk * chunkSize;
+                                      uint32_t chunkEnd = std::min(end, begin + chunkSize);
+                                      chunkCounts[chunk] = cullRange(frustum, begin, chunkEnd, visible.data() + begin);
+                                  }
+                              });
+
+        uint32_t visibleCount = chunkCounts[0];
+        for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+        {
+            std::memmove(visible.data() + visibleCount, visible.data() + chunk * chunkSize, chunkCounts[chunk] * sizeof(uint32_t));
+            visibleCount += chunkCounts[chunk];
+        }
+        visible.resize(visibleCount);
+    }
+
+    void LveFrustumCulling::benchmark(uint32_t sphereCount)
+    {
+        // Random spheres in a cube around a camera at the origin that sees a small fraction of them
+        std::mt19937 random{1234};
+        std::uniform_real_distribution<float> position{-100.0f, 100.0f};
+        std::uniform_real_distribution<float> size{0.1f, 2.0f};
+
+        LveFrustumCulling culling{};
+        std::vector<glm::vec4> spheres(sphereCount);
+        for (auto &sphere : spheres)
+        {
+            sphere = glm::vec4(position(random), position(random), position(random), size(random));
+            culling.add(glm::vec3(sphere), sphere.w);
+        }
+
+        glm::mat4 projection{0.0f};
+        float focal = 1.0f / std::tan(0.5f * 1.2f);
+        float nearPlane = 0.1f, farPlane = 150.0f;
+        projection[0][0] = focal;
+        projection[1][1] = focal;
+        projection[2][2] = farPlane / (nearPlane - farPlane);
+        projection[2][3] = -1.0f;
+        projection[3][2] = -(farPlane * nearPlane) / (farPlane - nearPlane);
+        LveFrustum frustum = LveFrustum::fromViewProjection(projection);
+
+        auto measure = [&](auto &&run)
+        {
+            size_t visibleCount = 0;
+            double bestNs = measureBestNs([&]()
+                                          { visibleCount = run(); });
+            return std::make_pair(static_cast<double>(sphereCount) / bestNs, visibleCount);
+        };
+
+        std::vector<uint32_t> visible{};
+        visible.reserve(sphereCount + LANE_COUNT);
+        auto [naiveRate, naiveVisible] = measure([&]()
+                                                 {
+                                                     visible.clear();
+                                                     for (uint32_t i = 0; i < sphereCount; i++)
+                                                     {
+                                                         bool inside = true;
+                                                         for (const auto &plane : frustum.planes)
+                                                         {
+                                                             if (glm::dot(glm::vec3(plane), glm::vec3(spheres[i])) + plane.w < -spheres[i].w)
+                                                             {
+                                                                 inside = false;
+                                                                 break;
+                                                             }
+                                                         }
+                                                         if (inside)
+                                                         {
+                                                             visible.push_back(i);
+                                                         }
+                                                     }
+                                                     return visible.size();
+                                                 });
+        spdlog::info("Culling benchmark, {} spheres: naive glm {:.3f} objects/ns, {} visible", sphereCount, naiveRate, naiveVisible);
+
+        for (Isa kernel : {Isa::Scalar, Isa::Sse41, Isa::Avx2})
+        {
+            if (kernel > detectIsa())
+            {
+                continue;
+            }
+            culling.setIsa(kernel);
+
+            // Single-threaded kernel throughput, then through cull() which may split across threads
+            auto [kernelRate, kernelVisible] = measure([&]()
+                                                       {
+                                                           visible.resize(culling.centerX.size());
+                                                           return static_cast<size_t>(culling.cullRange(
+                                                               frustum, 0, static_cast<uint32_t>(culling.centerX.size()), visible.data()));
+                                                       });
+            auto [cullRate, cullVisible] = measure([&]()
+                                                   {
+                                                       culling.cull(frustum, visible);
+                                                       return visible.size();
+                                                   });
+            spdlog::info("Culling benchmark, {} spheres: {} {:.3f} objects/ns single thread ({:.1f}x naive), "
+                         "{:.3f} objects/ns in cull(), {} visible",
+                         sphereCount, isaName(kernel), kernelRate, kernelRate / naiveRate, cullRate, cullVisible);
+            if (kernelVisible != naiveVisible || cullVisible != naiveVisible)
+            {
+                spdlog::warn("Culling benchmark: {} result differs from the naive loop", isaName(kernel));
+            }
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    struct LveFrustum
+    {
+        // Normalized, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six
+        glm::vec4 planes[6];
+
+        // Gribb/Hartmann extraction for a [0, 1] depth range
+        static LveFrustum fromViewProjection(const glm::mat4 &viewProjection);
+    };
+
+    // Bounding spheres in structure-of-arrays form, tested 8 (AVX2) or 4 (SSE4.1) at a time
+    // with a scalar fallback chosen at runtime. Large sets are split across threads.
+    class LveFrustumCulling
+    {
+    public:
+        enum class Isa
+        {
+            Scalar,
+            Sse41,
+            Avx2,
+        };
+
+        static constexpr uint32_t LANE_COUNT = 8;
+        static constexpr uint32_t PARALLEL_THRESHOLD = 65536;
+
+        LveFrustumCulling();
+
+        void clear();
+        uint32_t add(const glm::vec3 &center, float radius);
+        void update(uint32_t index, const glm::vec3 &center, float radius);
+        uint32_t size() const { return count; }
+
+        // Writes the indices of the spheres intersecting the frustum, in ascending order
+        void cull(const LveFrustum &frustum, std::vector<uint32_t> &visible) const;
+
+        // Requests a specific kernel, falls back to the best supported one below it
+        void setIsa(Isa requested);
+        Isa getIsa() const { return isa; }
+        static Isa detectIsa();
+        static const char *isaName(Isa isa);
+
+        // Logs objects/ns of every kernel and of a naive glm loop over sphereCount random spheres
+        static void benchmark(uint32_t sphereCount);
+
+    private:
+        uint32_t cullRange(const LveFrustum &frustum, uint32_t begin, uint32_t end, uint32_t *visible) const;
+
+        Isa isa{};
+        uint32_t count{};
+        // Padded to a multiple of LANE_COUNT with spheres that are never visible
+        std::vector<float> centerX{};
+        std::vector<float> centerY{};
+        std::vector<float> centerZ{};
+        std::vector<float> radius{};
+    };
+}
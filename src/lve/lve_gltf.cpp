@@ -0,0 +1,730 @@
+#include "lve_gltf.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+namespace lve
+{
+    namespace
+    {
+        // Just enough JSON for the glTF scene description, numbers are kept as doubles
+        struct JsonValue
+        {
+            enum class Type
+            {
+                Null,
+                Bool,
+                Number,
+                String,
+                Array,
+                Object
+            };
+
+            Type type{Type::Null};
+            bool boolean{};
+            double number{};
+            std::string string{};
+            std::vector<JsonValue> elements{};
+            std::vector<std::string> memberNames{};
+            std::vector<JsonValue> memberValues{};
+
+            const JsonValue *find(std::string_view name) const
+            {
+                for (size_t i = 0; i < memberNames.size(); i++)
+                {
+                    if (memberNames[i] == name)
+                    {
+                        return &memberValues[i];
+                    }
+                }
+                return nullptr;
+            }
+        };
+
+        class JsonParser
+        {
+        public:
+            explicit JsonParser(std::string_view text) : cursor{text.data()}, end{text.data() + text.size()} {}
+
+            JsonValue parseDocument()
+            {
+                JsonValue value = parseValue(0);
+                skipWhitespace();
+                if (cursor != end)
+                {
+                    throw std::runtime_error("JSON: Trailing characters");
+                }
+                return value;
+            }
+
+        private:
+            // Nesting bound, keeps hostile files from exhausting the stack
+            static constexpr uint32_t MAX_DEPTH = 64;
+
+            void skipWhitespace()
+            {
+                while (cursor != end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+                {
+                    cursor++;
+                }
+            }
+
+            void expect(char c)
+            {
+                skipWhitespace();
+                if (cursor == end || *cursor != c)
+                {
+                    throw std::runtime_error(std::string("JSON: Expected '") + c + "'");
+                }
+                cursor++;
+            }
+
+            bool consume(std::string_view literal)
+            {
+                if (static_cast<size_t>(end - cursor) < literal.size() ||
+                    std::string_view(cursor, literal.size()) != literal)
+                {
+                    return false;
+                }
+                cursor += literal.size();
+                return true;
+            }
+
+            JsonValue parseValue(uint32_t depth)
+            {
+                if (depth > MAX_DEPTH)
+                {
+                    throw std::runtime_error("JSON: Nested too deeply");
+                }
+
+                skipWhitespace();
+                if (cursor == end)
+                {
+                    throw std::runtime_error("JSON: Unexpected end");
+                }
+
+                JsonValue value{};
+                switch (*cursor)
+                {
+                case '{':
+                    value.type = JsonValue::Type::Object;
+                    cursor++;
+                    skipWhitespace();
+                    if (cursor != end && *cursor == '}')
+                    {
+                        cursor++;
+                        return value;
+                    }
+                    while (true)
+                    {
+                        skipWhitespace();
+                        value.memberNames.push_back(parseString());
+                        expect(':');
+                        value.memberValues.push_back(parseValue(depth + 1));
+                        skipWhitespace();
+                        if (cursor == end || *cursor != ',')
+                        {
+                            break;
+                        }
+                        cursor++;
+                    }
+                    expect('}');
+                    return value;
+                case '[':
+                    value.type = JsonValue::Type::Array;
+                    cursor++;
+                    skipWhitespace();
+                    if (cursor != end && *cursor == ']')
+                    {
+                        cursor++;
+                        return value;
+                    }
+                    while (true)
+                    {
+                        value.elements.push_back(parseValue(depth + 1));
+                        skipWhitespace();
+                        if (cursor == end || *cursor != ',')
+                        {
+                            break;
+                        }
+                        cursor++;
+                    }
+                    expect(']');
+                    return value;
+                case '"':
+                    value.type = JsonValue::Type::String;
+                    value.string = parseString();
+                    return value;
+                default:
+                    break;
+                }
+
+                if (consume("true"))
+                {
+                    value.type = JsonValue::Type::Bool;
+                    value.boolean = true;
+                    return value;
+                }
+                if (consume("false"))
+                {
+                    value.type = JsonValue::Type::Bool;
+                    return value;
+                }
+                if (consume("null"))
+                {
+                    return value;
+                }
+
+                // Copied out, strtod needs a terminated string and the chunk is not
+                const char *start = cursor;
+                while (cursor != end && ((*cursor >= '0' && *cursor <= '9') || *cursor == '-' || *cursor == '+' ||
+                                         *cursor == '.' || *cursor == 'e' || *cursor == 'E'))
+                {
+                    cursor++;
+                }
+                std::string token{start, cursor};
+                char *parsed = nullptr;
+                value.type = JsonValue::Type::Number;
+                value.number = std::strtod(token.c_str(), &parsed);
+                if (token.empty() || parsed != token.c_str() + token.size())
+                {
+                    throw std::runtime_error("JSON: Invalid value");
+                }
+                return value;
+            }
+
+            uint32_t parseHex4()
+            {
+                if (end - cursor < 4)
+                {
+                    throw std::runtime_error("JSON: Truncated escape");
+                }
+                uint32_t code = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    char c = *cursor++;
+                    code <<= 4;
+                    if (c >= '0' && c <= '9')
+                    {
+                        code |= c - '0';
+                    }
+                    else if (c >= 'a' && c <= 'f')
+                    {
+                        code |= c - 'a' + 10;
+                    }
+                    else if (c >= 'A' && c <= 'F')
+                    {
+                        code |= c - 'A' + 10;
+                    }
+                    else
+                    {
+                        throw std::runtime_error("JSON: Invalid escape");
+                    }
+                }
+                return code;
+            }
+
+            std::string parseString()
+            {
+                if (cursor == end || *cursor != '"')
+                {
+                    throw std::runtime_error("JSON: Expected string");
+                }
+                cursor++;
+
+                std::string result{};
+                while (true)
+                {
+                    if (cursor == end)
+                    {
+                        throw std::runtime_error("JSON: Unterminated string");
+                    }
+                    char c = *cursor++;
+                    if (c == '"')
+                    {
+                        return result;
+                    }
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        throw std::runtime_error("JSON: Control character in string");
+                    }
+                    if (c != '\\')
+                    {
+                        result += c;
+                        continue;
+                    }
+
+                    if (cursor == end)
+                    {
+                        throw std::runtime_error("JSON: Unterminated string");
+                    }
+                    switch (*cursor++)
+                    {
+                    case '"':
+                        result += '"';
+                        break;
+                    case '\\':
+                        result += '\\';
+                        break;
+                    case '/':
+                        result += '/';
+                        break;
+                    case 'b':
+                        result += '\b';
+                        break;
+                    case 'f':
+                        result += '\f';
+                        break;
+                    case 'n':
+                        result += '\n';
+                        break;
+                    case 'r':
+                        result += '\r';
+                        break;
+                    case 't':
+                        result += '\t';
+                        break;
+                    case 'u':
+                    {
+                        uint32_t code = parseHex4();
+                        // Surrogate pairs combine into one code point
+                        if (code >= 0xD800 && code < 0xDC00 && consume("\\u"))
+                        {
+                            uint32_t low = parseHex4();
+                            if (low < 0xDC00 || low >= 0xE000)
+                            {
+                                throw std::runtime_error("JSON: Invalid surrogate pair");
+                            }
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        if (code < 0x80)
+                        {
+                            result += static_cast<char>(code);
+                        }
+                        else if (code < 0x800)
+                        {
+                            result += static_cast<char>(0xC0 | (code >> 6));
+                            result += static_cast<char>(0x80 | (code & 0x3F));
+                        }
+                        else if (code < 0x10000)
+                        {
+                            result += static_cast<char>(0xE0 | (code >> 12));
+                            result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                            result += static_cast<char>(0x80 | (code & 0x3F));
+                        }
+                        else
+                        {
+                            result += static_cast<char>(0xF0 | (code >> 18));
+                            result += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                            result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                            result += static_cast<char>(0x80 | (code & 0x3F));
+                        }
+                        break;
+                    }
+                    default:
+                        throw std::runtime_error("JSON: Invalid escape");
+                    }
+                }
+            }
+
+            const char *cursor;
+            const char *end;
+        };
+
+        const JsonValue &member(const JsonValue &object, std::string_view name)
+        {
+            const JsonValue *value = object.find(name);
+            if (!value)
+            {
+                throw std::runtime_error("Missing " + std::string(name));
+            }
+            return *value;
+        }
+
+        const std::vector<JsonValue> &arrayMember(const JsonValue &object, std::string_view name)
+        {
+            static const std::vector<JsonValue> empty{};
+            const JsonValue *value = object.find(name);
+            if (!value)
+            {
+                return empty;
+            }
+            if (value->type != JsonValue::Type::Array)
+            {
+                throw std::runtime_error(std::string(name) + " is not an array");
+            }
+            return value->elements;
+        }
+
+        uint64_t toUint(const JsonValue &value, std::string_view name)
+        {
+            if (value.type != JsonValue::Type::Number || value.number < 0.0 || value.number > 9007199254740992.0 ||
+                std::floor(value.number) != value.number)
+            {
+                throw std::runtime_error(std::string(name) + " is not an unsigned integer");
+            }
+            return static_cast<uint64_t>(value.number);
+        }
+
+        uint64_t uintMember(const JsonValue &object, std::string_view name)
+        {
+            return toUint(member(object, name), name);
+        }
+
+        uint64_t uintMember(const JsonValue &object, std::string_view name, uint64_t fallback)
+        {
+            const JsonValue *value = object.find(name);
+            return value ? toUint(*value, name) : fallback;
+        }
+
+        // Index into an array of count entries
+        uint32_t indexMember(const JsonValue &object, std::string_view name, size_t count)
+        {
+            uint64_t index = uintMember(object, name);
+            if (index >= count)
+            {
+                throw std::runtime_error(std::string(name) + " out of range");
+            }
+            return static_cast<uint32_t>(index);
+        }
+
+        uint32_t componentSize(uint32_t componentType)
+        {
+            switch (componentType)
+            {
+            case LveGltf::Byte:
+            case LveGltf::UnsignedByte:
+                return 1;
+            case LveGltf::Short:
+            case LveGltf::UnsignedShort:
+                return 2;
+            case LveGltf::UnsignedInt:
+            case LveGltf::Float:
+                return 4;
+            default:
+                throw std::runtime_error("Unknown component type " + std::to_string(componentType));
+            }
+        }
+
+        template <typename T>
+        T load(const std::byte *src)
+        {
+            T value;
+            std::memcpy(&value, src, sizeof(T));
+            return value;
+        }
+
+        float loadComponent(const std::byte *src, uint32_t componentType, bool normalized)
+        {
+            switch (componentType)
+            {
+            case LveGltf::Byte:
+                return normalized ? std::max(load<int8_t>(src) / 127.0f, -1.0f) : load<int8_t>(src);
+            case LveGltf::UnsignedByte:
+                return normalized ? load<uint8_t>(src) / 255.0f : load<uint8_t>(src);
+            case LveGltf::Short:
+                return normalized ? std::max(load<int16_t>(src) / 32767.0f, -1.0f) : load<int16_t>(src);
+            case LveGltf::UnsignedShort:
+                return normalized ? load<uint16_t>(src) / 65535.0f : load<uint16_t>(src);
+            case LveGltf::UnsignedInt:
+                return static_cast<float>(load<uint32_t>(src));
+            default:
+                return load<float>(src);
+            }
+        }
+
+        uint32_t loadIndex(const std::byte *src, uint32_t componentType)
+        {
+            switch (componentType)
+            {
+            case LveGltf::UnsignedByte:
+                return load<uint8_t>(src);
+            case LveGltf::UnsignedShort:
+                return load<uint16_t>(src);
+            default:
+                return load<uint32_t>(src);
+            }
+        }
+
+        constexpr uint32_t GLB_MAGIC = 0x46546C67;
+        constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+        constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+        constexpr uint32_t TRIANGLES = 4;
+
+        struct GlbHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t length;
+        };
+
+        struct GlbChunkHeader
+        {
+            uint32_t length;
+            uint32_t type;
+        };
+
+        struct BufferView
+        {
+            uint64_t offset;
+            uint64_t length;
+            uint32_t stride;
+        };
+    }
+
+    LveGltf::LveGltf(const std::string &path) : file{path}
+    {
+        try
+        {
+            const std::byte *bytes = file.getData();
+            size_t size = file.getSize();
+            if (size < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+            {
+                throw std::runtime_error("Not a binary glTF file");
+            }
+
+            GlbHeader header = load<GlbHeader>(bytes);
+            if (header.magic != GLB_MAGIC || header.version != 2 || header.length > size)
+            {
+                throw std::runtime_error("Not a binary glTF 2.0 file");
+            }
+
+            // The JSON chunk comes first, the BIN chunk is optional
+            size_t offset = sizeof(GlbHeader);
+            GlbChunkHeader jsonChunk = load<GlbChunkHeader>(bytes + offset);
+            offset += sizeof(GlbChunkHeader);
+            if (jsonChunk.type != GLB_CHUNK_JSON || jsonChunk.length > header.length - offset)
+            {
+                throw std::runtime_error("Missing JSON chunk");
+            }
+            std::string_view jsonText{reinterpret_cast<const char *>(bytes + offset), jsonChunk.length};
+            offset += jsonChunk.length;
+
+            const std::byte *bin = nullptr;
+            uint64_t binLength = 0;
+            if (header.length - offset >= sizeof(GlbChunkHeader))
+            {
+                GlbChunkHeader binChunk = load<GlbChunkHeader>(bytes + offset);
+                offset += sizeof(GlbChunkHeader);
+                if (binChunk.type == GLB_CHUNK_BIN)
+                {
+                    if (binChunk.length > header.length - offset)
+                    {
+                        throw std::runtime_error("Truncated BIN chunk");
+                    }
+                    bin = bytes + offset;
+                    binLength = binChunk.length;
+                }
+            }
+
+            JsonValue root = JsonParser{jsonText}.parseDocument();
+            if (root.type != JsonValue::Type::Object)
+            {
+                throw std::runtime_error("JSON root is not an object");
+            }
+
+            // Only the GLB-stored buffer is available, it has no uri and lives in the BIN chunk
+            const std::vector<JsonValue> &buffers = arrayMember(root, "buffers");
+            uint64_t bufferLength = 0;
+            if (!buffers.empty())
+            {
+                if (buffers[0].find("uri"))
+                {
+                    throw std::runtime_error("External buffers are not supported");
+                }
+                bufferLength = uintMember(buffers[0], "byteLength");
+                if (bufferLength > binLength)
+                {
+                    throw std::runtime_error("Buffer exceeds the BIN chunk");
+                }
+            }
+
+            std::vector<BufferView> bufferViews{};
+            for (const JsonValue &view : arrayMember(root, "bufferViews"))
+            {
+                if (indexMember(view, "buffer", buffers.size()) != 0)
+                {
+                    throw std::runtime_error("External buffers are not supported");
+                }
+                uint64_t stride = uintMember(view, "byteStride", 0);
+                if (stride != 0 && (stride < 4 || stride > 252))
+                {
+                    throw std::runtime_error("Invalid byteStride");
+                }
+                BufferView bufferView{uintMember(view, "byteOffset", 0), uintMember(view, "byteLength"),
+                                      static_cast<uint32_t>(stride)};
+                if (bufferView.offset > bufferLength || bufferView.length > bufferLength - bufferView.offset)
+                {
+                    throw std::runtime_error("Buffer view exceeds its buffer");
+                }
+                bufferViews.push_back(bufferView);
+            }
+
+            for (const JsonValue &entry : arrayMember(root, "accessors"))
+            {
+                if (entry.find("sparse"))
+                {
+                    throw std::runtime_error("Sparse accessors are not supported");
+                }
+
+                Accessor accessor{};
+                accessor.componentType = static_cast<uint32_t>(uintMember(entry, "componentType"));
+                accessor.count = static_cast<uint32_t>(std::min<uint64_t>(uintMember(entry, "count"), UINT32_MAX));
+                const JsonValue *normalized = entry.find("normalized");
+                accessor.normalized = normalized && normalized->type == JsonValue::Type::Bool && normalized->boolean;
+
+                // Matrix columns of 1 and 2 byte components are padded to 4 bytes
+                const JsonValue &type = member(entry, "type");
+                uint32_t size = componentSize(accessor.componentType);
+                if (type.string == "SCALAR" || type.string == "VEC2" || type.string == "VEC3" || type.string == "VEC4")
+                {
+                    accessor.componentCount = type.string == "SCALAR" ? 1 : type.string[3] - '0';
+                    accessor.elementSize = accessor.componentCount * size;
+                }
+                else if (type.string == "MAT2" || type.string == "MAT3" || type.string == "MAT4")
+                {
+                    uint32_t columns = type.string[3] - '0';
+                    accessor.componentCount = columns * columns;
+                    accessor.elementSize = columns * ((columns * size + 3) & ~3u);
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown accessor type " + type.string);
+                }
+
+                // A buffer view is required. glTF reads accessors without one as zeros, which only
+                // makes sense with sparse storage, and that is rejected above.
+                const BufferView &view = bufferViews[indexMember(entry, "bufferView", bufferViews.size())];
+                uint64_t byteOffset = uintMember(entry, "byteOffset", 0);
+                if (view.stride != 0 && view.stride < accessor.elementSize)
+                {
+                    throw std::runtime_error("Accessor " + std::to_string(accessors.size()) + " overlaps its next element");
+                }
+                accessor.stride = view.stride != 0 ? view.stride : accessor.elementSize;
+                uint64_t byteLength = accessor.count == 0
+                                          ? 0
+                                          : uint64_t{accessor.count - 1} * accessor.stride + accessor.elementSize;
+                if (byteOffset > view.length || byteLength > view.length - byteOffset)
+                {
+                    throw std::runtime_error("Accessor " + std::to_string(accessors.size()) + " exceeds its buffer view");
+                }
+                accessor.data = bin + view.offset + byteOffset;
+                accessors.push_back(accessor);
+            }
+
+            for (const JsonValue &mesh : arrayMember(root, "meshes"))
+            {
+                for (const JsonValue &entry : arrayMember(mesh, "primitives"))
+                {
+                    const JsonValue &attributes = member(entry, "attributes");
+                    if (uintMember(entry, "mode", TRIANGLES) != TRIANGLES || !attributes.find("POSITION"))
+                    {
+                        skippedPrimitiveCount++;
+                        continue;
+                    }
+
+                    Primitive primitive{indexMember(attributes, "POSITION", accessors.size()), NO_ACCESSOR, NO_ACCESSOR};
+                    const Accessor &position = accessors[primitive.position];
+                    if (position.componentCount != 3)
+                    {
+                        throw std::runtime_error("POSITION is not a VEC3");
+                    }
+                    if (attributes.find("NORMAL"))
+                    {
+                        primitive.normal = indexMember(attributes, "NORMAL", accessors.size());
+                        const Accessor &normal = accessors[primitive.normal];
+                        if (normal.componentCount != 3 || normal.count != position.count)
+                        {
+                            throw std::runtime_error("NORMAL does not match POSITION");
+                        }
+                    }
+
+                    uint32_t cornerCount = position.count;
+                    if (entry.find("indices"))
+                    {
+                        primitive.indices = indexMember(entry, "indices", accessors.size());
+                        const Accessor &indices = accessors[primitive.indices];
+                        if (indices.componentCount != 1 || indices.componentType == Byte ||
+                            indices.componentType == Short || indices.componentType == Float)
+                        {
+                            throw std::runtime_error("Indices are not unsigned integers");
+                        }
+                        // Copied indices go to the GPU as they are, one past the vertices reads another mesh
+                        const std::byte *src = indices.data;
+                        for (uint32_t i = 0; i < indices.count; i++, src += indices.stride)
+                        {
+                            if (loadIndex(src, indices.componentType) >= position.count)
+                            {
+                                throw std::runtime_error("Index beyond POSITION");
+                            }
+                        }
+                        cornerCount = indices.count;
+                    }
+                    if (cornerCount % 3 != 0)
+                    {
+                        throw std::runtime_error("Triangle list with a partial triangle");
+                    }
+                    primitives.push_back(primitive);
+                }
+            }
+        }
+        catch (const std::exception &e)
+        {
+            throw std::runtime_error("LveGltf: " + path + ": " + e.what());
+        }
+    }
+
+    void LveGltf::copyVec3(const Accessor &accessor, void *dst, size_t dstStride)
+    {
+        std::byte *out = static_cast<std::byte *>(dst);
+        const std::byte *src = accessor.data;
+        if (accessor.componentType == Float)
+        {
+            for (uint32_t i = 0; i < accessor.count; i++, src += accessor.stride, out += dstStride)
+            {
+                std::memcpy(out, src, 3 * sizeof(float));
+            }
+            return;
+        }
+
+        uint32_t size = componentSize(accessor.componentType);
+        for (uint32_t i = 0; i < accessor.count; i++, src += accessor.stride, out += dstStride)
+        {
+            float value[3];
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                value[c] = loadComponent(src + c * size, accessor.componentType, accessor.normalized);
+            }
+            std::memcpy(out, value, sizeof(value));
+        }
+    }
+
+    void LveGltf::copyIndices(const Accessor &accessor, uint32_t *dst, uint32_t baseVertex)
+    {
+        const std::byte *src = accessor.data;
+        switch (accessor.componentType)
+        {
+        case UnsignedByte:
+            for (uint32_t i = 0; i < accessor.count; i++, src += accessor.stride)
+            {
+                dst[i] = baseVertex + load<uint8_t>(src);
+            }
+            break;
+        case UnsignedShort:
+            for (uint32_t i = 0; i < accessor.count; i++, src += accessor.stride)
+            {
+                dst[i] = baseVertex + load<uint16_t>(src);
+            }
+            break;
+        default:
+            for (uint32_t i = 0; i < accessor.count; i++, src += accessor.stride)
+            {
+                dst[i] = baseVertex + load<uint32_t>(src);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "lve_mapped_file.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    // Triangle geometry of a binary glTF 2.0 (.glb) file. The file stays mapped, accessors point
+    // straight into its BIN chunk so callers can copy attributes whose layout already matches
+    // theirs and convert only the rest. Every accessor is bounds checked against its buffer view
+    // and every index against its positions on load. Node transforms, materials and external
+    // buffers are not supported.
+    class LveGltf
+    {
+    public:
+        enum ComponentType : uint32_t
+        {
+            Byte = 5120,
+            UnsignedByte = 5121,
+            Short = 5122,
+            UnsignedShort = 5123,
+            UnsignedInt = 5125,
+            Float = 5126,
+        };
+
+        struct Accessor
+        {
+            // First element, later ones follow every stride bytes
+            const std::byte *data;
+            uint32_t count;
+            uint32_t componentType;
+            // 1 for SCALAR up to 4 for VEC4, 16 for MAT4
+            uint32_t componentCount;
+            // Includes the column padding of small matrix components
+            uint32_t elementSize;
+            uint32_t stride;
+            bool normalized;
+        };
+
+        // Accessor indices of a triangle list, indices is NO_ACCESSOR for non-indexed primitives and
+        // normal for primitives without normals
+        struct Primitive
+        {
+            uint32_t position;
+            uint32_t normal;
+            uint32_t indices;
+        };
+
+        static constexpr uint32_t NO_ACCESSOR = UINT32_MAX;
+
+        explicit LveGltf(const std::string &path);
+
+        LveGltf(const LveGltf &) = delete;
+        LveGltf &operator=(const LveGltf &) = delete;
+
+        const std::vector<Accessor> &getAccessors() const { return accessors; }
+        const Accessor &getAccessor(uint32_t accessor) const { return accessors[accessor]; }
+        // Triangle list primitives of all meshes, other topologies are skipped
+        const std::vector<Primitive> &getPrimitives() const { return primitives; }
+        uint32_t getSkippedPrimitiveCount() const { return skippedPrimitiveCount; }
+
+        // Converts a 3 component accessor to floats, normalized integers are mapped to [0, 1] or
+        // [-1, 1]. Writes count elements of 3 floats, dstStride bytes apart.
+        static void copyVec3(const Accessor &accessor, void *dst, size_t dstStride);
+        // Widens a SCALAR index accessor to 32 bits and adds baseVertex
+        static void copyIndices(const Accessor &accessor, uint32_t *dst, uint32_t baseVertex);
+
+    private:
+        LveMappedFile file;
+        std::vector<Accessor> accessors{};
+        std::vector<Primitive> primitives{};
+        uint32_t skippedPrimitiveCount{};
+    };
+}
@@ -0,0 +1,589 @@
+#include "lve_gpu_culling.hpp"
+#include "lve_archive.hpp"
+#include "lve_frustum_culling.hpp"
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <stdexcept>
+
+namespace lve
+{
+    static constexpr uint32_t CULL_GROUP_SIZE = 64;
+    static constexpr uint32_t HIZ_GROUP_SIZE = 8;
+
+    struct HiZReducePushConstants
+    {
+        int32_t sourceSize[2];
+        int32_t destinationSize[2];
+    };
+
+    LveGpuCulling::LveGpuCulling(LveDevice &device, LveSwapChain &swapChain, LveModel &model, uint32_t framesInFlight)
+        : device{device}, swapChain{swapChain}, model{model}
+    {
+        if (!isSupported(device))
+        {
+            throw std::runtime_error("LveGpuCulling: drawIndirectFirstInstance is not supported by the device");
+        }
+
+        createDescriptorLayouts();
+        createPipelines();
+        createHiZ();
+
+        frames.resize(framesInFlight);
+        for (auto &frame : frames)
+        {
+            frame.uniformBuffer = std::make_unique<LveBuffer>(
+                device,
+                sizeof(CullUniforms),
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.uniformBuffer->map();
+
+            frame.indirectBuffer = std::make_unique<LveBuffer>(
+                device,
+                sizeof(VkDrawIndexedIndirectCommand) * model.getMeshCount(),
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            frame.counterBuffer = std::make_unique<LveBuffer>(
+                device,
+                sizeof(Counters),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            frame.counterBuffer->map();
+        }
+
+        std::vector<glm::vec4> boundingSpheres(model.getMeshCount());
+        for (uint32_t mesh = 0; mesh < model.getMeshCount(); mesh++)
+        {
+            boundingSpheres[mesh] = model.getMesh(mesh).boundingSphere;
+        }
+        meshBuffer = LveBuffer::createDeviceLocal(
+            device,
+            boundingSpheres.data(),
+            sizeof(glm::vec4) * boundingSpheres.size(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+        createDescriptorPool();
+        updateHiZDescriptors();
+    }
+
+    LveGpuCulling::~LveGpuCulling()
+    {
+        for (auto view : hizLevelViews)
+        {
+            device.disp.destroyImageView(device.device(), view, nullptr);
+        }
+        device.disp.destroyImageView(device.device(), hizView, nullptr);
+        device.disp.destroyImage(device.device(), hizImage, nullptr);
+        device.disp.freeMemory(device.device(), hizImageMemory, nullptr);
+        device.disp.destroySampler(device.device(), sampler, nullptr);
+        device.disp.destroyDescriptorPool(device.device(), descriptorPool, nullptr);
+        device.disp.destroyPipelineLayout(device.device(), hizPipelineLayout, nullptr);
+        device.disp.destroyPipelineLayout(device.device(), cullPipelineLayout, nullptr);
+        device.disp.destroyDescriptorSetLayout(device.device(), hizSetLayout, nullptr);
+        device.disp.destroyDescriptorSetLayout(device.device(), cullSetLayout, nullptr);
+    }
+
+    bool LveGpuCulling::isSupported(LveDevice &device)
+    {
+        return device.enabledFeatures.drawIndirectFirstInstance == VK_TRUE;
+    }
+
+    bool LveGpuCulling::hasShaders()
+    {
+        for (const char *path : {HIZ_SHADER_PATH, CULL_SHADER_PATH})
+        {
+            if (!LveArchive::findDefault(path) && !std::filesystem::exists(path))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void LveGpuCulling::createDescriptorLayouts()
+    {
+        auto binding = [](uint32_t index, VkDescriptorType type)
+        {
+            VkDescriptorSetLayoutBinding layoutBinding{};
+            layoutBinding.binding = index;
+            layoutBinding.descriptorType = type;
+            layoutBinding.descriptorCount = 1;
+            layoutBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            return layoutBinding;
+        };
+
+        std::array<VkDescriptorSetLayoutBinding, 2> hizBindings = {
+            binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER),
+            binding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE)};
+        std::array<VkDescriptorSetLayoutBinding, 7> cullBindings = {
+            binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER),
+            binding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            binding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            binding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            binding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            binding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER),
+            binding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)};
+
+        VkDescriptorSetLayoutCreateInfo setLayoutCi{};
+        setLayoutCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        setLayoutCi.bindingCount = static_cast<uint32_t>(hizBindings.size());
+        setLayoutCi.pBindings = hizBindings.data();
+        if (device.disp.createDescriptorSetLayout(device.device(), &setLayoutCi, nullptr, &hizSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create descriptor set layout");
+        }
+
+        setLayoutCi.bindingCount = static_cast<uint32_t>(cullBindings.size());
+        setLayoutCi.pBindings = cullBindings.data();
+        if (device.disp.createDescriptorSetLayout(device.device(), &setLayoutCi, nullptr, &cullSetLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create descriptor set layout");
+        }
+    }
+
+    void LveGpuCulling::createPipelines()
+    {
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(HiZReducePushConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutCi{};
+        pipelineLayoutCi.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCi.setLayoutCount = 1;
+        pipelineLayoutCi.pSetLayouts = &hizSetLayout;
+        pipelineLayoutCi.pushConstantRangeCount = 1;
+        pipelineLayoutCi.pPushConstantRanges = &pushConstantRange;
+        if (device.disp.createPipelineLayout(device.device(), &pipelineLayoutCi, nullptr, &hizPipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create pipeline layout");
+        }
+
+        pipelineLayoutCi.pSetLayouts = &cullSetLayout;
+        pipelineLayoutCi.pushConstantRangeCount = 0;
+        pipelineLayoutCi.pPushConstantRanges = nullptr;
+        if (device.disp.createPipelineLayout(device.device(), &pipelineLayoutCi, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create pipeline layout");
+        }
+
+        hizPipeline = std::make_unique<LveComputePipeline>(device, HIZ_SHADER_PATH, hizPipelineLayout);
+        cullPipeline = std::make_unique<LveComputePipeline>(device, CULL_SHADER_PATH, cullPipelineLayout);
+    }
+
+    void LveGpuCulling::createHiZ()
+    {
+        // Half resolution, every texel holds the farthest depth it covers
+        VkExtent2D depthExtent = swapChain.getSwapChainExtent();
+        hizExtent = {std::max(depthExtent.width / 2, 1u), std::max(depthExtent.height / 2, 1u)};
+        uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(hizExtent.width, hizExtent.height)))) + 1;
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = hizExtent.width;
+        imageInfo.extent.height = hizExtent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = VK_FORMAT_R32_SFLOAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, hizImage, hizImageMemory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = hizImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (device.disp.createImageView(device.device(), &viewInfo, nullptr, &hizView) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create Hi-Z image view");
+        }
+
+        hizLevelViews.resize(levelCount);
+        for (uint32_t level = 0; level < levelCount; level++)
+        {
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            if (device.disp.createImageView(device.device(), &viewInfo, nullptr, &hizLevelViews[level]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Vulkan: Failed to create Hi-Z image view");
+            }
+        }
+
+        VkSamplerCreateInfo samplerCi{};
+        samplerCi.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerCi.magFilter = VK_FILTER_NEAREST;
+        samplerCi.minFilter = VK_FILTER_NEAREST;
+        samplerCi.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerCi.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCi.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCi.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerCi.maxLod = VK_LOD_CLAMP_NONE;
+        if (device.disp.createSampler(device.device(), &samplerCi, nullptr, &sampler) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create Hi-Z sampler");
+        }
+
+        // The pyramid stays in GENERAL, it is only ever written and read by compute
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = hizImage;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        device.disp.cmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 1, &barrier);
+        device.endSingleTimeCommands(commandBuffer);
+    }
+
+    void LveGpuCulling::createDescriptorPool()
+    {
+        uint32_t frameCount = static_cast<uint32_t>(frames.size());
+        uint32_t reduceSetCount = static_cast<uint32_t>(swapChain.imageCount() + hizLevelViews.size());
+
+        std::array<VkDescriptorPoolSize, 4> poolSizes{};
+        poolSizes[0] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount};
+        poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 5};
+        poolSizes[2] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount + reduceSetCount};
+        poolSizes[3] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, reduceSetCount};
+
+        VkDescriptorPoolCreateInfo descriptorPoolCi{};
+        descriptorPoolCi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptorPoolCi.maxSets = frameCount + reduceSetCount;
+        descriptorPoolCi.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        descriptorPoolCi.pPoolSizes = poolSizes.data();
+        if (device.disp.createDescriptorPool(device.device(), &descriptorPoolCi, nullptr, &descriptorPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create descriptor pool");
+        }
+
+        auto allocate = [&](VkDescriptorSetLayout setLayout, std::vector<VkDescriptorSet> &sets)
+        {
+            std::vector<VkDescriptorSetLayout> setLayouts(sets.size(), setLayout);
+            VkDescriptorSetAllocateInfo descriptorSetAi{};
+            descriptorSetAi.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            descriptorSetAi.descriptorPool = descriptorPool;
+            descriptorSetAi.descriptorSetCount = static_cast<uint32_t>(setLayouts.size());
+            descriptorSetAi.pSetLayouts = setLayouts.data();
+            if (device.disp.allocateDescriptorSets(device.device(), &descriptorSetAi, sets.data()) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Vulkan: Failed to allocate descriptor sets");
+            }
+        };
+
+        depthReduceSets.resize(swapChain.imageCount());
+        levelReduceSets.resize(hizLevelViews.size() - 1);
+        std::vector<VkDescriptorSet> cullSets(frames.size());
+        allocate(hizSetLayout, depthReduceSets);
+        if (!levelReduceSets.empty())
+        {
+            allocate(hizSetLayout, levelReduceSets);
+        }
+        allocate(cullSetLayout, cullSets);
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            frames[i].cullSet = cullSets[i];
+        }
+    }
+
+    void LveGpuCulling::updateHiZDescriptors()
+    {
+        auto writeReduceSet = [&](VkDescriptorSet set, VkImageView source, VkImageLayout sourceLayout, VkImageView destination)
+        {
+            VkDescriptorImageInfo sourceInfo{sampler, source, sourceLayout};
+            VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, destination, VK_IMAGE_LAYOUT_GENERAL};
+
+            std::array<VkWriteDescriptorSet, 2> writes{};
+            writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[0].dstSet = set;
+            writes[0].dstBinding = 0;
+            writes[0].descriptorCount = 1;
+            writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[0].pImageInfo = &sourceInfo;
+            writes[1] = writes[0];
+            writes[1].dstBinding = 1;
+            writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[1].pImageInfo = &destinationInfo;
+            device.disp.updateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        };
+
+        for (size_t i = 0; i < depthReduceSets.size(); i++)
+        {
+            writeReduceSet(
+                depthReduceSets[i],
+                swapChain.getDepthImageView(static_cast<int>(i)),
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                hizLevelViews[0]);
+        }
+        for (size_t level = 1; level < hizLevelViews.size(); level++)
+        {
+            writeReduceSet(levelReduceSets[level - 1], hizLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL, hizLevelViews[level]);
+        }
+    }
+
+    void LveGpuCulling::updateCullDescriptors()
+    {
+        VkDescriptorImageInfo hizInfo{sampler, hizView, VK_IMAGE_LAYOUT_GENERAL};
+        VkDescriptorBufferInfo objectInfo{objectBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo meshInfo{meshBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+
+        for (auto &frame : frames)
+        {
+            VkDescriptorBufferInfo uniformInfo{frame.uniformBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+            VkDescriptorBufferInfo commandInfo{frame.indirectBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+            VkDescriptorBufferInfo instanceInfo{frame.instanceBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+            VkDescriptorBufferInfo counterInfo{frame.counterBuffer->getBuffer(), 0, VK_WHOLE_SIZE};
+            const VkDescriptorBufferInfo *bufferInfos[] = {&uniformInfo, &objectInfo, &meshInfo, &commandInfo, &instanceInfo, &counterInfo};
+
+            std::array<VkWriteDescriptorSet, 7> writes{};
+            for (uint32_t binding = 0; binding < writes.size(); binding++)
+            {
+                writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[binding].dstSet = frame.cullSet;
+                writes[binding].dstBinding = binding;
+                writes[binding].descriptorCount = 1;
+                if (binding == 6)
+                {
+                    writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                    writes[binding].pImageInfo = &hizInfo;
+                }
+                else
+                {
+                    writes[binding].descriptorType = binding == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    writes[binding].pBufferInfo = bufferInfos[binding];
+                }
+            }
+            device.disp.updateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+        }
+    }
+
+    void LveGpuCulling::setScene(const std::vector<Object> &objects)
+    {
+        objectCount = static_cast<uint32_t>(objects.size());
+        if (objectCount == 0)
+        {
+            return;
+        }
+
+        // Every mesh gets a fixed range of the output, large enough for all of its objects
+        std::vector<uint32_t> meshObjectCounts(model.getMeshCount());
+        for (const auto &object : objects)
+        {
+            meshObjectCounts[object.mesh]++;
+        }
+
+        std::vector<VkDrawIndexedIndirectCommand> commandTemplates(model.getMeshCount());
+        uint32_t firstInstance = 0;
+        for (uint32_t mesh = 0; mesh < model.getMeshCount(); mesh++)
+        {
+            const auto &meshInfo = model.getMesh(mesh);
+            commandTemplates[mesh].indexCount = meshInfo.indexCount;
+            commandTemplates[mesh].instanceCount = 0;
+            commandTemplates[mesh].firstIndex = meshInfo.firstIndex;
+            commandTemplates[mesh].vertexOffset = meshInfo.vertexOffset;
+            commandTemplates[mesh].firstInstance = firstInstance;
+            firstInstance += meshObjectCounts[mesh];
+        }
+
+        commandTemplateBuffer = LveBuffer::createDeviceLocal(
+            device,
+            commandTemplates.data(),
+            sizeof(VkDrawIndexedIndirectCommand) * commandTemplates.size(),
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+        objectBuffer = LveBuffer::createDeviceLocal(
+            device,
+            objects.data(),
+            sizeof(Object) * objects.size(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+        for (auto &frame : frames)
+        {
+            frame.instanceBuffer = std::make_unique<LveBuffer>(
+                device,
+                sizeof(LveDrawList::Instance) * objectCount,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            frame.hasResults = false;
+        }
+        hasPreviousFrame = false;
+
+        updateCullDescriptors();
+    }
+
+    void LveGpuCulling::cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4 &viewProjection, uint32_t previousImageIndex)
+    {
+        LVE_TRACE_ZONE("LveGpuCulling::cull");
+        currentFrame = frameIndex;
+        auto &frame = frames[currentFrame];
+
+        // The frame's fence has been waited on, so its counters are final
+        if (frame.hasResults)
+        {
+            memcpy(&counters, frame.counterBuffer->getMappedMemory(), sizeof(Counters));
+        }
+        if (objectCount == 0)
+        {
+            return;
+        }
+
+        // Occlusion needs the depth and the camera of the previous frame's cull
+        bool occlusionEnabled = previousImageIndex != UINT32_MAX && hasPreviousFrame;
+        if (occlusionEnabled)
+        {
+            buildHiZ(commandBuffer, previousImageIndex);
+        }
+
+        CullUniforms uniforms{};
+        uniforms.previousViewProjection = previousViewProjection;
+        LveFrustum frustum = LveFrustum::fromViewProjection(viewProjection);
+        std::copy(std::begin(frustum.planes), std::end(frustum.planes), uniforms.frustumPlanes);
+        uniforms.hizSize = glm::vec2(static_cast<float>(hizExtent.width), static_cast<float>(hizExtent.height));
+        uniforms.hizLevels = static_cast<uint32_t>(hizLevelViews.size());
+        uniforms.objectCount = objectCount;
+        uniforms.occlusionEnabled = occlusionEnabled ? 1 : 0;
+        frame.uniformBuffer->writeToBuffer(&uniforms, sizeof(uniforms));
+        previousViewProjection = viewProjection;
+        hasPreviousFrame = true;
+
+        // Reset the batches to zero instances and the counters
+        VkBufferCopy copyRegion{};
+        copyRegion.size = commandTemplateBuffer->getSize();
+        device.disp.cmdCopyBuffer(commandBuffer, commandTemplateBuffer->getBuffer(), frame.indirectBuffer->getBuffer(), 1, &copyRegion);
+        device.disp.cmdFillBuffer(commandBuffer, frame.counterBuffer->getBuffer(), 0, sizeof(Counters), 0);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        device.disp.cmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        cullPipeline->bind(commandBuffer);
+        device.disp.cmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+        device.disp.cmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+        device.disp.cmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+            0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        frame.hasResults = true;
+    }
+
+    void LveGpuCulling::buildHiZ(VkCommandBuffer commandBuffer, uint32_t previousImageIndex)
+    {
+        // The last cull may still be sampling the pyramid
+        device.disp.cmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+        hizPipeline->bind(commandBuffer);
+
+        VkExtent2D sourceExtent = swapChain.getSwapChainExtent();
+        VkExtent2D levelExtent = hizExtent;
+        for (uint32_t level = 0; level < hizLevelViews.size(); level++)
+        {
+            VkDescriptorSet set = level == 0 ? depthReduceSets[previousImageIndex] : levelReduceSets[level - 1];
+            device.disp.cmdBindDescriptorSets(
+                commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, hizPipelineLayout, 0, 1, &set, 0, nullptr);
+
+            HiZReducePushConstants push{};
+            push.sourceSize[0] = static_cast<int32_t>(sourceExtent.width);
+            push.sourceSize[1] = static_cast<int32_t>(sourceExtent.height);
+            push.destinationSize[0] = static_cast<int32_t>(levelExtent.width);
+            push.destinationSize[1] = static_cast<int32_t>(levelExtent.height);
+            device.disp.cmdPushConstants(
+                commandBuffer, hizPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+            device.disp.cmdDispatch(
+                commandBuffer,
+                (levelExtent.width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+                (levelExtent.height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+                1);
+
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = hizImage;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = level;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.layerCount = 1;
+            device.disp.cmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            sourceExtent = levelExtent;
+            levelExtent = {std::max(levelExtent.width / 2, 1u), std::max(levelExtent.height / 2, 1u)};
+        }
+    }
+
+    void LveGpuCulling::draw(VkCommandBuffer commandBuffer)
+    {
+        if (objectCount == 0)
+        {
+            return;
+        }
+
+        model.bind(commandBuffer);
+        VkBuffer buffers[] = {frames[currentFrame].instanceBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        device.disp.cmdBindVertexBuffers(commandBuffer, 1, 1, buffers, offsets);
+
+        // Empty batches are left at zero instances, so every mesh is issued
+        VkBuffer indirectBuffer = frames[currentFrame].indirectBuffer->getBuffer();
+        uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if (device.enabledFeatures.multiDrawIndirect == VK_TRUE)
+        {
+            device.disp.cmdDrawIndexedIndirect(commandBuffer, indirectBuffer, 0, model.getMeshCount(), stride);
+        }
+        else
+        {
+            for (uint32_t mesh = 0; mesh < model.getMeshCount(); mesh++)
+            {
+                device.disp.cmdDrawIndexedIndirect(commandBuffer, indirectBuffer, stride * mesh, 1, stride);
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_compute_pipeline.hpp"
+#include "lve_draw_list.hpp"
+#include "lve_model.hpp"
+#include "lve_swap_chain.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace lve
+{
+    // GPU-driven visibility. A compute pass frustum-culls every object and occlusion-culls it
+    // against a Hi-Z pyramid of the previous frame's depth, then compacts the survivors into
+    // per-mesh batches of an indirect draw buffer. The CPU only records a fixed number of commands.
+    class LveGpuCulling
+    {
+    public:
+        // std430 layout shared with cull.comp
+        struct Object
+        {
+            LveDrawList::Instance instance;
+            uint32_t mesh;
+            uint32_t padding[3];
+        };
+
+        struct Counters
+        {
+            uint32_t visible;
+            uint32_t frustumCulled;
+            uint32_t occlusionCulled;
+        };
+
+        LveGpuCulling(LveDevice &device, LveSwapChain &swapChain, LveModel &model, uint32_t framesInFlight);
+        ~LveGpuCulling();
+        LveGpuCulling(const LveGpuCulling &) = delete;
+        LveGpuCulling &operator=(const LveGpuCulling &) = delete;
+
+        static constexpr const char *HIZ_SHADER_PATH = "shaders/hiz_reduce_comp.spv";
+        static constexpr const char *CULL_SHADER_PATH = "shaders/cull_comp.spv";
+
+        // Needs drawIndirectFirstInstance for the batch offsets
+        static bool isSupported(LveDevice &device);
+        // The compute shaders are built with the app, they are missing when it runs from elsewhere
+        static bool hasShaders();
+
+        // Must not be called while a frame using the previous scene is in flight
+        void setScene(const std::vector<Object> &objects);
+        // Recorded outside of a render pass after the frame's fence has been waited on.
+        // previousImageIndex is the swapchain image rendered last frame, UINT32_MAX disables occlusion.
+        void cull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4 &viewProjection, uint32_t previousImageIndex);
+        void draw(VkCommandBuffer commandBuffer);
+
+        // Results of the last completed cull
+        const Counters &getCounters() const { return counters; }
+
+    private:
+        struct CullUniforms
+        {
+            glm::mat4 previousViewProjection;
+            glm::vec4 frustumPlanes[6];
+            glm::vec2 hizSize;
+            uint32_t hizLevels;
+            uint32_t objectCount;
+            uint32_t occlusionEnabled;
+            uint32_t padding[3];
+        };
+
+        struct FrameResources
+        {
+            std::unique_ptr<LveBuffer> uniformBuffer;
+            std::unique_ptr<LveBuffer> indirectBuffer;
+            std::unique_ptr<LveBuffer> instanceBuffer;
+            std::unique_ptr<LveBuffer> counterBuffer;
+            VkDescriptorSet cullSet{};
+            bool hasResults{};
+        };
+
+        void createDescriptorLayouts();
+        void createPipelines();
+        void createHiZ();
+        void createDescriptorPool();
+        void updateHiZDescriptors();
+        void updateCullDescriptors();
+        void buildHiZ(VkCommandBuffer commandBuffer, uint32_t previousImageIndex);
+
+        LveDevice &device;
+        LveSwapChain &swapChain;
+        LveModel &model;
+
+        VkDescriptorSetLayout hizSetLayout{};
+        VkDescriptorSetLayout cullSetLayout{};
+        VkPipelineLayout hizPipelineLayout{};
+        VkPipelineLayout cullPipelineLayout{};
+        std::unique_ptr<LveComputePipeline> hizPipeline;
+        std::unique_ptr<LveComputePipeline> cullPipeline;
+        VkDescriptorPool descriptorPool{};
+        VkSampler sampler{};
+
+        VkImage hizImage{};
+        VkDeviceMemory hizImageMemory{};
+        VkImageView hizView{};
+        std::vector<VkImageView> hizLevelViews{};
+        VkExtent2D hizExtent{};
+        // The first level reads one of the swapchain depth images, the rest read the level above
+        std::vector<VkDescriptorSet> depthReduceSets{};
+        std::vector<VkDescriptorSet> levelReduceSets{};
+
+        std::vector<FrameResources> frames{};
+        std::unique_ptr<LveBuffer> meshBuffer;
+        std::unique_ptr<LveBuffer> objectBuffer;
+        std::unique_ptr<LveBuffer> commandTemplateBuffer;
+        uint32_t objectCount{};
+        uint32_t currentFrame{};
+        glm::mat4 previousViewProjection{1.0f};
+        bool hasPreviousFrame{};
+        Counters counters{};
+    };
+}
@@ -0,0 +1,243 @@
+#include "lve_gpu_profiler.hpp"
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace lve
+{
+    LveGpuProfiler::LveGpuProfiler(LveDevice &device, uint32_t framesInFlight) : device{device}
+    {
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(device.getPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+        uint32_t validBits = queueFamilies[device.findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+        supported = validBits > 0 && device.properties.limits.timestampPeriod > 0.0f;
+        if (!supported)
+        {
+            spdlog::warn("LveGpuProfiler: Timestamps are not supported on the graphics queue");
+            return;
+        }
+
+        timestampPeriodNs = static_cast<double>(device.properties.limits.timestampPeriod);
+        timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        resultBuffer.resize(MAX_SCOPES * 2 * 2);
+
+        frames.resize(framesInFlight);
+        for (auto &frame : frames)
+        {
+            VkQueryPoolCreateInfo queryPoolCi{};
+            queryPoolCi.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolCi.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            queryPoolCi.queryCount = MAX_SCOPES * 2;
+
+            if (device.disp.createQueryPool(device.device(), &queryPoolCi, nullptr, &frame.queryPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Vulkan: Failed to create timestamp query pool");
+            }
+            frame.scopes.reserve(MAX_SCOPES);
+        }
+
+        if (LveTrace::isEnabled())
+        {
+            calibrate();
+        }
+    }
+
+    LveGpuProfiler::~LveGpuProfiler()
+    {
+        for (auto &frame : frames)
+        {
+            device.disp.destroyQueryPool(device.device(), frame.queryPool, nullptr);
+        }
+    }
+
+    void LveGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        if (!supported)
+        {
+            return;
+        }
+
+        currentFrame = frameIndex;
+        auto &frame = frames[currentFrame];
+        collectResults(frame);
+
+        device.disp.cmdResetQueryPool(commandBuffer, frame.queryPool, 0, MAX_SCOPES * 2);
+        frame.scopes.clear();
+        frame.queryCount = 0;
+    }
+
+    uint32_t LveGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char *name)
+    {
+        if (!supported)
+        {
+            return 0;
+        }
+
+        auto &frame = frames[currentFrame];
+        if (frame.scopes.size() >= MAX_SCOPES)
+        {
+            spdlog::warn("LveGpuProfiler: Scope limit reached, dropping '{}'", name);
+            return MAX_SCOPES;
+        }
+
+        uint32_t scope = static_cast<uint32_t>(frame.scopes.size());
+        frame.scopes.push_back({name, frame.queryCount});
+        device.disp.cmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.queryPool, frame.queryCount);
+        frame.queryCount += 2;
+
+        return scope;
+    }
+
+    void LveGpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+    {
+        if (!supported || scope >= MAX_SCOPES)
+        {
+            return;
+        }
+
+        auto &frame = frames[currentFrame];
+        device.disp.cmdWriteTimestamp(
+            commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.scopes[scope].beginQuery + 1);
+    }
+
+    void LveGpuProfiler::collectResults(FrameQueries &frame)
+    {
+        if (frame.queryCount == 0)
+        {
+            return;
+        }
+
+        // Each query yields a value followed by its availability word
+        device.disp.getQueryPoolResults(
+            device.device(),
+            frame.queryPool,
+            0,
+            frame.queryCount,
+            frame.queryCount * 2 * sizeof(uint64_t),
+            resultBuffer.data(),
+            2 * sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        // Recalibrate regularly to follow drift between the two clocks when it is cheap to do so
+        bool traceEnabled = LveTrace::isEnabled();
+        if (traceEnabled && (!calibrated || (device.hasCalibratedTimestamps() && ++collectsSinceCalibration >= 1000)))
+        {
+            calibrate();
+        }
+
+        for (const auto &scope : frame.scopes)
+        {
+            const uint64_t *begin = &resultBuffer[scope.beginQuery * 2];
+            const uint64_t *end = &resultBuffer[(scope.beginQuery + 1) * 2];
+            if (begin[1] == 0 || end[1] == 0)
+            {
+                continue;
+            }
+
+            uint64_t ticks = (end[0] - begin[0]) & timestampMask;
+            addSample(scope.name, static_cast<double>(ticks) * timestampPeriodNs * 1e-6);
+
+            if (traceEnabled)
+            {
+                uint64_t beginNs = ticksToHostNs(begin[0]);
+                LveTrace::addGpuEvent(scope.name, beginNs, beginNs + static_cast<uint64_t>(ticks * timestampPeriodNs));
+            }
+        }
+    }
+
+    void LveGpuProfiler::calibrate()
+    {
+        collectsSinceCalibration = 0;
+        if (device.getCalibratedTimestamps(calibrationTicks, calibrationHostNs))
+        {
+            calibrated = true;
+            return;
+        }
+        if (calibrated)
+        {
+            return;
+        }
+
+        // Without VK_EXT_calibrated_timestamps, time a one-off timestamp write once and take the
+        // midpoint of the host interval around it. Off by roughly the submit latency.
+        VkQueryPoolCreateInfo queryPoolCi{};
+        queryPoolCi.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCi.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolCi.queryCount = 1;
+
+        VkQueryPool queryPool{};
+        if (device.disp.createQueryPool(device.device(), &queryPoolCi, nullptr, &queryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Vulkan: Failed to create timestamp query pool");
+        }
+
+        VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+        device.disp.cmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+        device.disp.cmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+        uint64_t submitNs = LveTrace::nowNs();
+        device.endSingleTimeCommands(commandBuffer);
+        uint64_t completeNs = LveTrace::nowNs();
+
+        device.disp.getQueryPoolResults(
+            device.device(),
+            queryPool,
+            0,
+            1,
+            sizeof(uint64_t),
+            &calibrationTicks,
+            sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        device.disp.destroyQueryPool(device.device(), queryPool, nullptr);
+
+        calibrationHostNs = submitNs + (completeNs - submitNs) / 2;
+        calibrated = true;
+        spdlog::warn("LveGpuProfiler: VK_EXT_calibrated_timestamps unavailable, GPU trace alignment is approximate");
+    }
+
+    uint64_t LveGpuProfiler::ticksToHostNs(uint64_t ticks) const
+    {
+        int64_t deltaTicks = static_cast<int64_t>(ticks - calibrationTicks);
+        return calibrationHostNs + static_cast<int64_t>(static_cast<double>(deltaTicks) * timestampPeriodNs);
+    }
+
+    void LveGpuProfiler::addSample(const char *name, double ms)
+    {
+        auto it = statsIndex.find(std::string_view(name));
+        if (it == statsIndex.end())
+        {
+            it = statsIndex.emplace(name, stats.size()).first;
+            stats.push_back({});
+            stats.back().name = name;
+        }
+
+        auto &scope = stats[it->second];
+        scope.history[scope.sampleCount % HISTORY_SIZE] = ms;
+        scope.sampleCount++;
+        scope.lastMs = ms;
+
+        size_t window = static_cast<size_t>(std::min<uint64_t>(scope.sampleCount, HISTORY_SIZE));
+        auto [minIt, maxIt] = std::minmax_element(scope.history.begin(), scope.history.begin() + window);
+        double sum = 0.0;
+        for (size_t i = 0; i < window; i++)
+        {
+            sum += scope.history[i];
+        }
+
+        scope.minMs = *minIt;
+        scope.maxMs = *maxIt;
+        scope.avgMs = sum / static_cast<double>(window);
+    }
+
+    void LveGpuProfiler::logStats() const
+    {
+        for (const auto &scope : stats)
+        {
+            spdlog::info("GPU {}: last {:.3f} ms, avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms",
+                         scope.name, scope.lastMs, scope.avgMs, scope.minMs, scope.maxMs);
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    // GPU timestamp profiler with one query pool per frame in flight.
+    // Results of a frame slot are read back the next time that slot is begun,
+    // after its fence has been waited on, so reading never stalls the CPU.
+    class LveGpuProfiler
+    {
+    public:
+        static constexpr uint32_t MAX_SCOPES = 32;
+        static constexpr uint32_t HISTORY_SIZE = 120;
+
+        struct ScopeStats
+        {
+            std::string name;
+            double lastMs{};
+            double avgMs{};
+            double minMs{};
+            double maxMs{};
+            uint64_t sampleCount{};
+            std::array<double, HISTORY_SIZE> history{};
+        };
+
+        LveGpuProfiler(LveDevice &device, uint32_t framesInFlight);
+        ~LveGpuProfiler();
+        LveGpuProfiler(const LveGpuProfiler &) = delete;
+        LveGpuProfiler &operator=(const LveGpuProfiler &) = delete;
+
+        // Collects the previous results of this frame slot and resets its queries.
+        // Must be recorded outside of a render pass.
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        // Scopes are told apart by the text of name, the statistics keep a copy of it. name must stay
+        // valid until this frame's results are collected, and while tracing until the trace is written.
+        uint32_t beginScope(VkCommandBuffer commandBuffer, const char *name);
+        void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+        bool isSupported() const { return supported; }
+        const std::vector<ScopeStats> &getStats() const { return stats; }
+        void logStats() const;
+
+    private:
+        struct FrameScope
+        {
+            const char *name;
+            uint32_t beginQuery;
+        };
+        struct FrameQueries
+        {
+            VkQueryPool queryPool{};
+            std::vector<FrameScope> scopes{};
+            uint32_t queryCount{};
+        };
+
+        void collectResults(FrameQueries &frame);
+        void addSample(const char *name, double ms);
+        // Maps device ticks onto LveTrace's host timeline
+        void calibrate();
+        uint64_t ticksToHostNs(uint64_t ticks) const;
+
+        LveDevice &device;
+        bool supported{};
+        double timestampPeriodNs{};
+        uint64_t timestampMask{};
+        uint32_t currentFrame{};
+        std::vector<FrameQueries> frames{};
+        std::vector<ScopeStats> stats{};
+        // Hashes string views too, so looking up a sample's scope never builds a string
+        struct NameHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+        };
+        std::unordered_map<std::string, size_t, NameHash, std::equal_to<>> statsIndex{};
+        std::vector<uint64_t> resultBuffer{};
+        bool calibrated{};
+        uint64_t calibrationTicks{};
+        uint64_t calibrationHostNs{};
+        uint32_t collectsSinceCalibration{};
+    };
+}
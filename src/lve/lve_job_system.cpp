@@ -0,0 +1,426 @@
+#include "lve_job_system.hpp"
+#include "lve_trace.hpp"
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace lve
+{
+    static thread_local const LveJobSystem *currentSystem = nullptr;
+    static thread_local uint32_t currentWorkerIndex = UINT32_MAX;
+    // Rotates the first steal victim so thieves spread over the deques
+    static thread_local uint32_t nextVictim = 0;
+
+    static void logDetachedException(std::exception_ptr exception)
+    {
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::error("LveJobSystem: Detached job threw: {}", e.what());
+        }
+        catch (...)
+        {
+            spdlog::error("LveJobSystem: Detached job threw");
+        }
+    }
+
+    bool LveJobSystem::Deque::push(Task *task)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= static_cast<int64_t>(DEQUE_CAPACITY))
+        {
+            return false;
+        }
+        tasks[b & (DEQUE_CAPACITY - 1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    LveJobSystem::Task *LveJobSystem::Deque::pop()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task *task = tasks[b & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last task, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    LveJobSystem::Task *LveJobSystem::Deque::steal()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return nullptr;
+        }
+
+        Task *task = tasks[t & (DEQUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return task;
+    }
+
+    LveJobSystem::LveJobSystem(uint32_t workerCount)
+    {
+        if (workerCount == 0)
+        {
+            workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        deques.reserve(workerCount);
+        for (uint32_t worker = 0; worker < workerCount; worker++)
+        {
+            deques.push_back(std::make_unique<Deque>());
+        }
+        workers.reserve(workerCount);
+        for (uint32_t worker = 0; worker < workerCount; worker++)
+        {
+            workers.emplace_back(&LveJobSystem::workerLoop, this, worker);
+        }
+    }
+
+    LveJobSystem::~LveJobSystem()
+    {
+        stopping.store(true);
+        {
+            std::lock_guard lock{sleepMutex};
+            wakeCondition.notify_all();
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+
+        // Jobs nobody waited for are dropped
+        for (auto &deque : deques)
+        {
+            while (Task *task = deque->steal())
+            {
+                delete task;
+            }
+        }
+        for (Task *task : externalTasks)
+        {
+            delete task;
+        }
+    }
+
+    LveJobSystem &LveJobSystem::get()
+    {
+        static LveJobSystem jobSystem{};
+        return jobSystem;
+    }
+
+    uint32_t LveJobSystem::currentWorker() const
+    {
+        return currentSystem == this ? currentWorkerIndex : NO_WORKER;
+    }
+
+    void LveJobSystem::run(Job job, LveJobCounter &counter)
+    {
+        counter.pending.fetch_add(1, std::memory_order_relaxed);
+        push(new Task{std::move(job), &counter});
+    }
+
+    void LveJobSystem::run(Job job)
+    {
+        push(new Task{std::move(job), nullptr});
+    }
+
+    void LveJobSystem::push(Task *task)
+    {
+        // Counted before it becomes visible, so taking it never sees the count at zero
+        queuedCount.fetch_add(1);
+
+        uint32_t worker = currentWorker();
+        if (worker != NO_WORKER)
+        {
+            if (!deques[worker]->push(task))
+            {
+                queuedCount.fetch_sub(1);
+                execute(task);
+                return;
+            }
+        }
+        else
+        {
+            std::lock_guard lock{externalMutex};
+            externalTasks.push_back(task);
+            externalCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (sleepingCount.load() > 0)
+        {
+            std::lock_guard lock{sleepMutex};
+            wakeCondition.notify_one();
+        }
+    }
+
+    LveJobSystem::Task *LveJobSystem::findTask(uint32_t worker)
+    {
+        if (worker != NO_WORKER)
+        {
+            if (Task *task = deques[worker]->pop())
+            {
+                queuedCount.fetch_sub(1);
+                return task;
+            }
+        }
+
+        if (externalCount.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard lock{externalMutex};
+            if (!externalTasks.empty())
+            {
+                Task *task = externalTasks.front();
+                externalTasks.pop_front();
+                externalCount.fetch_sub(1, std::memory_order_relaxed);
+                queuedCount.fetch_sub(1);
+                return task;
+            }
+        }
+
+        uint32_t dequeCount = static_cast<uint32_t>(deques.size());
+        uint32_t first = nextVictim++;
+        for (uint32_t i = 0; i < dequeCount; i++)
+        {
+            uint32_t victim = (first + i) % dequeCount;
+            if (victim == worker)
+            {
+                continue;
+            }
+            if (Task *task = deques[victim]->steal())
+            {
+                queuedCount.fetch_sub(1);
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    void LveJobSystem::execute(Task *task)
+    {
+        LveJobCounter *counter = task->counter;
+        try
+        {
+            task->job();
+        }
+        catch (...)
+        {
+            if (counter)
+            {
+                // Published to wait() by the release below
+                if (!counter->failed.exchange(true, std::memory_order_relaxed))
+                {
+                    counter->exception = std::current_exception();
+                }
+            }
+            else
+            {
+                logDetachedException(std::current_exception());
+            }
+        }
+        delete task;
+        if (counter)
+        {
+            counter->pending.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    void LveJobSystem::wait(LveJobCounter &counter)
+    {
+        uint32_t worker = currentWorker();
+        while (!counter.isDone())
+        {
+            if (Task *task = findTask(worker))
+            {
+                execute(task);
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (counter.failed.load(std::memory_order_relaxed))
+        {
+            // The counter can be reused once its failure is reported
+            std::exception_ptr exception = std::move(counter.exception);
+            counter.exception = nullptr;
+            counter.failed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(exception);
+        }
+    }
+
+    void LveJobSystem::workerLoop(uint32_t worker)
+    {
+        currentSystem = this;
+        currentWorkerIndex = worker;
+        LveTrace::setThreadName(("Job worker " + std::to_string(worker)).c_str());
+
+        uint32_t idleCount = 0;
+        while (true)
+        {
+            if (Task *task = findTask(worker))
+            {
+                execute(task);
+                idleCount = 0;
+                continue;
+            }
+            if (stopping.load())
+            {
+                break;
+            }
+            if (++idleCount < SPIN_COUNT)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock lock{sleepMutex};
+            sleepingCount.fetch_add(1);
+            wakeCondition.wait(lock, [this]()
+                               { return queuedCount.load() > 0 || stopping.load(); });
+            sleepingCount.fetch_sub(1);
+            idleCount = 0;
+        }
+    }
+
+    void LveJobSystem::benchmark(uint32_t jobCount)
+    {
+        auto elapsedMs = [](auto start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        auto bestOf = [](auto &&run)
+        {
+            double bestMs = std::numeric_limits<double>::max();
+            for (int repeat = 0; repeat < 5; repeat++)
+            {
+                bestMs = std::min(bestMs, run());
+            }
+            return bestMs;
+        };
+
+        LveJobSystem &jobSystem = get();
+
+        // Empty jobs, submitted from outside the pool and spawned by a job on a worker
+        double externalMs = bestOf([&]()
+                                   {
+                                       auto start = std::chrono::steady_clock::now();
+                                       LveJobCounter counter{};
+                                       for (uint32_t i = 0; i < jobCount; i++)
+                                       {
+                                           jobSystem.run([]() {}, counter);
+                                       }
+                                       jobSystem.wait(counter);
+                                       return elapsedMs(start);
+                                   });
+        double workerMs = bestOf([&]()
+                                 {
+                                     auto start = std::chrono::steady_clock::now();
+                                     LveJobCounter rootCounter{};
+                                     jobSystem.run([&]()
+                                                   {
+                                                       LveJobCounter counter{};
+                                                       for (uint32_t i = 0; i < jobCount; i++)
+                                                       {
+                                                           jobSystem.run([]() {}, counter);
+                                                       }
+                                                       jobSystem.wait(counter);
+                                                   },
+                                                   rootCounter);
+                                     jobSystem.wait(rootCounter);
+                                     return elapsedMs(start);
+                                 });
+
+        // What the engine did before, a thread per parallel task
+        uint32_t spawnCount = std::min(jobCount, 1000u);
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < spawnCount; i++)
+        {
+            std::thread([]() {}).join();
+        }
+        double threadMs = elapsedMs(start);
+
+        spdlog::info("Job system benchmark, {} jobs on {} threads: external submit {:.1f} ns/job, "
+                     "worker spawn {:.1f} ns/job, std::thread {:.1f} ns/thread",
+                     jobCount, jobSystem.getThreadCount(),
+                     externalMs * 1e6 / jobCount, workerMs * 1e6 / jobCount, threadMs * 1e6 / spawnCount);
+
+        // parallelFor scaling over a compute bound loop, from one thread to every hardware thread
+        const uint32_t elementCount = 1u << 22;
+        std::vector<float> values(elementCount);
+        auto kernel = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                float x = static_cast<float>(i);
+                values[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+            }
+        };
+
+        uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        double singleMs = 0.0;
+        for (uint32_t threads = 1;; threads = std::min(threads * 2, hardwareThreads))
+        {
+            // Zero workers would size the pool to the machine, the single thread baseline runs directly
+            std::unique_ptr<LveJobSystem> pool{};
+            if (threads > 1)
+            {
+                pool = std::make_unique<LveJobSystem>(threads - 1);
+            }
+            double ms = bestOf([&]()
+                               {
+                                   auto begin = std::chrono::steady_clock::now();
+                                   if (pool)
+                                   {
+                                       pool->parallelFor(elementCount, 4096, kernel);
+                                   }
+                                   else
+                                   {
+                                       kernel(0, elementCount);
+                                   }
+                                   return elapsedMs(begin);
+                               });
+            if (threads == 1)
+            {
+                singleMs = ms;
+            }
+            spdlog::info("Job system parallelFor, {} elements on {} threads: {:.2f} ms ({:.2f}x)",
+                         elementCount, threads, ms, singleMs / ms);
+            if (threads == hardwareThreads)
+            {
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lve
+{
+    // Counts the unfinished jobs started with it, LveJobSystem::wait joins them and rethrows the
+    // first exception one of them threw
+    class LveJobCounter
+    {
+    public:
+        bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        friend class LveJobSystem;
+        std::atomic<uint32_t> pending{};
+        // Set by the first job to throw, exception is only read once pending has reached zero
+        std::atomic<bool> failed{};
+        std::exception_ptr exception{};
+    };
+
+    // Fixed pool of worker threads, each owning a Chase-Lev work-stealing deque. Workers run their
+    // own jobs newest first and steal the oldest jobs of others when they run dry. Threads outside
+    // the pool submit through a shared locked queue. A thread waiting on a counter runs jobs
+    // instead of blocking, so jobs may start and wait on other jobs.
+    class LveJobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+
+        // Power of two, a worker runs a job inline when its deque is full
+        static constexpr uint32_t DEQUE_CAPACITY = 4096;
+        // Idle workers spin this many times looking for work before they sleep
+        static constexpr uint32_t SPIN_COUNT = 64;
+
+        // workerCount 0 starts one worker per hardware thread besides the calling thread, but at
+        // least one so detached jobs always make progress
+        explicit LveJobSystem(uint32_t workerCount = 0);
+        ~LveJobSystem();
+
+        LveJobSystem(const LveJobSystem &) = delete;
+        LveJobSystem &operator=(const LveJobSystem &) = delete;
+
+        // Process wide pool shared by culling, sorting, transforms and the ECS, started on first use
+        static LveJobSystem &get();
+
+        // A job that throws still counts as finished, its exception is rethrown by wait
+        void run(Job job, LveJobCounter &counter);
+        // Detached, nothing waits for the job. Used to resume coroutines on a worker. An exception
+        // it throws is logged and dropped.
+        void run(Job job);
+        // Runs queued jobs on the calling thread until the counter reaches zero, then rethrows the
+        // first exception of its jobs
+        void wait(LveJobCounter &counter);
+
+        // function(begin, end) over [0, count) in ranges of at least grainSize, a few per thread.
+        // Returns once every range has run, the calling thread runs the first range itself.
+        template <typename Function>
+        void parallelFor(uint32_t count, uint32_t grainSize, Function &&function)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+            uint32_t rangeCount = std::max(1u, getThreadCount() * 4);
+            uint32_t rangeSize = std::max({1u, grainSize, (count + rangeCount - 1) / rangeCount});
+            if (rangeSize >= count)
+            {
+                function(0u, count);
+                return;
+            }
+
+            LveJobCounter counter{};
+            for (uint32_t begin = rangeSize; begin < count; begin += rangeSize)
+            {
+                uint32_t end = std::min(count, begin + rangeSize);
+                run([&function, begin, end]()
+                    { function(begin, end); },
+                    counter);
+            }
+            // The other ranges refer to function and counter, they must finish even if this one throws
+            std::exception_ptr exception{};
+            try
+            {
+                function(0u, rangeSize);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+            wait(counter);
+            if (exception)
+            {
+                std::rethrow_exception(exception);
+            }
+        }
+
+        // Workers plus the thread that waits
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+        // Logs the scheduling overhead per job and parallelFor scaling from one thread to all of them
+        static void benchmark(uint32_t jobCount);
+
+    private:
+        static constexpr uint32_t NO_WORKER = UINT32_MAX;
+
+        struct Task
+        {
+            Job job;
+            // nullptr for detached jobs
+            LveJobCounter *counter;
+        };
+
+        // Lock-free single-owner deque (Chase-Lev, with the C11 orderings of Le et al.). Only the
+        // owner pushes and pops at the bottom, any thread steals from the top.
+        class Deque
+        {
+        public:
+            bool push(Task *task);
+            Task *pop();
+            Task *steal();
+
+        private:
+            alignas(64) std::atomic<int64_t> top{};
+            alignas(64) std::atomic<int64_t> bottom{};
+            std::unique_ptr<std::atomic<Task *>[]> tasks{new std::atomic<Task *>[DEQUE_CAPACITY]};
+        };
+
+        uint32_t currentWorker() const;
+        void push(Task *task);
+        Task *findTask(uint32_t worker);
+        void execute(Task *task);
+        void workerLoop(uint32_t worker);
+
+        std::vector<std::unique_ptr<Deque>> deques{};
+        std::vector<std::thread> workers{};
+
+        std::mutex externalMutex{};
+        std::deque<Task *> externalTasks{};
+        std::atomic<uint32_t> externalCount{};
+
+        // Tasks pushed but not yet taken, idle workers sleep while it is zero
+        std::atomic<uint32_t> queuedCount{};
+        std::atomic<uint32_t> sleepingCount{};
+        std::mutex sleepMutex{};
+        std::condition_variable wakeCondition{};
+        std::atomic<bool> stopping{};
+    };
+}
@@ -0,0 +1,107 @@
+#include "lve_mapped_file.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lve
+{
+#ifdef _WIN32
+    LveMappedFile::LveMappedFile(const std::string &path)
+    {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            file = nullptr;
+            throw std::runtime_error("LveMappedFile: Failed to open " + path);
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize))
+        {
+            CloseHandle(file);
+            throw std::runtime_error("LveMappedFile: Failed to query size of " + path);
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        // Empty files cannot be mapped, they stay without data
+        if (size == 0)
+        {
+            return;
+        }
+
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+        {
+            data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!data)
+        {
+            if (mapping)
+            {
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+            throw std::runtime_error("LveMappedFile: Failed to map " + path);
+        }
+    }
+
+    LveMappedFile::~LveMappedFile()
+    {
+        if (data)
+        {
+            UnmapViewOfFile(data);
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#else
+    LveMappedFile::LveMappedFile(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("LveMappedFile: Failed to open " + path);
+        }
+
+        struct stat status{};
+        if (fstat(fd, &status) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("LveMappedFile: Failed to query size of " + path);
+        }
+        size = static_cast<size_t>(status.st_size);
+        // Empty files cannot be mapped, they stay without data
+        if (size == 0)
+        {
+            close(fd);
+            return;
+        }
+
+        // The mapping keeps its own reference to the file
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            throw std::runtime_error("LveMappedFile: Failed to map " + path);
+        }
+        data = static_cast<const std::byte *>(mapped);
+    }
+
+    LveMappedFile::~LveMappedFile()
+    {
+        if (data)
+        {
+            munmap(const_cast<std::byte *>(data), size);
+        }
+    }
+#endif
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace lve
+{
+    // Read-only mapping of a whole file. Pages are read in by the OS on first access, so only the
+    // parts actually touched cost I/O.
+    class LveMappedFile
+    {
+    public:
+        explicit LveMappedFile(const std::string &path);
+        ~LveMappedFile();
+
+        LveMappedFile(const LveMappedFile &) = delete;
+        LveMappedFile &operator=(const LveMappedFile &) = delete;
+
+        const std::byte *getData() const { return data; }
+        size_t getSize() const { return size; }
+
+    private:
+        const std::byte *data{};
+        size_t size{};
+#ifdef _WIN32
+        void *file{};
+        void *mapping{};
+#endif
+    };
+}
@@ -0,0 +1,814 @@
+#include "lve_mesh_codec.hpp"
+#include "lve_benchmark.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+// SSE2 is part of x86-64 and NEON of AArch64, neither needs a runtime check
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_CODEC_SSE2 1
+#include <emmintrin.h>
+// The NEON decoder has not been compiled or run on AArch64 yet, ARM builds use the scalar one
+// unless LVE_CODEC_ENABLE_NEON is defined
+#elif defined(LVE_CODEC_ENABLE_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define LVE_CODEC_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace lve
+{
+    static constexpr uint8_t VERTEX_FORMAT = 0xA1;
+    static constexpr uint8_t INDEX_FORMAT = 0xB2;
+
+    namespace
+    {
+        constexpr uint32_t GROUP_SIZE = 16;
+        // Payload bytes of a group for each 2-bit header code: 0, 2, 4 and 8 bits per delta
+        constexpr size_t GROUP_PAYLOAD[4] = {0, 4, 8, 16};
+
+        // Payload bytes of the four groups behind one header byte
+        constexpr auto HEADER_PAYLOAD = []()
+        {
+            std::array<uint8_t, 256> payload{};
+            for (uint32_t header = 0; header < 256; header++)
+            {
+                for (uint32_t g = 0; g < 4; g++)
+                {
+                    payload[header] = static_cast<uint8_t>(payload[header] + GROUP_PAYLOAD[(header >> (2 * g)) & 3]);
+                }
+            }
+            return payload;
+        }();
+
+        // Edges coded 0 to 14 from the newest, 15 starts a triangle without a shared edge
+        constexpr uint32_t EDGE_FIFO_SIZE = 16;
+        constexpr uint8_t NO_EDGE = 15;
+        // Vertices coded 1 to 14 from the newest, 0 is the next unseen vertex, 15 a delta follows
+        constexpr uint32_t VERTEX_FIFO_SIZE = 16;
+        constexpr uint8_t NEXT_VERTEX = 0;
+        constexpr uint8_t EXPLICIT_VERTEX = 15;
+
+        void checkVertexSize(uint32_t vertexSize)
+        {
+            if (vertexSize == 0 || vertexSize % 4 != 0 || vertexSize > LveMeshCodec::MAX_VERTEX_SIZE)
+            {
+                throw std::runtime_error("LveMeshCodec: Vertex size must be a multiple of 4 up to 64");
+            }
+        }
+
+        void need(const uint8_t *p, const uint8_t *end, size_t size)
+        {
+            if (static_cast<size_t>(end - p) < size)
+            {
+                throw std::runtime_error("LveMeshCodec: Truncated data");
+            }
+        }
+
+        uint8_t zigzag(uint8_t delta)
+        {
+            return static_cast<uint8_t>((delta << 1) ^ static_cast<uint8_t>(static_cast<int8_t>(delta) >> 7));
+        }
+
+        uint8_t unzigzag(uint8_t value)
+        {
+            return static_cast<uint8_t>((value >> 1) ^ (0u - (value & 1u)));
+        }
+
+        // Skips the group codes of a lane and checks its whole payload is there, so the groups
+        // are decoded without bounds checks. Codes past the last group are 0.
+        const uint8_t *readLaneHeader(const uint8_t *&p, const uint8_t *end, uint32_t groupCount)
+        {
+            const uint8_t *header = p;
+            size_t headerSize = (groupCount + 3) / 4;
+            need(p, end, headerSize);
+            p += headerSize;
+            size_t payloadSize = 0;
+            for (size_t i = 0; i < headerSize; i++)
+            {
+                payloadSize += HEADER_PAYLOAD[header[i]];
+            }
+            need(p, end, payloadSize);
+            return header;
+        }
+
+        // Unpacks, unzigzags and prefix sums one byte of the vertex for a block, starting from
+        // the value of the previous vertex. values has room for whole groups.
+        const uint8_t *decodeLaneScalar(const uint8_t *p, const uint8_t *end, uint32_t groupCount, uint8_t last, uint8_t *values)
+        {
+            const uint8_t *header = readLaneHeader(p, end, groupCount);
+
+            for (uint32_t g = 0; g < groupCount; g++)
+            {
+                uint32_t code = (header[g / 4] >> (2 * (g % 4))) & 3;
+                uint8_t *group = values + g * GROUP_SIZE;
+                switch (code)
+                {
+                case 0:
+                    std::memset(group, 0, GROUP_SIZE);
+                    break;
+                case 1:
+                    for (uint32_t j = 0; j < 4; j++)
+                    {
+                        group[4 * j] = p[j] >> 6;
+                        group[4 * j + 1] = (p[j] >> 4) & 3;
+                        group[4 * j + 2] = (p[j] >> 2) & 3;
+                        group[4 * j + 3] = p[j] & 3;
+                    }
+                    break;
+                case 2:
+                    for (uint32_t j = 0; j < 8; j++)
+                    {
+                        group[2 * j] = p[j] >> 4;
+                        group[2 * j + 1] = p[j] & 15;
+                    }
+                    break;
+                default:
+                    std::memcpy(group, p, GROUP_SIZE);
+                    break;
+                }
+                p += GROUP_PAYLOAD[code];
+
+                for (uint32_t i = 0; i < GROUP_SIZE; i++)
+                {
+                    last = static_cast<uint8_t>(last + unzigzag(group[i]));
+                    group[i] = last;
+                }
+            }
+            return p;
+        }
+
+        void transposeScalar(const uint8_t (*lanes)[LveMeshCodec::BLOCK_VERTICES], uint32_t count, uint32_t vertexSize,
+                             uint8_t *vertices)
+        {
+            for (uint32_t v = 0; v < count; v++)
+            {
+                for (uint32_t k = 0; k < vertexSize; k++)
+                {
+                    vertices[size_t{v} * vertexSize + k] = lanes[k][v];
+                }
+            }
+        }
+
+#if defined(LVE_CODEC_SSE2)
+        __m128i unpackGroup(uint32_t code, const uint8_t *p)
+        {
+            switch (code)
+            {
+            case 0:
+                return _mm_setzero_si128();
+            case 1:
+            {
+                // Four bytes of four 2-bit values each, the first value in the top bits
+                int32_t packed;
+                std::memcpy(&packed, p, sizeof(packed));
+                __m128i bytes = _mm_cvtsi32_si128(packed);
+                __m128i mask = _mm_set1_epi8(3);
+                __m128i v0 = _mm_and_si128(_mm_srli_epi16(bytes, 6), mask);
+                __m128i v1 = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+                __m128i v2 = _mm_and_si128(_mm_srli_epi16(bytes, 2), mask);
+                __m128i v3 = _mm_and_si128(bytes, mask);
+                return _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+            }
+            case 2:
+            {
+                __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p));
+                __m128i mask = _mm_set1_epi8(15);
+                return _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask), _mm_and_si128(bytes, mask));
+            }
+            default:
+                return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            }
+        }
+
+        const uint8_t *decodeLaneSimd(const uint8_t *p, const uint8_t *end, uint32_t groupCount, uint8_t last, uint8_t *values)
+        {
+            const uint8_t *header = readLaneHeader(p, end, groupCount);
+
+            __m128i one = _mm_set1_epi8(1);
+            __m128i low7 = _mm_set1_epi8(0x7F);
+            __m128i carry = _mm_set1_epi8(static_cast<char>(last));
+            for (uint32_t g = 0; g < groupCount; g++)
+            {
+                uint32_t code = (header[g / 4] >> (2 * (g % 4))) & 3;
+                __m128i value = unpackGroup(code, p);
+                p += GROUP_PAYLOAD[code];
+
+                // Unzigzag, then a prefix sum in four shifted adds
+                value = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(value, 1), low7),
+                                      _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(value, one)));
+                value = _mm_add_epi8(value, _mm_slli_si128(value, 1));
+                value = _mm_add_epi8(value, _mm_slli_si128(value, 2));
+                value = _mm_add_epi8(value, _mm_slli_si128(value, 4));
+                value = _mm_add_epi8(value, _mm_slli_si128(value, 8));
+                value = _mm_add_epi8(value, carry);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(values + g * GROUP_SIZE), value);
+
+                // Broadcast of the last byte without SSSE3
+                carry = _mm_unpackhi_epi8(value, value);
+                carry = _mm_shufflehi_epi16(carry, 0xFF);
+                carry = _mm_shuffle_epi32(carry, 0xFF);
+            }
+            return p;
+        }
+
+        void storeColumns(__m128i columns, uint8_t *vertex, size_t vertexSize)
+        {
+            int32_t column = _mm_cvtsi128_si32(columns);
+            std::memcpy(vertex, &column, sizeof(column));
+            column = _mm_cvtsi128_si32(_mm_shuffle_epi32(columns, 1));
+            std::memcpy(vertex + vertexSize, &column, sizeof(column));
+            column = _mm_cvtsi128_si32(_mm_shuffle_epi32(columns, 2));
+            std::memcpy(vertex + 2 * vertexSize, &column, sizeof(column));
+            column = _mm_cvtsi128_si32(_mm_shuffle_epi32(columns, 3));
+            std::memcpy(vertex + 3 * vertexSize, &column, sizeof(column));
+        }
+
+        // Interleaves four byte lanes into bytes k to k + 3 of up to 16 vertices
+        void transposeGroup(const uint8_t *lane0, const uint8_t *lane1, const uint8_t *lane2, const uint8_t *lane3,
+                            uint32_t count, uint32_t vertexSize, uint8_t *vertex)
+        {
+            __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lane0));
+            __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lane1));
+            __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lane2));
+            __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lane3));
+            __m128i t0 = _mm_unpacklo_epi8(r0, r1);
+            __m128i t1 = _mm_unpackhi_epi8(r0, r1);
+            __m128i t2 = _mm_unpacklo_epi8(r2, r3);
+            __m128i t3 = _mm_unpackhi_epi8(r2, r3);
+            __m128i columns[4] = {_mm_unpacklo_epi16(t0, t2), _mm_unpackhi_epi16(t0, t2),
+                                  _mm_unpacklo_epi16(t1, t3), _mm_unpackhi_epi16(t1, t3)};
+            if (count == GROUP_SIZE)
+            {
+                storeColumns(columns[0], vertex, vertexSize);
+                storeColumns(columns[1], vertex + 4 * size_t{vertexSize}, vertexSize);
+                storeColumns(columns[2], vertex + 8 * size_t{vertexSize}, vertexSize);
+                storeColumns(columns[3], vertex + 12 * size_t{vertexSize}, vertexSize);
+                return;
+            }
+            alignas(16) uint8_t partial[4 * GROUP_SIZE];
+            std::memcpy(partial, columns, sizeof(partial));
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::memcpy(vertex + size_t{i} * vertexSize, partial + 4 * i, 4);
+            }
+        }
+#elif defined(LVE_CODEC_NEON)
+        uint8x16_t unpackGroup(uint32_t code, const uint8_t *p)
+        {
+            switch (code)
+            {
+            case 0:
+                return vdupq_n_u8(0);
+            case 1:
+            {
+                uint32_t packed;
+                std::memcpy(&packed, p, sizeof(packed));
+                uint8x8_t bytes = vreinterpret_u8_u32(vdup_n_u32(packed));
+                uint8x8_t mask = vdup_n_u8(3);
+                uint8x8x2_t v01 = vzip_u8(vshr_n_u8(bytes, 6), vand_u8(vshr_n_u8(bytes, 4), mask));
+                uint8x8x2_t v23 = vzip_u8(vand_u8(vshr_n_u8(bytes, 2), mask), vand_u8(bytes, mask));
+                uint16x4x2_t v = vzip_u16(vreinterpret_u16_u8(v01.val[0]), vreinterpret_u16_u8(v23.val[0]));
+                return vcombine_u8(vreinterpret_u8_u16(v.val[0]), vreinterpret_u8_u16(v.val[1]));
+            }
+            case 2:
+            {
+                uint8x8_t bytes = vld1_u8(p);
+                uint8x8x2_t v = vzip_u8(vshr_n_u8(bytes, 4), vand_u8(bytes, vdup_n_u8(15)));
+                return vcombine_u8(v.val[0], v.val[1]);
+            }
+            default:
+                return vld1q_u8(p);
+            }
+        }
+
+        const uint8_t *decodeLaneSimd(const uint8_t *p, const uint8_t *end, uint32_t groupCount, uint8_t last, uint8_t *values)
+        {
+            const uint8_t *header = readLaneHeader(p, end, groupCount);
+
+            uint8x16_t zero = vdupq_n_u8(0);
+            uint8x16_t carry = vdupq_n_u8(last);
+            for (uint32_t g = 0; g < groupCount; g++)
+            {
+                uint32_t code = (header[g / 4] >> (2 * (g % 4))) & 3;
+                uint8x16_t value = unpackGroup(code, p);
+                p += GROUP_PAYLOAD[code];
+
+                value = veorq_u8(vshrq_n_u8(value, 1), vsubq_u8(zero, vandq_u8(value, vdupq_n_u8(1))));
+                value = vaddq_u8(value, vextq_u8(zero, value, 15));
+                value = vaddq_u8(value, vextq_u8(zero, value, 14));
+                value = vaddq_u8(value, vextq_u8(zero, value, 12));
+                value = vaddq_u8(value, vextq_u8(zero, value, 8));
+                value = vaddq_u8(value, carry);
+                vst1q_u8(values + g * GROUP_SIZE, value);
+                carry = vdupq_laneq_u8(value, 15);
+            }
+            return p;
+        }
+
+        void storeColumns(uint32x4_t columns, uint8_t *vertex, size_t vertexSize)
+        {
+            uint32_t column = vgetq_lane_u32(columns, 0);
+            std::memcpy(vertex, &column, sizeof(column));
+            column = vgetq_lane_u32(columns, 1);
+            std::memcpy(vertex + vertexSize, &column, sizeof(column));
+            column = vgetq_lane_u32(columns, 2);
+            std::memcpy(vertex + 2 * vertexSize, &column, sizeof(column));
+            column = vgetq_lane_u32(columns, 3);
+            std::memcpy(vertex + 3 * vertexSize, &column, sizeof(column));
+        }
+
+        void transposeGroup(const uint8_t *lane0, const uint8_t *lane1, const uint8_t *lane2, const uint8_t *lane3,
+                            uint32_t count, uint32_t vertexSize, uint8_t *vertex)
+        {
+            uint8x16x2_t t01 = vzipq_u8(vld1q_u8(lane0), vld1q_u8(lane1));
+            uint8x16x2_t t23 = vzipq_u8(vld1q_u8(lane2), vld1q_u8(lane3));
+            uint16x8x2_t low = vzipq_u16(vreinterpretq_u16_u8(t01.val[0]), vreinterpretq_u16_u8(t23.val[0]));
+            uint16x8x2_t high = vzipq_u16(vreinterpretq_u16_u8(t01.val[1]), vreinterpretq_u16_u8(t23.val[1]));
+            uint32x4_t columns[4] = {vreinterpretq_u32_u16(low.val[0]), vreinterpretq_u32_u16(low.val[1]),
+                                     vreinterpretq_u32_u16(high.val[0]), vreinterpretq_u32_u16(high.val[1])};
+            if (count == GROUP_SIZE)
+            {
+                storeColumns(columns[0], vertex, vertexSize);
+                storeColumns(columns[1], vertex + 4 * size_t{vertexSize}, vertexSize);
+                storeColumns(columns[2], vertex + 8 * size_t{vertexSize}, vertexSize);
+                storeColumns(columns[3], vertex + 12 * size_t{vertexSize}, vertexSize);
+                return;
+            }
+            alignas(16) uint8_t partial[4 * GROUP_SIZE];
+            std::memcpy(partial, columns, sizeof(partial));
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::memcpy(vertex + size_t{i} * vertexSize, partial + 4 * i, 4);
+            }
+        }
+#endif
+
+#if defined(LVE_CODEC_SSE2) || defined(LVE_CODEC_NEON)
+        constexpr bool HAS_SIMD = true;
+
+        void transposeSimd(const uint8_t (*lanes)[LveMeshCodec::BLOCK_VERTICES], uint32_t count, uint32_t vertexSize,
+                           uint8_t *vertices)
+        {
+            for (uint32_t k = 0; k < vertexSize; k += 4)
+            {
+                for (uint32_t first = 0; first < count; first += GROUP_SIZE)
+                {
+                    transposeGroup(lanes[k] + first, lanes[k + 1] + first, lanes[k + 2] + first, lanes[k + 3] + first,
+                                   std::min(GROUP_SIZE, count - first), vertexSize, vertices + size_t{first} * vertexSize + k);
+                }
+            }
+        }
+#else
+        constexpr bool HAS_SIMD = false;
+#endif
+
+        template <bool Simd>
+        void decodeVertexData(uint8_t *vertices, uint32_t vertexCount, uint32_t vertexSize, std::span<const std::byte> data)
+        {
+            checkVertexSize(vertexSize);
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data());
+            const uint8_t *end = p + data.size();
+            need(p, end, 1);
+            if (*p++ != VERTEX_FORMAT)
+            {
+                throw std::runtime_error("LveMeshCodec: Unknown vertex format");
+            }
+
+            alignas(16) uint8_t lanes[LveMeshCodec::MAX_VERTEX_SIZE][LveMeshCodec::BLOCK_VERTICES];
+            uint8_t last[LveMeshCodec::MAX_VERTEX_SIZE]{};
+            for (uint32_t first = 0; first < vertexCount; first += LveMeshCodec::BLOCK_VERTICES)
+            {
+                uint32_t count = std::min(LveMeshCodec::BLOCK_VERTICES, vertexCount - first);
+                uint32_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+                for (uint32_t k = 0; k < vertexSize; k++)
+                {
+#if defined(LVE_CODEC_SSE2) || defined(LVE_CODEC_NEON)
+                    if constexpr (Simd)
+                    {
+                        p = decodeLaneSimd(p, end, groupCount, last[k], lanes[k]);
+                    }
+                    else
+#endif
+                    {
+                        p = decodeLaneScalar(p, end, groupCount, last[k], lanes[k]);
+                    }
+                    last[k] = lanes[k][count - 1];
+                }
+#if defined(LVE_CODEC_SSE2) || defined(LVE_CODEC_NEON)
+                if constexpr (Simd)
+                {
+                    transposeSimd(lanes, count, vertexSize, vertices + size_t{first} * vertexSize);
+                }
+                else
+#endif
+                {
+                    transposeScalar(lanes, count, vertexSize, vertices + size_t{first} * vertexSize);
+                }
+            }
+            if (p != end)
+            {
+                throw std::runtime_error("LveMeshCodec: Trailing vertex data");
+            }
+        }
+
+        // Both FIFOs start filled with UINT32_MAX, which decoding rejects as a vertex
+        struct TriangleFifos
+        {
+            uint32_t edges[EDGE_FIFO_SIZE][2];
+            uint32_t edgeHead{};
+            uint32_t vertices[VERTEX_FIFO_SIZE];
+            uint32_t vertexHead{};
+            uint32_t next{};
+            uint32_t last{};
+
+            TriangleFifos()
+            {
+                std::fill(&edges[0][0], &edges[0][0] + 2 * EDGE_FIFO_SIZE, UINT32_MAX);
+                std::fill(vertices, vertices + VERTEX_FIFO_SIZE, UINT32_MAX);
+            }
+
+            // Entry 0 is the newest
+            const uint32_t *edge(uint32_t i) const { return edges[(edgeHead - i) % EDGE_FIFO_SIZE]; }
+            uint32_t vertex(uint32_t i) const { return vertices[(vertexHead - i) % VERTEX_FIFO_SIZE]; }
+
+            void pushEdge(uint32_t a, uint32_t b)
+            {
+                edgeHead = (edgeHead + 1) % EDGE_FIFO_SIZE;
+                edges[edgeHead][0] = a;
+                edges[edgeHead][1] = b;
+            }
+
+            void pushVertex(uint32_t v)
+            {
+                vertexHead = (vertexHead + 1) % VERTEX_FIFO_SIZE;
+                vertices[vertexHead] = v;
+            }
+        };
+
+        uint8_t encodeVertex(TriangleFifos &fifos, uint32_t v, std::vector<uint32_t> &deltas)
+        {
+            if (v == fifos.next)
+            {
+                fifos.next++;
+                fifos.pushVertex(v);
+                return NEXT_VERTEX;
+            }
+            for (uint32_t i = 0; i < EXPLICIT_VERTEX - 1; i++)
+            {
+                if (fifos.vertex(i) == v)
+                {
+                    return static_cast<uint8_t>(i + 1);
+                }
+            }
+            int32_t delta = static_cast<int32_t>(v - fifos.last);
+            deltas.push_back((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31));
+            fifos.last = v;
+            fifos.next = std::max(fifos.next, v + 1);
+            fifos.pushVertex(v);
+            return EXPLICIT_VERTEX;
+        }
+
+        void writeVarint(std::vector<std::byte> &out, uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<std::byte>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<std::byte>(value));
+        }
+
+        uint32_t readVarint(const uint8_t *&p, const uint8_t *end)
+        {
+            uint32_t value = 0;
+            for (uint32_t shift = 0; shift < 35; shift += 7)
+            {
+                need(p, end, 1);
+                uint8_t byte = *p++;
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                if (byte < 0x80)
+                {
+                    return value;
+                }
+            }
+            throw std::runtime_error("LveMeshCodec: Bad index delta");
+        }
+
+        uint32_t decodeVertex(TriangleFifos &fifos, uint8_t code, const uint8_t *&p, const uint8_t *end)
+        {
+            if (code == NEXT_VERTEX)
+            {
+                uint32_t v = fifos.next++;
+                fifos.pushVertex(v);
+                return v;
+            }
+            if (code != EXPLICIT_VERTEX)
+            {
+                return fifos.vertex(code - 1u);
+            }
+            uint32_t zigzagged = readVarint(p, end);
+            uint32_t v = fifos.last + ((zigzagged >> 1) ^ (0u - (zigzagged & 1u)));
+            fifos.last = v;
+            fifos.next = std::max(fifos.next, v + 1);
+            fifos.pushVertex(v);
+            return v;
+        }
+    }
+
+    std::vector<std::byte> LveMeshCodec::encodeVertices(const void *vertices, uint32_t vertexCount, uint32_t vertexSize)
+    {
+        checkVertexSize(vertexSize);
+        const uint8_t *bytes = static_cast<const uint8_t *>(vertices);
+        std::vector<std::byte> out{};
+        out.reserve(1 + size_t{vertexCount} * vertexSize / 2);
+        out.push_back(std::byte{VERTEX_FORMAT});
+
+        uint8_t last[MAX_VERTEX_SIZE]{};
+        uint8_t deltas[BLOCK_VERTICES];
+        for (uint32_t first = 0; first < vertexCount; first += BLOCK_VERTICES)
+        {
+            uint32_t count = std::min(BLOCK_VERTICES, vertexCount - first);
+            uint32_t groupCount = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+            for (uint32_t k = 0; k < vertexSize; k++)
+            {
+                // Zero deltas pad the last group, so decoding carries the right value into the next block
+                uint8_t previous = last[k];
+                for (uint32_t v = 0; v < groupCount * GROUP_SIZE; v++)
+                {
+                    if (v < count)
+                    {
+                        uint8_t value = bytes[size_t{first + v} * vertexSize + k];
+                        deltas[v] = zigzag(static_cast<uint8_t>(value - previous));
+                        previous = value;
+                    }
+                    else
+                    {
+                        deltas[v] = 0;
+                    }
+                }
+                last[k] = previous;
+
+                size_t header = out.size();
+                out.resize(out.size() + (groupCount + 3) / 4);
+                for (uint32_t g = 0; g < groupCount; g++)
+                {
+                    const uint8_t *group = deltas + g * GROUP_SIZE;
+                    uint8_t largest = *std::max_element(group, group + GROUP_SIZE);
+                    uint32_t code = largest == 0 ? 0 : (largest < 4 ? 1 : (largest < 16 ? 2 : 3));
+                    out[header + g / 4] |= static_cast<std::byte>(code << (2 * (g % 4)));
+                    switch (code)
+                    {
+                    case 1:
+                        for (uint32_t j = 0; j < 4; j++)
+                        {
+                            out.push_back(static_cast<std::byte>(group[4 * j] << 6 | group[4 * j + 1] << 4 |
+                                                                 group[4 * j + 2] << 2 | group[4 * j + 3]));
+                        }
+                        break;
+                    case 2:
+                        for (uint32_t j = 0; j < 8; j++)
+                        {
+                            out.push_back(static_cast<std::byte>(group[2 * j] << 4 | group[2 * j + 1]));
+                        }
+                        break;
+                    case 3:
+                        out.insert(out.end(), reinterpret_cast<const std::byte *>(group),
+                                   reinterpret_cast<const std::byte *>(group) + GROUP_SIZE);
+                        break;
+                    }
+                }
+            }
+        }
+        return out;
+    }
+
+    void LveMeshCodec::decodeVertices(void *vertices, uint32_t vertexCount, uint32_t vertexSize, std::span<const std::byte> data)
+    {
+        decodeVertexData<HAS_SIMD>(static_cast<uint8_t *>(vertices), vertexCount, vertexSize, data);
+    }
+
+    std::vector<std::byte> LveMeshCodec::encodeIndices(const uint32_t *indices, uint32_t indexCount)
+    {
+        if (indexCount % 3 != 0)
+        {
+            throw std::runtime_error("LveMeshCodec: Index count must be a multiple of 3");
+        }
+
+        std::vector<std::byte> out{};
+        out.reserve(1 + indexCount / 2);
+        out.push_back(std::byte{INDEX_FORMAT});
+
+        TriangleFifos fifos{};
+        std::vector<uint32_t> deltas{};
+        for (uint32_t t = 0; t < indexCount; t += 3)
+        {
+            const uint32_t *triangle = indices + t;
+            deltas.clear();
+
+            // A rotation of the triangle keeps its winding, try all three against the edge FIFO
+            uint32_t edge = NO_EDGE;
+            uint32_t rotation = 0;
+            for (uint32_t i = 0; i < NO_EDGE && edge == NO_EDGE; i++)
+            {
+                for (uint32_t r = 0; r < 3; r++)
+                {
+                    if (fifos.edge(i)[0] == triangle[r] && fifos.edge(i)[1] == triangle[(r + 1) % 3])
+                    {
+                        edge = i;
+                        rotation = r;
+                        break;
+                    }
+                }
+            }
+
+            if (edge != NO_EDGE)
+            {
+                uint32_t a = triangle[rotation], b = triangle[(rotation + 1) % 3], c = triangle[(rotation + 2) % 3];
+                uint8_t code = encodeVertex(fifos, c, deltas);
+                out.push_back(static_cast<std::byte>(edge << 4 | code));
+                fifos.pushEdge(c, b);
+                fifos.pushEdge(a, c);
+            }
+            else
+            {
+                uint32_t a = triangle[0], b = triangle[1], c = triangle[2];
+                uint8_t codeA = encodeVertex(fifos, a, deltas);
+                uint8_t codeB = encodeVertex(fifos, b, deltas);
+                uint8_t codeC = encodeVertex(fifos, c, deltas);
+                out.push_back(static_cast<std::byte>(NO_EDGE << 4 | codeA));
+                out.push_back(static_cast<std::byte>(codeB << 4 | codeC));
+                fifos.pushEdge(b, a);
+                fifos.pushEdge(c, b);
+                fifos.pushEdge(a, c);
+            }
+            for (uint32_t delta : deltas)
+            {
+                writeVarint(out, delta);
+            }
+        }
+        return out;
+    }
+
+    void LveMeshCodec::decodeIndices(uint32_t *indices, uint32_t indexCount, uint32_t vertexCount, std::span<const std::byte> data)
+    {
+        if (indexCount % 3 != 0)
+        {
+            throw std::runtime_error("LveMeshCodec: Index count must be a multiple of 3");
+        }
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data());
+        const uint8_t *end = p + data.size();
+        need(p, end, 1);
+        if (*p++ != INDEX_FORMAT)
+        {
+            throw std::runtime_error("LveMeshCodec: Unknown index format");
+        }
+
+        TriangleFifos fifos{};
+        for (uint32_t t = 0; t < indexCount; t += 3)
+        {
+            need(p, end, 1);
+            uint8_t code = *p++;
+            uint32_t a, b, c;
+            if (code >> 4 != NO_EDGE)
+            {
+                const uint32_t *edge = fifos.edge(code >> 4);
+                a = edge[0];
+                b = edge[1];
+                c = decodeVertex(fifos, code & 15, p, end);
+                fifos.pushEdge(c, b);
+                fifos.pushEdge(a, c);
+            }
+            else
+            {
+                need(p, end, 1);
+                uint8_t codes = *p++;
+                a = decodeVertex(fifos, code & 15, p, end);
+                b = decodeVertex(fifos, codes >> 4, p, end);
+                c = decodeVertex(fifos, codes & 15, p, end);
+                fifos.pushEdge(b, a);
+                fifos.pushEdge(c, b);
+                fifos.pushEdge(a, c);
+            }
+            // Also catches references to FIFO entries never written
+            if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+            {
+                throw std::runtime_error("LveMeshCodec: Index out of range");
+            }
+            indices[t] = a;
+            indices[t + 1] = b;
+            indices[t + 2] = c;
+        }
+        if (p != end)
+        {
+            throw std::runtime_error("LveMeshCodec: Trailing index data");
+        }
+    }
+
+    const char *LveMeshCodec::simdName()
+    {
+#if defined(LVE_CODEC_SSE2)
+        return "SSE2";
+#elif defined(LVE_CODEC_NEON)
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+
+    void LveMeshCodec::benchmark(uint32_t vertexCount)
+    {
+        // A rolling height field with 16-bit positions and 8-bit normals, the record vp_cook stores
+        struct QuantizedVertex
+        {
+            uint16_t position[3];
+            int8_t normal[3];
+            uint8_t padding[3];
+        };
+        static_assert(sizeof(QuantizedVertex) == 12);
+
+        uint32_t side = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<double>(vertexCount))));
+        vertexCount = side * side;
+        std::vector<QuantizedVertex> vertices(vertexCount);
+        for (uint32_t z = 0; z < side; z++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                float u = static_cast<float>(x) / static_cast<float>(side) * 12.0f;
+                float v = static_cast<float>(z) / static_cast<float>(side) * 12.0f;
+                float height = std::sin(u) * std::cos(v);
+                float dx = std::cos(u) * std::cos(v), dz = -std::sin(u) * std::sin(v);
+                float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+                vertices[z * side + x] = {{static_cast<uint16_t>(x * 65535ull / (side - 1)),
+                                           static_cast<uint16_t>((height * 0.5f + 0.5f) * 65535.0f),
+                                           static_cast<uint16_t>(z * 65535ull / (side - 1))},
+                                          {static_cast<int8_t>(std::lround(-dx / length * 127.0f)),
+                                           static_cast<int8_t>(std::lround(1.0f / length * 127.0f)),
+                                           static_cast<int8_t>(std::lround(-dz / length * 127.0f))},
+                                          {}};
+            }
+        }
+        std::vector<uint32_t> indices{};
+        indices.reserve(size_t{side - 1} * (side - 1) * 6);
+        for (uint32_t z = 0; z + 1 < side; z++)
+        {
+            for (uint32_t x = 0; x + 1 < side; x++)
+            {
+                uint32_t i = z * side + x;
+                indices.insert(indices.end(), {i, i + side, i + 1, i + 1, i + side, i + side + 1});
+            }
+        }
+        uint32_t indexCount = static_cast<uint32_t>(indices.size());
+
+        size_t vertexBytes = vertices.size() * sizeof(QuantizedVertex);
+        size_t indexBytes = indices.size() * sizeof(uint32_t);
+        std::vector<std::byte> encodedVertices = encodeVertices(vertices.data(), vertexCount, sizeof(QuantizedVertex));
+        std::vector<std::byte> encodedIndices = encodeIndices(indices.data(), indexCount);
+        spdlog::info("Mesh codec benchmark, {} vertices, {} triangles: vertices {:.2f}x smaller, indices {:.2f}x smaller",
+                     vertexCount, indexCount / 3, static_cast<double>(vertexBytes) / static_cast<double>(encodedVertices.size()),
+                     static_cast<double>(indexBytes) / static_cast<double>(encodedIndices.size()));
+
+        std::vector<QuantizedVertex> decodedVertices(vertexCount);
+        std::vector<uint32_t> decodedIndices(indexCount);
+        double copyNs = measureBestNs([&]()
+                                      { std::memcpy(decodedVertices.data(), vertices.data(), vertexBytes); });
+        spdlog::info("memcpy of the raw vertices: {:.2f} GB/s", static_cast<double>(vertexBytes) / copyNs);
+
+        double scalarNs = measureBestNs([&]()
+                                        { decodeVertexData<false>(reinterpret_cast<uint8_t *>(decodedVertices.data()), vertexCount,
+                                                                  sizeof(QuantizedVertex), encodedVertices); });
+        spdlog::info("Vertex decode, scalar: {:.2f} GB/s", static_cast<double>(vertexBytes) / scalarNs);
+        if (HAS_SIMD)
+        {
+            double simdNs = measureBestNs([&]()
+                                          { decodeVertexData<true>(reinterpret_cast<uint8_t *>(decodedVertices.data()), vertexCount,
+                                                                   sizeof(QuantizedVertex), encodedVertices); });
+            spdlog::info("Vertex decode, {}: {:.2f} GB/s", simdName(), static_cast<double>(vertexBytes) / simdNs);
+        }
+        if (std::memcmp(decodedVertices.data(), vertices.data(), vertexBytes) != 0)
+        {
+            spdlog::error("Vertex decode does not match the input");
+        }
+
+        double indexNs = measureBestNs([&]()
+                                       { decodeIndices(decodedIndices.data(), indexCount, vertexCount, encodedIndices); });
+        spdlog::info("Index decode: {:.2f} GB/s", static_cast<double>(indexBytes) / indexNs);
+        // Triangles come back rotated but with their winding
+        for (uint32_t t = 0; t < indexCount; t += 3)
+        {
+            const uint32_t *in = indices.data() + t, *out = decodedIndices.data() + t;
+            bool same = false;
+            for (uint32_t r = 0; r < 3; r++)
+            {
+                same |= out[0] == in[r] && out[1] == in[(r + 1) % 3] && out[2] == in[(r + 2) % 3];
+            }
+            if (!same)
+            {
+                spdlog::error("Index decode does not match the input");
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,476 @@
+#include "lve_mesh_normals.hpp"
+#include "lve_benchmark.hpp"
+#include "lve_job_system.hpp"
+#include <algorithm>
+#include <cmath>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+// SSE2 is part of x86-64 and NEON of AArch64, neither needs a runtime check
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_NORMALS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LVE_NORMALS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace lve
+{
+    namespace
+    {
+        constexpr uint32_t LANE_COUNT = 4;
+        // Smallest vertex range per job of the passes over vertices
+        constexpr uint32_t VERTEX_GRAIN = 4096;
+        // Faces whose normals are summed while they are still in L1
+        constexpr uint32_t FACE_BLOCK = 256;
+
+        struct Vec3Arrays
+        {
+            std::vector<float> x{};
+            std::vector<float> y{};
+            std::vector<float> z{};
+
+            void resize(size_t count)
+            {
+                x.resize(count);
+                y.resize(count);
+                z.resize(count);
+            }
+        };
+
+        // Triangles of one thread and the vertex range they reference
+        struct Chunk
+        {
+            uint32_t firstTriangle;
+            uint32_t endTriangle;
+            uint32_t firstVertex;
+            uint32_t endVertex;
+            // Over the vertex range: face normal sums when smoothing, corner counts and then fill
+            // cursors when creasing
+            Vec3Arrays sums{};
+            std::vector<uint32_t> counts{};
+        };
+
+#if defined(LVE_NORMALS_SSE2)
+        constexpr bool HAS_SIMD = true;
+        using Lanes = __m128;
+
+        // Corner k of four consecutive faces, corners points at corner k of the first
+        inline Lanes gather(const float *values, const uint32_t *corners)
+        {
+            return _mm_setr_ps(values[corners[0]], values[corners[3]], values[corners[6]], values[corners[9]]);
+        }
+        inline Lanes sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+        inline void store(float *out, Lanes a) { _mm_storeu_ps(out, a); }
+#elif defined(LVE_NORMALS_NEON)
+        constexpr bool HAS_SIMD = true;
+        using Lanes = float32x4_t;
+
+        inline Lanes gather(const float *values, const uint32_t *corners)
+        {
+            float lanes[LANE_COUNT] = {values[corners[0]], values[corners[3]], values[corners[6]], values[corners[9]]};
+            return vld1q_f32(lanes);
+        }
+        inline Lanes sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+        inline Lanes mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+        inline void store(float *out, Lanes a) { vst1q_f32(out, a); }
+#else
+        constexpr bool HAS_SIMD = false;
+#endif
+
+        // Unnormalized normals of faces [begin, end), twice the face area long. Face begin + i goes to
+        // element i of the outputs.
+        template <bool SIMD>
+        void computeFaceNormals(const Vec3Arrays &positions, const uint32_t *indices, uint32_t begin, uint32_t end,
+                                float *faceX, float *faceY, float *faceZ)
+        {
+            const float *x = positions.x.data();
+            const float *y = positions.y.data();
+            const float *z = positions.z.data();
+            uint32_t f = begin;
+#if defined(LVE_NORMALS_SSE2) || defined(LVE_NORMALS_NEON)
+            if constexpr (SIMD)
+            {
+                for (; f + LANE_COUNT <= end; f += LANE_COUNT)
+                {
+                    const uint32_t *corners = indices + size_t{f} * 3;
+                    Lanes ax = gather(x, corners), ay = gather(y, corners), az = gather(z, corners);
+                    Lanes ux = sub(gather(x, corners + 1), ax), uy = sub(gather(y, corners + 1), ay),
+                          uz = sub(gather(z, corners + 1), az);
+                    Lanes vx = sub(gather(x, corners + 2), ax), vy = sub(gather(y, corners + 2), ay),
+                          vz = sub(gather(z, corners + 2), az);
+                    store(faceX + (f - begin), sub(mul(uy, vz), mul(uz, vy)));
+                    store(faceY + (f - begin), sub(mul(uz, vx), mul(ux, vz)));
+                    store(faceZ + (f - begin), sub(mul(ux, vy), mul(uy, vx)));
+                }
+            }
+#endif
+            for (; f < end; f++)
+            {
+                const uint32_t *corners = indices + size_t{f} * 3;
+                uint32_t a = corners[0], b = corners[1], c = corners[2];
+                float ux = x[b] - x[a], uy = y[b] - y[a], uz = z[b] - z[a];
+                float vx = x[c] - x[a], vy = y[c] - y[a], vz = z[c] - z[a];
+                faceX[f - begin] = uy * vz - uz * vy;
+                faceY[f - begin] = uz * vx - ux * vz;
+                faceZ[f - begin] = ux * vy - uy * vx;
+            }
+        }
+
+        glm::vec3 normalizeOrZero(glm::vec3 v)
+        {
+            float length = std::sqrt(glm::dot(v, v));
+            return length > 0.0f ? v / length : glm::vec3(0.0f);
+        }
+
+        void generateNormals(std::span<const float> positions, std::span<const uint32_t> indices, float creaseAngle,
+                             LveJobSystem *jobSystem, std::vector<glm::vec3> &normals, std::vector<uint32_t> &normalIndices)
+        {
+            if (positions.size() % 3 != 0 || indices.size() % 3 != 0)
+            {
+                throw std::runtime_error("LveMeshNormals: Positions or indices are not a multiple of 3");
+            }
+            if (positions.size() / 3 > UINT32_MAX || indices.size() > UINT32_MAX)
+            {
+                throw std::runtime_error("LveMeshNormals: Mesh too large");
+            }
+            uint32_t vertexCount = static_cast<uint32_t>(positions.size() / 3);
+            uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+            auto forRanges = [jobSystem](uint32_t count, uint32_t grainSize, auto &&function)
+            {
+                if (jobSystem)
+                {
+                    jobSystem->parallelFor(count, grainSize, function);
+                }
+                else if (count > 0)
+                {
+                    function(0u, count);
+                }
+            };
+
+            // Whole lanes per chunk so only the last one has a scalar tail
+            uint32_t chunkCount = jobSystem ? jobSystem->getThreadCount() : 1;
+            uint32_t chunkSize = ((triangleCount + chunkCount - 1) / chunkCount + LANE_COUNT - 1) / LANE_COUNT * LANE_COUNT;
+            std::vector<Chunk> chunks(chunkCount);
+            for (uint32_t c = 0; c < chunkCount; c++)
+            {
+                chunks[c].firstTriangle = static_cast<uint32_t>(std::min<uint64_t>(triangleCount, uint64_t{c} * chunkSize));
+                chunks[c].endTriangle = static_cast<uint32_t>(std::min<uint64_t>(triangleCount, uint64_t{c + 1} * chunkSize));
+            }
+
+            // Bounds are checked before any position is read through an index
+            forRanges(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+                      {
+                          for (uint32_t c = begin; c < end; c++)
+                          {
+                              Chunk &chunk = chunks[c];
+                              uint32_t low = UINT32_MAX, high = 0;
+                              for (size_t i = size_t{chunk.firstTriangle} * 3; i < size_t{chunk.endTriangle} * 3; i++)
+                              {
+                                  low = std::min(low, indices[i]);
+                                  high = std::max(high, indices[i]);
+                              }
+                              chunk.firstVertex = low <= high ? low : 0;
+                              chunk.endVertex = low <= high ? high : 0;
+                          }
+                      });
+            for (Chunk &chunk : chunks)
+            {
+                if (chunk.firstTriangle < chunk.endTriangle && chunk.endVertex >= vertexCount)
+                {
+                    throw std::runtime_error("LveMeshNormals: Index out of range");
+                }
+                chunk.endVertex += chunk.firstTriangle < chunk.endTriangle ? 1 : 0;
+            }
+
+            Vec3Arrays soa{};
+            soa.resize(vertexCount);
+            forRanges(vertexCount, VERTEX_GRAIN, [&](uint32_t begin, uint32_t end)
+                      {
+                          for (uint32_t v = begin; v < end; v++)
+                          {
+                              soa.x[v] = positions[size_t{v} * 3 + 0];
+                              soa.y[v] = positions[size_t{v} * 3 + 1];
+                              soa.z[v] = positions[size_t{v} * 3 + 2];
+                          }
+                      });
+            if (creaseAngle >= LveMeshNormals::NO_CREASE)
+            {
+                // Every chunk sums into its own buffer, no atomics, then each vertex adds up the
+                // buffers covering it
+                forRanges(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+                          {
+                              for (uint32_t c = begin; c < end; c++)
+                              {
+                                  Chunk &chunk = chunks[c];
+                                  chunk.sums.resize(chunk.endVertex - chunk.firstVertex);
+                                  float faceX[FACE_BLOCK], faceY[FACE_BLOCK], faceZ[FACE_BLOCK];
+                                  for (uint32_t first = chunk.firstTriangle; first < chunk.endTriangle; first += FACE_BLOCK)
+                                  {
+                                      uint32_t last = std::min(chunk.endTriangle, first + FACE_BLOCK);
+                                      computeFaceNormals<HAS_SIMD>(soa, indices.data(), first, last, faceX, faceY, faceZ);
+                                      for (uint32_t f = first; f < last; f++)
+                                      {
+                                          for (uint32_t k = 0; k < 3; k++)
+                                          {
+                                              uint32_t v = indices[size_t{f} * 3 + k] - chunk.firstVertex;
+                                              chunk.sums.x[v] += faceX[f - first];
+                                              chunk.sums.y[v] += faceY[f - first];
+                                              chunk.sums.z[v] += faceZ[f - first];
+                                          }
+                                      }
+                                  }
+                              }
+                          });
+
+                normals.resize(vertexCount);
+                forRanges(vertexCount, VERTEX_GRAIN, [&](uint32_t begin, uint32_t end)
+                          {
+                              Vec3Arrays sums{};
+                              sums.resize(end - begin);
+                              for (const Chunk &chunk : chunks)
+                              {
+                                  uint32_t low = std::max(begin, chunk.firstVertex), high = std::min(end, chunk.endVertex);
+                                  for (uint32_t v = low; v < high; v++)
+                                  {
+                                      sums.x[v - begin] += chunk.sums.x[v - chunk.firstVertex];
+                                      sums.y[v - begin] += chunk.sums.y[v - chunk.firstVertex];
+                                      sums.z[v - begin] += chunk.sums.z[v - chunk.firstVertex];
+                                  }
+                              }
+                              for (uint32_t v = begin; v < end; v++)
+                              {
+                                  normals[v] = normalizeOrZero(glm::vec3(sums.x[v - begin], sums.y[v - begin], sums.z[v - begin]));
+                              }
+                          });
+                normalIndices.assign(indices.begin(), indices.end());
+                return;
+            }
+
+            // The corners around every vertex in triangle order. Chunks count their corners per
+            // vertex, the counts turn into each chunk's first slot and every chunk fills its own.
+            Vec3Arrays faces{};
+            faces.resize(triangleCount);
+            forRanges(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+                      {
+                          for (uint32_t c = begin; c < end; c++)
+                          {
+                              Chunk &chunk = chunks[c];
+                              computeFaceNormals<HAS_SIMD>(soa, indices.data(), chunk.firstTriangle, chunk.endTriangle,
+                                                           faces.x.data() + chunk.firstTriangle, faces.y.data() + chunk.firstTriangle,
+                                                           faces.z.data() + chunk.firstTriangle);
+                              chunk.counts.assign(chunk.endVertex - chunk.firstVertex, 0);
+                              for (size_t i = size_t{chunk.firstTriangle} * 3; i < size_t{chunk.endTriangle} * 3; i++)
+                              {
+                                  chunk.counts[indices[i] - chunk.firstVertex]++;
+                              }
+                          }
+                      });
+
+            std::vector<uint32_t> offsets(size_t{vertexCount} + 1);
+            forRanges(vertexCount, VERTEX_GRAIN, [&](uint32_t begin, uint32_t end)
+                      {
+                          for (Chunk &chunk : chunks)
+                          {
+                              uint32_t low = std::max(begin, chunk.firstVertex), high = std::min(end, chunk.endVertex);
+                              for (uint32_t v = low; v < high; v++)
+                              {
+                                  uint32_t &count = chunk.counts[v - chunk.firstVertex];
+                                  uint32_t previous = offsets[v + 1];
+                                  offsets[v + 1] += count;
+                                  count = previous;
+                              }
+                          }
+                      });
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+
+            std::vector<uint32_t> corners(indices.size());
+            forRanges(chunkCount, 1, [&](uint32_t begin, uint32_t end)
+                      {
+                          for (uint32_t c = begin; c < end; c++)
+                          {
+                              Chunk &chunk = chunks[c];
+                              for (size_t i = size_t{chunk.firstTriangle} * 3; i < size_t{chunk.endTriangle} * 3; i++)
+                              {
+                                  uint32_t v = indices[i];
+                                  corners[offsets[v] + chunk.counts[v - chunk.firstVertex]++] = static_cast<uint32_t>(i);
+                              }
+                          }
+                      });
+
+            // A corner sums the faces within the crease angle of its own, a corner of a degenerate
+            // face all of them. Corners of a vertex with equal normals share one.
+            float minCos = std::cos(std::max(creaseAngle, 0.0f));
+            std::vector<glm::vec3> cornerNormals(indices.size());
+            std::vector<uint32_t> normalOffsets(size_t{vertexCount} + 1);
+            forRanges(vertexCount, VERTEX_GRAIN, [&](uint32_t begin, uint32_t end)
+                      {
+                          std::vector<glm::vec3> faceNormals{}, units{};
+                          for (uint32_t v = begin; v < end; v++)
+                          {
+                              uint32_t first = offsets[v], count = offsets[v + 1] - first;
+                              faceNormals.resize(count);
+                              units.resize(count);
+                              for (uint32_t j = 0; j < count; j++)
+                              {
+                                  uint32_t f = corners[first + j] / 3;
+                                  faceNormals[j] = glm::vec3(faces.x[f], faces.y[f], faces.z[f]);
+                                  units[j] = normalizeOrZero(faceNormals[j]);
+                              }
+
+                              uint32_t distinct = 0;
+                              for (uint32_t j = 0; j < count; j++)
+                              {
+                                  bool degenerate = glm::dot(units[j], units[j]) == 0.0f;
+                                  glm::vec3 sum{0.0f};
+                                  for (uint32_t k = 0; k < count; k++)
+                                  {
+                                      if (k == j || degenerate || glm::dot(units[j], units[k]) >= minCos)
+                                      {
+                                          sum += faceNormals[k];
+                                      }
+                                  }
+                                  glm::vec3 *normal = cornerNormals.data() + first + j;
+                                  *normal = normalizeOrZero(sum);
+                                  distinct += std::find(cornerNormals.data() + first, normal, *normal) == normal ? 1 : 0;
+                              }
+                              normalOffsets[v + 1] = distinct;
+                          }
+                      });
+            for (uint32_t v = 0; v < vertexCount; v++)
+            {
+                normalOffsets[v + 1] += normalOffsets[v];
+            }
+
+            normals.resize(normalOffsets[vertexCount]);
+            normalIndices.resize(indices.size());
+            forRanges(vertexCount, VERTEX_GRAIN, [&](uint32_t begin, uint32_t end)
+                      {
+                          for (uint32_t v = begin; v < end; v++)
+                          {
+                              uint32_t next = normalOffsets[v];
+                              for (uint32_t slot = offsets[v]; slot < offsets[v + 1]; slot++)
+                              {
+                                  const glm::vec3 *normal = cornerNormals.data() + slot;
+                                  const glm::vec3 *match = std::find(normal - (slot - offsets[v]), normal, *normal);
+                                  if (match == normal)
+                                  {
+                                      normals[next] = *normal;
+                                      normalIndices[corners[slot]] = next++;
+                                  }
+                                  else
+                                  {
+                                      normalIndices[corners[slot]] = normalIndices[corners[match - cornerNormals.data()]];
+                                  }
+                              }
+                          }
+                      });
+        }
+    }
+
+    void LveMeshNormals::generate(std::span<const float> positions, std::span<const uint32_t> indices, float creaseAngle,
+                                  std::vector<glm::vec3> &normals, std::vector<uint32_t> &normalIndices,
+                                  LveJobSystem *jobSystem)
+    {
+        generateNormals(positions, indices, creaseAngle, indices.size() / 3 >= PARALLEL_THRESHOLD ? jobSystem : nullptr,
+                        normals, normalIndices);
+    }
+
+    const char *LveMeshNormals::simdName()
+    {
+#if defined(LVE_NORMALS_SSE2)
+        return "SSE2";
+#elif defined(LVE_NORMALS_NEON)
+        return "NEON";
+#else
+        return "scalar";
+#endif
+    }
+
+    void LveMeshNormals::benchmark(uint32_t triangleCount)
+    {
+        // A rolling height field with a step cut through the middle, the step's walls are creases
+        uint32_t side = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<double>(triangleCount) / 2.0)) + 1);
+        std::vector<float> positions(size_t{side} * side * 3);
+        for (uint32_t z = 0; z < side; z++)
+        {
+            for (uint32_t x = 0; x < side; x++)
+            {
+                float u = static_cast<float>(x) / static_cast<float>(side) * 12.0f;
+                float v = static_cast<float>(z) / static_cast<float>(side) * 12.0f;
+                float *position = positions.data() + (size_t{z} * side + x) * 3;
+                position[0] = u;
+                position[1] = std::sin(u) * std::cos(v) + (x > side / 2 ? 2.0f : 0.0f);
+                position[2] = v;
+            }
+        }
+        std::vector<uint32_t> indices{};
+        indices.reserve(size_t{side - 1} * (side - 1) * 6);
+        for (uint32_t z = 0; z + 1 < side; z++)
+        {
+            for (uint32_t x = 0; x + 1 < side; x++)
+            {
+                uint32_t i = z * side + x;
+                indices.insert(indices.end(), {i, i + side, i + 1, i + 1, i + side, i + side + 1});
+            }
+        }
+        triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+        auto trianglesPerSecond = [&](double ns)
+        { return static_cast<double>(triangleCount) / ns * 1e3; };
+
+        spdlog::info("Mesh normals benchmark, {} vertices, {} triangles, {} threads", side * side, triangleCount,
+                     LveJobSystem::get().getThreadCount());
+
+        Vec3Arrays soa{}, faces{};
+        soa.resize(size_t{side} * side);
+        for (size_t v = 0; v < soa.x.size(); v++)
+        {
+            soa.x[v] = positions[v * 3 + 0];
+            soa.y[v] = positions[v * 3 + 1];
+            soa.z[v] = positions[v * 3 + 2];
+        }
+        faces.resize(triangleCount);
+        double scalarNs = measureBestNs([&]()
+                                        { computeFaceNormals<false>(soa, indices.data(), 0, triangleCount, faces.x.data(), faces.y.data(), faces.z.data()); });
+        spdlog::info("Face normals, scalar: {:.1f} M triangles/s", trianglesPerSecond(scalarNs));
+        if (HAS_SIMD)
+        {
+            double simdNs = measureBestNs([&]()
+                                          { computeFaceNormals<true>(soa, indices.data(), 0, triangleCount, faces.x.data(), faces.y.data(), faces.z.data()); });
+            spdlog::info("Face normals, {}: {:.1f} M triangles/s", simdName(), trianglesPerSecond(simdNs));
+        }
+
+        std::vector<glm::vec3> serialNormals{}, normals{};
+        std::vector<uint32_t> serialIndices{}, normalIndices{};
+        const float creaseAngles[] = {NO_CREASE, 0.5f};
+        for (float creaseAngle : creaseAngles)
+        {
+            const char *mode = creaseAngle >= NO_CREASE ? "smooth" : "creased";
+            double serialNs = measureBestNs([&]()
+                                            { generateNormals(positions, indices, creaseAngle, nullptr, serialNormals, serialIndices); });
+            double parallelNs = measureBestNs([&]()
+                                              { generateNormals(positions, indices, creaseAngle, &LveJobSystem::get(), normals, normalIndices); });
+            spdlog::info("Generate {}, {} normals: {:.1f} M triangles/s on one thread, {:.1f} M triangles/s on all",
+                         mode, normals.size(), trianglesPerSecond(serialNs), trianglesPerSecond(parallelNs));
+
+            // Sums are split differently across threads, results agree up to rounding
+            bool same = normals.size() == serialNormals.size() && normalIndices == serialIndices;
+            for (size_t n = 0; same && n < normals.size(); n++)
+            {
+                glm::vec3 difference = normals[n] - serialNormals[n];
+                same = glm::dot(difference, difference) < 1e-8f;
+            }
+            if (!same)
+            {
+                spdlog::error("Generate {}: threaded normals do not match the single threaded ones", mode);
+            }
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "lve_job_system.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace lve
+{
+    // Smooth normals for meshes that come without them, every face adds its normal weighted by its
+    // area to its vertices. Face normals are cross products over the positions in
+    // structure-of-arrays form, 4 faces per instruction with SSE2 or NEON. Large meshes are split
+    // across threads, each summing into its own buffer over the vertex range it touches, and a last
+    // pass adds the buffers up.
+    //
+    // Below NO_CREASE a corner only averages the faces around its vertex within creaseAngle of its
+    // own face, so hard edges stay sharp and their vertices get one normal per side.
+    class LveMeshNormals
+    {
+    public:
+        static constexpr float NO_CREASE = 3.14159265f;
+        static constexpr uint32_t PARALLEL_THRESHOLD = 65536;
+
+        // positions holds x, y, z of every vertex and indices a triangle list over them. Fills
+        // normals and, as OBJ files store them, the index into normals of every corner. Vertices
+        // without a face of nonzero area get a zero normal. Large meshes are split across
+        // jobSystem, nullptr keeps them on the calling thread.
+        static void generate(std::span<const float> positions, std::span<const uint32_t> indices, float creaseAngle,
+                             std::vector<glm::vec3> &normals, std::vector<uint32_t> &normalIndices,
+                             LveJobSystem *jobSystem = &LveJobSystem::get());
+
+        // Name of the vector unit the face normals use, "scalar" without one
+        static const char *simdName();
+
+        // Logs face normal throughput, scalar and SIMD, and generation on one and on all threads,
+        // smooth and creased, for a triangleCount height field
+        static void benchmark(uint32_t triangleCount);
+    };
+}
@@ -0,0 +1,328 @@
+#include "lve_mesh_optimizer.hpp"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace lve
+{
+    namespace
+    {
+        void checkTriangles(const std::vector<uint32_t> &indices, uint32_t vertexCount)
+        {
+            if (indices.size() % 3 != 0)
+            {
+                throw std::runtime_error("LveMeshOptimizer: Index count must be a multiple of 3");
+            }
+            for (uint32_t index : indices)
+            {
+                if (index >= vertexCount)
+                {
+                    throw std::runtime_error("LveMeshOptimizer: Index out of range");
+                }
+            }
+        }
+
+        void bounds(const std::vector<LveMeshOptimizer::Vertex> &vertices, glm::vec3 &lo, float &extent)
+        {
+            lo = glm::vec3(FLT_MAX);
+            glm::vec3 hi(-FLT_MAX);
+            for (const LveMeshOptimizer::Vertex &vertex : vertices)
+            {
+                lo = glm::min(lo, vertex.position);
+                hi = glm::max(hi, vertex.position);
+            }
+            glm::vec3 size = vertices.empty() ? glm::vec3(0.0f) : hi - lo;
+            extent = std::max({size.x, size.y, size.z});
+        }
+
+        // Drops triangles with a repeated corner
+        void appendTriangle(std::vector<uint32_t> &indices, uint32_t a, uint32_t b, uint32_t c)
+        {
+            if (a != b && b != c && a != c)
+            {
+                indices.insert(indices.end(), {a, b, c});
+            }
+        }
+    }
+
+    float LveMeshOptimizer::quantizeAndWeld(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        checkTriangles(indices, static_cast<uint32_t>(vertices.size()));
+
+        glm::vec3 lo;
+        float extent;
+        bounds(vertices, lo, extent);
+        const float positionSteps = static_cast<float>((1u << POSITION_BITS) - 1);
+        const float normalSteps = static_cast<float>((1u << (NORMAL_BITS - 1)) - 1);
+        float step = extent > 0.0f ? extent / positionSteps : 1.0f;
+
+        // 48 bits of grid position and 24 bits of normal per vertex
+        std::vector<std::pair<uint64_t, uint32_t>> keys(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            Vertex &vertex = vertices[i];
+            glm::vec3 grid = glm::clamp(glm::floor((vertex.position - lo) / step + 0.5f), glm::vec3(0.0f), glm::vec3(positionSteps));
+            vertex.position = lo + grid * step;
+
+            float length = glm::length(vertex.normal);
+            glm::vec3 normal = length > 0.0f ? glm::floor(vertex.normal / length * normalSteps + 0.5f) : glm::vec3(0.0f);
+            vertex.normal = normal / normalSteps;
+
+            keys[i].first = static_cast<uint64_t>(grid.x) | static_cast<uint64_t>(grid.y) << 16 | static_cast<uint64_t>(grid.z) << 32;
+            keys[i].second = static_cast<uint32_t>(static_cast<uint8_t>(static_cast<int8_t>(normal.x))) |
+                             static_cast<uint32_t>(static_cast<uint8_t>(static_cast<int8_t>(normal.y))) << 8 |
+                             static_cast<uint32_t>(static_cast<uint8_t>(static_cast<int8_t>(normal.z))) << 16;
+        }
+
+        std::vector<uint32_t> order(vertices.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                  { return keys[a] != keys[b] ? keys[a] < keys[b] : a < b; });
+
+        std::vector<uint32_t> remap(vertices.size());
+        std::vector<Vertex> welded{};
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            if (i == 0 || keys[order[i]] != keys[order[i - 1]])
+            {
+                welded.push_back(vertices[order[i]]);
+            }
+            remap[order[i]] = static_cast<uint32_t>(welded.size() - 1);
+        }
+
+        std::vector<uint32_t> remapped{};
+        remapped.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            appendTriangle(remapped, remap[indices[i]], remap[indices[i + 1]], remap[indices[i + 2]]);
+        }
+
+        vertices = std::move(welded);
+        indices = std::move(remapped);
+        return step;
+    }
+
+    void LveMeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount)
+    {
+        checkTriangles(indices, vertexCount);
+        uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // Triangles around each vertex, live counts the ones not emitted yet
+        std::vector<uint32_t> live(vertexCount, 0);
+        for (uint32_t index : indices)
+        {
+            live[index]++;
+        }
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            offsets[v + 1] = offsets[v] + live[v];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                adjacency[fill[indices[3 * t + k]]++] = t;
+            }
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEnd{}, candidates{}, result{};
+        result.reserve(indices.size());
+        uint32_t time = CACHE_SIZE + 1;
+        uint32_t cursor = 0;
+
+        int64_t fanning = 0;
+        while (fanning >= 0)
+        {
+            uint32_t f = static_cast<uint32_t>(fanning);
+            candidates.clear();
+            for (uint32_t a = offsets[f]; a < offsets[f + 1]; a++)
+            {
+                uint32_t t = adjacency[a];
+                if (emitted[t])
+                {
+                    continue;
+                }
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t v = indices[3 * t + k];
+                    result.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - cacheTime[v] > CACHE_SIZE)
+                    {
+                        cacheTime[v] = time++;
+                    }
+                }
+                emitted[t] = true;
+            }
+
+            // Next fanning vertex: a candidate still in cache that stays there while its remaining
+            // triangles are emitted, the one longest in cache first
+            fanning = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates)
+            {
+                if (live[v] == 0)
+                {
+                    continue;
+                }
+                int64_t priority = 0;
+                if (time - cacheTime[v] + 2 * live[v] <= CACHE_SIZE)
+                {
+                    priority = time - cacheTime[v];
+                }
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    fanning = v;
+                }
+            }
+            // Dead end, back up through recently emitted vertices, then scan for any live one
+            while (fanning < 0 && !deadEnd.empty())
+            {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0)
+                {
+                    fanning = v;
+                }
+            }
+            while (fanning < 0 && cursor < vertexCount)
+            {
+                if (live[cursor] > 0)
+                {
+                    fanning = cursor;
+                }
+                cursor++;
+            }
+        }
+
+        indices = std::move(result);
+    }
+
+    void LveMeshOptimizer::optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+    {
+        checkTriangles(indices, static_cast<uint32_t>(vertices.size()));
+
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        std::vector<Vertex> ordered{};
+        ordered.reserve(vertices.size());
+        for (uint32_t &index : indices)
+        {
+            if (remap[index] == UINT32_MAX)
+            {
+                remap[index] = static_cast<uint32_t>(ordered.size());
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices = std::move(ordered);
+    }
+
+    std::vector<uint32_t> LveMeshOptimizer::simplifyClusters(const std::vector<Vertex> &vertices,
+                                                             const std::vector<uint32_t> &indices, uint32_t gridSize)
+    {
+        checkTriangles(indices, static_cast<uint32_t>(vertices.size()));
+        // 10 bits per axis in the cluster key
+        gridSize = std::clamp(gridSize, 1u, 1024u);
+
+        glm::vec3 lo;
+        float extent;
+        bounds(vertices, lo, extent);
+        if (extent <= 0.0f)
+        {
+            return {};
+        }
+        float cellSize = extent / static_cast<float>(gridSize);
+
+        std::unordered_map<uint64_t, uint32_t> clusterIds{};
+        std::vector<uint32_t> clusters(vertices.size());
+        std::vector<glm::vec3> sums{};
+        std::vector<uint32_t> counts{};
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            const Vertex &vertex = vertices[i];
+            glm::vec3 cell = glm::clamp(glm::floor((vertex.position - lo) / cellSize), glm::vec3(0.0f),
+                                        glm::vec3(static_cast<float>(gridSize - 1)));
+            uint64_t octant = (vertex.normal.x < 0.0f ? 1u : 0u) | (vertex.normal.y < 0.0f ? 2u : 0u) |
+                              (vertex.normal.z < 0.0f ? 4u : 0u);
+            uint64_t key = static_cast<uint64_t>(cell.x) | static_cast<uint64_t>(cell.y) << 10 |
+                           static_cast<uint64_t>(cell.z) << 20 | octant << 30;
+
+            auto [it, inserted] = clusterIds.try_emplace(key, static_cast<uint32_t>(sums.size()));
+            if (inserted)
+            {
+                sums.emplace_back(0.0f);
+                counts.push_back(0);
+            }
+            clusters[i] = it->second;
+            sums[it->second] += vertex.position;
+            counts[it->second]++;
+        }
+
+        std::vector<uint32_t> representatives(sums.size(), UINT32_MAX);
+        std::vector<float> distances(sums.size(), FLT_MAX);
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            uint32_t cluster = clusters[i];
+            glm::vec3 offset = vertices[i].position - sums[cluster] / static_cast<float>(counts[cluster]);
+            float distance = glm::dot(offset, offset);
+            if (distance < distances[cluster])
+            {
+                distances[cluster] = distance;
+                representatives[cluster] = static_cast<uint32_t>(i);
+            }
+        }
+
+        // Rotated so the smallest index leads, which keeps the winding and makes repeats adjacent
+        // after sorting
+        std::vector<std::array<uint32_t, 3>> triangles{};
+        triangles.reserve(indices.size() / 3);
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t a = representatives[clusters[indices[i]]];
+            uint32_t b = representatives[clusters[indices[i + 1]]];
+            uint32_t c = representatives[clusters[indices[i + 2]]];
+            if (a == b || b == c || a == c)
+            {
+                continue;
+            }
+            if (b < a && b < c)
+            {
+                triangles.push_back({b, c, a});
+            }
+            else if (c < a && c < b)
+            {
+                triangles.push_back({c, a, b});
+            }
+            else
+            {
+                triangles.push_back({a, b, c});
+            }
+        }
+        std::sort(triangles.begin(), triangles.end());
+        triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+        std::vector<uint32_t> simplified{};
+        simplified.reserve(triangles.size() * 3);
+        for (const std::array<uint32_t, 3> &triangle : triangles)
+        {
+            simplified.insert(simplified.end(), triangle.begin(), triangle.end());
+        }
+        return simplified;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Offline passes over indexed triangle lists, run by the asset cooker. All of them are
+    // deterministic so cooking the same input twice gives the same bytes.
+    class LveMeshOptimizer
+    {
+    public:
+        struct Vertex
+        {
+            glm::vec3 position;
+            glm::vec3 normal;
+        };
+
+        // Post-transform cache size the vertex cache pass optimizes for
+        static constexpr uint32_t CACHE_SIZE = 16;
+        static constexpr uint32_t POSITION_BITS = 16;
+        static constexpr uint32_t NORMAL_BITS = 8;
+
+        // Snaps positions to a POSITION_BITS grid over the longest side of the bounds and normals
+        // to NORMAL_BITS per component, then merges vertices that became equal and drops triangles
+        // that collapsed. Returns the grid step.
+        static float quantizeAndWeld(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+        // Reorders triangles for post-transform cache hits with Tipsify (Sander et al. 2007)
+        static void optimizeVertexCache(std::vector<uint32_t> &indices, uint32_t vertexCount);
+
+        // Renumbers vertices in order of first use across indices and drops unused ones, so fetches
+        // walk memory forward
+        static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+        // Vertex clustering on a gridSize^3 grid over the bounds. Vertices of a cell facing the
+        // same octant collapse into the one nearest their mean, triangles that collapse or repeat
+        // are dropped. The returned indices reference the input vertices.
+        static std::vector<uint32_t> simplifyClusters(const std::vector<Vertex> &vertices,
+                                                      const std::vector<uint32_t> &indices, uint32_t gridSize);
+    };
+}
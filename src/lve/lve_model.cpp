@@ -0,0 +1,86 @@
+#include "lve_model.hpp"
+#include <cstddef>
+#include <stdexcept>
+
+namespace lve
+{
+    std::vector<VkVertexInputBindingDescription> LveModel::Vertex::getBindingDescriptions()
+    {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(Vertex);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> LveModel::Vertex::getAttributeDescriptions()
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(2);
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(Vertex, position);
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(Vertex, color);
+        return attributeDescriptions;
+    }
+
+    uint32_t LveModel::Builder::addMesh(const std::vector<Vertex> &meshVertices, const std::vector<uint32_t> &meshIndices)
+    {
+        Mesh mesh{};
+        mesh.firstIndex = static_cast<uint32_t>(indices.size());
+        mesh.indexCount = static_cast<uint32_t>(meshIndices.size());
+        mesh.vertexOffset = static_cast<int32_t>(vertices.size());
+
+        // Sphere around the bounding box center, not minimal but cheap and stable
+        glm::vec3 minPosition{meshVertices.empty() ? glm::vec3{0.0f} : meshVertices[0].position};
+        glm::vec3 maxPosition{minPosition};
+        for (const auto &vertex : meshVertices)
+        {
+            minPosition = glm::min(minPosition, vertex.position);
+            maxPosition = glm::max(maxPosition, vertex.position);
+        }
+        glm::vec3 center = 0.5f * (minPosition + maxPosition);
+        float radius = 0.0f;
+        for (const auto &vertex : meshVertices)
+        {
+            radius = glm::max(radius, glm::length(vertex.position - center));
+        }
+        mesh.boundingSphere = glm::vec4(center, radius);
+
+        vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+        indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+        meshes.push_back(mesh);
+
+        return static_cast<uint32_t>(meshes.size() - 1);
+    }
+
+    LveModel::LveModel(LveDevice &device, const Builder &builder) : device{device}, meshes{builder.meshes}
+    {
+        if (builder.vertices.empty() || builder.indices.empty())
+        {
+            throw std::runtime_error("LveModel: Model has no geometry");
+        }
+
+        vertexBuffer = LveBuffer::createDeviceLocal(
+            device,
+            builder.vertices.data(),
+            sizeof(Vertex) * builder.vertices.size(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        indexBuffer = LveBuffer::createDeviceLocal(
+            device,
+            builder.indices.data(),
+            sizeof(uint32_t) * builder.indices.size(),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    }
+
+    void LveModel::bind(VkCommandBuffer commandBuffer)
+    {
+        VkBuffer buffers[] = {vertexBuffer->getBuffer()};
+        VkDeviceSize offsets[] = {0};
+        device.disp.cmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        device.disp.cmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    }
+}
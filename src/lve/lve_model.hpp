@@ -0,0 +1,59 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace lve
+{
+    // Indexed meshes sharing one device-local vertex buffer and one index buffer,
+    // so any of them can be drawn after a single bind
+    class LveModel
+    {
+    public:
+        struct Vertex
+        {
+            glm::vec3 position;
+            glm::vec3 color;
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+        };
+
+        struct Mesh
+        {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            int32_t vertexOffset;
+            // xyz center and w radius in model space
+            glm::vec4 boundingSphere;
+        };
+
+        struct Builder
+        {
+            std::vector<Vertex> vertices{};
+            std::vector<uint32_t> indices{};
+            std::vector<Mesh> meshes{};
+
+            // Returns the mesh id, indices are relative to the mesh's own vertices
+            uint32_t addMesh(const std::vector<Vertex> &meshVertices, const std::vector<uint32_t> &meshIndices);
+        };
+
+        LveModel(LveDevice &device, const Builder &builder);
+        LveModel(const LveModel &) = delete;
+        LveModel &operator=(const LveModel &) = delete;
+
+        void bind(VkCommandBuffer commandBuffer);
+        const Mesh &getMesh(uint32_t mesh) const { return meshes[mesh]; }
+        uint32_t getMeshCount() const { return static_cast<uint32_t>(meshes.size()); }
+        VkBuffer getVertexBuffer() const { return vertexBuffer->getBuffer(); }
+        VkBuffer getIndexBuffer() const { return indexBuffer->getBuffer(); }
+
+    private:
+        LveDevice &device;
+        std::unique_ptr<LveBuffer> vertexBuffer;
+        std::unique_ptr<LveBuffer> indexBuffer;
+        std::vector<Mesh> meshes{};
+    };
+}
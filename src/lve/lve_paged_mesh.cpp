@@ -0,0 +1,314 @@
+#include "lve_paged_mesh.hpp"
+#include "lve_mesh_codec.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace lve
+{
+    static constexpr char PAGE_FILE_MAGIC[4] = {'L', 'V', 'P', 'G'};
+    static constexpr uint32_t PAGE_FILE_VERSION = 3;
+
+    // Followed by the cluster table, then the pages in cluster order
+    struct PageFileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t vertexStride;
+        uint32_t clusterCount;
+    };
+
+    void LvePageFile::build(const std::string &path, const void *vertices, uint32_t vertexStride, uint32_t vertexCount,
+                            const uint32_t *indices, uint32_t indexCount)
+    {
+        if (indexCount == 0 || indexCount % 3 != 0)
+        {
+            throw std::runtime_error("LvePageFile: Index count must be a non-zero multiple of 3");
+        }
+
+        const std::byte *vertexBytes = static_cast<const std::byte *>(vertices);
+        auto position = [&](uint32_t vertex)
+        {
+            glm::vec3 p;
+            std::memcpy(&p, vertexBytes + static_cast<size_t>(vertex) * vertexStride, sizeof(p));
+            return p;
+        };
+
+        uint32_t triangleCount = indexCount / 3;
+        std::vector<uint32_t> triangles(triangleCount);
+        std::vector<glm::vec3> centroids(triangleCount);
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            triangles[t] = t;
+            centroids[t] = (position(indices[3 * t]) + position(indices[3 * t + 1]) + position(indices[3 * t + 2])) / 3.0f;
+        }
+
+        // Stamps count the distinct vertices of a range without clearing between ranges
+        std::vector<uint32_t> stamps(vertexCount, 0);
+        uint32_t stamp = 0;
+        auto uniqueVertices = [&](uint32_t begin, uint32_t end)
+        {
+            stamp++;
+            uint32_t unique = 0;
+            for (uint32_t t = begin; t < end; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t vertex = indices[3 * triangles[t] + k];
+                    if (stamps[vertex] != stamp)
+                    {
+                        stamps[vertex] = stamp;
+                        unique++;
+                    }
+                }
+            }
+            return unique;
+        };
+
+        // Depth first with the lower half on top, so neighbouring clusters end up in neighbouring pages
+        std::vector<std::pair<uint32_t, uint32_t>> ranges{};
+        std::vector<std::pair<uint32_t, uint32_t>> stack{{0, triangleCount}};
+        while (!stack.empty())
+        {
+            auto [begin, end] = stack.back();
+            stack.pop_back();
+            if (end - begin <= PAGE_TRIANGLES && uniqueVertices(begin, end) <= PAGE_VERTICES)
+            {
+                ranges.emplace_back(begin, end);
+                continue;
+            }
+
+            glm::vec3 lo{FLT_MAX}, hi{-FLT_MAX};
+            for (uint32_t t = begin; t < end; t++)
+            {
+                lo = glm::min(lo, centroids[triangles[t]]);
+                hi = glm::max(hi, centroids[triangles[t]]);
+            }
+            glm::vec3 extent = hi - lo;
+            int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+            uint32_t middle = begin + (end - begin) / 2;
+            std::nth_element(triangles.begin() + begin, triangles.begin() + middle, triangles.begin() + end,
+                             [&](uint32_t a, uint32_t b)
+                             { return centroids[a][axis] < centroids[b][axis]; });
+            stack.emplace_back(middle, end);
+            stack.emplace_back(begin, middle);
+        }
+
+        std::ofstream out{path, std::ios::binary | std::ios::trunc};
+        if (!out)
+        {
+            throw std::runtime_error("LvePageFile: Failed to create " + path);
+        }
+
+        // The table is written once the page offsets are known
+        PageFileHeader header{{}, PAGE_FILE_VERSION, vertexStride, static_cast<uint32_t>(ranges.size())};
+        std::memcpy(header.magic, PAGE_FILE_MAGIC, sizeof(header.magic));
+        std::vector<Cluster> clusters(ranges.size());
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(clusters.data()), clusters.size() * sizeof(Cluster));
+
+        uint64_t offset = sizeof(header) + clusters.size() * sizeof(Cluster);
+        std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+        std::vector<uint32_t> pageVertices{}, pageIndices{};
+        std::vector<std::byte> pageData{};
+        for (size_t c = 0; c < ranges.size(); c++)
+        {
+            pageVertices.clear();
+            pageIndices.clear();
+            for (uint32_t t = ranges[c].first; t < ranges[c].second; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    uint32_t vertex = indices[3 * triangles[t] + k];
+                    if (remap[vertex] == UINT32_MAX)
+                    {
+                        remap[vertex] = static_cast<uint32_t>(pageVertices.size());
+                        pageVertices.push_back(vertex);
+                    }
+                    pageIndices.push_back(remap[vertex]);
+                }
+            }
+
+            glm::vec3 lo{FLT_MAX}, hi{-FLT_MAX};
+            pageData.resize(pageVertices.size() * vertexStride);
+            for (size_t v = 0; v < pageVertices.size(); v++)
+            {
+                remap[pageVertices[v]] = UINT32_MAX;
+                lo = glm::min(lo, position(pageVertices[v]));
+                hi = glm::max(hi, position(pageVertices[v]));
+                std::memcpy(pageData.data() + v * vertexStride,
+                            vertexBytes + static_cast<size_t>(pageVertices[v]) * vertexStride, vertexStride);
+            }
+
+            glm::vec3 center = 0.5f * (lo + hi);
+            float radius = 0.0f;
+            for (uint32_t vertex : pageVertices)
+            {
+                radius = std::max(radius, glm::length(position(vertex) - center));
+            }
+
+            std::vector<std::byte> vertexData =
+                LveMeshCodec::encodeVertices(pageData.data(), static_cast<uint32_t>(pageVertices.size()), vertexStride);
+            std::vector<std::byte> indexData =
+                LveMeshCodec::encodeIndices(pageIndices.data(), static_cast<uint32_t>(pageIndices.size()));
+            out.write(reinterpret_cast<const char *>(vertexData.data()), static_cast<std::streamsize>(vertexData.size()));
+            out.write(reinterpret_cast<const char *>(indexData.data()), static_cast<std::streamsize>(indexData.size()));
+            clusters[c] = {center, radius, static_cast<uint32_t>(pageVertices.size()),
+                           static_cast<uint32_t>(pageIndices.size()), offset,
+                           static_cast<uint32_t>(vertexData.size()), static_cast<uint32_t>(indexData.size())};
+            offset += vertexData.size() + indexData.size();
+        }
+
+        out.seekp(sizeof(header));
+        out.write(reinterpret_cast<const char *>(clusters.data()), clusters.size() * sizeof(Cluster));
+        if (!out)
+        {
+            throw std::runtime_error("LvePageFile: Failed to write " + path);
+        }
+    }
+
+    LvePageFile::LvePageFile(const std::string &path) : file{path, std::ios::binary}
+    {
+        if (!file)
+        {
+            throw std::runtime_error("LvePageFile: Failed to open " + path);
+        }
+
+        PageFileHeader header{};
+        file.read(reinterpret_cast<char *>(&header), sizeof(header));
+        if (!file || std::memcmp(header.magic, PAGE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != PAGE_FILE_VERSION)
+        {
+            throw std::runtime_error("LvePageFile: Not a page file: " + path);
+        }
+
+        vertexStride = header.vertexStride;
+        clusters.resize(header.clusterCount);
+        file.read(reinterpret_cast<char *>(clusters.data()), clusters.size() * sizeof(Cluster));
+        if (!file)
+        {
+            throw std::runtime_error("LvePageFile: Truncated cluster table: " + path);
+        }
+    }
+
+    glm::vec4 LvePageFile::getBounds() const
+    {
+        glm::vec3 lo{FLT_MAX}, hi{-FLT_MAX};
+        for (const Cluster &cluster : clusters)
+        {
+            lo = glm::min(lo, cluster.center - cluster.radius);
+            hi = glm::max(hi, cluster.center + cluster.radius);
+        }
+
+        glm::vec3 center = 0.5f * (lo + hi);
+        float radius = 0.0f;
+        for (const Cluster &cluster : clusters)
+        {
+            radius = std::max(radius, glm::length(cluster.center - center) + cluster.radius);
+        }
+        return glm::vec4(center, radius);
+    }
+
+    void LvePageFile::readPage(uint32_t cluster, void *vertices, uint32_t *indices)
+    {
+        const Cluster &page = clusters[cluster];
+        std::vector<std::byte> data(size_t{page.vertexDataSize} + page.indexDataSize);
+        {
+            std::lock_guard lock{mutex};
+            file.seekg(static_cast<std::streamoff>(page.offset));
+            file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file)
+            {
+                file.clear();
+                throw std::runtime_error("LvePageFile: Failed to read page " + std::to_string(cluster));
+            }
+        }
+
+        std::span<const std::byte> encoded{data};
+        LveMeshCodec::decodeVertices(vertices, page.vertexCount, vertexStride, encoded.first(page.vertexDataSize));
+        LveMeshCodec::decodeIndices(indices, page.indexCount, page.vertexCount, encoded.subspan(page.vertexDataSize));
+    }
+
+    LvePageTable::LvePageTable(uint32_t slotCount, uint32_t clusterCount)
+        : slots(slotCount), clusterSlots(clusterCount, NO_SLOT)
+    {
+    }
+
+    uint32_t LvePageTable::use(uint32_t cluster, uint64_t frame)
+    {
+        uint32_t slot = clusterSlots[cluster];
+        if (slot == NO_SLOT || slots[slot].loading)
+        {
+            return NO_SLOT;
+        }
+        slots[slot].lastUsed = frame;
+        return slot;
+    }
+
+    bool LvePageTable::isLoading(uint32_t cluster) const
+    {
+        uint32_t slot = clusterSlots[cluster];
+        return slot != NO_SLOT && slots[slot].loading;
+    }
+
+    uint32_t LvePageTable::beginLoad(uint32_t cluster, uint64_t frame)
+    {
+        if (clusterSlots[cluster] != NO_SLOT)
+        {
+            throw std::runtime_error("LvePageTable: Cluster already has a slot");
+        }
+
+        // A free slot if there is one, otherwise the least recently used. Linear, but only a few
+        // loads start per frame.
+        uint32_t best = NO_SLOT;
+        for (uint32_t s = 0; s < slots.size(); s++)
+        {
+            const Slot &slot = slots[s];
+            if (slot.cluster == NO_CLUSTER)
+            {
+                best = s;
+                break;
+            }
+            if (slot.loading || slot.lastUsed >= frame)
+            {
+                continue;
+            }
+            if (best == NO_SLOT || slot.lastUsed < slots[best].lastUsed)
+            {
+                best = s;
+            }
+        }
+        if (best == NO_SLOT)
+        {
+            return NO_SLOT;
+        }
+
+        Slot &slot = slots[best];
+        if (slot.cluster != NO_CLUSTER)
+        {
+            clusterSlots[slot.cluster] = NO_SLOT;
+            residentCount--;
+            evictionCount++;
+        }
+        slot.cluster = cluster;
+        slot.loading = true;
+        slot.lastUsed = frame;
+        clusterSlots[cluster] = best;
+        return best;
+    }
+
+    void LvePageTable::endLoad(uint32_t slot)
+    {
+        slots[slot].loading = false;
+        residentCount++;
+    }
+
+    void LvePageTable::abortLoad(uint32_t slot)
+    {
+        clusterSlots[slots[slot].cluster] = NO_SLOT;
+        slots[slot] = {};
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    // Mesh split offline into spatial clusters of at most PAGE_VERTICES vertices and
+    // PAGE_TRIANGLES triangles. Each cluster is one page of the file, its vertices followed by its
+    // indices relative to the page, both compressed with LveMeshCodec. Only the cluster table is
+    // read up front, pages on demand.
+    class LvePageFile
+    {
+    public:
+        static constexpr uint32_t PAGE_VERTICES = 256;
+        static constexpr uint32_t PAGE_TRIANGLES = 256;
+        static constexpr uint32_t PAGE_INDICES = PAGE_TRIANGLES * 3;
+
+        struct Cluster
+        {
+            glm::vec3 center;
+            float radius;
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            uint64_t offset;
+            // Encoded bytes of the vertices and of the indices that follow them
+            uint32_t vertexDataSize;
+            uint32_t indexDataSize;
+        };
+
+        // Splits an indexed triangle list by recursive median cuts of the triangle centroids along
+        // their longest axis. Every vertex starts with its position as three floats, the stride is
+        // a multiple of 4 up to LveMeshCodec::MAX_VERTEX_SIZE.
+        static void build(const std::string &path, const void *vertices, uint32_t vertexStride, uint32_t vertexCount,
+                          const uint32_t *indices, uint32_t indexCount);
+
+        explicit LvePageFile(const std::string &path);
+
+        LvePageFile(const LvePageFile &) = delete;
+        LvePageFile &operator=(const LvePageFile &) = delete;
+
+        uint32_t getVertexStride() const { return vertexStride; }
+        const std::vector<Cluster> &getClusters() const { return clusters; }
+        // Sphere around every cluster
+        glm::vec4 getBounds() const;
+
+        // Thread safe, pages are decoded outside the file lock. vertices and indices must have room
+        // for the cluster's counts.
+        void readPage(uint32_t cluster, void *vertices, uint32_t *indices);
+
+    private:
+        std::mutex mutex{};
+        std::ifstream file{};
+        uint32_t vertexStride{};
+        std::vector<Cluster> clusters{};
+    };
+
+    // Residency of page file clusters in a fixed number of GPU page slots. A cluster missing from
+    // the pool takes a free slot or the least recently used one, slots still loading or used in
+    // the current frame are never taken.
+    class LvePageTable
+    {
+    public:
+        static constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+        LvePageTable(uint32_t slotCount, uint32_t clusterCount);
+
+        // Slot of the cluster if it is resident, NO_SLOT otherwise. Marks it used in frame.
+        uint32_t use(uint32_t cluster, uint64_t frame);
+        bool isLoading(uint32_t cluster) const;
+        // Slot to load the cluster into, evicting its previous cluster. NO_SLOT if none is free.
+        uint32_t beginLoad(uint32_t cluster, uint64_t frame);
+        void endLoad(uint32_t slot);
+        // The load failed, the slot is free again and the cluster missing
+        void abortLoad(uint32_t slot);
+
+        uint32_t getSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+        uint32_t getResidentCount() const { return residentCount; }
+        uint64_t getEvictionCount() const { return evictionCount; }
+
+    private:
+        static constexpr uint32_t NO_CLUSTER = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t cluster{NO_CLUSTER};
+            bool loading{};
+            uint64_t lastUsed{};
+        };
+
+        std::vector<Slot> slots{};
+        std::vector<uint32_t> clusterSlots{};
+        uint32_t residentCount{};
+        uint64_t evictionCount{};
+    };
+}
@@ -1,5 +1,6 @@
 #include "lve_pipeline.hpp"
-#include <fstream>
+#include "lve_archive.hpp"
+#include "lve_trace.hpp"
 #include <stdexcept>
 
 namespace lve
@@ -15,32 +16,13 @@ namespace lve
 
     LvePipeline::~LvePipeline()
     {
-        vkDestroyShaderModule(device.device(), vertShaderModule, nullptr);
-        vkDestroyShaderModule(device.device(), fragShaderModule, nullptr);
-        vkDestroyPipeline(device.device(), graphicsPipeline, nullptr);
+        device.disp.destroyShaderModule(device.device(), vertShaderModule, nullptr);
+        device.disp.destroyShaderModule(device.device(), fragShaderModule, nullptr);
+        device.disp.destroyPipeline(device.device(), graphicsPipeline, nullptr);
     }
     void LvePipeline::bind(VkCommandBuffer commandBuffer)
     {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-    }
-
-    std::vector<char> LvePipeline::readFile(const std::string &filePath)
-    {
-        std::ifstream file(filePath, std::ios::ate | std::ios::binary);
-
-        if (!file.is_open())
-        {
-            throw std::runtime_error("LvePipeline: Failed to open file");
-        }
-
-        size_t fileSize = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-
-        return buffer;
+        device.disp.cmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
     }
 
     void LvePipeline::createGraphicsPipeline(
@@ -48,8 +30,11 @@ namespace lve
         const std::string &fragFilePath,
         const PipelineConfigInfo &configInfo)
     {
-        auto vertCode = readFile(vertFilePath);
-        auto fragCode = readFile(fragFilePath);
+        LVE_TRACE_ZONE("LvePipeline::createGraphicsPipeline");
+        // Views into the mapped asset archive when it holds the shaders, no copy is made
+        std::vector<std::byte> vertStorage{}, fragStorage{};
+        auto vertCode = LveArchive::load(vertFilePath, vertStorage);
+        auto fragCode = LveArchive::load(fragFilePath, fragStorage);
 
         createShaderModule(vertCode, vertShaderModule);
         createShaderModule(fragCode, fragShaderModule);
@@ -64,9 +49,12 @@ namespace lve
         shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 
-        // Hardcoding data, so keep everything default
         VkPipelineVertexInputStateCreateInfo vertexIsci{};
         vertexIsci.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexIsci.vertexBindingDescriptionCount = static_cast<uint32_t>(configInfo.bindingDescriptions.size());
+        vertexIsci.pVertexBindingDescriptions = configInfo.bindingDescriptions.data();
+        vertexIsci.vertexAttributeDescriptionCount = static_cast<uint32_t>(configInfo.attributeDescriptions.size());
+        vertexIsci.pVertexAttributeDescriptions = configInfo.attributeDescriptions.data();
 
         VkPipelineViewportStateCreateInfo viewportSci{};
         viewportSci.pScissors = &configInfo.scissor;
@@ -75,11 +63,15 @@ namespace lve
         viewportSci.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportSci.viewportCount = 1;
 
+        // The config may have been copied since defaultPipelineConfigInfo pointed this at its attachment state
+        VkPipelineColorBlendStateCreateInfo colorBlendSci = configInfo.colorBlendSci;
+        colorBlendSci.pAttachments = &configInfo.colorBlendAttachmentState;
+
         VkGraphicsPipelineCreateInfo graphicsPipeline_ci{};
         graphicsPipeline_ci.pStages = shaderStages;
         graphicsPipeline_ci.pViewportState = &viewportSci;
         graphicsPipeline_ci.pInputAssemblyState = &configInfo.inputAssemblySci;
-        graphicsPipeline_ci.pColorBlendState = &configInfo.colorBlendSci;
+        graphicsPipeline_ci.pColorBlendState = &colorBlendSci;
         graphicsPipeline_ci.pDepthStencilState = &configInfo.depthStenciSci;
         graphicsPipeline_ci.pMultisampleState = &configInfo.multisampleSci;
         graphicsPipeline_ci.pRasterizationState = &configInfo.rasterizationSci;
@@ -90,20 +82,20 @@ namespace lve
         graphicsPipeline_ci.stageCount = 2;
         graphicsPipeline_ci.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 
-        if (vkCreateGraphicsPipelines(device.device(), nullptr, 1, &graphicsPipeline_ci, nullptr, &graphicsPipeline) != VK_SUCCESS)
+        if (device.disp.createGraphicsPipelines(device.device(), nullptr, 1, &graphicsPipeline_ci, nullptr, &graphicsPipeline) != VK_SUCCESS)
         {
             throw std::runtime_error("Vulkan: Failed to create graphics pipeline");
         }
     }
 
-    void LvePipeline::createShaderModule(const std::vector<char> &code, VkShaderModule &shaderModule)
+    void LvePipeline::createShaderModule(std::span<const std::byte> code, VkShaderModule &shaderModule)
     {
         VkShaderModuleCreateInfo shader_module_ci{};
         shader_module_ci.codeSize = code.size();
         shader_module_ci.pCode = reinterpret_cast<const uint32_t *>(code.data());
         shader_module_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 
-        if (vkCreateShaderModule(device.device(), &shader_module_ci, nullptr, &shaderModule) != VK_SUCCESS)
+        if (device.disp.createShaderModule(device.device(), &shader_module_ci, nullptr, &shaderModule) != VK_SUCCESS)
         {
             throw std::runtime_error("Vulkan: Failed to create shader module");
         }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include <cstddef>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -16,6 +18,8 @@ namespace lve
         VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
         VkPipelineColorBlendStateCreateInfo colorBlendSci{};
         VkPipelineDepthStencilStateCreateInfo depthStenciSci{};
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
         VkPipelineLayout layout{};
         VkRenderPass renderPass{};
         uint32_t subpass{};
@@ -35,13 +39,12 @@ namespace lve
         static PipelineConfigInfo defaultPipelineConfigInfo(uint32_t width, uint32_t height);
 
     private:
-        static std::vector<char> readFile(const std::string &filePath);
         void createGraphicsPipeline(
             const std::string &vertFilePath,
             const std::string &fragFilePath,
             const PipelineConfigInfo &configInfo);
 
-        void createShaderModule(const std::vector<char> &code, VkShaderModule &shaderModule);
+        void createShaderModule(std::span<const std::byte> code, VkShaderModule &shaderModule);
 
         LveDevice &device;
         VkPipeline graphicsPipeline{};
@@ -0,0 +1,182 @@
+#include "lve_pipeline_statistics.hpp"
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace lve
+{
+    // Results are returned in bit order, followed by the availability word
+    static constexpr VkQueryPipelineStatisticFlags STATISTIC_FLAGS =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    static constexpr uint32_t RESULT_WORDS = 5;
+
+    LvePipelineStatistics::LvePipelineStatistics(LveDevice &device, uint32_t framesInFlight)
+        : device{device}, framesInFlight{framesInFlight}
+    {
+        supported = device.enabledFeatures.pipelineStatisticsQuery == VK_TRUE;
+    }
+
+    LvePipelineStatistics::~LvePipelineStatistics()
+    {
+        for (auto &frame : frames)
+        {
+            device.disp.destroyQueryPool(device.device(), frame.queryPool, nullptr);
+        }
+    }
+
+    void LvePipelineStatistics::setEnabled(bool enable)
+    {
+        if (enable && !supported)
+        {
+            spdlog::warn("LvePipelineStatistics: pipelineStatisticsQuery is not supported by the device");
+            return;
+        }
+        requestedEnabled = enable;
+    }
+
+    void LvePipelineStatistics::createQueryPools()
+    {
+        frames.resize(framesInFlight);
+        for (auto &frame : frames)
+        {
+            VkQueryPoolCreateInfo queryPoolCi{};
+            queryPoolCi.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            queryPoolCi.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            queryPoolCi.queryCount = MAX_DRAWS;
+            queryPoolCi.pipelineStatistics = STATISTIC_FLAGS;
+
+            if (device.disp.createQueryPool(device.device(), &queryPoolCi, nullptr, &frame.queryPool) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Vulkan: Failed to create pipeline statistics query pool");
+            }
+            frame.draws.reserve(MAX_DRAWS);
+        }
+    }
+
+    void LvePipelineStatistics::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+    {
+        if (requestedEnabled != enabled)
+        {
+            enabled = requestedEnabled;
+            if (enabled && frames.empty())
+            {
+                createQueryPools();
+            }
+            // Results recorded before a toggle are stale
+            for (auto &frame : frames)
+            {
+                frame.draws.clear();
+            }
+        }
+
+        if (!enabled)
+        {
+            return;
+        }
+
+        currentFrame = frameIndex;
+        auto &frame = frames[currentFrame];
+        collectResults(frame);
+
+        device.disp.cmdResetQueryPool(commandBuffer, frame.queryPool, 0, MAX_DRAWS);
+        frame.draws.clear();
+    }
+
+    uint32_t LvePipelineStatistics::beginQuery(VkCommandBuffer commandBuffer, const char *name)
+    {
+        auto &frame = frames[currentFrame];
+        if (frame.draws.size() >= MAX_DRAWS)
+        {
+            return MAX_DRAWS;
+        }
+
+        uint32_t draw = static_cast<uint32_t>(frame.draws.size());
+        frame.draws.push_back(name);
+        device.disp.cmdBeginQuery(commandBuffer, frame.queryPool, draw, 0);
+
+        return draw;
+    }
+
+    void LvePipelineStatistics::endQuery(VkCommandBuffer commandBuffer, uint32_t draw)
+    {
+        device.disp.cmdEndQuery(commandBuffer, frames[currentFrame].queryPool, draw);
+    }
+
+    void LvePipelineStatistics::collectResults(FrameQueries &frame)
+    {
+        if (frame.draws.empty())
+        {
+            return;
+        }
+
+        uint64_t results[MAX_DRAWS * RESULT_WORDS]{};
+        device.disp.getQueryPoolResults(
+            device.device(),
+            frame.queryPool,
+            0,
+            static_cast<uint32_t>(frame.draws.size()),
+            sizeof(results),
+            results,
+            RESULT_WORDS * sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+        for (size_t i = 0; i < frame.draws.size(); i++)
+        {
+            const uint64_t *result = &results[i * RESULT_WORDS];
+            if (result[4] == 0)
+            {
+                continue;
+            }
+
+            auto [it, inserted] = statsIndex.try_emplace(frame.draws[i], stats.size());
+            if (inserted)
+            {
+                stats.push_back({});
+                stats.back().name = frame.draws[i];
+            }
+
+            auto &draw = stats[it->second];
+            draw.last = {result[0], result[1], result[2], result[3]};
+            draw.sampleCount++;
+        }
+    }
+
+    void LvePipelineStatistics::logStats() const
+    {
+        for (const auto &draw : stats)
+        {
+            spdlog::info("Pipeline statistics {}: IA vertices {}, VS invocations {}, clipping primitives {}, FS invocations {}",
+                         draw.name,
+                         draw.last.inputAssemblyVertices,
+                         draw.last.vertexShaderInvocations,
+                         draw.last.clippingPrimitives,
+                         draw.last.fragmentShaderInvocations);
+        }
+    }
+
+    void LvePipelineStatistics::writeJson(const std::string &filePath) const
+    {
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("LvePipelineStatistics: Failed to open file");
+        }
+
+        file << "{\n  \"pipelineStatistics\": [";
+        for (size_t i = 0; i < stats.size(); i++)
+        {
+            const auto &draw = stats[i];
+            file << (i ? ",\n" : "\n")
+                 << "    {\"name\": \"" << draw.name << "\""
+                 << ", \"samples\": " << draw.sampleCount
+                 << ", \"inputAssemblyVertices\": " << draw.last.inputAssemblyVertices
+                 << ", \"vertexShaderInvocations\": " << draw.last.vertexShaderInvocations
+                 << ", \"clippingPrimitives\": " << draw.last.clippingPrimitives
+                 << ", \"fragmentShaderInvocations\": " << draw.last.fragmentShaderInvocations << "}";
+        }
+        file << "\n  ]\n}\n";
+    }
+}
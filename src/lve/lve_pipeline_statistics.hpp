@@ -0,0 +1,82 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve
+{
+    // Optional per-draw pipeline-statistics queries. Query pools are only created the first
+    // time the instrumentation is enabled, and while disabled every call is a single branch.
+    class LvePipelineStatistics
+    {
+    public:
+        static constexpr uint32_t MAX_DRAWS = 64;
+
+        struct Counters
+        {
+            uint64_t inputAssemblyVertices{};
+            uint64_t vertexShaderInvocations{};
+            uint64_t clippingPrimitives{};
+            uint64_t fragmentShaderInvocations{};
+        };
+        struct DrawStats
+        {
+            std::string name;
+            Counters last{};
+            uint64_t sampleCount{};
+        };
+
+        LvePipelineStatistics(LveDevice &device, uint32_t framesInFlight);
+        ~LvePipelineStatistics();
+        LvePipelineStatistics(const LvePipelineStatistics &) = delete;
+        LvePipelineStatistics &operator=(const LvePipelineStatistics &) = delete;
+
+        bool isSupported() const { return supported; }
+        bool isEnabled() const { return enabled; }
+        // Takes effect at the next beginFrame
+        void setEnabled(bool enable);
+
+        // Must be recorded outside of a render pass
+        void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        // Draw scopes must begin and end within the same subpass
+        uint32_t beginDraw(VkCommandBuffer commandBuffer, const char *name)
+        {
+            return enabled ? beginQuery(commandBuffer, name) : MAX_DRAWS;
+        }
+        void endDraw(VkCommandBuffer commandBuffer, uint32_t draw)
+        {
+            if (draw < MAX_DRAWS)
+            {
+                endQuery(commandBuffer, draw);
+            }
+        }
+
+        const std::vector<DrawStats> &getStats() const { return stats; }
+        void logStats() const;
+        void writeJson(const std::string &filePath) const;
+
+    private:
+        struct FrameQueries
+        {
+            VkQueryPool queryPool{};
+            std::vector<const char *> draws{};
+        };
+
+        void createQueryPools();
+        uint32_t beginQuery(VkCommandBuffer commandBuffer, const char *name);
+        void endQuery(VkCommandBuffer commandBuffer, uint32_t draw);
+        void collectResults(FrameQueries &frame);
+
+        LveDevice &device;
+        bool supported{};
+        bool enabled{};
+        bool requestedEnabled{};
+        uint32_t framesInFlight{};
+        uint32_t currentFrame{};
+        std::vector<FrameQueries> frames{};
+        std::vector<DrawStats> stats{};
+        std::unordered_map<std::string, size_t> statsIndex{};
+    };
+}
@@ -0,0 +1,501 @@
+#include "lve_point_cloud.hpp"
+#include "lve_job_system.hpp"
+#include "lve_mapped_file.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+
+namespace lve
+{
+    namespace
+    {
+        struct RawPoint
+        {
+            glm::vec3 position;
+            uint8_t color[4];
+        };
+
+        // Subtrees larger than this are built as jobs of their own
+        constexpr uint32_t PARALLEL_POINTS = 1u << 18;
+
+        double secondsSince(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        // Recursive split of a range of points, in place with a scratch copy of the same size
+        class OctreeBuilder
+        {
+        public:
+            OctreeBuilder(std::vector<LvePoint> &points, std::vector<LvePointCloud::Node> &nodes, glm::vec3 origin, float size)
+                : points{points}, scratch(points.size()), nodes{nodes}, origin{origin}, unit{size / 65535.0f} {}
+
+            uint32_t buildNode(uint32_t begin, uint32_t end, uint32_t level, glm::uvec3 cubeMin)
+            {
+                uint32_t maxLevel = depth.load(std::memory_order_relaxed);
+                while (maxLevel < level && !depth.compare_exchange_weak(maxLevel, level, std::memory_order_relaxed))
+                {
+                }
+
+                // Cubes are power of two sized and aligned on the 16-bit grid
+                uint32_t cubeSize = 65536u >> level;
+                float halfSize = 0.5f * static_cast<float>(cubeSize) * unit;
+                LvePointCloud::Node node{origin + (glm::vec3(cubeMin) + 0.5f * static_cast<float>(cubeSize)) * unit,
+                                         halfSize, begin, end - begin, {}};
+                std::fill(std::begin(node.children), std::end(node.children), LvePointCloud::NO_NODE);
+                if (end - begin <= LvePointCloud::LEAF_POINTS || cubeSize == 1)
+                {
+                    return addNode(node);
+                }
+
+                // The first point of every occupied cell stays in the node. The w component marks
+                // the selected points until they are scattered.
+                uint32_t cellBits = std::min(LvePointCloud::GRID_BITS, 16 - level);
+                uint32_t cellShift = 16 - level - cellBits;
+                uint32_t cellMask = (1u << cellBits) - 1;
+                uint32_t octantShift = 15 - level;
+                std::vector<uint64_t> occupied((size_t{1} << (3 * cellBits)) / 64 + 1, 0);
+                uint32_t selectedCount = 0;
+                uint32_t octantCounts[8]{};
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    LvePoint &point = points[i];
+                    uint32_t cell = ((point.position[0] >> cellShift) & cellMask) |
+                                    (((point.position[1] >> cellShift) & cellMask) << cellBits) |
+                                    (((point.position[2] >> cellShift) & cellMask) << (2 * cellBits));
+                    uint64_t bit = uint64_t{1} << (cell % 64);
+                    if (!(occupied[cell / 64] & bit))
+                    {
+                        occupied[cell / 64] |= bit;
+                        point.position[3] = 1;
+                        selectedCount++;
+                    }
+                    else
+                    {
+                        point.position[3] = 0;
+                        octantCounts[octant(point, octantShift)]++;
+                    }
+                }
+
+                // Stable scatter, selected points first and then the rest grouped by octant
+                uint32_t offsets[9]{};
+                offsets[0] = begin + selectedCount;
+                for (uint32_t o = 0; o < 8; o++)
+                {
+                    offsets[o + 1] = offsets[o] + octantCounts[o];
+                }
+                uint32_t selectedOffset = begin;
+                uint32_t octantOffsets[8];
+                std::copy(offsets, offsets + 8, octantOffsets);
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    LvePoint point = points[i];
+                    uint32_t target = point.position[3] ? selectedOffset++ : octantOffsets[octant(point, octantShift)]++;
+                    point.position[3] = 0;
+                    scratch[target] = point;
+                }
+                std::memcpy(points.data() + begin, scratch.data() + begin, size_t{end - begin} * sizeof(LvePoint));
+
+                node.pointCount = selectedCount;
+                uint32_t index = addNode(node);
+
+                // Children are independent ranges, large ones are split across the job system
+                uint32_t children[8];
+                std::fill(std::begin(children), std::end(children), LvePointCloud::NO_NODE);
+                LveJobCounter counter{};
+                uint32_t half = cubeSize / 2;
+                for (uint32_t o = 0; o < 8; o++)
+                {
+                    uint32_t childBegin = offsets[o], childEnd = offsets[o + 1];
+                    if (childBegin == childEnd)
+                    {
+                        continue;
+                    }
+                    glm::uvec3 childMin = cubeMin + glm::uvec3(o & 1, (o >> 1) & 1, (o >> 2) & 1) * half;
+                    if (childEnd - childBegin >= PARALLEL_POINTS)
+                    {
+                        LveJobSystem::get().run([this, &children, o, childBegin, childEnd, level, childMin]()
+                                                { children[o] = buildNode(childBegin, childEnd, level + 1, childMin); },
+                                                counter);
+                    }
+                    else
+                    {
+                        children[o] = buildNode(childBegin, childEnd, level + 1, childMin);
+                    }
+                }
+                LveJobSystem::get().wait(counter);
+
+                std::lock_guard lock{mutex};
+                std::copy(std::begin(children), std::end(children), nodes[index].children);
+                return index;
+            }
+
+            uint32_t getDepth() const { return depth.load(); }
+
+        private:
+            static uint32_t octant(const LvePoint &point, uint32_t shift)
+            {
+                return ((point.position[0] >> shift) & 1) | (((point.position[1] >> shift) & 1) << 1) |
+                       (((point.position[2] >> shift) & 1) << 2);
+            }
+
+            uint32_t addNode(const LvePointCloud::Node &node)
+            {
+                std::lock_guard lock{mutex};
+                nodes.push_back(node);
+                return static_cast<uint32_t>(nodes.size() - 1);
+            }
+
+            std::vector<LvePoint> &points;
+            std::vector<LvePoint> scratch;
+            std::vector<LvePointCloud::Node> &nodes;
+            std::mutex mutex{};
+            std::atomic<uint32_t> depth{};
+            glm::vec3 origin;
+            float unit;
+        };
+
+        enum class PlyType
+        {
+            Int8,
+            UInt8,
+            Int16,
+            UInt16,
+            Int32,
+            UInt32,
+            Float32,
+            Float64
+        };
+
+        PlyType parsePlyType(const std::string &name)
+        {
+            if (name == "char" || name == "int8")
+                return PlyType::Int8;
+            if (name == "uchar" || name == "uint8")
+                return PlyType::UInt8;
+            if (name == "short" || name == "int16")
+                return PlyType::Int16;
+            if (name == "ushort" || name == "uint16")
+                return PlyType::UInt16;
+            if (name == "int" || name == "int32")
+                return PlyType::Int32;
+            if (name == "uint" || name == "uint32")
+                return PlyType::UInt32;
+            if (name == "float" || name == "float32")
+                return PlyType::Float32;
+            if (name == "double" || name == "float64")
+                return PlyType::Float64;
+            throw std::runtime_error("Unknown property type " + name);
+        }
+
+        uint32_t plyTypeSize(PlyType type)
+        {
+            switch (type)
+            {
+            case PlyType::Int8:
+            case PlyType::UInt8:
+                return 1;
+            case PlyType::Int16:
+            case PlyType::UInt16:
+                return 2;
+            case PlyType::Float64:
+                return 8;
+            default:
+                return 4;
+            }
+        }
+    }
+
+    template <typename ReadPoint>
+    LvePointCloud LvePointCloud::build(uint32_t pointCount, ReadPoint &&readPoint)
+    {
+        if (pointCount == 0)
+        {
+            throw std::runtime_error("LvePointCloud: No points");
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        LveJobSystem &jobs = LveJobSystem::get();
+        LvePointCloud cloud{};
+
+        // Bounds first, they define the quantization grid
+        std::mutex mutex{};
+        glm::vec3 lo{FLT_MAX}, hi{-FLT_MAX};
+        jobs.parallelFor(pointCount, 65536, [&](uint32_t begin, uint32_t end)
+                         {
+                             glm::vec3 rangeLo{FLT_MAX}, rangeHi{-FLT_MAX};
+                             for (uint32_t i = begin; i < end; i++)
+                             {
+                                 glm::vec3 position = readPoint(i).position;
+                                 rangeLo = glm::min(rangeLo, position);
+                                 rangeHi = glm::max(rangeHi, position);
+                             }
+                             std::lock_guard lock{mutex};
+                             lo = glm::min(lo, rangeLo);
+                             hi = glm::max(hi, rangeHi); });
+        glm::vec3 extent = hi - lo;
+        cloud.origin = lo;
+        cloud.size = std::max({extent.x, extent.y, extent.z, FLT_MIN});
+        if (!std::isfinite(cloud.size))
+        {
+            throw std::runtime_error("LvePointCloud: Positions are not finite");
+        }
+
+        float scale = 65535.0f / cloud.size;
+        cloud.points.resize(pointCount);
+        jobs.parallelFor(pointCount, 65536, [&](uint32_t begin, uint32_t end)
+                         {
+                             for (uint32_t i = begin; i < end; i++)
+                             {
+                                 RawPoint raw = readPoint(i);
+                                 glm::vec3 q = glm::clamp((raw.position - lo) * scale + 0.5f, glm::vec3(0.0f), glm::vec3(65535.0f));
+                                 LvePoint &point = cloud.points[i];
+                                 point.position[0] = static_cast<uint16_t>(q.x);
+                                 point.position[1] = static_cast<uint16_t>(q.y);
+                                 point.position[2] = static_cast<uint16_t>(q.z);
+                                 point.position[3] = 0;
+                                 std::memcpy(point.color, raw.color, sizeof(point.color));
+                             } });
+        cloud.loadTimes.read = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        OctreeBuilder builder{cloud.points, cloud.nodes, cloud.origin, cloud.size};
+        builder.buildNode(0, pointCount, 0, glm::uvec3(0));
+        cloud.depth = builder.getDepth();
+        cloud.loadTimes.build = secondsSince(start);
+        return cloud;
+    }
+
+    LvePointCloud LvePointCloud::loadPly(const std::string &path)
+    {
+        LveMappedFile file{path};
+        const char *text = reinterpret_cast<const char *>(file.getData());
+        std::string_view content{text, file.getSize()};
+        size_t headerEnd = content.find("end_header\n");
+        if (content.substr(0, 4) != "ply\n" || headerEnd == std::string_view::npos)
+        {
+            throw std::runtime_error("LvePointCloud: Not a PLY file: " + path);
+        }
+
+        // Elements ahead of the vertices are skipped, they need a fixed size for that
+        std::istringstream header{std::string(content.substr(0, headerEnd))};
+        std::string line{};
+        std::string format{};
+        bool inVertex = false, vertexSeen = false;
+        uint64_t skipBytes = 0, elementCount = 0, elementStride = 0;
+        uint64_t vertexCount = 0, vertexStride = 0;
+        int64_t offsets[6] = {-1, -1, -1, -1, -1, -1};
+        PlyType types[6]{};
+        const char *names[6] = {"x", "y", "z", "red", "green", "blue"};
+        while (std::getline(header, line))
+        {
+            std::istringstream words{line};
+            std::string keyword{};
+            words >> keyword;
+            if (keyword == "format")
+            {
+                words >> format;
+            }
+            else if (keyword == "element")
+            {
+                if (!vertexSeen)
+                {
+                    skipBytes += elementCount * elementStride;
+                }
+                std::string name{};
+                words >> name >> elementCount;
+                elementStride = 0;
+                inVertex = name == "vertex";
+                if (inVertex)
+                {
+                    if (vertexSeen)
+                    {
+                        throw std::runtime_error("LvePointCloud: Several vertex elements in " + path);
+                    }
+                    vertexSeen = true;
+                    vertexCount = elementCount;
+                }
+            }
+            else if (keyword == "property")
+            {
+                std::string type{}, name{};
+                words >> type;
+                if (type == "list")
+                {
+                    if (!vertexSeen || inVertex)
+                    {
+                        throw std::runtime_error("LvePointCloud: List properties before the vertices are not supported: " + path);
+                    }
+                    continue;
+                }
+                words >> name;
+                PlyType plyType = parsePlyType(type);
+                if (inVertex)
+                {
+                    for (int i = 0; i < 6; i++)
+                    {
+                        if (name == names[i])
+                        {
+                            offsets[i] = static_cast<int64_t>(elementStride);
+                            types[i] = plyType;
+                        }
+                    }
+                }
+                elementStride += plyTypeSize(plyType);
+                if (inVertex)
+                {
+                    vertexStride = elementStride;
+                }
+            }
+        }
+
+        if (format != "binary_little_endian")
+        {
+            throw std::runtime_error("LvePointCloud: Only binary_little_endian PLY is supported: " + path);
+        }
+        for (int i = 0; i < 3; i++)
+        {
+            if (offsets[i] < 0 || (types[i] != PlyType::Float32 && types[i] != PlyType::Float64))
+            {
+                throw std::runtime_error("LvePointCloud: Vertices need float or double x, y and z: " + path);
+            }
+        }
+        bool hasColor = offsets[3] >= 0 && offsets[4] >= 0 && offsets[5] >= 0 && types[3] == PlyType::UInt8 &&
+                        types[4] == PlyType::UInt8 && types[5] == PlyType::UInt8;
+        if (vertexCount == 0 || vertexCount > UINT32_MAX)
+        {
+            throw std::runtime_error("LvePointCloud: Unsupported vertex count in " + path);
+        }
+
+        uint64_t dataOffset = headerEnd + std::string_view("end_header\n").size() + skipBytes;
+        if (dataOffset > file.getSize() || vertexCount * vertexStride > file.getSize() - dataOffset)
+        {
+            throw std::runtime_error("LvePointCloud: Truncated vertex data in " + path);
+        }
+
+        const std::byte *vertices = file.getData() + dataOffset;
+        auto readComponent = [](const std::byte *src, PlyType type)
+        {
+            if (type == PlyType::Float64)
+            {
+                double value;
+                std::memcpy(&value, src, sizeof(value));
+                return static_cast<float>(value);
+            }
+            float value;
+            std::memcpy(&value, src, sizeof(value));
+            return value;
+        };
+
+        LvePointCloud cloud = build(static_cast<uint32_t>(vertexCount), [&](uint32_t i)
+                                    {
+                                        const std::byte *vertex = vertices + i * vertexStride;
+                                        RawPoint raw{{readComponent(vertex + offsets[0], types[0]),
+                                                      readComponent(vertex + offsets[1], types[1]),
+                                                      readComponent(vertex + offsets[2], types[2])},
+                                                     {255, 255, 255, 255}};
+                                        if (hasColor)
+                                        {
+                                            for (int c = 0; c < 3; c++)
+                                            {
+                                                raw.color[c] = static_cast<uint8_t>(vertex[offsets[3 + c]]);
+                                            }
+                                        }
+                                        return raw; });
+        return cloud;
+    }
+
+    LvePointCloud LvePointCloud::generate(uint32_t pointCount, uint32_t seed)
+    {
+        // Rolling hills on a 1 km square, colored from green valleys to brown tops. Every point
+        // hashes its own index, so the ranges of the parallel passes agree.
+        auto random = [seed](uint64_t i)
+        {
+            uint64_t z = (i + (uint64_t{seed} << 32)) * 0x9E3779B97F4A7C15ull;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        };
+
+        return build(pointCount, [&](uint32_t i)
+                     {
+                         uint64_t bits = random(i);
+                         float x = static_cast<float>(bits & 0xFFFFFF) / 16777216.0f * 1000.0f;
+                         float z = static_cast<float>((bits >> 24) & 0xFFFFFF) / 16777216.0f * 1000.0f;
+                         float height = 40.0f * std::sin(x * 0.011f) * std::cos(z * 0.007f) +
+                                        8.0f * std::sin(x * 0.05f + z * 0.03f) + 1.5f * std::sin(x * 0.4f) * std::sin(z * 0.35f);
+                         float t = std::clamp((height + 50.0f) / 100.0f, 0.0f, 1.0f);
+                         RawPoint raw{{x, height, z},
+                                      {static_cast<uint8_t>(60 + 120 * t), static_cast<uint8_t>(140 - 40 * t),
+                                       static_cast<uint8_t>(50 + 20 * t), 255}};
+                         return raw; });
+    }
+
+    uint64_t LvePointCloud::select(const LveFrustum &frustum, const glm::vec3 &eye, float pixelsPerUnit,
+                                   float minSpacingPixels, uint64_t pointBudget, std::vector<uint32_t> &selected) const
+    {
+        selected.clear();
+        auto visible = [&](const Node &node)
+        {
+            float radius = node.halfSize * 1.7320508f;
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                if (glm::dot(glm::vec3(plane), node.center) + plane.w < -radius)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        // Projected size of the node's bounding sphere, unbounded once the eye is inside
+        auto projectedSize = [&](const Node &node)
+        {
+            float radius = node.halfSize * 1.7320508f;
+            float distance = glm::length(node.center - eye) - radius;
+            return distance <= 0.0f ? FLT_MAX : radius / distance * pixelsPerUnit;
+        };
+
+        // Largest on screen first, so the budget goes where detail is most visible
+        std::priority_queue<std::pair<float, uint32_t>> queue{};
+        if (visible(nodes[0]))
+        {
+            queue.emplace(projectedSize(nodes[0]), 0);
+        }
+
+        uint64_t pointCount = 0;
+        while (!queue.empty())
+        {
+            auto [priority, index] = queue.top();
+            queue.pop();
+            const Node &node = nodes[index];
+            if (pointCount + node.pointCount > pointBudget)
+            {
+                break;
+            }
+            selected.push_back(index);
+            pointCount += node.pointCount;
+
+            // Refined while the node's cell spacing still shows as gaps on screen
+            float spacingPixels = priority * (2.0f / GRID) / 1.7320508f;
+            if (spacingPixels < minSpacingPixels)
+            {
+                continue;
+            }
+            for (uint32_t child : node.children)
+            {
+                if (child != NO_NODE && visible(nodes[child]))
+                {
+                    queue.emplace(projectedSize(nodes[child]), child);
+                }
+            }
+        }
+        return pointCount;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "lve_frustum_culling.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve
+{
+    // 12 bytes, read by the vertex shader as R16G16B16A16_UNORM and R8G8B8A8_UNORM. Positions are
+    // quantized to a 16-bit grid over the cloud's bounding cube, w is unused.
+    struct LvePoint
+    {
+        uint16_t position[4];
+        uint8_t color[4];
+    };
+
+    // Point cloud arranged as an octree for level of detail. A node keeps at most one point per
+    // cell of a GRID^3 grid over its cube, its children keep the rest, so a node drawn together
+    // with its ancestors shows the cloud at the node's cell spacing. Every node is a contiguous
+    // range of getPoints() and its subtree directly follows it.
+    class LvePointCloud
+    {
+    public:
+        static constexpr uint32_t GRID_BITS = 5;
+        static constexpr uint32_t GRID = 1u << GRID_BITS;
+        // Nodes with fewer points are not split
+        static constexpr uint32_t LEAF_POINTS = 8192;
+        static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+        struct Node
+        {
+            glm::vec3 center;
+            float halfSize;
+            uint32_t firstPoint;
+            uint32_t pointCount;
+            uint32_t children[8];
+        };
+
+        // Loading phases in seconds, for the throughput log
+        struct LoadTimes
+        {
+            double read;
+            double build;
+        };
+
+        // Binary little endian PLY with float or double x, y, z and optional uchar red, green, blue
+        // vertex properties. The file is mapped and converted in parallel.
+        static LvePointCloud loadPly(const std::string &path);
+        // Procedural terrain, for running without a capture at hand
+        static LvePointCloud generate(uint32_t pointCount, uint32_t seed);
+
+        const std::vector<LvePoint> &getPoints() const { return points; }
+        const std::vector<Node> &getNodes() const { return nodes; }
+        uint32_t getDepth() const { return depth; }
+        const LoadTimes &getLoadTimes() const { return loadTimes; }
+        // World position of a point is origin + unorm position * size
+        glm::vec3 getOrigin() const { return origin; }
+        float getSize() const { return size; }
+
+        // Nodes intersecting the frustum, largest on screen first. Children are only visited while
+        // their parent's cell spacing projects to at least minSpacingPixels, and selection stops
+        // before pointBudget would be exceeded. pixelsPerUnit is the projected pixel size of a unit
+        // length at unit distance. Returns the selected point count.
+        uint64_t select(const LveFrustum &frustum, const glm::vec3 &eye, float pixelsPerUnit, float minSpacingPixels,
+                        uint64_t pointBudget, std::vector<uint32_t> &selected) const;
+
+    private:
+        template <typename ReadPoints>
+        static LvePointCloud build(uint32_t pointCount, ReadPoints &&readPoints);
+
+        std::vector<LvePoint> points{};
+        std::vector<Node> nodes{};
+        uint32_t depth{};
+        LoadTimes loadTimes{};
+        glm::vec3 origin{};
+        float size{};
+    };
+}
@@ -0,0 +1,371 @@
+#include "lve_render_queue.hpp"
+#include "lve_benchmark.hpp"
+#include "lve_job_system.hpp"
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace lve
+{
+    static constexpr uint32_t DESCRIPTOR_SET_SHIFT = LveRenderQueue::MESH_BITS + LveRenderQueue::DEPTH_BITS;
+    static constexpr uint32_t PIPELINE_SHIFT = DESCRIPTOR_SET_SHIFT + LveRenderQueue::DESCRIPTOR_SET_BITS;
+    static constexpr uint32_t PASS_SHIFT = PIPELINE_SHIFT + LveRenderQueue::PIPELINE_BITS;
+
+    static constexpr uint32_t RADIX_BITS = 8;
+    static constexpr uint32_t RADIX = 1u << RADIX_BITS;
+    static constexpr uint32_t DIGIT_COUNT = 64 / RADIX_BITS;
+
+    static uint32_t keyField(uint64_t key, uint32_t shift, uint32_t bits)
+    {
+        return static_cast<uint32_t>((key >> shift) & ((1ull << bits) - 1));
+    }
+
+    LveRenderQueue::LveRenderQueue(LveDevice &device, uint32_t framesInFlight, uint32_t maxPackets)
+        : device{device}, maxPackets{maxPackets}
+    {
+        instanceBuffers.resize(framesInFlight);
+        for (auto &instanceBuffer : instanceBuffers)
+        {
+            instanceBuffer = std::make_unique<LveBuffer>(
+                device,
+                sizeof(LveDrawList::Instance) * maxPackets,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            instanceBuffer->map();
+        }
+
+        packets.reserve(maxPackets);
+        scratch.reserve(maxPackets);
+        instances.reserve(maxPackets);
+    }
+
+    uint32_t LveRenderQueue::registerPipeline(LvePipeline &pipeline, VkPipelineLayout layout)
+    {
+        if (pipelines.size() >= (1u << PIPELINE_BITS))
+        {
+            throw std::runtime_error("LveRenderQueue: Too many pipelines");
+        }
+        pipelines.push_back({&pipeline, layout});
+        return static_cast<uint32_t>(pipelines.size() - 1);
+    }
+
+    uint32_t LveRenderQueue::registerDescriptorSet(VkDescriptorSet descriptorSet)
+    {
+        if (descriptorSets.size() >= (1u << DESCRIPTOR_SET_BITS))
+        {
+            throw std::runtime_error("LveRenderQueue: Too many descriptor sets");
+        }
+        descriptorSets.push_back(descriptorSet);
+        return static_cast<uint32_t>(descriptorSets.size() - 1);
+    }
+
+    uint32_t LveRenderQueue::registerMesh(LveModel &model, uint32_t mesh)
+    {
+        if (meshes.size() >= (1u << MESH_BITS))
+        {
+            throw std::runtime_error("LveRenderQueue: Too many meshes");
+        }
+        meshes.push_back({&model, mesh});
+        return static_cast<uint32_t>(meshes.size() - 1);
+    }
+
+    uint64_t LveRenderQueue::makeKey(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth)
+    {
+        constexpr float DEPTH_SCALE = static_cast<float>((1u << DEPTH_BITS) - 1);
+        uint64_t quantizedDepth = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * DEPTH_SCALE);
+
+        return static_cast<uint64_t>(pass) << PASS_SHIFT |
+               static_cast<uint64_t>(pipeline) << PIPELINE_SHIFT |
+               static_cast<uint64_t>(descriptorSet) << DESCRIPTOR_SET_SHIFT |
+               static_cast<uint64_t>(mesh) << DEPTH_BITS |
+               quantizedDepth;
+    }
+
+    void LveRenderQueue::clear()
+    {
+        packets.clear();
+        instances.clear();
+    }
+
+    void LveRenderQueue::submit(uint64_t key, const LveDrawList::Instance &instance)
+    {
+        packets.push_back({key, static_cast<uint32_t>(instances.size())});
+        instances.push_back(instance);
+    }
+
+    void LveRenderQueue::build(uint32_t frameIndex)
+    {
+        LVE_TRACE_ZONE("LveRenderQueue::build");
+        if (packets.size() > maxPackets)
+        {
+            throw std::runtime_error("LveRenderQueue: Packet capacity exceeded");
+        }
+
+        currentFrame = frameIndex;
+        replayStats = {};
+        sort(packets, scratch);
+
+        // Instances follow the packet order, so a run of equal state is a contiguous instance range
+        auto *mappedInstances = static_cast<LveDrawList::Instance *>(instanceBuffers[currentFrame]->getMappedMemory());
+        for (size_t i = 0; i < packets.size(); i++)
+        {
+            mappedInstances[i] = instances[packets[i].instance];
+        }
+    }
+
+    void LveRenderQueue::draw(VkCommandBuffer commandBuffer, uint32_t pass)
+    {
+        LVE_TRACE_ZONE("LveRenderQueue::draw");
+
+        // Packets are sorted, so the pass is one contiguous range
+        auto first = std::partition_point(packets.begin(), packets.end(), [pass](const Packet &packet)
+                                          { return (packet.key >> PASS_SHIFT) < pass; });
+        auto last = std::partition_point(first, packets.end(), [pass](const Packet &packet)
+                                         { return (packet.key >> PASS_SHIFT) == pass; });
+        if (first == last)
+        {
+            return;
+        }
+
+        VkBuffer instanceBuffer = instanceBuffers[currentFrame]->getBuffer();
+        VkDeviceSize offset = 0;
+        device.disp.cmdBindVertexBuffers(commandBuffer, 1, 1, &instanceBuffer, &offset);
+
+        uint32_t boundPipeline = std::numeric_limits<uint32_t>::max();
+        uint32_t boundDescriptorSet = NO_DESCRIPTOR_SET;
+        VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+        VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+
+        auto it = first;
+        while (it != last)
+        {
+            // Everything above the depth bits is draw state
+            uint64_t state = it->key >> DEPTH_BITS;
+            auto runEnd = std::find_if(it + 1, last, [state](const Packet &packet)
+                                       { return (packet.key >> DEPTH_BITS) != state; });
+
+            uint32_t pipeline = keyField(it->key, PIPELINE_SHIFT, PIPELINE_BITS);
+            uint32_t descriptorSet = keyField(it->key, DESCRIPTOR_SET_SHIFT, DESCRIPTOR_SET_BITS);
+            const auto &meshEntry = meshes[keyField(it->key, DEPTH_BITS, MESH_BITS)];
+
+            if (pipeline != boundPipeline)
+            {
+                pipelines[pipeline].pipeline->bind(commandBuffer);
+                boundPipeline = pipeline;
+                replayStats.pipelineBinds++;
+            }
+            if (descriptorSet != NO_DESCRIPTOR_SET && descriptorSet != boundDescriptorSet)
+            {
+                device.disp.cmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[pipeline].layout,
+                                                  0, 1, &descriptorSets[descriptorSet], 0, nullptr);
+                boundDescriptorSet = descriptorSet;
+                replayStats.descriptorSetBinds++;
+            }
+
+            VkBuffer vertexBuffer = meshEntry.model->getVertexBuffer();
+            if (vertexBuffer != boundVertexBuffer)
+            {
+                device.disp.cmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+                boundVertexBuffer = vertexBuffer;
+                replayStats.vertexBufferBinds++;
+            }
+            VkBuffer indexBuffer = meshEntry.model->getIndexBuffer();
+            if (indexBuffer != boundIndexBuffer)
+            {
+                device.disp.cmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                boundIndexBuffer = indexBuffer;
+                replayStats.indexBufferBinds++;
+            }
+
+            const auto &mesh = meshEntry.model->getMesh(meshEntry.mesh);
+            device.disp.cmdDrawIndexed(
+                commandBuffer,
+                mesh.indexCount,
+                static_cast<uint32_t>(runEnd - it),
+                mesh.firstIndex,
+                mesh.vertexOffset,
+                static_cast<uint32_t>(it - packets.begin()));
+            replayStats.draws++;
+
+            it = runEnd;
+        }
+        replayStats.packets += static_cast<uint32_t>(last - first);
+    }
+
+    void LveRenderQueue::sort(std::vector<Packet> &packets, std::vector<Packet> &scratch)
+    {
+        uint32_t threadCount = LveJobSystem::get().getThreadCount();
+        radixSort(packets, scratch, packets.size() < PARALLEL_THRESHOLD ? 1 : threadCount);
+    }
+
+    void LveRenderQueue::radixSort(std::vector<Packet> &packets, std::vector<Packet> &scratch, uint32_t threadCount)
+    {
+        size_t count = packets.size();
+        scratch.resize(count);
+        if (count < 2)
+        {
+            return;
+        }
+
+        // One block of packets per thread, every phase below is a fork-join over the blocks
+        LveJobSystem &jobSystem = LveJobSystem::get();
+        auto forEachBlock = [&](auto &&function)
+        {
+            jobSystem.parallelFor(threadCount, 1, [&](uint32_t firstBlock, uint32_t lastBlock)
+                                  {
+                                      for (uint32_t t = firstBlock; t < lastBlock; t++)
+                                      {
+                                          function(t, count * t / threadCount, count * (t + 1) / threadCount);
+                                      }
+                                  });
+        };
+
+        // Histograms of all digits from one read, per block and in the input order
+        std::vector<std::array<uint32_t, DIGIT_COUNT * RADIX>> digitCounts(threadCount);
+        // Per-block bucket counts of the current digit, in the current order
+        std::vector<std::array<uint32_t, RADIX>> passCounts(threadCount);
+
+        forEachBlock([&](uint32_t t, size_t begin, size_t end)
+                     {
+                         auto &counts = digitCounts[t];
+                         counts.fill(0);
+                         for (size_t i = begin; i < end; i++)
+                         {
+                             uint64_t key = packets[i].key;
+                             for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++)
+                             {
+                                 counts[digit * RADIX + ((key >> (digit * RADIX_BITS)) & (RADIX - 1))]++;
+                             }
+                         }
+                     });
+
+        Packet *src = packets.data();
+        Packet *dst = scratch.data();
+        bool firstPass = true;
+        uint32_t passCount = 0;
+        for (uint32_t digit = 0; digit < DIGIT_COUNT; digit++)
+        {
+            // Skip digits where every key agrees, the high fields are often constant
+            std::array<uint32_t, RADIX> totals{};
+            bool constant = false;
+            for (uint32_t bucket = 0; bucket < RADIX; bucket++)
+            {
+                for (uint32_t t = 0; t < threadCount; t++)
+                {
+                    totals[bucket] += digitCounts[t][digit * RADIX + bucket];
+                }
+                constant = constant || totals[bucket] == count;
+            }
+            if (constant)
+            {
+                continue;
+            }
+
+            uint32_t shift = digit * RADIX_BITS;
+            if (firstPass)
+            {
+                for (uint32_t t = 0; t < threadCount; t++)
+                {
+                    std::copy_n(digitCounts[t].begin() + digit * RADIX, RADIX, passCounts[t].begin());
+                }
+            }
+            else
+            {
+                forEachBlock([&](uint32_t t, size_t begin, size_t end)
+                             {
+                                 auto &local = passCounts[t];
+                                 local.fill(0);
+                                 for (size_t i = begin; i < end; i++)
+                                 {
+                                     local[(src[i].key >> shift) & (RADIX - 1)]++;
+                                 }
+                             });
+            }
+            firstPass = false;
+
+            // Each block scatters after the same buckets of the blocks before it, which keeps the
+            // sort stable
+            forEachBlock([&](uint32_t t, size_t begin, size_t end)
+                         {
+                             std::array<uint32_t, RADIX> offsets{};
+                             uint32_t offset = 0;
+                             for (uint32_t bucket = 0; bucket < RADIX; bucket++)
+                             {
+                                 offsets[bucket] = offset;
+                                 for (uint32_t other = 0; other < t; other++)
+                                 {
+                                     offsets[bucket] += passCounts[other][bucket];
+                                 }
+                                 offset += totals[bucket];
+                             }
+
+                             for (size_t i = begin; i < end; i++)
+                             {
+                                 dst[offsets[(src[i].key >> shift) & (RADIX - 1)]++] = src[i];
+                             }
+                         });
+
+            std::swap(src, dst);
+            passCount++;
+        }
+
+        // After an odd number of passes the sorted packets are in the scratch buffer
+        if (passCount % 2 == 1)
+        {
+            packets.swap(scratch);
+        }
+    }
+
+    void LveRenderQueue::benchmark(uint32_t packetCount)
+    {
+        // A frame-like mix: few passes and pipelines, more meshes, random depth
+        std::mt19937 random{1234};
+        std::uniform_int_distribution<uint32_t> pass{0, 2};
+        std::uniform_int_distribution<uint32_t> pipeline{0, 15};
+        std::uniform_int_distribution<uint32_t> descriptorSet{0, 63};
+        std::uniform_int_distribution<uint32_t> mesh{0, 1023};
+        std::uniform_real_distribution<float> depth{0.0f, 1.0f};
+
+        std::vector<Packet> input(packetCount);
+        for (uint32_t i = 0; i < packetCount; i++)
+        {
+            input[i] = {makeKey(pass(random), pipeline(random), descriptorSet(random), mesh(random), depth(random)), i};
+        }
+
+        std::vector<Packet> sorted{};
+        std::vector<Packet> scratch{};
+        auto measure = [&](auto &&run)
+        {
+            // Every run sorts a fresh copy of the input
+            return static_cast<double>(packetCount) / measureBestNs(run, [&]()
+                                                                    { sorted = input; });
+        };
+
+        double stdRate = measure([&]()
+                                 { std::stable_sort(sorted.begin(), sorted.end(), [](const Packet &a, const Packet &b)
+                                                    { return a.key < b.key; }); });
+        std::vector<Packet> reference = sorted;
+
+        uint32_t threadCount = LveJobSystem::get().getThreadCount();
+        double singleRate = measure([&]()
+                                    { radixSort(sorted, scratch, 1); });
+        bool singleMatches = std::equal(sorted.begin(), sorted.end(), reference.begin(), [](const Packet &a, const Packet &b)
+                                        { return a.key == b.key && a.instance == b.instance; });
+        double parallelRate = measure([&]()
+                                      { radixSort(sorted, scratch, threadCount); });
+        bool parallelMatches = std::equal(sorted.begin(), sorted.end(), reference.begin(), [](const Packet &a, const Packet &b)
+                                          { return a.key == b.key && a.instance == b.instance; });
+
+        spdlog::info("Render queue benchmark, {} packets: std::stable_sort {:.3f} packets/ns, radix {:.3f} packets/ns "
+                     "single thread ({:.1f}x), {:.3f} packets/ns on {} threads ({:.1f}x)",
+                     packetCount, stdRate, singleRate, singleRate / stdRate, parallelRate, threadCount, parallelRate / stdRate);
+        if (!singleMatches || !parallelMatches)
+        {
+            spdlog::warn("Render queue benchmark: radix sort result differs from std::stable_sort");
+        }
+    }
+}
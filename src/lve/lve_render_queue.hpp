@@ -0,0 +1,103 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_draw_list.hpp"
+#include "lve_model.hpp"
+#include "lve_pipeline.hpp"
+#include <memory>
+#include <vector>
+
+namespace lve
+{
+    // Draw packets sorted by a 64-bit key, most significant field first:
+    // pass | pipeline | descriptor set | mesh | depth.
+    // After the sort, packets sharing everything but depth are adjacent, so replay merges them
+    // into one instanced draw and only binds state that differs from the previous draw.
+    class LveRenderQueue
+    {
+    public:
+        static constexpr uint32_t PASS_BITS = 4;
+        static constexpr uint32_t PIPELINE_BITS = 10;
+        static constexpr uint32_t DESCRIPTOR_SET_BITS = 10;
+        static constexpr uint32_t MESH_BITS = 16;
+        static constexpr uint32_t DEPTH_BITS = 24;
+        static_assert(PASS_BITS + PIPELINE_BITS + DESCRIPTOR_SET_BITS + MESH_BITS + DEPTH_BITS == 64);
+
+        // Descriptor set id meaning nothing is bound at set 0
+        static constexpr uint32_t NO_DESCRIPTOR_SET = 0;
+        static constexpr uint32_t PARALLEL_THRESHOLD = 65536;
+
+        struct Packet
+        {
+            uint64_t key;
+            // Index of the packet's instance in submission order
+            uint32_t instance;
+        };
+
+        struct ReplayStats
+        {
+            uint32_t packets;
+            uint32_t draws;
+            uint32_t pipelineBinds;
+            uint32_t descriptorSetBinds;
+            uint32_t vertexBufferBinds;
+            uint32_t indexBufferBinds;
+        };
+
+        LveRenderQueue(LveDevice &device, uint32_t framesInFlight, uint32_t maxPackets);
+        LveRenderQueue(const LveRenderQueue &) = delete;
+        LveRenderQueue &operator=(const LveRenderQueue &) = delete;
+
+        // Ids are stable for the lifetime of the queue and are what packet keys refer to
+        uint32_t registerPipeline(LvePipeline &pipeline, VkPipelineLayout layout);
+        uint32_t registerDescriptorSet(VkDescriptorSet descriptorSet);
+        uint32_t registerMesh(LveModel &model, uint32_t mesh);
+
+        // depth is clamped to [0, 1], pass 1 - depth to sort back to front
+        static uint64_t makeKey(uint32_t pass, uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, float depth);
+
+        void clear();
+        void submit(uint64_t key, const LveDrawList::Instance &instance);
+        // Sorts the packets and writes their instances in sorted order into this frame's buffer,
+        // the frame's fence must have been waited on
+        void build(uint32_t frameIndex);
+        // Replays the packets of one pass, binding the pipeline of the first packet even if the caller
+        // bound it already
+        void draw(VkCommandBuffer commandBuffer, uint32_t pass);
+
+        uint32_t getPacketCount() const { return static_cast<uint32_t>(packets.size()); }
+        // Summed over every pass drawn since the last build()
+        const ReplayStats &getReplayStats() const { return replayStats; }
+
+        // Stable LSD radix sort on the key, split across threads above PARALLEL_THRESHOLD
+        static void sort(std::vector<Packet> &packets, std::vector<Packet> &scratch);
+        // Logs packets/ns of std::stable_sort and of the radix sort on one and on all threads
+        static void benchmark(uint32_t packetCount);
+
+    private:
+        struct PipelineEntry
+        {
+            LvePipeline *pipeline;
+            VkPipelineLayout layout;
+        };
+        struct MeshEntry
+        {
+            LveModel *model;
+            uint32_t mesh;
+        };
+
+        static void radixSort(std::vector<Packet> &packets, std::vector<Packet> &scratch, uint32_t threadCount);
+
+        LveDevice &device;
+        uint32_t maxPackets;
+        uint32_t currentFrame{};
+        std::vector<std::unique_ptr<LveBuffer>> instanceBuffers{};
+        std::vector<PipelineEntry> pipelines{};
+        std::vector<VkDescriptorSet> descriptorSets{VK_NULL_HANDLE};
+        std::vector<MeshEntry> meshes{};
+        std::vector<Packet> packets{};
+        std::vector<Packet> scratch{};
+        std::vector<LveDrawList::Instance> instances{};
+        ReplayStats replayStats{};
+    };
+}
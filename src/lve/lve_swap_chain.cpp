@@ -1,7 +1,9 @@
 #include "lve_swap_chain.hpp"
+#include "lve_trace.hpp"
 
 // std
 #include <array>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -15,6 +17,7 @@ namespace lve
   LveSwapChain::LveSwapChain(LveDevice &deviceRef, VkExtent2D extent)
       : device{deviceRef}, windowExtent{extent}
   {
+    LVE_TRACE_ZONE("LveSwapChain::LveSwapChain");
     createSwapChain();
     createImageViews();
     createRenderPass();
@@ -27,49 +30,53 @@ namespace lve
   {
     for (auto imageView : swapChainImageViews)
     {
-      vkDestroyImageView(device.device(), imageView, nullptr);
+      device.disp.destroyImageView(device.device(), imageView, nullptr);
     }
     swapChainImageViews.clear();
 
     if (swapChain != nullptr)
     {
-      vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
+      device.disp.destroySwapchainKHR(device.device(), swapChain, nullptr);
       swapChain = nullptr;
     }
 
     for (int i = 0; i < depthImages.size(); i++)
     {
-      vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-      vkDestroyImage(device.device(), depthImages[i], nullptr);
-      vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+      device.disp.destroyImageView(device.device(), depthImageViews[i], nullptr);
+      device.disp.destroyImage(device.device(), depthImages[i], nullptr);
+      device.disp.freeMemory(device.device(), depthImageMemorys[i], nullptr);
     }
 
     for (auto framebuffer : swapChainFramebuffers)
     {
-      vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+      device.disp.destroyFramebuffer(device.device(), framebuffer, nullptr);
     }
 
-    vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    device.disp.destroyRenderPass(device.device(), renderPass, nullptr);
 
     // cleanup synchronization objects
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-      vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-      vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-      vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+      device.disp.destroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
+      device.disp.destroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
+      device.disp.destroyFence(device.device(), inFlightFences[i], nullptr);
     }
   }
 
   VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex)
   {
-    vkWaitForFences(
-        device.device(),
-        1,
-        &inFlightFences[currentFrame],
-        VK_TRUE,
-        std::numeric_limits<uint64_t>::max());
+    {
+      LVE_TRACE_ZONE("Wait for frame fence");
+      device.disp.waitForFences(
+          device.device(),
+          1,
+          &inFlightFences[currentFrame],
+          VK_TRUE,
+          std::numeric_limits<uint64_t>::max());
+    }
 
-    VkResult result = vkAcquireNextImageKHR(
+    LVE_TRACE_ZONE("vkAcquireNextImageKHR");
+    VkResult result = device.disp.acquireNextImageKHR(
         device.device(),
         swapChain,
         std::numeric_limits<uint64_t>::max(),
@@ -83,9 +90,11 @@ namespace lve
   VkResult LveSwapChain::submitCommandBuffers(
       const VkCommandBuffer *buffers, uint32_t *imageIndex)
   {
+    auto submitStart = std::chrono::steady_clock::now();
     if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE)
     {
-      vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+      LVE_TRACE_ZONE("Wait for image fence");
+      device.disp.waitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
     }
     imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
@@ -105,11 +114,20 @@ namespace lve
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-        VK_SUCCESS)
+    device.disp.resetFences(device.device(), 1, &inFlightFences[currentFrame]);
     {
-      throw std::runtime_error("failed to submit draw command buffer!");
+      LVE_TRACE_ZONE("vkQueueSubmit");
+      if (device.disp.queueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+          VK_SUCCESS)
+      {
+        throw std::runtime_error("failed to submit draw command buffer!");
+      }
+    }
+
+    auto presentStart = std::chrono::steady_clock::now();
+    if (telemetry)
+    {
+      telemetry->addPhaseTime(LveFrameTelemetry::Phase::Submit, presentStart - submitStart);
     }
 
     VkPresentInfoKHR presentInfo = {};
@@ -124,7 +142,16 @@ namespace lve
 
     presentInfo.pImageIndices = imageIndex;
 
-    auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    VkResult result;
+    {
+      LVE_TRACE_ZONE("vkQueuePresentKHR");
+      result = device.disp.queuePresentKHR(device.presentQueue(), &presentInfo);
+    }
+    if (telemetry)
+    {
+      telemetry->addPhaseTime(
+          LveFrameTelemetry::Phase::Present, std::chrono::steady_clock::now() - presentStart);
+    }
 
     currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -181,7 +208,7 @@ namespace lve
 
     createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-    if (vkCreateSwapchainKHR(device.device(), &createInfo, nullptr, &swapChain) != VK_SUCCESS)
+    if (device.disp.createSwapchainKHR(device.device(), &createInfo, nullptr, &swapChain) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create swap chain!");
     }
@@ -190,9 +217,9 @@ namespace lve
     // allowed to create a swap chain with more. That's why we'll first query the final number of
     // images with vkGetSwapchainImagesKHR, then resize the container and finally call it again to
     // retrieve the handles.
-    vkGetSwapchainImagesKHR(device.device(), swapChain, &imageCount, nullptr);
+    device.disp.getSwapchainImagesKHR(device.device(), swapChain, &imageCount, nullptr);
     swapChainImages.resize(imageCount);
-    vkGetSwapchainImagesKHR(device.device(), swapChain, &imageCount, swapChainImages.data());
+    device.disp.getSwapchainImagesKHR(device.device(), swapChain, &imageCount, swapChainImages.data());
 
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
@@ -214,7 +241,7 @@ namespace lve
       viewInfo.subresourceRange.baseArrayLayer = 0;
       viewInfo.subresourceRange.layerCount = 1;
 
-      if (vkCreateImageView(device.device(), &viewInfo, nullptr, &swapChainImageViews[i]) !=
+      if (device.disp.createImageView(device.device(), &viewInfo, nullptr, &swapChainImageViews[i]) !=
           VK_SUCCESS)
       {
         throw std::runtime_error("failed to create texture image view!");
@@ -228,11 +255,12 @@ namespace lve
     depthAttachment.format = findDepthFormat();
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    // Kept for the next frame's Hi-Z pyramid
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
     VkAttachmentReference depthAttachmentRef{};
     depthAttachmentRef.attachment = 1;
@@ -261,14 +289,26 @@ namespace lve
     VkSubpassDependency dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.srcAccessMask = 0;
-    dependency.srcStageMask =
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    // Compute reads of an earlier frame's depth must finish before it is cleared
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                              VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
     dependency.dstSubpass = 0;
     dependency.dstStageMask =
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.dstAccessMask =
         VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+    // Depth writes are read by compute in later submissions
+    VkSubpassDependency depthReadDependency = {};
+    depthReadDependency.srcSubpass = 0;
+    depthReadDependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depthReadDependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depthReadDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    depthReadDependency.dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    depthReadDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    std::array<VkSubpassDependency, 2> dependencies = {dependency, depthReadDependency};
     std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
     VkRenderPassCreateInfo renderPassInfo = {};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -276,10 +316,10 @@ namespace lve
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+    renderPassInfo.pDependencies = dependencies.data();
 
-    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    if (device.disp.createRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
     {
       throw std::runtime_error("failed to create render pass!");
     }
@@ -302,7 +342,7 @@ namespace lve
       framebufferInfo.height = swapChainExt.height;
       framebufferInfo.layers = 1;
 
-      if (vkCreateFramebuffer(
+      if (device.disp.createFramebuffer(
               device.device(),
               &framebufferInfo,
               nullptr,
@@ -335,7 +375,7 @@ namespace lve
       imageInfo.format = depthFormat;
       imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
       imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-      imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+      imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
       imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
       imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
       imageInfo.flags = 0;
@@ -357,7 +397,7 @@ namespace lve
       viewInfo.subresourceRange.baseArrayLayer = 0;
       viewInfo.subresourceRange.layerCount = 1;
 
-      if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS)
+      if (device.disp.createImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS)
       {
         throw std::runtime_error("failed to create texture image view!");
       }
@@ -380,11 +420,11 @@ namespace lve
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
-      if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
+      if (device.disp.createSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
               VK_SUCCESS ||
-          vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
+          device.disp.createSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
               VK_SUCCESS ||
-          vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
+          device.disp.createFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
       {
         throw std::runtime_error("failed to create synchronization objects for a frame!");
       }
@@ -454,7 +494,7 @@ namespace lve
     return device.findSupportedFormat(
         {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
   }
 
 } // namespace lve
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_frame_telemetry.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -26,11 +27,15 @@ namespace lve
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
     VkRenderPass getRenderPass() { return renderPass; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+    // Left in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL by the render pass
+    VkImage getDepthImage(int index) { return depthImages[index]; }
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
+    uint32_t getCurrentFrame() { return static_cast<uint32_t>(currentFrame); }
 
     float extentAspectRatio()
     {
@@ -40,6 +45,8 @@ namespace lve
 
     VkResult acquireNextImage(uint32_t *imageIndex);
     VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+    // Optional, splits submitCommandBuffers into submit and present phases
+    void setTelemetry(LveFrameTelemetry *frameTelemetry) { telemetry = frameTelemetry; }
 
   private:
     void createSwapChain();
@@ -78,6 +85,7 @@ namespace lve
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;
     size_t currentFrame = 0;
+    LveFrameTelemetry *telemetry = nullptr;
   };
 
 } // namespace lve
@@ -0,0 +1,23 @@
+#include "lve_task.hpp"
+#include <algorithm>
+
+namespace lve
+{
+    void LveFrameScheduler::pump(uint64_t completedSerial)
+    {
+        {
+            std::lock_guard lock{mutex};
+            auto firstWaiting = std::stable_partition(waiters.begin(), waiters.end(), [completedSerial](const Waiter &waiter)
+                                                      { return waiter.serial <= completedSerial; });
+            ready.assign(waiters.begin(), firstWaiting);
+            waiters.erase(waiters.begin(), firstWaiting);
+        }
+
+        // Outside the lock, resumed coroutines may await the scheduler again
+        for (const Waiter &waiter : ready)
+        {
+            waiter.handle.resume();
+        }
+        ready.clear();
+    }
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "lve_job_system.hpp"
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace lve
+{
+    template <typename T = void>
+    class LveTask;
+
+    // Shared by the promises of LveTask<T> and LveTask<void>
+    class LveTaskPromiseBase
+    {
+    public:
+        // Lazy, the task runs once it is awaited or started
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                LveTaskPromiseBase &promise = handle.promise();
+                // Read before done is published, the owner may destroy the frame right after
+                std::coroutine_handle<> continuation = promise.continuation;
+                promise.done.store(true, std::memory_order_release);
+                return continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() { exception = std::current_exception(); }
+
+        std::coroutine_handle<> continuation{std::noop_coroutine()};
+        std::exception_ptr exception{};
+        std::atomic<bool> done{};
+    };
+
+    // Coroutine returning T. Awaiting it from another coroutine starts it and resumes the awaiting
+    // coroutine on whichever thread the task finishes. The top level task is started from a plain
+    // function with start() and polled with isDone(), it must outlive its coroutine.
+    template <typename T>
+    class LveTask
+    {
+    public:
+        class promise_type : public LveTaskPromiseBase
+        {
+        public:
+            LveTask get_return_object() { return LveTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            void return_value(T result) { value.emplace(std::move(result)); }
+
+            std::optional<T> value{};
+        };
+
+        LveTask() = default;
+        LveTask(LveTask &&other) noexcept : handle{std::exchange(other.handle, {})} {}
+        LveTask &operator=(LveTask &&other) noexcept
+        {
+            if (this != &other)
+            {
+                destroy();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+        ~LveTask() { destroy(); }
+
+        void start() { handle.resume(); }
+        bool isValid() const { return static_cast<bool>(handle); }
+        bool isDone() const { return handle && handle.promise().done.load(std::memory_order_acquire); }
+        // Only once isDone(), rethrows an exception escaping the coroutine
+        T get()
+        {
+            if (handle.promise().exception)
+            {
+                std::rethrow_exception(handle.promise().exception);
+            }
+            return std::move(*handle.promise().value);
+        }
+
+        auto operator co_await() &&noexcept
+        {
+            struct Awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+                T await_resume()
+                {
+                    if (handle.promise().exception)
+                    {
+                        std::rethrow_exception(handle.promise().exception);
+                    }
+                    return std::move(*handle.promise().value);
+                }
+            };
+            return Awaiter{handle};
+        }
+
+    private:
+        explicit LveTask(std::coroutine_handle<promise_type> handle) : handle{handle} {}
+        void destroy()
+        {
+            if (handle)
+            {
+                handle.destroy();
+                handle = {};
+            }
+        }
+
+        std::coroutine_handle<promise_type> handle{};
+    };
+
+    template <>
+    class LveTask<void>
+    {
+    public:
+        class promise_type : public LveTaskPromiseBase
+        {
+        public:
+            LveTask get_return_object() { return LveTask{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            void return_void() {}
+        };
+
+        LveTask() = default;
+        LveTask(LveTask &&other) noexcept : handle{std::exchange(other.handle, {})} {}
+        LveTask &operator=(LveTask &&other) noexcept
+        {
+            if (this != &other)
+            {
+                destroy();
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+        ~LveTask() { destroy(); }
+
+        void start() { handle.resume(); }
+        bool isValid() const { return static_cast<bool>(handle); }
+        bool isDone() const { return handle && handle.promise().done.load(std::memory_order_acquire); }
+        void get()
+        {
+            if (handle.promise().exception)
+            {
+                std::rethrow_exception(handle.promise().exception);
+            }
+        }
+
+        auto operator co_await() &&noexcept
+        {
+            struct Awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+                void await_resume()
+                {
+                    if (handle.promise().exception)
+                    {
+                        std::rethrow_exception(handle.promise().exception);
+                    }
+                }
+            };
+            return Awaiter{handle};
+        }
+
+    private:
+        explicit LveTask(std::coroutine_handle<promise_type> handle) : handle{handle} {}
+        void destroy()
+        {
+            if (handle)
+            {
+                handle.destroy();
+                handle = {};
+            }
+        }
+
+        std::coroutine_handle<promise_type> handle{};
+    };
+
+    // co_await resumeOn(jobSystem) continues the coroutine on one of the job system's workers
+    inline auto resumeOn(LveJobSystem &jobSystem)
+    {
+        struct Awaiter
+        {
+            LveJobSystem &jobSystem;
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                jobSystem.run([handle]()
+                              { handle.resume(); });
+            }
+            void await_resume() noexcept {}
+        };
+        return Awaiter{jobSystem};
+    }
+
+    // Resumes coroutines from the render loop, either at its next pump() or once a submitted frame
+    // has completed on the GPU. Frames are identified by serials the loop increments per submit.
+    class LveFrameScheduler
+    {
+    public:
+        // co_await schedule() continues on the thread calling pump()
+        auto schedule() { return Awaiter{*this, 0}; }
+        // co_await waitForFrame(serial) continues on the pump() thread once that frame's fence signalled
+        auto waitForFrame(uint64_t serial) { return Awaiter{*this, serial}; }
+
+        // Resumes everything scheduled or waiting on a frame up to completedSerial. Coroutines that
+        // suspend again while being resumed are kept for a later pump.
+        void pump(uint64_t completedSerial);
+
+    private:
+        struct Waiter
+        {
+            uint64_t serial;
+            std::coroutine_handle<> handle;
+        };
+        struct Awaiter
+        {
+            LveFrameScheduler &scheduler;
+            uint64_t serial;
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                std::lock_guard lock{scheduler.mutex};
+                scheduler.waiters.push_back({serial, handle});
+            }
+            void await_resume() noexcept {}
+        };
+
+        std::mutex mutex{};
+        std::vector<Waiter> waiters{};
+        std::vector<Waiter> ready{};
+    };
+}
@@ -0,0 +1,146 @@
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace lve
+{
+    namespace
+    {
+        struct TraceEvent
+        {
+            const char *name;
+            uint64_t beginNs;
+            uint64_t endNs;
+        };
+
+        struct ThreadBuffer
+        {
+            uint32_t threadId{};
+            std::string threadName{};
+            std::vector<TraceEvent> events{};
+        };
+
+        struct TraceRegistry
+        {
+            std::mutex mutex{};
+            std::vector<std::unique_ptr<ThreadBuffer>> threads{};
+            std::vector<TraceEvent> gpuEvents{};
+        };
+
+        TraceRegistry &registry()
+        {
+            static TraceRegistry instance{};
+            return instance;
+        }
+
+        // Buffers are owned by the registry, so events outlive the thread that recorded them
+        ThreadBuffer &threadBuffer()
+        {
+            thread_local ThreadBuffer *buffer = nullptr;
+            if (!buffer)
+            {
+                auto &traceRegistry = registry();
+                std::lock_guard lock{traceRegistry.mutex};
+                traceRegistry.threads.push_back(std::make_unique<ThreadBuffer>());
+                buffer = traceRegistry.threads.back().get();
+                buffer->threadId = static_cast<uint32_t>(traceRegistry.threads.size());
+                buffer->threadName = "Thread " + std::to_string(buffer->threadId);
+                buffer->events.reserve(1 << 16);
+            }
+            return *buffer;
+        }
+
+        void writeEscaped(std::ostream &file, const std::string &text)
+        {
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    file << '\\';
+                }
+                file << c;
+            }
+        }
+
+        void writeEvent(std::ostream &file, const TraceEvent &event, uint64_t baseNs, uint32_t pid, uint32_t tid)
+        {
+            file << ",\n{\"name\":\"";
+            writeEscaped(file, event.name);
+            file << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+                 << ",\"ts\":" << static_cast<double>(event.beginNs - baseNs) * 1e-3
+                 << ",\"dur\":" << static_cast<double>(event.endNs - event.beginNs) * 1e-3 << "}";
+        }
+    }
+
+    void LveTrace::setThreadName(const char *name)
+    {
+        threadBuffer().threadName = name;
+    }
+
+    void LveTrace::addCpuEvent(const char *name, uint64_t beginNs, uint64_t endNs)
+    {
+        threadBuffer().events.push_back({name, beginNs, endNs});
+    }
+
+    void LveTrace::addGpuEvent(const char *name, uint64_t beginNs, uint64_t endNs)
+    {
+        auto &traceRegistry = registry();
+        std::lock_guard lock{traceRegistry.mutex};
+        traceRegistry.gpuEvents.push_back({name, beginNs, endNs});
+    }
+
+    void LveTrace::writeChromeTrace(const std::string &filePath)
+    {
+        auto &traceRegistry = registry();
+        std::lock_guard lock{traceRegistry.mutex};
+
+        std::ofstream file(filePath);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("LveTrace: Failed to open file");
+        }
+        file.precision(15);
+
+        uint64_t baseNs = UINT64_MAX;
+        for (const auto &thread : traceRegistry.threads)
+        {
+            for (const auto &event : thread->events)
+            {
+                baseNs = std::min(baseNs, event.beginNs);
+            }
+        }
+        for (const auto &event : traceRegistry.gpuEvents)
+        {
+            baseNs = std::min(baseNs, event.beginNs);
+        }
+
+        constexpr uint32_t cpuPid = 1, gpuPid = 2;
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+             << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << cpuPid << ",\"args\":{\"name\":\"CPU\"}},\n"
+             << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << gpuPid << ",\"args\":{\"name\":\"GPU\"}},\n"
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << gpuPid << ",\"tid\":1,\"args\":{\"name\":\"Graphics queue\"}}";
+
+        for (const auto &thread : traceRegistry.threads)
+        {
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << cpuPid << ",\"tid\":" << thread->threadId
+                 << ",\"args\":{\"name\":\"";
+            writeEscaped(file, thread->threadName);
+            file << "\"}}";
+
+            for (const auto &event : thread->events)
+            {
+                writeEvent(file, event, baseNs, cpuPid, thread->threadId);
+            }
+        }
+        for (const auto &event : traceRegistry.gpuEvents)
+        {
+            writeEvent(file, event, baseNs, gpuPid, 1);
+        }
+
+        file << "\n]}\n";
+    }
+}
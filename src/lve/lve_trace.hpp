@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace lve
+{
+    // Scoped CPU zones and GPU scopes exported as Chrome trace-event JSON (Perfetto, chrome://tracing).
+    // Each thread appends into its own buffer, so recording a zone is two clock reads and a push.
+    // writeChromeTrace must only be called once the recording threads are idle.
+    class LveTrace
+    {
+    public:
+        static void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+        static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+        // Host timeline, the same clock calibrated GPU timestamps are mapped to
+        static uint64_t nowNs()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                             std::chrono::steady_clock::now().time_since_epoch())
+                                             .count());
+        }
+
+        static void setThreadName(const char *name);
+        static void addCpuEvent(const char *name, uint64_t beginNs, uint64_t endNs);
+        static void addGpuEvent(const char *name, uint64_t beginNs, uint64_t endNs);
+        static void writeChromeTrace(const std::string &filePath);
+
+        class Zone
+        {
+        public:
+            explicit Zone(const char *name) : name{name}, beginNs{isEnabled() ? nowNs() : 0} {}
+            ~Zone()
+            {
+                if (beginNs)
+                {
+                    addCpuEvent(name, beginNs, nowNs());
+                }
+            }
+            Zone(const Zone &) = delete;
+            Zone &operator=(const Zone &) = delete;
+
+        private:
+            const char *name;
+            uint64_t beginNs;
+        };
+
+    private:
+        static inline std::atomic<bool> enabled{};
+    };
+}
+
+#define LVE_TRACE_CONCAT_INNER(a, b) a##b
+#define LVE_TRACE_CONCAT(a, b) LVE_TRACE_CONCAT_INNER(a, b)
+// Name must be a string literal or otherwise outlive the trace
+#define LVE_TRACE_ZONE(name) ::lve::LveTrace::Zone LVE_TRACE_CONCAT(lveTraceZone, __LINE__){name}
@@ -0,0 +1,486 @@
+#include "lve_transform_hierarchy.hpp"
+#include "lve_benchmark.hpp"
+#include "lve_job_system.hpp"
+#include "lve_trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <memory>
+#include <random>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <type_traits>
+
+// SSE2 is part of x86-64 and NEON of AArch64, neither needs a runtime check
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_TRANSFORM_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define LVE_TRANSFORM_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace lve
+{
+    void LveTransformHierarchy::clear()
+    {
+        nodeToIndex.clear();
+        indexToNode.clear();
+        parents.clear();
+        dirty.clear();
+        for (auto *component : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW,
+                                &scaleX, &scaleY, &scaleZ})
+        {
+            component->clear();
+        }
+        world.clear();
+        subtreeStarts.clear();
+        rangeStarts.clear();
+        partitionedRangeCount = 0;
+        structureChanged = false;
+        anyDirty = false;
+    }
+
+    uint32_t LveTransformHierarchy::add(const Transform &local, uint32_t parent)
+    {
+        if (parent != NO_PARENT && parent >= size())
+        {
+            throw std::runtime_error("LveTransformHierarchy: Parent does not exist");
+        }
+
+        uint32_t node = size();
+        nodeToIndex.push_back(node);
+        indexToNode.push_back(node);
+        parents.push_back(parent == NO_PARENT ? NO_PARENT : nodeToIndex[parent]);
+        dirty.push_back(0);
+        for (auto *component : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW,
+                                &scaleX, &scaleY, &scaleZ})
+        {
+            component->push_back(0.0f);
+        }
+        world.emplace_back(1.0f);
+
+        setLocal(node, local);
+        structureChanged = true;
+        return node;
+    }
+
+    void LveTransformHierarchy::setLocal(uint32_t node, const Transform &local)
+    {
+        setPosition(node, local.position);
+        setRotation(node, local.rotation);
+
+        uint32_t index = nodeToIndex[node];
+        scaleX[index] = local.scale.x;
+        scaleY[index] = local.scale.y;
+        scaleZ[index] = local.scale.z;
+    }
+
+    void LveTransformHierarchy::setPosition(uint32_t node, const glm::vec3 &position)
+    {
+        uint32_t index = nodeToIndex[node];
+        positionX[index] = position.x;
+        positionY[index] = position.y;
+        positionZ[index] = position.z;
+        dirty[index] = 1;
+        anyDirty = true;
+    }
+
+    void LveTransformHierarchy::setRotation(uint32_t node, const glm::quat &rotation)
+    {
+        uint32_t index = nodeToIndex[node];
+        rotationX[index] = rotation.x;
+        rotationY[index] = rotation.y;
+        rotationZ[index] = rotation.z;
+        rotationW[index] = rotation.w;
+        dirty[index] = 1;
+        anyDirty = true;
+    }
+
+    void LveTransformHierarchy::sortDepthFirst()
+    {
+        LVE_TRACE_ZONE("LveTransformHierarchy::sortDepthFirst");
+        uint32_t count = size();
+
+        // Children of each index in compressed rows, in index order
+        std::vector<uint32_t> childStarts(count + 1, 0);
+        for (uint32_t parent : parents)
+        {
+            if (parent != NO_PARENT)
+            {
+                childStarts[parent + 1]++;
+            }
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            childStarts[i + 1] += childStarts[i];
+        }
+        std::vector<uint32_t> children(childStarts[count]);
+        std::vector<uint32_t> fill(childStarts.begin(), childStarts.end() - 1);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (parents[i] != NO_PARENT)
+            {
+                children[fill[parents[i]]++] = i;
+            }
+        }
+
+        // Pre-order walk from every root, order[newIndex] = oldIndex
+        std::vector<uint32_t> order{};
+        order.reserve(count);
+        std::vector<uint32_t> stack{};
+        subtreeStarts.clear();
+        for (uint32_t root = 0; root < count; root++)
+        {
+            if (parents[root] != NO_PARENT)
+            {
+                continue;
+            }
+
+            subtreeStarts.push_back(static_cast<uint32_t>(order.size()));
+            stack.push_back(root);
+            while (!stack.empty())
+            {
+                uint32_t index = stack.back();
+                stack.pop_back();
+                order.push_back(index);
+                for (uint32_t child = childStarts[index + 1]; child > childStarts[index]; child--)
+                {
+                    stack.push_back(children[child - 1]);
+                }
+            }
+        }
+        subtreeStarts.push_back(count);
+
+        std::vector<uint32_t> newIndex(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            newIndex[order[i]] = i;
+        }
+
+        auto permute = [&](auto &values)
+        {
+            std::remove_reference_t<decltype(values)> sorted(values.size());
+            for (uint32_t i = 0; i < count; i++)
+            {
+                sorted[i] = values[order[i]];
+            }
+            values.swap(sorted);
+        };
+
+        for (uint32_t &parent : parents)
+        {
+            parent = parent == NO_PARENT ? NO_PARENT : newIndex[parent];
+        }
+        permute(parents);
+        permute(indexToNode);
+        permute(dirty);
+        for (auto *component : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW,
+                                &scaleX, &scaleY, &scaleZ})
+        {
+            permute(*component);
+        }
+        permute(world);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            nodeToIndex[indexToNode[i]] = i;
+        }
+        partitionedRangeCount = 0;
+    }
+
+    void LveTransformHierarchy::partition(uint32_t rangeCount)
+    {
+        if (partitionedRangeCount == rangeCount)
+        {
+            return;
+        }
+        partitionedRangeCount = rangeCount;
+
+        // Whole subtrees only, cut once a range has reached its share of the nodes
+        uint32_t target = (size() + rangeCount - 1) / rangeCount;
+        rangeStarts.assign(1, 0);
+        for (size_t i = 1; i + 1 < subtreeStarts.size(); i++)
+        {
+            if (subtreeStarts[i] - rangeStarts.back() >= target)
+            {
+                rangeStarts.push_back(subtreeStarts[i]);
+            }
+        }
+        rangeStarts.push_back(size());
+    }
+
+    void LveTransformHierarchy::update()
+    {
+        LVE_TRACE_ZONE("LveTransformHierarchy::update");
+        if (structureChanged)
+        {
+            sortDepthFirst();
+            structureChanged = false;
+        }
+        if (!anyDirty)
+        {
+            return;
+        }
+        anyDirty = false;
+
+        LveJobSystem &jobSystem = LveJobSystem::get();
+        uint32_t threads = threadCount != 0 ? threadCount : jobSystem.getThreadCount();
+        if (size() < PARALLEL_THRESHOLD || threads == 1)
+        {
+            updateRange(0, size());
+            return;
+        }
+
+        // A subtree never depends on another, so ranges of whole subtrees update independently
+        partition(threads);
+        jobSystem.parallelFor(static_cast<uint32_t>(rangeStarts.size() - 1), 1, [this](uint32_t firstRange, uint32_t lastRange)
+                              { updateRange(rangeStarts[firstRange], rangeStarts[lastRange]); });
+    }
+
+    void LveTransformHierarchy::updateRange(uint32_t begin, uint32_t end)
+    {
+        const float *px = positionX.data(), *py = positionY.data(), *pz = positionZ.data();
+        const float *rx = rotationX.data(), *ry = rotationY.data(), *rz = rotationZ.data(), *rw = rotationW.data();
+        const float *sx = scaleX.data(), *sy = scaleY.data(), *sz = scaleZ.data();
+
+        // Local matrices of a block in SoA registers, branch free so the loop vectorizes
+        float local[AFFINE_COMPONENTS][BLOCK_SIZE];
+        auto computeLocal = [&](uint32_t first, uint32_t lanes)
+        {
+            for (uint32_t lane = 0; lane < lanes; lane++)
+            {
+                uint32_t i = first + lane;
+                float x = rx[i], y = ry[i], z = rz[i], w = rw[i];
+
+                local[0][lane] = (1.0f - 2.0f * (y * y + z * z)) * sx[i];
+                local[1][lane] = 2.0f * (x * y + z * w) * sx[i];
+                local[2][lane] = 2.0f * (x * z - y * w) * sx[i];
+                local[3][lane] = 2.0f * (x * y - z * w) * sy[i];
+                local[4][lane] = (1.0f - 2.0f * (x * x + z * z)) * sy[i];
+                local[5][lane] = 2.0f * (y * z + x * w) * sy[i];
+                local[6][lane] = 2.0f * (x * z + y * w) * sz[i];
+                local[7][lane] = 2.0f * (y * z - x * w) * sz[i];
+                local[8][lane] = (1.0f - 2.0f * (x * x + y * y)) * sz[i];
+                local[9][lane] = px[i];
+                local[10][lane] = py[i];
+                local[11][lane] = pz[i];
+            }
+        };
+
+        // World = parent world * local, one column of the parent per vector register. The parent
+        // is loaded whole before the result is written, the compiler cannot tell they never alias.
+        auto multiplyParent = [&](const glm::mat4 &parent, uint32_t lane, glm::mat4 &result)
+        {
+#if defined(LVE_TRANSFORM_SSE2)
+            const float *parentColumns = &parent[0][0];
+            __m128 p0 = _mm_loadu_ps(parentColumns), p1 = _mm_loadu_ps(parentColumns + 4);
+            __m128 p2 = _mm_loadu_ps(parentColumns + 8), p3 = _mm_loadu_ps(parentColumns + 12);
+            float *resultColumns = &result[0][0];
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                __m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[column * 3][lane])),
+                                                     _mm_mul_ps(p1, _mm_set1_ps(local[column * 3 + 1][lane]))),
+                                          _mm_mul_ps(p2, _mm_set1_ps(local[column * 3 + 2][lane])));
+                _mm_storeu_ps(resultColumns + column * 4, column == 3 ? _mm_add_ps(value, p3) : value);
+            }
+#elif defined(LVE_TRANSFORM_NEON)
+            const float *parentColumns = &parent[0][0];
+            float32x4_t p0 = vld1q_f32(parentColumns), p1 = vld1q_f32(parentColumns + 4);
+            float32x4_t p2 = vld1q_f32(parentColumns + 8), p3 = vld1q_f32(parentColumns + 12);
+            float *resultColumns = &result[0][0];
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                float32x4_t value = vmulq_n_f32(p0, local[column * 3][lane]);
+                value = vmlaq_n_f32(value, p1, local[column * 3 + 1][lane]);
+                value = vmlaq_n_f32(value, p2, local[column * 3 + 2][lane]);
+                vst1q_f32(resultColumns + column * 4, column == 3 ? vaddq_f32(value, p3) : value);
+            }
+#else
+            for (uint32_t column = 0; column < 4; column++)
+            {
+                result[column] = parent[0] * local[column * 3][lane] +
+                                 parent[1] * local[column * 3 + 1][lane] +
+                                 parent[2] * local[column * 3 + 2][lane];
+            }
+            result[3] = result[3] + parent[3];
+#endif
+        };
+
+        for (uint32_t blockBegin = begin; blockBegin < end; blockBegin += BLOCK_SIZE)
+        {
+            uint32_t lanes = std::min(end - blockBegin, BLOCK_SIZE);
+
+            // Dirty flags flow down, parents come first so their flag is already final
+            uint8_t blockDirty = 0;
+            for (uint32_t i = blockBegin; i < blockBegin + lanes; i++)
+            {
+                if (parents[i] != NO_PARENT)
+                {
+                    dirty[i] |= dirty[parents[i]];
+                }
+                blockDirty |= dirty[i];
+            }
+            if (!blockDirty)
+            {
+                continue;
+            }
+
+            computeLocal(blockBegin, lanes);
+
+            // A parent earlier in the same block is already done
+            for (uint32_t lane = 0; lane < lanes; lane++)
+            {
+                uint32_t i = blockBegin + lane;
+                if (!dirty[i])
+                {
+                    continue;
+                }
+
+                glm::mat4 &result = world[i];
+                if (parents[i] == NO_PARENT)
+                {
+                    for (uint32_t column = 0; column < 4; column++)
+                    {
+                        result[column] = glm::vec4(local[column * 3][lane],
+                                                   local[column * 3 + 1][lane],
+                                                   local[column * 3 + 2][lane],
+                                                   column == 3 ? 1.0f : 0.0f);
+                    }
+                    continue;
+                }
+
+                multiplyParent(world[parents[i]], lane, result);
+            }
+        }
+
+        // Children in later blocks have read their parents' flags by now
+        std::fill(dirty.begin() + begin, dirty.begin() + end, 0);
+    }
+
+    void LveTransformHierarchy::benchmark(uint32_t nodeCount)
+    {
+        // Roots with 100 node subtrees of random shape, created interleaved so ids are not depth first
+        std::mt19937 random{1234};
+        std::uniform_real_distribution<float> offset{-1.0f, 1.0f};
+        std::uniform_real_distribution<float> angle{0.0f, 6.2831853f};
+        uint32_t rootCount = std::max(1u, nodeCount / 100);
+
+        auto randomTransform = [&]()
+        {
+            Transform local{};
+            local.position = glm::vec3(offset(random), offset(random), offset(random));
+            local.rotation = glm::angleAxis(angle(random), glm::normalize(glm::vec3(offset(random), 1.0f, offset(random))));
+            local.scale = glm::vec3(1.0f + 0.1f * offset(random));
+            return local;
+        };
+
+        // The same hierarchy as heap nodes with child pointers, the layout this replaces
+        struct TreeNode
+        {
+            Transform local;
+            glm::mat4 world;
+            std::vector<TreeNode *> children;
+        };
+        std::vector<std::unique_ptr<TreeNode>> treeNodes{};
+
+        LveTransformHierarchy hierarchy{};
+        std::vector<std::vector<uint32_t>> subtrees(rootCount);
+        for (uint32_t root = 0; root < rootCount; root++)
+        {
+            Transform local = randomTransform();
+            subtrees[root].push_back(hierarchy.add(local));
+            treeNodes.push_back(std::make_unique<TreeNode>(TreeNode{local, glm::mat4{1.0f}, {}}));
+        }
+        for (uint32_t node = rootCount; node < nodeCount; node++)
+        {
+            auto &subtree = subtrees[node % rootCount];
+            uint32_t parent = subtree[std::uniform_int_distribution<size_t>{0, subtree.size() - 1}(random)];
+            Transform local = randomTransform();
+            subtree.push_back(hierarchy.add(local, parent));
+            treeNodes.push_back(std::make_unique<TreeNode>(TreeNode{local, glm::mat4{1.0f}, {}}));
+            treeNodes[parent]->children.push_back(treeNodes.back().get());
+        }
+        hierarchy.update();
+
+        auto walk = [](auto &self, TreeNode &node, const glm::mat4 &parentWorld) -> void
+        {
+            node.world = glm::translate(parentWorld, node.local.position) * glm::mat4_cast(node.local.rotation) *
+                         glm::scale(glm::mat4{1.0f}, node.local.scale);
+            for (TreeNode *child : node.children)
+            {
+                self(self, *child, node.world);
+            }
+        };
+
+        auto measure = [](auto &&run)
+        { return measureBestNs(run, 10) * 1e-6; };
+
+        // Rotating every root dirties the whole hierarchy
+        float time = 0.0f;
+        auto animate = [&](uint32_t stride)
+        {
+            time += 0.01f;
+            for (uint32_t root = 0; root < rootCount; root += stride)
+            {
+                glm::quat rotation = glm::angleAxis(time, glm::vec3(0.0f, 1.0f, 0.0f));
+                hierarchy.setRotation(subtrees[root][0], rotation);
+                treeNodes[root]->local.rotation = rotation;
+            }
+        };
+
+        double treeMs = measure([&]()
+                                {
+                                    animate(1);
+                                    for (uint32_t root = 0; root < rootCount; root++)
+                                    {
+                                        walk(walk, *treeNodes[root], glm::mat4{1.0f});
+                                    }
+                                });
+        hierarchy.setThreadCount(1);
+        double singleMs = measure([&]()
+                                  {
+                                      animate(1);
+                                      hierarchy.update();
+                                  });
+        hierarchy.setThreadCount(0);
+        double parallelMs = measure([&]()
+                                    {
+                                        animate(1);
+                                        hierarchy.update();
+                                    });
+        double sparseMs = measure([&]()
+                                  {
+                                      animate(100);
+                                      hierarchy.update();
+                                  });
+
+        // Both layouts saw the same final animation step
+        animate(1);
+        hierarchy.update();
+        for (uint32_t root = 0; root < rootCount; root++)
+        {
+            walk(walk, *treeNodes[root], glm::mat4{1.0f});
+        }
+        float maxError = 0.0f;
+        for (uint32_t node = 0; node < nodeCount; node++)
+        {
+            const glm::mat4 &expected = treeNodes[node]->world;
+            const glm::mat4 &actual = hierarchy.getWorld(node);
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    maxError = std::max(maxError, std::abs(expected[column][row] - actual[column][row]));
+                }
+            }
+        }
+
+        spdlog::info("Transform benchmark, {} nodes: pointer tree {:.3f} ms, SoA {:.3f} ms single thread, "
+                     "{:.3f} ms on {} threads, {:.3f} ms with 1% of roots changed",
+                     nodeCount, treeMs, singleMs, parallelMs, LveJobSystem::get().getThreadCount(), sparseMs);
+        if (maxError > 1e-3f)
+        {
+            spdlog::warn("Transform benchmark: world matrices differ from the pointer tree by up to {}", maxError);
+        }
+    }
+}
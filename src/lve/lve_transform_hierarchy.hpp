@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace lve
+{
+    // Transform hierarchy in structure-of-arrays form. Nodes are kept in depth-first order, so
+    // parents come before their children and every root's subtree is one contiguous range.
+    // update() recomputes the world matrices of changed nodes and their descendants in one linear
+    // pass, large hierarchies are split across threads at subtree boundaries.
+    class LveTransformHierarchy
+    {
+    public:
+        static constexpr uint32_t NO_PARENT = UINT32_MAX;
+        static constexpr uint32_t BLOCK_SIZE = 8;
+        static constexpr uint32_t PARALLEL_THRESHOLD = 16384;
+
+        struct Transform
+        {
+            glm::vec3 position{0.0f};
+            glm::quat rotation{1.0f, 0.0f, 0.0f, 0.0f};
+            glm::vec3 scale{1.0f};
+        };
+
+        void clear();
+        // Returns the node id, the parent must already exist
+        uint32_t add(const Transform &local, uint32_t parent = NO_PARENT);
+        void setLocal(uint32_t node, const Transform &local);
+        void setPosition(uint32_t node, const glm::vec3 &position);
+        void setRotation(uint32_t node, const glm::quat &rotation);
+        uint32_t size() const { return static_cast<uint32_t>(parents.size()); }
+
+        // Restores depth-first order if nodes were added, then recomputes dirty branches
+        void update();
+        void setThreadCount(uint32_t count) { threadCount = count; }
+
+        const glm::mat4 &getWorld(uint32_t node) const { return world[nodeToIndex[node]]; }
+        // World matrices in internal order, getIndex maps a node id into it
+        const std::vector<glm::mat4> &getWorldMatrices() const { return world; }
+        uint32_t getIndex(uint32_t node) const { return nodeToIndex[node]; }
+
+        // Logs update times for nodeCount transforms against a pointer-based tree walk
+        static void benchmark(uint32_t nodeCount);
+
+    private:
+        // Rows 0-2 of the four columns of a local affine matrix
+        static constexpr uint32_t AFFINE_COMPONENTS = 12;
+
+        void sortDepthFirst();
+        void partition(uint32_t rangeCount);
+        void updateRange(uint32_t begin, uint32_t end);
+
+        uint32_t threadCount{};
+        uint32_t partitionedRangeCount{};
+        bool structureChanged{};
+        bool anyDirty{};
+        std::vector<uint32_t> nodeToIndex{};
+        std::vector<uint32_t> indexToNode{};
+        // Parent index per index, appending keeps parents first but only sorting keeps subtrees contiguous
+        std::vector<uint32_t> parents{};
+        std::vector<uint8_t> dirty{};
+        std::vector<float> positionX{}, positionY{}, positionZ{};
+        std::vector<float> rotationX{}, rotationY{}, rotationZ{}, rotationW{};
+        std::vector<float> scaleX{}, scaleY{}, scaleZ{};
+        std::vector<glm::mat4> world{};
+        // Index where each root's subtree begins, followed by size()
+        std::vector<uint32_t> subtreeStarts{};
+        std::vector<uint32_t> rangeStarts{};
+    };
+}
@@ -14,6 +14,7 @@ namespace lve
         bool shouldClose();
         void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
         VkExtent2D getExtent() { return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}; }
+        GLFWwindow *getGLFWwindow() const { return window; }
 
         LveWindow(const LveWindow &) = delete;
         LveWindow &operator=(const LveWindow &) = delete;
@@ -1,11 +1,131 @@
 #include "first_app.hpp"
+#include "lve_mesh_codec.hpp"
+#include "lve_mesh_normals.hpp"
+#include "lve_trace.hpp"
+#include "lve_transform_hierarchy.hpp"
+#include <algorithm>
+#include <cstdlib>
 #include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
 
-int main()
+int main(int argc, char **argv)
 {
-    lve::FirstApp app{};
+    // --trace <file> records CPU zones and GPU scopes into a Chrome trace-event file
+    // --bench-dispatch times command recording through the loader and the device dispatch table
+    // --instances <count> sets the number of scene instances
+    // --gpu-culling starts with compute culling instead of the CPU draw list
+    // --bench-culling compares the SIMD frustum culling kernels against a naive loop
+    // --bench-queue compares the render queue's radix sort against std::stable_sort
+    // --bench-transforms times world matrix updates of the SoA transform hierarchy
+    // --bench-ecs times entity creation, destruction and queries of the archetype ECS
+    // --bench-jobs measures job system scheduling overhead and parallelFor scaling
+    // --bench-codec measures mesh codec compression and decode throughput, scalar and SIMD
+    // --bench-normals times smooth normal generation on a 4 million triangle mesh, scalar and SIMD
+    std::string tracePath{};
+    bool benchDispatch = false;
+    bool gpuCulling = false;
+    bool benchCulling = false;
+    bool benchQueue = false;
+    bool benchTransforms = false;
+    bool benchEcs = false;
+    bool benchJobs = false;
+    bool benchCodec = false;
+    bool benchNormals = false;
+    uint32_t instanceCount = lve::FirstApp::DEFAULT_INSTANCE_COUNT;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg{argv[i]};
+        if (arg == "--trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if (arg == "--bench-dispatch")
+        {
+            benchDispatch = true;
+        }
+        else if (arg == "--bench-culling")
+        {
+            benchCulling = true;
+        }
+        else if (arg == "--bench-queue")
+        {
+            benchQueue = true;
+        }
+        else if (arg == "--bench-transforms")
+        {
+            benchTransforms = true;
+        }
+        else if (arg == "--bench-ecs")
+        {
+            benchEcs = true;
+        }
+        else if (arg == "--bench-jobs")
+        {
+            benchJobs = true;
+        }
+        else if (arg == "--bench-codec")
+        {
+            benchCodec = true;
+        }
+        else if (arg == "--bench-normals")
+        {
+            benchNormals = true;
+        }
+        else if (arg == "--gpu-culling")
+        {
+            gpuCulling = true;
+        }
+        else if (arg == "--instances" && i + 1 < argc)
+        {
+            instanceCount = static_cast<uint32_t>(std::max(1ul, std::strtoul(argv[++i], nullptr, 10)));
+        }
+    }
+    if (!tracePath.empty())
+    {
+        lve::LveTrace::setEnabled(true);
+        lve::LveTrace::setThreadName("Main thread");
+    }
+
+    lve::FirstApp app{instanceCount};
     try
     {
+        if (gpuCulling)
+        {
+            app.setGpuCulling(true);
+        }
+        if (benchCulling)
+        {
+            lve::LveFrustumCulling::benchmark(1000000);
+        }
+        if (benchQueue)
+        {
+            lve::LveRenderQueue::benchmark(1000000);
+        }
+        if (benchTransforms)
+        {
+            lve::LveTransformHierarchy::benchmark(100000);
+        }
+        if (benchEcs)
+        {
+            lve::LveEcs::benchmark(1000000);
+        }
+        if (benchJobs)
+        {
+            lve::LveJobSystem::benchmark(100000);
+        }
+        if (benchCodec)
+        {
+            lve::LveMeshCodec::benchmark(1000000);
+        }
+        if (benchNormals)
+        {
+            lve::LveMeshNormals::benchmark(4000000);
+        }
+        if (benchDispatch)
+        {
+            app.benchmarkDispatch(1000000);
+        }
         app.run();
     }
     catch (std::exception &e)
@@ -14,5 +134,11 @@ int main()
         return EXIT_FAILURE;
     }
 
+    if (!tracePath.empty())
+    {
+        lve::LveTrace::writeChromeTrace(tracePath);
+        spdlog::info("Trace written to {}", tracePath);
+    }
+
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -1,20 +1,21 @@
 #version 450
 
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec4 inPositionScale;
+layout (location = 3) in vec4 inRotation;
 layout (location = 0) out vec3 color;
 
-vec2 positions[3] = vec2[] (
-    vec2(0.0, -0.5),
-    vec2(-0.5, 0.5),
-    vec2(0.5, 0.5)
-);
+layout (push_constant) uniform Camera {
+    mat4 viewProjection;
+} camera;
 
-vec3 colors[3] = vec3[] (
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    color = colors[gl_VertexIndex];
-}
\ No newline at end of file
+    vec3 worldPosition = rotate(inRotation, inPosition * inPositionScale.w) + inPositionScale.xyz;
+    gl_Position = camera.viewProjection * vec4(worldPosition, 1.0);
+    color = inColor;
+}
@@ -0,0 +1,719 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <glm/glm.hpp>
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+#include <spdlog/spdlog.h>
+#include <lve_archive.hpp>
+#include <lve_cooked_mesh.hpp>
+#include <lve_gltf.hpp>
+#include <lve_job_system.hpp>
+#include <lve_mapped_file.hpp>
+#include <lve_mesh_normals.hpp>
+#include <lve_mesh_optimizer.hpp>
+
+namespace fs = std::filesystem;
+
+// Converts a tree of source assets into their runtime formats.
+// Meshes (.obj, .glb) become .lvemesh files. They are compressed unless --raw asks for the upload layout.
+// OBJ files without normals get generated ones, split at edges sharper than --crease degrees.
+// GLSL shaders are compiled to SPIR-V under the names the samples load, prebuilt .spv files are validated and copied.
+// Every input is keyed by a hash of its bytes and the cooker settings.
+// Inputs whose key matches the previous manifest and whose output still exists are skipped.
+// All outputs are also packed into one archive the runtime maps instead of opening them one by one.
+class AssetCooker
+{
+public:
+    AssetCooker(fs::path source_dir, fs::path output_dir, bool force, bool raw, float crease_angle, uint32_t job_count,
+                std::vector<std::string> required)
+        : source_dir{std::move(source_dir)}, output_dir{std::move(output_dir)}, force{force}, raw{raw},
+          crease_angle{crease_angle}, job_count{job_count}, required{std::move(required)}
+    {
+    }
+
+    // Returns false if any asset failed to cook
+    bool run()
+    {
+        auto start = std::chrono::steady_clock::now();
+        collectInputs();
+        loadManifest();
+        fs::create_directories(output_dir);
+
+        // One asset per job, large meshes and shader compiles dominate so no batching
+        if (job_count != 1)
+        {
+            jobs = std::make_unique<lve::LveJobSystem>(job_count == 0 ? 0 : job_count - 1);
+            jobs->parallelFor(static_cast<uint32_t>(assets.size()), 1, [this](uint32_t begin, uint32_t end)
+                              {
+                                  for (uint32_t i = begin; i < end; i++)
+                                  {
+                                      cookAsset(assets[i]);
+                                  }
+                              });
+        }
+        else
+        {
+            for (Asset &asset : assets)
+            {
+                cookAsset(asset);
+            }
+        }
+
+        bool removed = removeStaleOutputs();
+        writeManifest();
+
+        uint32_t cooked = 0, skipped = 0, failed = 0;
+        uint64_t cooked_bytes = 0;
+        for (const Asset &asset : assets)
+        {
+            switch (asset.status)
+            {
+            case Status::Cooked:
+                cooked++;
+                cooked_bytes += asset.input_bytes;
+                break;
+            case Status::Skipped:
+                skipped++;
+                break;
+            case Status::Failed:
+                failed++;
+                spdlog::error("{}: {}", asset.input, asset.error);
+                break;
+            }
+        }
+
+        // The archive is repacked whole, copying cooked outputs is cheap next to cooking them
+        if (cooked > 0 || removed || !fs::exists(output_dir / lve::LveArchive::DEFAULT_PATH))
+        {
+            writeArchive();
+        }
+
+        // Names the runtime asks for, a mismatch would otherwise only show when a sample starts
+        bool missing = false;
+        if (!required.empty())
+        {
+            lve::LveArchive archive{(output_dir / lve::LveArchive::DEFAULT_PATH).string()};
+            for (const std::string &name : required)
+            {
+                if (!archive.find(name))
+                {
+                    spdlog::error("{} is not in the archive", name);
+                    missing = true;
+                }
+            }
+        }
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info("vp_cook: {} assets, {} cooked ({:.1f} MB), {} up to date, {} failed in {:.2f} s on {} threads",
+                     assets.size(), cooked, static_cast<double>(cooked_bytes) / 1e6, skipped, failed, elapsed,
+                     jobs ? jobs->getThreadCount() : 1);
+        return failed == 0 && !missing;
+    }
+
+private:
+    // Bump when an output format or processing step changes, so every asset is cooked again
+    static constexpr uint32_t COOK_VERSION = 4;
+    // Simplification stops once a level would drop below this
+    static constexpr uint32_t MIN_LOD_TRIANGLES = 64;
+    // A level is only kept if it removes at least a quarter of the previous level's triangles
+    static constexpr float MAX_LOD_RATIO = 0.75f;
+
+    enum class Kind
+    {
+        Mesh,
+        Glsl,
+        Spirv,
+    };
+    enum class Status
+    {
+        Cooked,
+        Skipped,
+        Failed,
+    };
+    struct Asset
+    {
+        Kind kind;
+        // Generic paths relative to the source and output directories
+        std::string input;
+        std::string output;
+        uint64_t hash;
+        uint64_t input_bytes;
+        Status status;
+        std::string error;
+    };
+    struct ManifestEntry
+    {
+        uint64_t hash;
+        std::string output;
+    };
+
+    fs::path source_dir;
+    fs::path output_dir;
+    bool force;
+    bool raw;
+    // Radians, NO_CREASE smooths generated normals everywhere
+    float crease_angle;
+    uint32_t job_count;
+    // Archive entries that must exist after cooking
+    std::vector<std::string> required;
+    std::vector<Asset> assets{};
+    std::unordered_map<std::string, ManifestEntry> previous_manifest{};
+    std::string glslc{"glslc"};
+    // Also splits normal generation of large meshes, none with --jobs 1
+    std::unique_ptr<lve::LveJobSystem> jobs{};
+
+    static uint64_t mix(uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= 0xBF58476D1CE4E5B9ull;
+        value ^= value >> 27;
+        value *= 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+    // Not cryptographic, only tells changed inputs apart. Eight bytes per step so hashing stays
+    // well below the cost of reading the file.
+    static uint64_t hashBytes(const std::byte *data, size_t size, uint64_t seed)
+    {
+        uint64_t hash = mix(seed ^ size);
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = std::rotl(hash ^ (word * 0x9E3779B97F4A7C15ull), 29) * 0xC2B2AE3D27D4EB4Full;
+        }
+        uint64_t tail = 0;
+        if (i < size)
+        {
+            std::memcpy(&tail, data + i, size - i);
+        }
+        return mix(hash ^ tail);
+    }
+    static uint64_t hashString(const std::string &text, uint64_t seed)
+    {
+        return hashBytes(reinterpret_cast<const std::byte *>(text.data()), text.size(), seed);
+    }
+
+    // Named like the samples load them: shaders/shader.vert becomes shaders/vert.spv, depth.vert
+    // depth_vert.spv and simple_shader.vert simple_vert.spv
+    static std::string spirvName(const fs::path &relative)
+    {
+        std::string stem = relative.stem().string();
+        if (stem == "shader")
+        {
+            stem.clear();
+        }
+        else if (stem.ends_with("_shader"))
+        {
+            stem.resize(stem.rfind('_'));
+        }
+        std::string name = relative.extension().string().substr(1) + ".spv";
+        if (!stem.empty())
+        {
+            name = stem + "_" + name;
+        }
+        return (relative.parent_path() / name).generic_string();
+    }
+
+    void collectInputs()
+    {
+        if (!fs::is_directory(source_dir))
+        {
+            throw std::runtime_error("vp_cook: Not a directory: " + source_dir.string());
+        }
+        if (const char *path = std::getenv("VP_COOK_GLSLC"))
+        {
+            glslc = path;
+        }
+
+        // An output directory inside the source tree is not cooked again
+        fs::path cooked_dir = fs::weakly_canonical(output_dir);
+        for (auto entry = fs::recursive_directory_iterator(source_dir); entry != fs::recursive_directory_iterator(); ++entry)
+        {
+            if (entry->is_directory() && fs::weakly_canonical(entry->path()) == cooked_dir)
+            {
+                entry.disable_recursion_pending();
+                continue;
+            }
+            if (!entry->is_regular_file())
+            {
+                continue;
+            }
+            fs::path relative = entry->path().lexically_relative(source_dir);
+            std::string extension = relative.extension().string();
+            Asset asset{};
+            if (extension == ".obj" || extension == ".glb")
+            {
+                asset.kind = Kind::Mesh;
+                asset.output = fs::path(relative).replace_extension(".lvemesh").generic_string();
+            }
+            else if (extension == ".vert" || extension == ".frag" || extension == ".comp")
+            {
+                asset.kind = Kind::Glsl;
+                asset.output = spirvName(relative);
+            }
+            else if (extension == ".spv")
+            {
+                asset.kind = Kind::Spirv;
+                asset.output = relative.generic_string();
+            }
+            else
+            {
+                continue;
+            }
+            asset.input = relative.generic_string();
+            assets.push_back(std::move(asset));
+        }
+        // Sorted so logs and the manifest come out the same on every run
+        std::sort(assets.begin(), assets.end(), [](const Asset &a, const Asset &b)
+                  { return a.input < b.input; });
+
+        // A prebuilt .spv next to the GLSL source it was compiled from is likely stale, the source wins
+        std::unordered_set<std::string> compiled{};
+        for (const Asset &asset : assets)
+        {
+            if (asset.kind == Kind::Glsl)
+            {
+                compiled.insert(asset.output);
+            }
+        }
+        std::erase_if(assets, [&](const Asset &asset)
+                      {
+                          bool shadowed = asset.kind == Kind::Spirv && compiled.contains(asset.output);
+                          if (shadowed)
+                          {
+                              spdlog::info("Ignored {}, it is compiled from source instead", asset.input);
+                          }
+                          return shadowed; });
+
+        // Two sources cooking to one output, e.g. Teapot.obj next to Teapot.glb, fail the later one
+        std::unordered_set<std::string> outputs{};
+        for (Asset &asset : assets)
+        {
+            if (!outputs.insert(asset.output).second)
+            {
+                asset.status = Status::Failed;
+                asset.error = "Output " + asset.output + " is already produced by another input";
+            }
+        }
+    }
+
+    void loadManifest()
+    {
+        std::ifstream file{output_dir / "manifest.txt"};
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // hash, input and output separated by tabs
+            size_t first = line.find('\t');
+            size_t second = first == std::string::npos ? std::string::npos : line.find('\t', first + 1);
+            if (line.empty() || line[0] == '#' || second == std::string::npos)
+            {
+                continue;
+            }
+            ManifestEntry entry{std::strtoull(line.substr(0, first).c_str(), nullptr, 16), line.substr(second + 1)};
+            previous_manifest[line.substr(first + 1, second - first - 1)] = std::move(entry);
+        }
+    }
+
+    void writeManifest()
+    {
+        // Failed assets are left out, so the next run tries them again
+        fs::path path = output_dir / "manifest.txt";
+        fs::path temp_path = output_dir / "manifest.txt.tmp";
+        {
+            std::ofstream file{temp_path, std::ios::trunc};
+            file << "# vp_cook " << COOK_VERSION << ": hash, input, output\n";
+            for (const Asset &asset : assets)
+            {
+                if (asset.status != Status::Failed)
+                {
+                    char hash[17];
+                    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(asset.hash));
+                    file << hash << '\t' << asset.input << '\t' << asset.output << '\n';
+                }
+            }
+            if (!file)
+            {
+                throw std::runtime_error("vp_cook: Failed to write " + temp_path.string());
+            }
+        }
+        fs::rename(temp_path, path);
+    }
+
+    void writeArchive()
+    {
+        // Entries are named like the loose outputs, so runtime paths resolve either way
+        std::vector<lve::LveArchive::Source> sources{};
+        for (const Asset &asset : assets)
+        {
+            if (asset.status != Status::Failed)
+            {
+                sources.push_back({asset.output, (output_dir / asset.output).string()});
+            }
+        }
+        fs::path path = output_dir / lve::LveArchive::DEFAULT_PATH;
+        lve::LveArchive::write(path.string(), sources);
+        spdlog::info("Packed {} assets into {} ({} bytes)", sources.size(), path.string(), fs::file_size(path));
+    }
+
+    // Returns true if an output was removed
+    bool removeStaleOutputs()
+    {
+        bool removed = false;
+        // Only outputs the previous manifest recorded are removed, never unrelated files
+        std::unordered_set<std::string> outputs{};
+        for (const Asset &asset : assets)
+        {
+            outputs.insert(asset.output);
+        }
+        for (const auto &[input, entry] : previous_manifest)
+        {
+            if (!outputs.contains(entry.output))
+            {
+                std::error_code error{};
+                if (fs::remove(output_dir / entry.output, error))
+                {
+                    spdlog::info("Removed {}, its source {} is gone", entry.output, input);
+                    removed = true;
+                }
+            }
+        }
+        return removed;
+    }
+
+    void cookAsset(Asset &asset)
+    {
+        if (asset.status == Status::Failed)
+        {
+            return;
+        }
+        try
+        {
+            auto start = std::chrono::steady_clock::now();
+            fs::path input_path = source_dir / asset.input;
+            fs::path output_path = output_dir / asset.output;
+
+            // The key covers what the output depends on besides the bytes: the cooker version,
+            // the kind of processing and, for GLSL, the compiler and for meshes, the encoding and crease angle
+            lve::LveMappedFile input{input_path.string()};
+            uint64_t seed = mix(COOK_VERSION * 0x100000001B3ull + static_cast<uint64_t>(asset.kind));
+            if (asset.kind == Kind::Glsl)
+            {
+                seed = hashString(glslc, seed);
+            }
+            if (asset.kind == Kind::Mesh)
+            {
+                seed = mix(seed + (raw ? 1 : 0));
+                seed = mix(seed + std::bit_cast<uint32_t>(crease_angle));
+            }
+            asset.hash = hashBytes(input.getData(), input.getSize(), seed);
+            asset.input_bytes = input.getSize();
+
+            auto previous = previous_manifest.find(asset.input);
+            if (!force && previous != previous_manifest.end() && previous->second.hash == asset.hash &&
+                previous->second.output == asset.output && fs::exists(output_path))
+            {
+                asset.status = Status::Skipped;
+                return;
+            }
+
+            fs::create_directories(output_path.parent_path());
+            switch (asset.kind)
+            {
+            case Kind::Mesh:
+                cookMesh(input_path, output_path, !raw, crease_angle, jobs.get());
+                break;
+            case Kind::Glsl:
+                compileGlsl(input_path, output_path);
+                break;
+            case Kind::Spirv:
+                copySpirv(input, output_path);
+                break;
+            }
+            asset.status = Status::Cooked;
+
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            spdlog::info("Cooked {} -> {} in {:.1f} ms", asset.input, asset.output, elapsed * 1e3);
+        }
+        catch (const std::exception &e)
+        {
+            asset.status = Status::Failed;
+            asset.error = e.what();
+        }
+    }
+
+    static void readObj(const fs::path &path, std::vector<lve::LveMeshOptimizer::Vertex> &vertices,
+                        std::vector<uint32_t> &indices, float crease_angle, lve::LveJobSystem *jobs)
+    {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.string().c_str());
+        if (!ret || !err.empty())
+        {
+            throw std::runtime_error("tinyobjloader: " + (err.empty() ? std::string("Failed to load model") : err));
+        }
+
+        // Generated normals are indexed per corner in the order of the shapes
+        std::vector<glm::vec3> generated_normals{};
+        std::vector<uint32_t> normal_indices{};
+        if (attrib.normals.empty())
+        {
+            std::vector<uint32_t> position_indices{};
+            for (const tinyobj::shape_t &shape : shapes)
+            {
+                for (const tinyobj::index_t &idx : shape.mesh.indices)
+                {
+                    position_indices.push_back(static_cast<uint32_t>(idx.vertex_index));
+                }
+            }
+            lve::LveMeshNormals::generate(attrib.vertices, position_indices, crease_angle, generated_normals, normal_indices, jobs);
+        }
+
+        // One vertex per corner, welding merges the shared ones
+        for (const tinyobj::shape_t &shape : shapes)
+        {
+            for (const tinyobj::index_t &idx : shape.mesh.indices)
+            {
+                lve::LveMeshOptimizer::Vertex vertex{};
+                vertex.position = glm::vec3(attrib.vertices[3 * size_t(idx.vertex_index) + 0],
+                                            attrib.vertices[3 * size_t(idx.vertex_index) + 1],
+                                            attrib.vertices[3 * size_t(idx.vertex_index) + 2]);
+                if (!normal_indices.empty())
+                {
+                    vertex.normal = generated_normals[normal_indices[vertices.size()]];
+                }
+                else if (idx.normal_index >= 0)
+                {
+                    vertex.normal = glm::vec3(attrib.normals[3 * size_t(idx.normal_index) + 0],
+                                              attrib.normals[3 * size_t(idx.normal_index) + 1],
+                                              attrib.normals[3 * size_t(idx.normal_index) + 2]);
+                }
+                indices.push_back(static_cast<uint32_t>(vertices.size()));
+                vertices.push_back(vertex);
+            }
+        }
+    }
+
+    static void readGltf(const fs::path &path, std::vector<lve::LveMeshOptimizer::Vertex> &vertices,
+                         std::vector<uint32_t> &indices)
+    {
+        lve::LveGltf gltf{path.string()};
+        for (const lve::LveGltf::Primitive &primitive : gltf.getPrimitives())
+        {
+            const lve::LveGltf::Accessor &position = gltf.getAccessor(primitive.position);
+            uint32_t base_vertex = static_cast<uint32_t>(vertices.size());
+            vertices.resize(vertices.size() + position.count);
+            lve::LveGltf::copyVec3(position, &vertices[base_vertex].position, sizeof(lve::LveMeshOptimizer::Vertex));
+            if (primitive.normal != lve::LveGltf::NO_ACCESSOR)
+            {
+                lve::LveGltf::copyVec3(gltf.getAccessor(primitive.normal), &vertices[base_vertex].normal,
+                                       sizeof(lve::LveMeshOptimizer::Vertex));
+            }
+
+            if (primitive.indices == lve::LveGltf::NO_ACCESSOR)
+            {
+                for (uint32_t v = 0; v < position.count; v++)
+                {
+                    indices.push_back(base_vertex + v);
+                }
+            }
+            else
+            {
+                const lve::LveGltf::Accessor &primitive_indices = gltf.getAccessor(primitive.indices);
+                size_t first_index = indices.size();
+                indices.resize(first_index + primitive_indices.count);
+                lve::LveGltf::copyIndices(primitive_indices, indices.data() + first_index, base_vertex);
+            }
+        }
+    }
+
+    static void cookMesh(const fs::path &input_path, const fs::path &output_path, bool encode, float crease_angle,
+                         lve::LveJobSystem *jobs)
+    {
+        std::vector<lve::LveMeshOptimizer::Vertex> vertices{};
+        std::vector<uint32_t> indices{};
+        if (input_path.extension() == ".glb")
+        {
+            readGltf(input_path, vertices, indices);
+        }
+        else
+        {
+            readObj(input_path, vertices, indices, crease_angle, jobs);
+        }
+        if (indices.empty())
+        {
+            throw std::runtime_error("Mesh has no triangles");
+        }
+
+        float position_step = lve::LveMeshOptimizer::quantizeAndWeld(vertices, indices);
+        lve::LveMeshOptimizer::optimizeVertexCache(indices, static_cast<uint32_t>(vertices.size()));
+
+        // Each level halves the triangles of the one before. The grid resolution that gets there
+        // is found by bisection below the previous level's, every level simplifies the full mesh.
+        std::vector<std::vector<uint32_t>> levels{indices};
+        std::vector<float> errors{0.0f};
+        float extent = position_step * static_cast<float>((1u << lve::LveMeshOptimizer::POSITION_BITS) - 1);
+        uint32_t max_grid = 1024;
+        while (levels.size() < lve::LveCookedMesh::MAX_LODS && levels.back().size() / 3 >= 2 * MIN_LOD_TRIANGLES)
+        {
+            size_t target = levels.back().size() / 6 * 3;
+            std::vector<uint32_t> best{};
+            uint32_t best_grid = 0;
+            for (uint32_t lo = 1, hi = max_grid; lo <= hi;)
+            {
+                uint32_t grid = lo + (hi - lo) / 2;
+                std::vector<uint32_t> simplified = lve::LveMeshOptimizer::simplifyClusters(vertices, indices, grid);
+                if (simplified.size() <= target)
+                {
+                    best = std::move(simplified);
+                    best_grid = grid;
+                    lo = grid + 1;
+                }
+                else
+                {
+                    hi = grid - 1;
+                }
+            }
+            if (best.size() / 3 < MIN_LOD_TRIANGLES || best.size() > levels.back().size() * MAX_LOD_RATIO)
+            {
+                break;
+            }
+            lve::LveMeshOptimizer::optimizeVertexCache(best, static_cast<uint32_t>(vertices.size()));
+            levels.push_back(std::move(best));
+            errors.push_back(extent / static_cast<float>(best_grid));
+            max_grid = best_grid - 1;
+        }
+
+        // Levels back to back with the coarsest first, so after the fetch reorder every level
+        // references a prefix of the vertices and a mesh can be streamed coarse to fine
+        std::vector<uint32_t> all_indices{};
+        std::vector<lve::LveCookedMesh::Lod> lods(levels.size());
+        for (size_t l = levels.size(); l-- > 0;)
+        {
+            lods[l] = {.firstIndex = static_cast<uint32_t>(all_indices.size()),
+                       .indexCount = static_cast<uint32_t>(levels[l].size()),
+                       .error = errors[l]};
+            all_indices.insert(all_indices.end(), levels[l].begin(), levels[l].end());
+        }
+        lve::LveMeshOptimizer::optimizeVertexFetch(vertices, all_indices);
+
+        lve::LveCookedMesh::write(output_path.string(), vertices, all_indices, lods, position_step, encode);
+        size_t raw_bytes = vertices.size() * (sizeof(lve::LveCookedMesh::Vertex) + sizeof(glm::vec3)) +
+                           all_indices.size() * sizeof(uint32_t);
+        spdlog::info("{}: {} vertices, {} triangles, {} levels down to {} triangles, {:.1f}x smaller than raw",
+                     input_path.filename().string(), vertices.size(), lods[0].indexCount / 3, lods.size(),
+                     lods.back().indexCount / 3, static_cast<double>(raw_bytes) / static_cast<double>(fs::file_size(output_path)));
+    }
+
+    void compileGlsl(const fs::path &input_path, const fs::path &output_path) const
+    {
+        fs::path temp_path = output_path.string() + ".tmp";
+        std::string command = "\"" + glslc + "\" -O \"" + input_path.string() + "\" -o \"" + temp_path.string() + "\"";
+#ifdef _WIN32
+        // cmd.exe strips the outer quotes of the whole line
+        command = "\"" + command + "\"";
+#endif
+        if (std::system(command.c_str()) != 0)
+        {
+            std::error_code error{};
+            fs::remove(temp_path, error);
+            throw std::runtime_error("glslc failed, set VP_COOK_GLSLC to the compiler if it is not on PATH");
+        }
+        fs::rename(temp_path, output_path);
+    }
+
+    static void copySpirv(const lve::LveMappedFile &input, const fs::path &output_path)
+    {
+        const uint32_t SPIRV_MAGIC = 0x07230203;
+        uint32_t magic = 0;
+        if (input.getSize() >= sizeof(magic))
+        {
+            std::memcpy(&magic, input.getData(), sizeof(magic));
+        }
+        if (input.getSize() % 4 != 0 || magic != SPIRV_MAGIC)
+        {
+            throw std::runtime_error("Not a SPIR-V module");
+        }
+
+        fs::path temp_path = output_path.string() + ".tmp";
+        {
+            std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+            file.write(reinterpret_cast<const char *>(input.getData()), input.getSize());
+            if (!file)
+            {
+                throw std::runtime_error("Failed to write " + temp_path.string());
+            }
+        }
+        fs::rename(temp_path, output_path);
+    }
+};
+
+int main(int argc, char **argv)
+{
+    bool force = false;
+    bool raw = false;
+    float crease_angle = lve::LveMeshNormals::NO_CREASE;
+    uint32_t job_count = 0;
+    std::vector<std::string> required{};
+    std::vector<std::string> paths{};
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--force")
+        {
+            force = true;
+        }
+        else if (arg == "--raw")
+        {
+            raw = true;
+        }
+        else if (arg == "--crease" && i + 1 < argc)
+        {
+            crease_angle = glm::radians(std::strtof(argv[++i], nullptr));
+        }
+        else if (arg == "--jobs" && i + 1 < argc)
+        {
+            job_count = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--require" && i + 1 < argc)
+        {
+            required.push_back(argv[++i]);
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2)
+    {
+        spdlog::error("Usage: vp_cook [--force] [--raw] [--crease degrees] [--jobs N] [--require name]... <source dir> <output dir>");
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        AssetCooker cooker{paths[0], paths[1], force, raw, crease_angle, job_count, std::move(required)};
+        return cooker.run() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception &e)
+    {
+        spdlog::error(e.what());
+
+        return EXIT_FAILURE;
+    }
+}